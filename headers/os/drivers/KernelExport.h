@@ -90,6 +90,7 @@ struct timer {
 	uint16		cpu;
 	timer_hook	hook;
 	bigtime_t	period;
+	struct timer **prev_link;	/* private */
 };
 
 #define B_ONE_SHOT_ABSOLUTE_TIMER	1
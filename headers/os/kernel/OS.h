@@ -639,6 +639,39 @@ extern ssize_t		wait_for_objects(object_wait_info* infos, int numInfos);
 extern ssize_t		wait_for_objects_etc(object_wait_info* infos, int numInfos,
 						uint32 flags, bigtime_t timeout);
 
+/* event queue behavior flags, ORed into event_wait_info::events */
+enum {
+	B_EVENT_LEVEL_TRIGGERED		= 0x10000,	/* report the events for as long
+											   as they persist, instead of
+											   once when they occur */
+	B_EVENT_ONE_SHOT			= 0x20000	/* deselect the object once its
+											   events have been reported */
+};
+
+typedef struct event_wait_info {
+	int32		object;						/* ID of the object */
+	uint16		type;						/* type of the object */
+	int32		events;						/* events mask and behavior */
+	void*		user_data;					/* returned with the events */
+} event_wait_info;
+
+/* An event queue is a file descriptor that keeps a set of objects selected
+   until they are removed from it, so that waiting doesn't have to select all
+   of them again like wait_for_objects() does. event_queue_select() adds the
+   objects, or changes their events, if the events field is > 0, removes them,
+   if it is 0, and returns their current events and user data, if it is < 0.
+   The infos of objects that could not be selected get B_EVENT_INVALID.
+   At most 1024 infos can be passed to event_queue_select() at once.
+   event_queue_wait() waits until at least one of the selected events
+   occurred, and returns up to numInfos infos with the events that occurred.
+   Objects that have become invalid are removed from the queue. */
+
+extern int			event_queue_create(int openFlags);
+extern status_t		event_queue_select(int queue, event_wait_info* infos,
+						int numInfos);
+extern ssize_t		event_queue_wait(int queue, event_wait_info* infos,
+						int numInfos, uint32 flags, bigtime_t timeout);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,24 @@
+/*
+ * Copyright 2026 Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SYS_SENDFILE_H
+#define _SYS_SENDFILE_H
+
+
+#include <sys/types.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+ssize_t sendfile(int outFD, int inFD, off_t *offset, size_t count);
+ssize_t splice(int inFD, off_t *inOffset, int outFD, off_t *outOffset,
+	size_t length, unsigned int flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SYS_SENDFILE_H */
@@ -331,6 +331,8 @@ typedef struct arch_cpu_info {
 	uint32				logical_apic_id;
 
 	struct X86PagingStructures* active_paging_structures;
+	int32				lazy_paging_state;
+		// X86_LAZY_PAGING_* flags, see X86PagingStructures.h
 
 	size_t				dr6;	// temporary storage for debug registers (cf.
 	size_t				dr7;	// x86_exit_user_debug_at_kernel_entry())
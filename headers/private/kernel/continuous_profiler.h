@@ -0,0 +1,25 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _KERNEL_CONTINUOUS_PROFILER_H
+#define _KERNEL_CONTINUOUS_PROFILER_H
+
+#include <sys/cdefs.h>
+
+#include <OS.h>
+
+
+struct continuous_profiler_parameters;
+
+
+__BEGIN_DECLS
+
+status_t _user_continuous_profiler_start(
+			struct continuous_profiler_parameters* parameters);
+status_t _user_continuous_profiler_stop();
+
+__END_DECLS
+
+
+#endif	/* _KERNEL_CONTINUOUS_PROFILER_H */
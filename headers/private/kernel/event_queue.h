@@ -0,0 +1,27 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _KERNEL_EVENT_QUEUE_H
+#define _KERNEL_EVENT_QUEUE_H
+
+
+#include <OS.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int			_user_event_queue_create(int openFlags);
+status_t	_user_event_queue_select(int queue, event_wait_info* userInfos,
+				int numInfos);
+ssize_t		_user_event_queue_wait(int queue, event_wait_info* userInfos,
+				int numInfos, uint32 flags, bigtime_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif	/* _KERNEL_EVENT_QUEUE_H */
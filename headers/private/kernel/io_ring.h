@@ -0,0 +1,28 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _KERNEL_IO_RING_H
+#define _KERNEL_IO_RING_H
+
+
+#include <OS.h>
+
+
+struct io_ring_parameters;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int			_user_io_ring_create(struct io_ring_parameters* parameters);
+ssize_t		_user_io_ring_enter(int ring, uint32 toSubmit, uint32 minComplete,
+				uint32 flags, bigtime_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif	/* _KERNEL_IO_RING_H */
@@ -8,6 +8,7 @@
 
 #include <thread.h>
 #include <iovec.h>
+#include <port_defs.h>
 
 struct kernel_args;
 struct select_info;
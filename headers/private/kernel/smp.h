@@ -40,6 +40,17 @@ enum {
 
 typedef void (*smp_call_func)(addr_t data1, int32 currentCPU, addr_t data2, addr_t data3);
 
+// per-CPU ICI statistics
+struct smp_ici_stats {
+	uint64		sent;					// messages sent by the CPU
+	uint64		sent_tlb;				// ... of them TLB invalidations
+	uint64		received;				// messages processed by the CPU
+	uint64		received_tlb;			// ... of them TLB invalidations
+	uint64		sync_waits;				// synchronous messages waited for
+	bigtime_t	sync_wait_time;			// total time spent waiting for them
+	bigtime_t	max_sync_wait_time;
+};
+
 class CPUSet {
 public:
 	inline				CPUSet();
@@ -85,6 +96,8 @@ void smp_send_broadcast_ici(int32 message, addr_t data, addr_t data2, addr_t dat
 void smp_send_broadcast_ici_interrupts_disabled(int32 currentCPU, int32 message,
 		addr_t data, addr_t data2, addr_t data3, void *data_ptr, uint32 flags);
 
+void smp_get_ici_stats(int32 cpu, struct smp_ici_stats* stats);
+
 int32 smp_get_num_cpus(void);
 void smp_set_num_cpus(int32 numCPUs);
 int32 smp_get_current_cpu(void);
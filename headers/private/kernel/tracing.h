@@ -13,6 +13,8 @@
 #include <stdarg.h>
 #include <stdio.h>
 
+#include <boot/kernel_args.h>
+
 #include "tracing_config.h"
 
 
@@ -85,14 +87,16 @@ class TraceEntry {
 
 		void* operator new(size_t size, const std::nothrow_t&) throw();
 
+		// The object is preceded by its trace_entry and the time it was
+		// allocated at, which orders the entries of the per-CPU buffers.
 		trace_entry* ToTraceEntry() const
 		{
-			return (trace_entry*)this - 1;
+			return (trace_entry*)((bigtime_t*)this - 1) - 1;
 		}
 
 		static TraceEntry* FromTraceEntry(trace_entry* entry)
 		{
-			return (TraceEntry*)(entry + 1);
+			return (TraceEntry*)((bigtime_t*)(entry + 1) + 1);
 		}
 };
 
@@ -214,12 +218,16 @@ public:
 };
 
 
+/*!	Iterates through the entries of all per-CPU tracing buffers, merged by
+	allocation time.
+*/
 class TraceEntryIterator {
 public:
 	TraceEntryIterator()
 		:
  		fEntry(NULL),
-		fIndex(0)
+		fIndex(0),
+		fEntryBuffer(-1)
 	{
 	}
 
@@ -244,12 +252,18 @@ public:
 	TraceEntry* MoveTo(int32 index);
 
 private:
-	trace_entry* _NextNonBufferEntry(trace_entry* entry);
-	trace_entry* _PreviousNonBufferEntry(trace_entry* entry);
+	void _SetToEnd();
+
+	trace_entry* _NextNonBufferEntry(int32 buffer, trace_entry* entry);
+	trace_entry* _PreviousNonBufferEntry(int32 buffer, trace_entry* entry);
 
 private:
 	trace_entry*	fEntry;
 	int32			fIndex;
+	int32			fEntryBuffer;
+	trace_entry*	fNext[SMP_MAX_CPUS];
+		// per buffer the next entry in forward direction, NULL when all of
+		// the buffer's entries have been passed
 };
 
 
@@ -289,9 +303,10 @@ void tracing_print_stack_trace(struct tracing_stack_trace* stackTrace);
 
 void lock_tracing_buffer();
 void unlock_tracing_buffer();
-status_t tracing_init(void);
+status_t tracing_init(struct kernel_args* args);
 
 void _user_ktrace_output(const char *message);
+ssize_t _user_ktrace_read(char* buffer, size_t size, bool fromStart);
 
 #ifdef __cplusplus
 }
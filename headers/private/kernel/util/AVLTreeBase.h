@@ -39,6 +39,7 @@ public:
 	inline	int					Count() const	{ return fNodeCount; }
 	inline	bool				IsEmpty() const	{ return (fNodeCount == 0); }
 			void				MakeEmpty();
+			void				Swap(AVLTreeBase& other);
 
 	inline	AVLTreeNode*		Root() const	{ return fRoot; }
 
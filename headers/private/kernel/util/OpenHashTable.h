@@ -84,7 +84,8 @@ template<typename Definition, bool AutoExpand = true,
 	bool CheckDuplicates = false, typename Allocator = MallocAllocator>
 class BOpenHashTable {
 public:
-	typedef BOpenHashTable<Definition, AutoExpand, CheckDuplicates> HashTable;
+	typedef BOpenHashTable<Definition, AutoExpand, CheckDuplicates, Allocator>
+		HashTable;
 	typedef typename Definition::KeyType	KeyType;
 	typedef typename Definition::ValueType	ValueType;
 
@@ -0,0 +1,390 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef KERNEL_UTIL_TIMER_WHEEL_H
+#define KERNEL_UTIL_TIMER_WHEEL_H
+
+
+#include <SupportDefs.h>
+
+
+/*!	A hierarchical timing wheel.
+
+	Time is divided into ticks of 2^kTickShift microseconds. Each level of the
+	wheel has kSlotCount slots; a slot of level n covers kSlotCount^n ticks.
+	A timer is put into the level of the highest digit in which its tick
+	differs from the current one, so that adding it is O(1).
+	When the current tick reaches a slot, its timers are moved down to the
+	next lower level, until they end up in the due list, which is sorted by
+	schedule time and only contains timers of the current tick or earlier.
+	Timers that are too far in the future are kept in the first slot of the
+	top level, and are sorted in again whenever the top level wraps around.
+
+	The wheel can be zero-initialized. It does not do any locking. The Timer
+	type needs to have the following members:
+		Timer*	next;
+		Timer**	prev_link;
+		int64	schedule_time;
+	The lists are doubly linked: \c prev_link points to the link that points
+	to the timer, so that removing it is O(1), too. It is \c NULL while the
+	timer is not in the wheel; a timer must therefore be zero-initialized
+	before it is first passed to Remove(). The schedule time of a timer must
+	not be changed while it is in the wheel.
+*/
+template<typename Timer>
+class TimerWheel {
+public:
+	enum {
+		kTickShift	= 10,
+		kSlotShift	= 6,
+		kSlotCount	= 1 << kSlotShift,
+		kLevelCount	= 5
+	};
+
+public:
+			void				Init(bigtime_t now);
+
+			void				Add(Timer* timer);
+			bool				Remove(Timer* timer);
+
+			Timer*				RemoveExpired(bigtime_t now);
+			bigtime_t			NextDeadline();
+
+	template<typename Visitor>
+			void				VisitAll(Visitor& visitor);
+
+private:
+	static	uint64				_Tick(bigtime_t time)
+									{ return time > 0 ? (uint64)time
+										>> kTickShift : 0; }
+	static	uint32				_Digit(uint64 tick, uint32 level)
+									{ return (tick >> (kSlotShift * level))
+										& (kSlotCount - 1); }
+	static	uint32				_LowestBit(uint64 bits);
+
+			bool				_SlotFor(uint64 tick, uint32& _level,
+									uint32& _slot) const;
+	static	void				_Insert(Timer** link, Timer* timer);
+	static	void				_Unlink(Timer* timer);
+			void				_AddDue(Timer* timer);
+	template<typename Visitor>
+	static	void				_VisitList(Timer** link, Visitor& visitor);
+			bool				_NextEventTick(uint64& _tick,
+									uint32& _level);
+			void				_Advance(uint64 tick);
+
+private:
+			Timer*				fDue;
+			Timer*				fSlots[kLevelCount][kSlotCount];
+			uint64				fPending[kLevelCount];
+				// a set bit may belong to a slot that has become empty
+				// through Remove(); it is cleared when it is found
+			uint64				fCurrentTick;
+};
+
+
+template<typename Timer>
+void
+TimerWheel<Timer>::Init(bigtime_t now)
+{
+	fDue = NULL;
+	for (uint32 level = 0; level < kLevelCount; level++) {
+		for (uint32 slot = 0; slot < kSlotCount; slot++)
+			fSlots[level][slot] = NULL;
+		fPending[level] = 0;
+	}
+	fCurrentTick = _Tick(now);
+}
+
+
+template<typename Timer>
+void
+TimerWheel<Timer>::Add(Timer* timer)
+{
+	uint32 level;
+	uint32 slot;
+	if (!_SlotFor(_Tick(timer->schedule_time), level, slot)) {
+		_AddDue(timer);
+		return;
+	}
+
+	_Insert(&fSlots[level][slot], timer);
+	fPending[level] |= (uint64)1 << slot;
+}
+
+
+/*!	Removes \a timer from the wheel. Returns \c false, if it wasn't in it,
+	ie. if it has never been added, has already been removed, or has expired.
+*/
+template<typename Timer>
+bool
+TimerWheel<Timer>::Remove(Timer* timer)
+{
+	if (timer->prev_link == NULL)
+		return false;
+
+	_Unlink(timer);
+	return true;
+}
+
+
+/*!	Removes and returns the first timer that is scheduled before \a now, or
+	returns \c NULL if there is none.
+*/
+template<typename Timer>
+Timer*
+TimerWheel<Timer>::RemoveExpired(bigtime_t now)
+{
+	_Advance(_Tick(now));
+
+	Timer* timer = fDue;
+	if (timer == NULL || timer->schedule_time >= now)
+		return NULL;
+
+	_Unlink(timer);
+	return timer;
+}
+
+
+/*!	Returns the time at which the wheel needs attention next, or
+	\c B_INFINITE_TIMEOUT if it is empty. That is the schedule time of the
+	first timer, unless that one still sits in a slot above the first level;
+	then it's the time the slot is reached.
+*/
+template<typename Timer>
+bigtime_t
+TimerWheel<Timer>::NextDeadline()
+{
+	if (fDue != NULL)
+		return fDue->schedule_time;
+
+	uint64 tick;
+	uint32 level;
+	if (!_NextEventTick(tick, level))
+		return B_INFINITE_TIMEOUT;
+
+	if (level > 0)
+		return (bigtime_t)(tick << kTickShift);
+
+	bigtime_t deadline = B_INFINITE_TIMEOUT;
+	for (Timer* timer = fSlots[0][_Digit(tick, 0)]; timer != NULL;
+			timer = timer->next) {
+		if (timer->schedule_time < deadline)
+			deadline = timer->schedule_time;
+	}
+
+	return deadline;
+}
+
+
+/*!	Calls \a visitor for each timer in the wheel, in no particular order.
+	The visitor returns whether the timer shall be removed from the wheel; in
+	that case, it may already reuse the timer's \c next member.
+*/
+template<typename Timer>
+template<typename Visitor>
+void
+TimerWheel<Timer>::VisitAll(Visitor& visitor)
+{
+	_VisitList(&fDue, visitor);
+
+	for (uint32 level = 0; level < kLevelCount; level++) {
+		for (uint32 slot = 0; slot < kSlotCount; slot++)
+			_VisitList(&fSlots[level][slot], visitor);
+	}
+}
+
+
+template<typename Timer>
+/*static*/ uint32
+TimerWheel<Timer>::_LowestBit(uint64 bits)
+{
+	static const uint8 kDeBruijnBitPosition[32] = {
+		0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+		31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+	};
+
+	uint32 offset = 0;
+	uint32 low = (uint32)bits;
+	if (low == 0) {
+		low = (uint32)(bits >> 32);
+		offset = 32;
+	}
+
+	return offset
+		+ kDeBruijnBitPosition[(uint32)((low & -low) * 0x077CB531U) >> 27];
+}
+
+
+/*!	Determines the slot a timer that is scheduled for \a tick belongs into.
+	Returns \c false, if it belongs into the due list instead.
+*/
+template<typename Timer>
+bool
+TimerWheel<Timer>::_SlotFor(uint64 tick, uint32& _level, uint32& _slot) const
+{
+	if (tick <= fCurrentTick)
+		return false;
+
+	uint32 level = 0;
+	for (uint64 difference = (tick ^ fCurrentTick) >> kSlotShift;
+			difference != 0 && level < kLevelCount;
+			difference >>= kSlotShift) {
+		level++;
+	}
+
+	if (level < kLevelCount) {
+		_level = level;
+		_slot = _Digit(tick, level);
+	} else {
+		// The first slot of the top level is only used for these, as it's
+		// reached when the top level wraps around.
+		_level = kLevelCount - 1;
+		_slot = 0;
+	}
+
+	return true;
+}
+
+
+template<typename Timer>
+template<typename Visitor>
+/*static*/ void
+TimerWheel<Timer>::_VisitList(Timer** link, Visitor& visitor)
+{
+	while (Timer* timer = *link) {
+		Timer* next = timer->next;
+		if (visitor(timer)) {
+			*link = next;
+			if (next != NULL)
+				next->prev_link = link;
+			timer->prev_link = NULL;
+		} else
+			link = &timer->next;
+	}
+}
+
+
+template<typename Timer>
+void
+TimerWheel<Timer>::_AddDue(Timer* timer)
+{
+	// timers with the same schedule time are called in reverse order
+	Timer** link = &fDue;
+	while (*link != NULL && (*link)->schedule_time < timer->schedule_time)
+		link = &(*link)->next;
+
+	_Insert(link, timer);
+}
+
+
+template<typename Timer>
+/*static*/ void
+TimerWheel<Timer>::_Insert(Timer** link, Timer* timer)
+{
+	timer->next = *link;
+	timer->prev_link = link;
+	if (timer->next != NULL)
+		timer->next->prev_link = &timer->next;
+	*link = timer;
+}
+
+
+template<typename Timer>
+/*static*/ void
+TimerWheel<Timer>::_Unlink(Timer* timer)
+{
+	*timer->prev_link = timer->next;
+	if (timer->next != NULL)
+		timer->next->prev_link = timer->prev_link;
+	timer->next = NULL;
+	timer->prev_link = NULL;
+}
+
+
+/*!	Finds the next tick after the current one at which a non-empty slot is
+	reached, and the lowest level with a slot due at that tick.
+*/
+template<typename Timer>
+bool
+TimerWheel<Timer>::_NextEventTick(uint64& _tick, uint32& _level)
+{
+	bool found = false;
+
+	for (uint32 level = 0; level < kLevelCount; level++) {
+		while (fPending[level] != 0) {
+			// Slots after the current one are reached within the current
+			// round of this level, the others in the next one.
+			uint32 rotation = (_Digit(fCurrentTick, level) + 1)
+				& (kSlotCount - 1);
+			uint64 pending = fPending[level];
+			if (rotation != 0) {
+				pending = (pending >> rotation)
+					| (pending << (kSlotCount - rotation));
+			}
+
+			uint32 slot = (_LowestBit(pending) + rotation) & (kSlotCount - 1);
+			if (fSlots[level][slot] == NULL) {
+				fPending[level] &= ~((uint64)1 << slot);
+				continue;
+			}
+
+			uint32 shift = kSlotShift * level;
+			uint64 round = (uint64)1 << (shift + kSlotShift);
+			uint64 tick = (fCurrentTick & ~(round - 1))
+				+ ((uint64)slot << shift);
+			if (tick <= fCurrentTick)
+				tick += round;
+
+			if (!found || tick < _tick) {
+				_tick = tick;
+				_level = level;
+				found = true;
+			}
+			break;
+		}
+	}
+
+	return found;
+}
+
+
+/*!	Moves the current tick forward to \a tick, and sorts the timers of all
+	slots reached on the way into the lower levels, or the due list.
+*/
+template<typename Timer>
+void
+TimerWheel<Timer>::_Advance(uint64 tick)
+{
+	uint64 eventTick;
+	uint32 eventLevel;
+	while (_NextEventTick(eventTick, eventLevel) && eventTick <= tick) {
+		fCurrentTick = eventTick;
+
+		// All slots reached at this tick are handled at once, from the top
+		// down, as their timers may move into the lower ones.
+		for (int32 level = kLevelCount - 1; level >= 0; level--) {
+			uint32 shift = kSlotShift * level;
+			if ((eventTick & (((uint64)1 << shift) - 1)) != 0)
+				continue;
+
+			uint32 slot = _Digit(eventTick, level);
+			Timer* timer = fSlots[level][slot];
+			fSlots[level][slot] = NULL;
+			fPending[level] &= ~((uint64)1 << slot);
+
+			while (timer != NULL) {
+				Timer* next = timer->next;
+				Add(timer);
+				timer = next;
+			}
+		}
+	}
+
+	if (tick > fCurrentTick)
+		fCurrentTick = tick;
+}
+
+
+#endif	// KERNEL_UTIL_TIMER_WHEEL_H
@@ -92,6 +92,7 @@ void		vfs_vnode_to_node_ref(struct vnode *vnode, dev_t *_mountID,
 struct fs_vnode* vfs_fsnode_for_vnode(struct vnode* vnode);
 
 int			vfs_open_vnode(struct vnode* vnode, int openMode, bool kernel);
+int			vfs_open(const char* path, int openMode, int perms, bool kernel);
 status_t	vfs_lookup_vnode(dev_t mountID, ino_t vnodeID,
 				struct vnode **_vnode);
 void		vfs_put_vnode(struct vnode *vnode);
@@ -249,6 +250,8 @@ int			_user_dup(int fd);
 int			_user_dup2(int ofd, int nfd);
 status_t	_user_lock_node(int fd);
 status_t	_user_unlock_node(int fd);
+ssize_t		_user_transfer_data(int sourceFD, off_t sourcePos, int targetFD,
+				off_t targetPos, size_t length, uint32 flags);
 
 /* socket user prototypes (implementation in socket.cpp) */
 int			_user_socket(int family, int type, int protocol);
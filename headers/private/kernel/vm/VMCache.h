@@ -10,8 +10,11 @@
 #define _KERNEL_VM_VM_CACHE_H
 
 
+#include <stddef.h>
+
 #include <debug.h>
 #include <kernel.h>
+#include <util/AVLTreeBase.h>
 #include <util/DoublyLinkedList.h>
 #include <vm/vm.h>
 #include <vm/vm_types.h>
@@ -43,33 +46,95 @@ extern ObjectCache* gDeviceCacheObjectCache;
 extern ObjectCache* gNullCacheObjectCache;
 
 
-struct VMCachePagesTreeDefinition {
-	typedef page_num_t KeyType;
-	typedef	vm_page NodeType;
+/*!	The index of the pages of a VMCache, ordered by their cache offset.
+	It is an AVL tree linked through vm_page::cache_link. Unlike a splay tree,
+	lookups and iteration never restructure the tree, so they don't write to
+	the pages' cache lines, and the depth of a lookup is bounded by about
+	1.44 * log2(page count).
+	All methods require the cache to be locked.
+*/
+class VMCachePagesTree : private AVLTreeCompare {
+public:
+	class Iterator {
+	public:
+		Iterator()
+			:
+			fTree(NULL),
+			fCurrent(NULL),
+			fNext(NULL)
+		{
+		}
+
+		Iterator(const AVLTreeBase* tree, AVLTreeNode* next)
+			:
+			fTree(tree),
+			fCurrent(NULL),
+			fNext(next)
+		{
+		}
+
+		bool HasNext() const
+		{
+			return fNext != NULL;
+		}
+
+		vm_page* Next()
+		{
+			// Fetch the successor right away, so that the caller may remove
+			// the returned page from the tree.
+			fCurrent = fNext;
+			if (fNext != NULL)
+				fNext = fTree->Next(fNext);
+			return VMCachePagesTree::PageFor(fCurrent);
+		}
+
+		vm_page* Current() const
+		{
+			return VMCachePagesTree::PageFor(fCurrent);
+		}
+
+	private:
+		const AVLTreeBase*	fTree;
+		AVLTreeNode*		fCurrent;
+		AVLTreeNode*		fNext;
+	};
+
+	typedef Iterator ConstIterator;
 
-	static page_num_t GetKey(const NodeType* node)
-	{
-		return node->cache_offset;
-	}
+public:
+								VMCachePagesTree();
+	virtual						~VMCachePagesTree();
 
-	static SplayTreeLink<NodeType>* GetLink(NodeType* node)
-	{
-		return &node->cache_link;
-	}
+	inline	bool				IsEmpty() const
+									{ return fTree.IsEmpty(); }
+	inline	vm_page*			First() const
+									{ return PageFor(
+										fTree.LeftMost(fTree.Root())); }
 
-	static int Compare(page_num_t key, const NodeType* node)
-	{
-		return key == node->cache_offset ? 0
-			: (key < node->cache_offset ? -1 : 1);
-	}
+	inline	vm_page*			Lookup(page_num_t offset) const;
+			void				Insert(vm_page* page);
+			void				Remove(vm_page* page);
+			void				Swap(VMCachePagesTree& other);
 
-	static NodeType** GetListLink(NodeType* node)
-	{
-		return &node->cache_next;
-	}
-};
+	inline	Iterator			GetIterator() const;
+			Iterator			GetIterator(page_num_t offset, bool greater,
+									bool orEqual) const;
 
-typedef IteratableSplayTree<VMCachePagesTreeDefinition> VMCachePagesTree;
+	static	inline vm_page*		PageFor(const AVLTreeNode* node);
+
+private:
+								VMCachePagesTree(
+									const VMCachePagesTree& other);
+			VMCachePagesTree&	operator=(const VMCachePagesTree& other);
+
+	virtual	int					CompareKeyNode(const void* key,
+									const AVLTreeNode* node);
+	virtual	int					CompareNodes(const AVLTreeNode* node1,
+									const AVLTreeNode* node2);
+
+private:
+			AVLTreeBase			fTree;
+};
 
 
 struct VMCache : public DoublyLinkedListLinkImpl<VMCache> {
@@ -354,6 +419,38 @@ VMCache::DecrementWiredPagesCount()
 }
 
 
+vm_page*
+VMCachePagesTree::PageFor(const AVLTreeNode* node)
+{
+	if (node == NULL)
+		return NULL;
+	return (vm_page*)((addr_t)node - offsetof(vm_page, cache_link));
+}
+
+
+vm_page*
+VMCachePagesTree::Lookup(page_num_t offset) const
+{
+	AVLTreeNode* node = fTree.Root();
+	while (node != NULL) {
+		vm_page* page = PageFor(node);
+		if (offset == page->cache_offset)
+			return page;
+
+		node = offset < page->cache_offset ? node->left : node->right;
+	}
+
+	return NULL;
+}
+
+
+VMCachePagesTree::Iterator
+VMCachePagesTree::GetIterator() const
+{
+	return Iterator(&fTree, fTree.LeftMost(fTree.Root()));
+}
+
+
 // vm_page methods implemented here to avoid VMCache.h inclusion in vm_types.h
 
 inline void
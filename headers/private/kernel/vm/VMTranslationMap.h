@@ -42,6 +42,11 @@ public:
 	virtual	status_t			DebugMarkRangePresent(addr_t start, addr_t end,
 									bool markPresent);
 
+	virtual	size_t				LargePageSize() const;
+	virtual	status_t			CollapseLargePage(addr_t address);
+			int32				LargePageCount() const
+									{ return fLargePageCount; }
+
 	// map not locked
 	virtual	status_t			UnmapPage(VMArea* area, addr_t address,
 									bool updatePageQueue) = 0;
@@ -91,6 +96,7 @@ protected:
 protected:
 			recursive_lock		fLock;
 			int32				fMapCount;
+			int32				fLargePageCount;
 };
 
 
@@ -15,6 +15,7 @@
 #include <vm/vm_types.h>
 
 
+struct compressed_swap_info;
 struct generic_io_vec;
 struct kernel_args;
 struct ObjectCache;
@@ -132,6 +133,8 @@ int32 vm_remove_all_page_mappings_if_unaccessed(struct vm_page *page);
 status_t vm_wire_page(team_id team, addr_t address, bool writable,
 			struct VMPageWiringInfo* info);
 void vm_unwire_page(struct VMPageWiringInfo* info);
+status_t vm_move_pages_into_area(team_id team, addr_t address,
+			struct vm_page** pages, size_t count);
 
 status_t vm_get_physical_page(phys_addr_t paddr, addr_t* vaddr, void** _handle);
 status_t vm_put_physical_page(addr_t vaddr, void* handle);
@@ -174,6 +177,8 @@ status_t _user_sync_memory(void *address, size_t size, uint32 flags);
 status_t _user_memory_advice(void* address, size_t size, uint32 advice);
 status_t _user_get_memory_properties(team_id teamID, const void *address,
 			uint32 *_protected, uint32 *_lock);
+status_t _user_get_compressed_swap_info(struct compressed_swap_info* userInfo,
+			size_t size);
 
 area_id _user_area_for(void *address);
 area_id _user_find_area(const char *name);
@@ -16,6 +16,7 @@
 struct kernel_args;
 
 extern int32 gMappedPagesCount;
+extern int32 gMappedLargePagesCount;
 
 
 struct vm_page_reservation {
@@ -65,6 +66,9 @@ struct vm_page *vm_page_allocate_page(vm_page_reservation* reservation,
 	uint32 flags);
 struct vm_page *vm_page_allocate_page_run(uint32 flags, page_num_t length,
 	const physical_address_restrictions* restrictions, int priority);
+struct vm_page *vm_page_allocate_reserved_page_run(
+	vm_page_reservation* reservation, uint32 flags, page_num_t length,
+	const physical_address_restrictions* restrictions);
 struct vm_page *vm_page_at_index(int32 index);
 struct vm_page *vm_lookup_page(page_num_t pageNumber);
 bool vm_page_is_dummy(struct vm_page *page);
@@ -17,9 +17,9 @@
 #include <condition_variable.h>
 #include <kernel.h>
 #include <lock.h>
+#include <util/AVLTreeBase.h>
 #include <util/DoublyLinkedList.h>
 #include <util/DoublyLinkedQueue.h>
-#include <util/SplayTree.h>
 
 #include <sys/uio.h>
 
@@ -126,8 +126,7 @@ public:
 								// TODO: Only 32 bit on 32 bit platforms!
 								// Introduce a new 64 bit type page_off_t!
 
-	SplayTreeLink<vm_page>	cache_link;
-	vm_page*				cache_next;
+	AVLTreeNode				cache_link;
 
 	vm_page_mappings		mappings;
 
@@ -21,12 +21,19 @@ typedef struct select_info {
 	uint16				selected_events;
 } select_info;
 
-typedef struct select_sync {
-	int32				ref_count;
-	sem_id				sem;
-	uint32				count;
-	struct select_info*	set;
-} select_sync;
+/*!	The object the select_infos of a select()/poll()/wait_for_objects() call
+	or of an event queue belong to. notify_select_events() hands the events
+	an object reports to Notify(), which may be called with spinlocks held
+	and interrupts disabled.
+*/
+struct select_sync {
+								select_sync();
+	virtual						~select_sync();
+
+	virtual	status_t			Notify(select_info* info, uint16 events) = 0;
+
+			int32				ref_count;
+};
 
 #define SELECT_FLAG(type) (1L << (type - 1))
 
@@ -40,6 +47,11 @@ extern void		put_select_sync(select_sync* sync);
 extern status_t	notify_select_events(select_info* info, uint16 events);
 extern void		notify_select_events_list(select_info* list, uint16 events);
 
+extern status_t	select_object(uint32 type, int32 object, select_info* info,
+					bool kernel);
+extern status_t	deselect_object(uint32 type, int32 object, select_info* info,
+					bool kernel);
+
 extern ssize_t	_user_wait_for_objects(object_wait_info* userInfos,
 					int numInfos, uint32 flags, bigtime_t timeout);
 
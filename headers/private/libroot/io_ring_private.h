@@ -0,0 +1,68 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _LIBROOT_IO_RING_PRIVATE_H
+#define _LIBROOT_IO_RING_PRIVATE_H
+
+
+#include <sys/cdefs.h>
+
+#include <io_ring_defs.h>
+
+
+/* An I/O ring as seen by the team using it: the area shared with the kernel
+   and the ring indices only the team writes. io_ring_get_submission() hands
+   out free submission entries, io_ring_submit() passes all entries filled in
+   since the last call on to the kernel, and io_ring_peek_completion() and
+   io_ring_advance_completions() harvest the results. The functions aren't
+   thread-safe, a ring must only be used by one thread at a time. */
+
+typedef struct io_ring {
+	int						fd;
+	area_id					area;
+	struct io_ring_header*	header;
+	struct io_ring_submission* submissions;
+	struct io_ring_completion* completions;
+	uint32					submission_mask;
+	uint32					completion_mask;
+	uint32					submission_tail;	/* entries handed out */
+	uint32					completion_head;	/* completions consumed */
+} io_ring;
+
+
+__BEGIN_DECLS
+
+status_t	io_ring_init(io_ring* ring, uint32 entries, uint32 workerCount);
+void		io_ring_destroy(io_ring* ring);
+
+struct io_ring_submission* io_ring_get_submission(io_ring* ring);
+ssize_t		io_ring_submit(io_ring* ring, uint32 minComplete, uint32 flags,
+				bigtime_t timeout);
+
+struct io_ring_completion* io_ring_peek_completion(io_ring* ring);
+void		io_ring_advance_completions(io_ring* ring, uint32 count);
+status_t	io_ring_wait_completion(io_ring* ring,
+				struct io_ring_completion** _completion, uint32 flags,
+				bigtime_t timeout);
+
+__END_DECLS
+
+
+static inline void
+io_ring_prepare(struct io_ring_submission* submission, uint8 operation,
+	int32 fd, void* buffer, uint32 length, off_t offset, uint64 userData)
+{
+	submission->operation = operation;
+	submission->reserved0 = 0;
+	submission->reserved1 = 0;
+	submission->fd = fd;
+	submission->offset = offset;
+	submission->buffer = buffer;
+	submission->length = length;
+	submission->flags = 0;
+	submission->user_data = userData;
+}
+
+
+#endif	/* _LIBROOT_IO_RING_PRIVATE_H */
@@ -117,6 +117,9 @@ struct net_socket_module_info {
 	int			(*shutdown)(net_socket* socket, int direction);
 	status_t	(*socketpair)(int family, int type, int protocol,
 					net_socket* _sockets[2]);
+	ssize_t		(*send_from)(net_socket* socket, size_t length, int flags,
+					ssize_t (*read)(void* cookie, void* data, size_t length),
+					void* cookie);
 };
 
 
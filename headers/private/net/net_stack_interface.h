@@ -75,6 +75,10 @@ struct net_stack_interface_module_info {
 
 	status_t (*get_next_socket_stat)(int family, uint32 *cookie,
 					struct net_stat *stat);
+
+	ssize_t (*send_from)(net_socket* socket, size_t length, int flags,
+					ssize_t (*read)(void* cookie, void* data, size_t length),
+					void* cookie);
 };
 
 
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SYSTEM_CONTINUOUS_PROFILER_DEFS_H
+#define _SYSTEM_CONTINUOUS_PROFILER_DEFS_H
+
+
+#include <OS.h>
+
+
+// The continuous profiler samples the stacks of the threads running on each
+// CPU at a fixed interval and appends them to a per-CPU ring in an area
+// shared with the userland reader. Each ring has exactly one writer (the
+// profiling timer of its CPU) and one reader, so neither side needs a lock:
+// the kernel only advances "head", the reader only advances "tail".
+//
+// Area layout:
+//	continuous_profiler_header
+//	continuous_profiler_ring[cpu_count]
+//	ring data[cpu_count], ring_size bytes each
+
+
+struct continuous_profiler_parameters {
+	area_id		buffer_area;			// area holding the sample rings
+	uint32		flags;					// B_CONTINUOUS_PROFILER_* flags
+	bigtime_t	interval;				// interval at which to take samples
+	uint32		stack_depth;			// maximum stack depth to sample
+};
+
+
+// flags
+enum {
+	B_CONTINUOUS_PROFILER_KERNEL_STACKS	= 0x01,
+	B_CONTINUOUS_PROFILER_USER_STACKS	= 0x02,
+	B_CONTINUOUS_PROFILER_IDLE_THREADS	= 0x04
+};
+
+
+#define B_CONTINUOUS_PROFILER_RING_ALIGNMENT	64
+
+
+// written by the kernel when profiling is started
+struct continuous_profiler_header {
+	uint32		cpu_count;
+	uint32		ring_size;				// per CPU, a power of two
+	uint32		data_offset;			// offset of the first ring's data
+										// relative to the area start
+	uint32		reserved[13];
+};
+
+
+struct continuous_profiler_ring {
+	int32		head;					// bytes written so far, by the kernel
+	int32		tail;					// bytes consumed so far, by the reader
+	int64		dropped_samples;		// samples that didn't fit
+	uint8		reserved[B_CONTINUOUS_PROFILER_RING_ALIGNMENT - 16];
+};
+
+
+// A sample record in a ring. Records are 8 byte aligned and never wrap
+// around the end of the ring; if a record doesn't fit, the remaining space is
+// filled with a padding record (team < 0).
+struct continuous_profiler_sample {
+	uint16		size;					// size of the record including the
+										// addresses and the alignment padding
+	uint8		kernel_depth;			// number of kernel return addresses
+	uint8		user_depth;				// number of user return addresses
+	team_id		team;
+	thread_id	thread;
+	addr_t		addresses[0];			// kernel return addresses followed by
+										// the user ones, innermost first
+};
+
+
+#endif	/* _SYSTEM_CONTINUOUS_PROFILER_DEFS_H */
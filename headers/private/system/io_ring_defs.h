@@ -0,0 +1,120 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SYSTEM_IO_RING_DEFS_H
+#define _SYSTEM_IO_RING_DEFS_H
+
+
+#include <OS.h>
+
+
+// An I/O ring is a pair of rings in an area shared between a team and the
+// kernel: the team queues I/O operations in the submission ring and hands
+// them to the kernel in batches with a single _kern_io_ring_enter() call, and
+// the kernel appends the results to the completion ring, from which the team
+// harvests them without entering the kernel at all. Each index has exactly
+// one writer: the team only advances "submission_tail" and "completion_head",
+// the kernel only "submission_head" and "completion_tail".
+//
+// Area layout:
+//	io_ring_header
+//	io_ring_submission[submission_entries]	at submission_offset
+//	io_ring_completion[completion_entries]	at completion_offset
+
+
+#define B_IO_RING_ALIGNMENT			64
+#define B_IO_RING_MAX_ENTRIES		32768
+#define B_IO_RING_MAX_WORKERS		64
+
+
+struct io_ring_parameters {
+	uint32		submission_entries;		// power of two
+	uint32		completion_entries;		// power of two, at least
+										// submission_entries
+	uint32		worker_count;			// threads executing the operations,
+										// 0 for the default
+	uint32		flags;					// reserved, must be 0
+
+	// returned by the kernel
+	area_id		area;					// area holding the rings; it goes
+										// away with the ring
+	void*		address;				// where it's mapped
+};
+
+
+// operations
+enum {
+	B_IO_RING_NOP	= 0,
+	B_IO_RING_READ,
+	B_IO_RING_WRITE,
+	B_IO_RING_READV,
+	B_IO_RING_WRITEV,
+	B_IO_RING_FSYNC,
+	B_IO_RING_ACCEPT,
+	B_IO_RING_RECV,
+	B_IO_RING_SEND,
+
+	B_IO_RING_OPERATION_COUNT
+};
+
+
+// written by the kernel when the ring is created
+struct io_ring_header {
+	int32		submission_head;		// entries consumed, by the kernel
+	int32		submission_tail;		// entries queued, by the team
+	uint32		submission_entries;
+	uint32		submission_offset;
+	int32		completion_head;		// entries consumed, by the team
+	int32		completion_tail;		// entries written, by the kernel
+	uint32		completion_entries;
+	uint32		completion_offset;
+	int32		completions_dropped;	// completions that didn't fit, because
+										// the team moved completion_head ahead
+										// of completion_tail
+	uint32		reserved[7];
+};
+
+
+struct io_ring_submission {
+	uint8		operation;				// B_IO_RING_*
+	uint8		reserved0;
+	uint16		reserved1;
+	int32		fd;
+	off_t		offset;					// -1 for the current file position
+	void*		buffer;					// data, or iovec array for the
+										// vectored operations
+	uint32		length;					// size of the data, or iovec count
+	int32		flags;					// send()/recv() flags
+	uint64		user_data;				// passed on to the completion
+};
+
+
+struct io_ring_completion {
+	uint64		user_data;
+	int64		result;					// the operation's return value, an
+										// error code, if < 0
+};
+
+
+// The submission ring directly follows the header, the completion ring starts
+// at the next B_IO_RING_ALIGNMENT boundary after it.
+static inline uint32
+io_ring_completion_offset(uint32 submissionEntries)
+{
+	return (sizeof(struct io_ring_header)
+			+ submissionEntries * sizeof(struct io_ring_submission)
+			+ B_IO_RING_ALIGNMENT - 1)
+		/ B_IO_RING_ALIGNMENT * B_IO_RING_ALIGNMENT;
+}
+
+
+static inline size_t
+io_ring_area_size(uint32 submissionEntries, uint32 completionEntries)
+{
+	return io_ring_completion_offset(submissionEntries)
+		+ completionEntries * sizeof(struct io_ring_completion);
+}
+
+
+#endif	/* _SYSTEM_IO_RING_DEFS_H */
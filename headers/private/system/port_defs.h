@@ -0,0 +1,17 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SYSTEM_PORT_DEFS_H
+#define _SYSTEM_PORT_DEFS_H
+
+
+// read_port_etc() flags
+#define B_REMAP_PORT_MESSAGE	0x200
+	// Large messages may be moved into the buffer page by page, instead of
+	// being copied. The buffer must be page aligned and lie in a private
+	// anonymous area, otherwise the message is copied as usual. The pages
+	// of the buffer the message is moved into are replaced.
+
+
+#endif	/* _SYSTEM_PORT_DEFS_H */
@@ -0,0 +1,47 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SYSTEM_SPAWN_DEFS_H
+#define _SYSTEM_SPAWN_DEFS_H
+
+
+#include <signal.h>
+#include <sys/types.h>
+
+#include <SupportDefs.h>
+
+
+#define MAX_SPAWN_FILE_ACTIONS	1024
+
+// spawn_file_action::type
+enum {
+	SPAWN_FILE_ACTION_OPEN	= 1,
+	SPAWN_FILE_ACTION_CLOSE,
+	SPAWN_FILE_ACTION_DUP2
+};
+
+
+struct spawn_file_action {
+	int32		type;
+	int32		fd;
+	int32		new_fd;		// dup2
+	int32		open_mode;	// open
+	mode_t		perms;		// open
+	char*		path;		// open
+};
+
+// the posix_spawn() attributes and file actions passed to _kern_spawn_image()
+struct spawn_args {
+	uint32						flags;		// POSIX_SPAWN_*
+	pid_t						process_group;
+	int32						priority;	// < 0 to use the default
+	mode_t						umask;
+	sigset_t					signal_mask;
+	sigset_t					default_signals;
+	int32						file_action_count;
+	struct spawn_file_action*	file_actions;
+};
+
+
+#endif	/* _SYSTEM_SPAWN_DEFS_H */
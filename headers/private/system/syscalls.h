@@ -22,11 +22,13 @@ extern "C" {
 #endif
 
 struct attr_info;
+struct compressed_swap_info;
 struct dirent;
 struct fd_info;
 struct fd_set;
 struct fs_info;
 struct iovec;
+struct io_ring_parameters;
 struct msqid_ds;
 struct net_stat;
 struct pollfd;
@@ -37,8 +39,10 @@ struct sembuf;
 union semun;
 struct sigaction;
 struct signal_frame_data;
+struct spawn_args;
 struct stat;
 struct system_profiler_parameters;
+struct continuous_profiler_parameters;
 struct user_timer_info;
 
 struct disk_device_job_progress_info;
@@ -74,6 +78,19 @@ extern status_t		_kern_get_safemode_option(const char *parameter,
 extern ssize_t		_kern_wait_for_objects(object_wait_info* infos, int numInfos,
 						uint32 flags, bigtime_t timeout);
 
+/* event queue functions */
+extern int			_kern_event_queue_create(int openFlags);
+extern status_t		_kern_event_queue_select(int queue, event_wait_info* infos,
+						int numInfos);
+extern ssize_t		_kern_event_queue_wait(int queue, event_wait_info* infos,
+						int numInfos, uint32 flags, bigtime_t timeout);
+
+/* I/O ring functions */
+extern int			_kern_io_ring_create(
+						struct io_ring_parameters* parameters);
+extern ssize_t		_kern_io_ring_enter(int ring, uint32 toSubmit,
+						uint32 minComplete, uint32 flags, bigtime_t timeout);
+
 /* user mutex functions */
 extern status_t		_kern_mutex_lock(int32* mutex, const char* name,
 						uint32 flags, bigtime_t timeout);
@@ -136,6 +153,9 @@ extern thread_id	_kern_load_image(const char* const* flatArgs,
 						size_t flatArgsSize, int32 argCount, int32 envCount,
 						int32 priority, uint32 flags, port_id errorPort,
 						uint32 errorToken);
+extern thread_id	_kern_spawn_image(const char* const* flatArgs,
+						size_t flatArgsSize, int32 argCount, int32 envCount,
+						const struct spawn_args* spawnArgs);
 extern void __NO_RETURN _kern_exit_team(status_t returnValue);
 extern status_t		_kern_kill_team(team_id team);
 extern team_id		_kern_get_current_team();
@@ -322,6 +342,9 @@ extern ssize_t		_kern_write(int fd, off_t pos, const void *buffer,
 						size_t bufferSize);
 extern ssize_t		_kern_writev(int fd, off_t pos, const struct iovec *vecs,
 						size_t count);
+extern ssize_t		_kern_transfer_data(int sourceFD, off_t sourcePos,
+						int targetFD, off_t targetPos, size_t length,
+						uint32 flags);
 extern status_t		_kern_ioctl(int fd, uint32 cmd, void *data, size_t length);
 extern ssize_t		_kern_read_dir(int fd, struct dirent *buffer,
 						size_t bufferSize, uint32 maxCount);
@@ -447,6 +470,9 @@ extern status_t		_kern_memory_advice(void *address, size_t size,
 extern status_t		_kern_get_memory_properties(team_id teamID,
 						const void *address, uint32* _protected, uint32* _lock);
 
+extern status_t		_kern_get_compressed_swap_info(
+						struct compressed_swap_info* info, size_t size);
+
 /* kernel port functions */
 extern port_id		_kern_create_port(int32 queue_length, const char *name);
 extern status_t		_kern_close_port(port_id id);
@@ -498,6 +524,10 @@ extern status_t		_kern_system_profiler_stop();
 extern status_t		_kern_system_profiler_recorded(
 						struct system_profiler_parameters* parameters);
 
+extern status_t		_kern_continuous_profiler_start(
+						struct continuous_profiler_parameters* parameters);
+extern status_t		_kern_continuous_profiler_stop();
+
 /* atomic_* ops (needed for CPUs that don't support them directly) */
 #ifdef ATOMIC_FUNCS_ARE_SYSCALLS
 extern void		_kern_atomic_set(int32 *value, int32 newValue);
@@ -536,6 +566,8 @@ extern status_t		_kern_analyze_scheduling(bigtime_t from, bigtime_t until,
 /* Debug output */
 extern void			_kern_debug_output(const char *message);
 extern void			_kern_ktrace_output(const char *message);
+extern ssize_t		_kern_ktrace_read(char* buffer, size_t size,
+						bool fromStart);
 extern status_t		_kern_frame_buffer_update(addr_t baseAddress, int32 width,
 						int32 height, int32 depth, int32 bytesPerRow);
 
@@ -31,7 +31,8 @@ enum {
 	B_SYSTEM_PROFILER_IMAGE_EVENTS			= 0x04,
 	B_SYSTEM_PROFILER_SAMPLING_EVENTS		= 0x08,
 	B_SYSTEM_PROFILER_SCHEDULING_EVENTS		= 0x10,
-	B_SYSTEM_PROFILER_IO_SCHEDULING_EVENTS	= 0x20
+	B_SYSTEM_PROFILER_IO_SCHEDULING_EVENTS	= 0x20,
+	B_SYSTEM_PROFILER_ICI_EVENTS			= 0x40
 };
 
 
@@ -71,7 +72,10 @@ enum {
 	B_SYSTEM_PROFILER_IO_REQUEST_SCHEDULED,
 	B_SYSTEM_PROFILER_IO_REQUEST_FINISHED,
 	B_SYSTEM_PROFILER_IO_OPERATION_STARTED,
-	B_SYSTEM_PROFILER_IO_OPERATION_FINISHED
+	B_SYSTEM_PROFILER_IO_OPERATION_FINISHED,
+
+	// inter-CPU interrupts
+	B_SYSTEM_PROFILER_ICI_STATS
 };
 
 
@@ -229,5 +233,20 @@ struct system_profiler_io_operation_finished {
 	size_t		transferred;
 };
 
+// B_SYSTEM_PROFILER_ICI_STATS
+// The counters are totals since boot; one event per CPU is recorded at the
+// start and whenever the profiler hands out the next buffer.
+struct system_profiler_ici_stats {
+	nanotime_t	time;
+	int32		cpu;
+	uint64		sent;
+	uint64		sent_tlb;
+	uint64		received;
+	uint64		received_tlb;
+	uint64		sync_waits;
+	bigtime_t	sync_wait_time;
+	bigtime_t	max_sync_wait_time;
+};
+
 
 #endif	/* _SYSTEM_SYSTEM_PROFILER_DEFS_H */
@@ -34,10 +34,15 @@
 #define B_KERNEL_AREA			0x4000
 	// Usable from userland according to its protection flags, but the area
 	// itself is not deletable, resizable, etc from userland.
+#define B_LARGE_PAGES_AREA		0x8000
+	// Map the large page aligned chunks of a fully locked or contiguous
+	// area with large pages, if possible.
 
-#define B_USER_AREA_FLAGS		(B_USER_PROTECTION | B_OVERCOMMITTING_AREA)
+#define B_USER_AREA_FLAGS \
+	(B_USER_PROTECTION | B_OVERCOMMITTING_AREA | B_LARGE_PAGES_AREA)
 #define B_KERNEL_AREA_FLAGS \
-	(B_KERNEL_PROTECTION | B_USER_CLONEABLE_AREA | B_SHARED_AREA)
+	(B_KERNEL_PROTECTION | B_USER_CLONEABLE_AREA | B_SHARED_AREA \
+		| B_LARGE_PAGES_AREA)
 
 // mapping argument for several internal VM functions
 enum {
@@ -54,4 +59,19 @@ enum {
 #define MEMORY_TYPE_SHIFT		28
 
 
+// compressed swap statistics, as returned by _kern_get_compressed_swap_info()
+struct compressed_swap_info {
+	char		algorithm[32];		// empty, if the pool is disabled
+	uint64		max_pool_size;
+	uint64		pool_size;			// bytes used by the compressed pages
+	uint64		stored_pages;		// pages currently in the pool
+	uint64		rejected_pages;		// pages that went to the swap file directly
+	uint64		demoted_pages;		// pages moved on to the swap file
+	uint64		pool_faults;		// pages read in from the pool
+	bigtime_t	pool_fault_time;	// total time spent on them
+	uint64		disk_faults;		// pages read in from the swap file
+	bigtime_t	disk_fault_time;
+};
+
+
 #endif	/* _SYSTEM_VM_DEFS_H */
@@ -366,7 +366,8 @@ CachedNode::MakeWritable(Transaction& transaction)
 	if (fNode == NULL)
 		return NULL;
 
-	if (block_cache_make_writable(transaction.GetVolume()->BlockCache(),
+	if (transaction.WillWriteBlock(fBlockNumber) == B_OK
+		&& block_cache_make_writable(transaction.GetVolume()->BlockCache(),
 			fBlockNumber, transaction.ID()) == B_OK) {
 		return fNode;
 	}
@@ -442,8 +443,10 @@ CachedNode::InternalSetTo(Transaction* transaction, off_t offset)
 
 #if !_BOOT_MODE
 		if (transaction != NULL) {
-			block = (uint8*)block_cache_get_writable(volume->BlockCache(),
-				fBlockNumber, transaction->ID());
+			if (transaction->WillWriteBlock(fBlockNumber) == B_OK) {
+				block = (uint8*)block_cache_get_writable(volume->BlockCache(),
+					fBlockNumber, transaction->ID());
+			}
 			fWritable = true;
 		} else {
 			block = (uint8*)block_cache_get(volume->BlockCache(), fBlockNumber);
@@ -2894,6 +2897,809 @@ TreeIterator::Dump()
 #endif
 
 
+//	#pragma mark - TreeBuilder
+
+
+#if !_BOOT_MODE
+static const size_t kBuilderChunkSize = 65536;
+static const size_t kMaxBuilderMemory = 32 * 1024 * 1024;
+static const int32 kMinBuilderEntries = 4096;
+static const int32 kInsertsPerTransaction = 256;
+static const uint32 kBuilderTransactionSize = 1024 * 1024;
+
+
+struct builder_chunk {
+	builder_chunk*	next;
+};
+
+struct builder_entry {
+	off_t			value;
+	uint16			length;
+	uint8			key[0];
+};
+
+/*!	A key in a node that is about to be written, and the value that belongs
+	to it: either the (duplicate) value of a leaf, or the child node that
+	contains all keys up to this one.
+*/
+struct builder_key {
+	const builder_entry*	entry;
+	off_t					value;
+};
+
+
+static const size_t kBuilderChunkHeaderSize
+	= (sizeof(builder_chunk) + 7) & ~(size_t)7;
+
+
+/*!	Writes the given keys and values into an empty node; the keys must
+	already be sorted, and they must fit into the node.
+*/
+static void
+fill_node(bplustree_node* node, const builder_key* keys, int32 count)
+{
+	uint16 length = 0;
+	for (int32 i = 0; i < count; i++)
+		length += keys[i].entry->length;
+
+	node->all_key_count = HOST_ENDIAN_TO_BFS_INT16(count);
+	node->all_key_length = HOST_ENDIAN_TO_BFS_INT16(length);
+
+	uint8* keyStart = node->Keys();
+	uint16* keyLengths = node->KeyLengths();
+	off_t* values = node->Values();
+
+	length = 0;
+	for (int32 i = 0; i < count; i++) {
+		memcpy(keyStart + length, keys[i].entry->key, keys[i].entry->length);
+		length += keys[i].entry->length;
+
+		keyLengths[i] = HOST_ENDIAN_TO_BFS_INT16(length);
+		values[i] = HOST_ENDIAN_TO_BFS_INT64(keys[i].value);
+	}
+}
+
+
+TreeBuilder::TreeBuilder(BPlusTree* tree)
+	:
+	fTree(tree),
+	fChunks(NULL),
+	fChunkUsed(kBuilderChunkSize),
+	fEntries(NULL),
+	fCount(0),
+	fCapacity(0),
+	fMemoryUsed(0),
+	fNextOffset(0),
+	fNodesWritten(0),
+	fFragments(NULL),
+	fFragmentsOffset(BPLUSTREE_NULL),
+	fFragmentIndex(0)
+{
+}
+
+
+TreeBuilder::~TreeBuilder()
+{
+	_MakeEmpty();
+}
+
+
+/*!	Adds an entry to the tree. It is only written to the tree when
+	Flush(), or Finish() is called, or when the entries collected so far
+	use up too much memory.
+	If there is not enough memory to collect the entry, the entries
+	collected so far are written out to make room; if that doesn't help
+	either, the entry is inserted into the tree directly.
+*/
+status_t
+TreeBuilder::Add(const uint8* key, uint16 keyLength, off_t value)
+{
+	if (keyLength < BPLUSTREE_MIN_KEY_LENGTH
+		|| keyLength > BPLUSTREE_MAX_KEY_LENGTH)
+		RETURN_ERROR(B_BAD_VALUE);
+
+	size_t size = (sizeof(builder_entry) + keyLength + 7) & ~(size_t)7;
+
+	// The sort needs as much memory as the entry array again
+	size_t needed = 0;
+	if (fCount == fCapacity) {
+		needed += max_c(fCapacity, kMinBuilderEntries) * 2
+			* sizeof(builder_entry*);
+	}
+	if (fChunkUsed + size > kBuilderChunkSize)
+		needed += kBuilderChunkSize;
+
+	if (fCount > 0 && fMemoryUsed + needed > kMaxBuilderMemory) {
+		// Write out what we have so far, and start over
+		status_t status = Flush();
+		if (status != B_OK)
+			return status;
+	}
+
+	status_t status = _Reserve(size);
+	if (status == B_NO_MEMORY && fCount > 0) {
+		status = Flush();
+		if (status == B_OK)
+			status = _Reserve(size);
+	}
+	if (status == B_NO_MEMORY)
+		return _Insert(key, keyLength, value);
+	if (status != B_OK)
+		return status;
+
+	builder_entry* entry = (builder_entry*)((uint8*)fChunks + fChunkUsed);
+	entry->value = value;
+	entry->length = keyLength;
+	memcpy(entry->key, key, keyLength);
+
+	fChunkUsed += size;
+	fEntries[fCount++] = entry;
+	return B_OK;
+}
+
+
+/*!	Writes all entries that were added so far to the tree, and frees the
+	memory they used. The builder can be used to add more entries
+	afterwards.
+	The tree is written in several transactions of its own. The journal
+	stays locked in between, so that no one else can change the tree
+	until this method returns.
+*/
+status_t
+TreeBuilder::Flush()
+{
+	if (fCount == 0)
+		return B_OK;
+
+	// Index updates are only done in transactions; keeping the journal
+	// locked across all of ours keeps them out of the tree until it is
+	// complete. The checker already holds this lock, so this only nests.
+	Journal* journal = fTree->fStream->GetVolume()->GetJournal(0);
+	status_t status = journal->Lock(NULL, true);
+	if (status != B_OK)
+		return status;
+
+	status = _Sort();
+	if (status == B_OK) {
+		// Only an empty tree can be built bottom up; everything added
+		// after the first batch is inserted into the existing tree.
+		// A failed build leaves the tree empty.
+		if (_TreeIsEmpty()) {
+			status = _Build();
+			if (status == B_NO_MEMORY)
+				status = _InsertEntries();
+		} else
+			status = _InsertEntries();
+	} else if (status == B_NO_MEMORY) {
+		// Don't lose the entries, just insert them in any order
+		status = _InsertEntries();
+	}
+
+	journal->Unlock(NULL, true);
+
+	_MakeEmpty();
+	return status;
+}
+
+
+/*!	Writes all entries that were added to the tree. If the tree was empty,
+	it is built from scratch, otherwise the entries are inserted in sorted
+	order.
+	Like Flush(), this keeps the journal locked until the tree is complete.
+*/
+status_t
+TreeBuilder::Finish()
+{
+	return Flush();
+}
+
+
+void
+TreeBuilder::_MakeEmpty()
+{
+	while (fChunks != NULL) {
+		builder_chunk* next = fChunks->next;
+		free(fChunks);
+		fChunks = next;
+	}
+
+	free(fEntries);
+	fEntries = NULL;
+	fCount = 0;
+	fCapacity = 0;
+	fChunkUsed = kBuilderChunkSize;
+	fMemoryUsed = 0;
+}
+
+
+/*!	Makes sure there is room for one more entry of \a size bytes. */
+status_t
+TreeBuilder::_Reserve(size_t size)
+{
+	if (fCount == fCapacity) {
+		int32 capacity = max_c(fCapacity * 2, kMinBuilderEntries);
+		builder_entry** entries = (builder_entry**)realloc(fEntries,
+			capacity * sizeof(builder_entry*));
+		if (entries == NULL)
+			return B_NO_MEMORY;
+
+		fMemoryUsed += (capacity - fCapacity) * 2 * sizeof(builder_entry*);
+		fEntries = entries;
+		fCapacity = capacity;
+	}
+
+	if (fChunkUsed + size > kBuilderChunkSize) {
+		builder_chunk* chunk = (builder_chunk*)malloc(kBuilderChunkSize);
+		if (chunk == NULL)
+			return B_NO_MEMORY;
+
+		chunk->next = fChunks;
+		fChunks = chunk;
+		fChunkUsed = kBuilderChunkHeaderSize;
+		fMemoryUsed += kBuilderChunkSize;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Sorts the entries by key, and duplicates by value, using a bottom up
+	merge sort, as qsort() has no way to pass the tree to the compare
+	function.
+*/
+status_t
+TreeBuilder::_Sort()
+{
+	builder_entry** buffer
+		= (builder_entry**)malloc(fCount * sizeof(builder_entry*));
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+
+	builder_entry** source = fEntries;
+	builder_entry** target = buffer;
+
+	for (int32 width = 1; width < fCount; width *= 2) {
+		for (int32 start = 0; start < fCount; start += 2 * width) {
+			int32 middle = min_c(start + width, fCount);
+			int32 end = min_c(start + 2 * width, fCount);
+			int32 left = start;
+			int32 right = middle;
+
+			for (int32 i = start; i < end; i++) {
+				if (left < middle && (right == end
+						|| _Compare(source[left], source[right]) <= 0))
+					target[i] = source[left++];
+				else
+					target[i] = source[right++];
+			}
+		}
+
+		builder_entry** swap = source;
+		source = target;
+		target = swap;
+	}
+
+	if (source != fEntries)
+		memcpy(fEntries, source, fCount * sizeof(builder_entry*));
+
+	free(buffer);
+	return B_OK;
+}
+
+
+int32
+TreeBuilder::_Compare(const builder_entry* a, const builder_entry* b)
+{
+	int32 compare = fTree->_CompareKeys(a->key, a->length, b->key,
+		b->length);
+	if (compare != 0)
+		return compare;
+
+	return a->value < b->value ? -1 : a->value > b->value ? 1 : 0;
+}
+
+
+bool
+TreeBuilder::_TreeIsEmpty()
+{
+	if (fTree->fHeader.RootNode() != (off_t)fTree->fNodeSize
+		|| fTree->fHeader.MaxNumberOfLevels() != 1)
+		return false;
+
+	CachedNode cached(fTree);
+	const bplustree_node* root = cached.SetTo(fTree->fHeader.RootNode());
+	return root != NULL && root->IsLeaf() && root->NumKeys() == 0;
+}
+
+
+/*!	Returns whether or not a node with \a keyCount keys that have a length
+	of \a keyLength bytes altogether fits into a node. Uses the same limit
+	as BPlusTree::Insert().
+*/
+bool
+TreeBuilder::_Fits(int32 keyCount, uint32 keyLength) const
+{
+	return key_align(sizeof(bplustree_node) + keyLength)
+		+ keyCount * (sizeof(uint16) + sizeof(off_t)) < fTree->fNodeSize;
+}
+
+
+/*!	Inserts a single entry into the tree in a transaction of its own. */
+status_t
+TreeBuilder::_Insert(const uint8* key, uint16 keyLength, off_t value)
+{
+	Inode* stream = fTree->fStream;
+	Transaction transaction(stream->GetVolume(), stream->BlockNumber());
+	stream->WriteLockInTransaction(transaction);
+
+	status_t status = fTree->Insert(transaction, key, keyLength, value);
+	if (status != B_OK)
+		RETURN_ERROR(status);
+
+	return transaction.Done();
+}
+
+
+/*!	Inserts all collected entries into the tree one by one. This works
+	for any tree, but is faster when the entries are sorted.
+*/
+status_t
+TreeBuilder::_InsertEntries()
+{
+	Inode* stream = fTree->fStream;
+	Transaction transaction(stream->GetVolume(), stream->BlockNumber());
+	stream->WriteLockInTransaction(transaction);
+
+	for (int32 i = 0; i < fCount; i++) {
+		if (i > 0 && i % kInsertsPerTransaction == 0) {
+			status_t status = _RestartTransaction(transaction);
+			if (status != B_OK)
+				return status;
+		}
+
+		builder_entry* entry = fEntries[i];
+		status_t status = fTree->Insert(transaction, entry->key,
+			entry->length, entry->value);
+		if (status != B_OK)
+			RETURN_ERROR(status);
+	}
+
+	return transaction.Done();
+}
+
+
+/*!	Builds the tree from the sorted entries: first the leaves, and then
+	the levels above them, until only the root node is left.
+	All nodes are written behind the empty root node, which is only replaced
+	in the very last transaction, together with the header. If anything
+	goes wrong in between, the tree stays empty, and only the space written
+	to so far is lost.
+	The caller must hold the journal lock across all transactions, as the
+	root node, and the nodes behind maximum_size must not be used by anyone
+	else until the tree is complete.
+*/
+status_t
+TreeBuilder::_Build()
+{
+	Inode* stream = fTree->fStream;
+	Transaction transaction(stream->GetVolume(), stream->BlockNumber());
+	stream->WriteLockInTransaction(transaction);
+
+	{
+		// All nodes behind the root are going to be overwritten
+		CachedNode cached(fTree);
+		bplustree_header* header = cached.SetToWritableHeader(transaction);
+		if (header == NULL)
+			RETURN_ERROR(B_IO_ERROR);
+
+		header->free_node_pointer
+			= HOST_ENDIAN_TO_BFS_INT64((uint64)BPLUSTREE_NULL);
+		header->maximum_size = HOST_ENDIAN_TO_BFS_INT64(stream->Size());
+	}
+
+	fFragments = (bplustree_node*)malloc(fTree->fNodeSize);
+	if (fFragments == NULL)
+		return B_NO_MEMORY;
+
+	fNextOffset = 2 * fTree->fNodeSize;
+	fNodesWritten = 0;
+	fFragmentsOffset = BPLUSTREE_NULL;
+	fFragmentIndex = 0;
+
+	builder_key* keys = NULL;
+	int32 count = 0;
+	uint32 levels = 1;
+
+	status_t status = _BuildLeaves(transaction, &keys, &count);
+	while (status == B_OK && count > 1) {
+		status = _BuildLevel(transaction, keys, &count);
+		levels++;
+	}
+
+	free(keys);
+	free(fFragments);
+	fFragments = NULL;
+
+	if (status != B_OK)
+		return status;
+
+	// The root node has just been written; now update the header, and cut
+	// off the space that was not needed
+
+	CachedNode cached(fTree);
+	bplustree_header* header = cached.SetToWritableHeader(transaction);
+	if (header == NULL)
+		RETURN_ERROR(B_IO_ERROR);
+
+	header->max_number_of_levels = HOST_ENDIAN_TO_BFS_INT32(levels);
+
+	if (fNextOffset < stream->Size()) {
+		status = stream->SetFileSize(transaction, fNextOffset);
+		if (status != B_OK)
+			return status;
+
+		header->maximum_size = HOST_ENDIAN_TO_BFS_INT64(fNextOffset);
+	}
+
+	cached.Unset();
+	return transaction.Done();
+}
+
+
+/*!	Writes the leaf nodes, and returns the largest key, and the offset of
+	every leaf in \a _keys, so that the next level can be built from them.
+*/
+status_t
+TreeBuilder::_BuildLeaves(Transaction& transaction, builder_key** _keys,
+	int32* _count)
+{
+	uint32 nodeSize = fTree->fNodeSize;
+	bplustree_node* node = (bplustree_node*)malloc(nodeSize);
+	builder_key* items = (builder_key*)malloc(
+		(nodeSize / (sizeof(uint16) + sizeof(off_t)) + 1)
+			* sizeof(builder_key));
+	MemoryDeleter nodeDeleter(node);
+	MemoryDeleter itemsDeleter(items);
+	if (node == NULL || items == NULL)
+		return B_NO_MEMORY;
+
+	builder_key* leaves = NULL;
+	int32 leafCount = 0;
+	int32 leafCapacity = 0;
+
+	off_t offset = BPLUSTREE_NULL;
+	off_t previous = BPLUSTREE_NULL;
+	int32 itemCount = 0;
+	uint32 keyLength = 0;
+	status_t status = B_OK;
+
+	for (int32 first = 0; first <= fCount; ) {
+		const builder_entry* entry = first < fCount ? fEntries[first] : NULL;
+		bool isLast = entry == NULL;
+
+		if (isLast || !_Fits(itemCount + 1, keyLength + entry->length)) {
+			// This leaf is complete, write it
+			off_t next = BPLUSTREE_NULL;
+			if (isLast) {
+				// Fragments must be written before the root node
+				status = _WriteFragments(transaction);
+				if (status == B_OK && offset == BPLUSTREE_NULL)
+					offset = nodeSize;
+			} else {
+				if (offset == BPLUSTREE_NULL)
+					status = _AllocateNode(transaction, &offset);
+				if (status == B_OK)
+					status = _AllocateNode(transaction, &next);
+			}
+
+			if (status == B_OK && leafCount == leafCapacity) {
+				leafCapacity = max_c(leafCapacity * 2, 64);
+				builder_key* newLeaves = (builder_key*)realloc(leaves,
+					leafCapacity * sizeof(builder_key));
+				if (newLeaves != NULL)
+					leaves = newLeaves;
+				else
+					status = B_NO_MEMORY;
+			}
+			if (status == B_OK) {
+				memset(node, 0, nodeSize);
+				fill_node(node, items, itemCount);
+				node->left_link = HOST_ENDIAN_TO_BFS_INT64(previous);
+				node->right_link = HOST_ENDIAN_TO_BFS_INT64(next);
+				node->overflow_link
+					= HOST_ENDIAN_TO_BFS_INT64((uint64)BPLUSTREE_NULL);
+
+				status = _WriteNode(transaction, offset, node);
+			}
+			if (status != B_OK)
+				break;
+
+			leaves[leafCount].entry = items[itemCount - 1].entry;
+			leaves[leafCount].value = offset;
+			leafCount++;
+
+			if (isLast)
+				break;
+
+			previous = offset;
+			offset = next;
+			itemCount = 0;
+			keyLength = 0;
+		}
+
+		// Collect all values of this key
+		int32 end = first + 1;
+		while (end < fCount && fTree->_CompareKeys(entry->key, entry->length,
+				fEntries[end]->key, fEntries[end]->length) == 0) {
+			end++;
+		}
+
+		if (end - first > 1 && !fTree->fAllowDuplicates) {
+			status = B_NAME_IN_USE;
+			break;
+		}
+
+		status = _DuplicateLink(transaction, first, end - first,
+			&items[itemCount].value);
+		if (status != B_OK)
+			break;
+
+		items[itemCount].entry = entry;
+		itemCount++;
+		keyLength += entry->length;
+		first = end;
+	}
+
+	if (status != B_OK) {
+		free(leaves);
+		return status;
+	}
+
+	*_keys = leaves;
+	*_count = leafCount;
+	return B_OK;
+}
+
+
+/*!	Writes the level above the nodes in \a keys, and replaces them with
+	the nodes of the new level. Every node is filled with as many children
+	as possible; the last child of a node is referenced by its overflow link.
+*/
+status_t
+TreeBuilder::_BuildLevel(Transaction& transaction, builder_key* keys,
+	int32* _count)
+{
+	uint32 nodeSize = fTree->fNodeSize;
+	bplustree_node* node = (bplustree_node*)malloc(nodeSize);
+	if (node == NULL)
+		return B_NO_MEMORY;
+
+	MemoryDeleter nodeDeleter(node);
+
+	int32 count = *_count;
+	int32 nodeCount = 0;
+	off_t offset = BPLUSTREE_NULL;
+	off_t previous = BPLUSTREE_NULL;
+
+	for (int32 start = 0; start < count; ) {
+		// All children but the last one need a key in this node
+		int32 end = start + 1;
+		uint32 keyLength = 0;
+		while (end < count
+			&& _Fits(end - start, keyLength + keys[end - 1].entry->length)) {
+			keyLength += keys[end - 1].entry->length;
+			end++;
+		}
+
+		// Don't leave a node with a single child behind
+		if (end == count - 1 && end - start > 2)
+			end--;
+
+		status_t status = B_OK;
+		off_t next = BPLUSTREE_NULL;
+		if (offset == BPLUSTREE_NULL) {
+			if (start == 0 && end == count)
+				offset = nodeSize;
+			else
+				status = _AllocateNode(transaction, &offset);
+		}
+		if (status == B_OK && end < count)
+			status = _AllocateNode(transaction, &next);
+		if (status != B_OK)
+			return status;
+
+		memset(node, 0, nodeSize);
+		fill_node(node, keys + start, end - 1 - start);
+		node->left_link = HOST_ENDIAN_TO_BFS_INT64(previous);
+		node->right_link = HOST_ENDIAN_TO_BFS_INT64(next);
+		node->overflow_link = HOST_ENDIAN_TO_BFS_INT64(keys[end - 1].value);
+
+		status = _WriteNode(transaction, offset, node);
+		if (status != B_OK)
+			return status;
+
+		// The new node replaces its children in the array; it can never
+		// overwrite one that has not been used yet
+		keys[nodeCount].entry = keys[end - 1].entry;
+		keys[nodeCount].value = offset;
+		nodeCount++;
+
+		previous = offset;
+		offset = next;
+		start = end;
+	}
+
+	*_count = nodeCount;
+	return B_OK;
+}
+
+
+/*!	Returns the value that is stored in the leaf for the \a count entries
+	starting at \a first, which all share the same key. Duplicates are put
+	into a fragment if there are only a few of them, or into as many
+	completely filled duplicate nodes as needed.
+*/
+status_t
+TreeBuilder::_DuplicateLink(Transaction& transaction, int32 first,
+	int32 count, off_t* _link)
+{
+	if (count == 1) {
+		*_link = fEntries[first]->value;
+		return B_OK;
+	}
+
+	uint32 nodeSize = fTree->fNodeSize;
+
+	if (count <= NUM_FRAGMENT_VALUES) {
+		if (fFragmentsOffset == BPLUSTREE_NULL
+			|| fFragmentIndex >= bplustree_node::MaxFragments(nodeSize)) {
+			status_t status = _WriteFragments(transaction);
+			if (status == B_OK)
+				status = _AllocateNode(transaction, &fFragmentsOffset);
+			if (status != B_OK)
+				return status;
+
+			memset(fFragments, 0, nodeSize);
+			fFragmentIndex = 0;
+		}
+
+		duplicate_array* array = fFragments->FragmentAt(fFragmentIndex);
+		array->count = HOST_ENDIAN_TO_BFS_INT64(count);
+		for (int32 i = 0; i < count; i++)
+			array->SetValueAt(i, fEntries[first + i]->value);
+
+		*_link = bplustree_node::MakeLink(BPLUSTREE_DUPLICATE_FRAGMENT,
+			fFragmentsOffset, fFragmentIndex++);
+		return B_OK;
+	}
+
+	bplustree_node* node = (bplustree_node*)malloc(nodeSize);
+	if (node == NULL)
+		return B_NO_MEMORY;
+
+	MemoryDeleter nodeDeleter(node);
+
+	off_t offset;
+	status_t status = _AllocateNode(transaction, &offset);
+	if (status != B_OK)
+		return status;
+
+	*_link = bplustree_node::MakeLink(BPLUSTREE_DUPLICATE_NODE, offset);
+	off_t previous = BPLUSTREE_NULL;
+
+	for (int32 index = 0; index < count; index += NUM_DUPLICATE_VALUES) {
+		int32 valueCount = min_c(count - index, NUM_DUPLICATE_VALUES);
+		off_t next = BPLUSTREE_NULL;
+		if (index + valueCount < count) {
+			status = _AllocateNode(transaction, &next);
+			if (status != B_OK)
+				return status;
+		}
+
+		memset(node, 0, nodeSize);
+		node->left_link = HOST_ENDIAN_TO_BFS_INT64(previous);
+		node->right_link = HOST_ENDIAN_TO_BFS_INT64(next);
+
+		duplicate_array* array = node->DuplicateArray();
+		array->count = HOST_ENDIAN_TO_BFS_INT64(valueCount);
+		for (int32 i = 0; i < valueCount; i++)
+			array->SetValueAt(i, fEntries[first + index + i]->value);
+
+		status = _WriteNode(transaction, offset, node);
+		if (status != B_OK)
+			return status;
+
+		previous = offset;
+		offset = next;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Returns the offset of the next unused node; the stream is grown in
+	larger steps if needed.
+*/
+status_t
+TreeBuilder::_AllocateNode(Transaction& transaction, off_t* _offset)
+{
+	Inode* stream = fTree->fStream;
+	uint32 nodeSize = fTree->fNodeSize;
+
+	if (fNextOffset + (off_t)nodeSize > stream->Size()) {
+		off_t size = stream->Size();
+		off_t grow = max_c(size / 4, 65536);
+		grow = max_c(grow - grow % nodeSize, (off_t)nodeSize);
+
+		status_t status = stream->SetFileSize(transaction, size + grow);
+		if (status != B_OK)
+			return status;
+
+		CachedNode cached(fTree);
+		bplustree_header* header = cached.SetToWritableHeader(transaction);
+		if (header == NULL)
+			RETURN_ERROR(B_IO_ERROR);
+
+		header->maximum_size = HOST_ENDIAN_TO_BFS_INT64(size + grow);
+	}
+
+	*_offset = fNextOffset;
+	fNextOffset += nodeSize;
+	return B_OK;
+}
+
+
+status_t
+TreeBuilder::_WriteNode(Transaction& transaction, off_t offset,
+	const bplustree_node* node)
+{
+	// Don't let the transaction grow too large; the nodes written so far
+	// are not yet part of the tree, anyway
+	if (++fNodesWritten % (kBuilderTransactionSize / fTree->fNodeSize) == 0) {
+		status_t status = _RestartTransaction(transaction);
+		if (status != B_OK)
+			return status;
+	}
+
+	CachedNode cached(fTree);
+	bplustree_node* target = cached.SetToWritable(transaction, offset, false);
+	if (target == NULL)
+		RETURN_ERROR(B_IO_ERROR);
+
+	memcpy(target, node, fTree->fNodeSize);
+	return B_OK;
+}
+
+
+status_t
+TreeBuilder::_WriteFragments(Transaction& transaction)
+{
+	if (fFragmentsOffset == BPLUSTREE_NULL)
+		return B_OK;
+
+	status_t status = _WriteNode(transaction, fFragmentsOffset, fFragments);
+	fFragmentsOffset = BPLUSTREE_NULL;
+	return status;
+}
+
+
+status_t
+TreeBuilder::_RestartTransaction(Transaction& transaction)
+{
+	Inode* stream = fTree->fStream;
+
+	status_t status = transaction.Done();
+	if (status == B_OK)
+		status = transaction.Start(stream->GetVolume(), stream->BlockNumber());
+	if (status != B_OK)
+		return status;
+
+	stream->WriteLockInTransaction(transaction);
+	return B_OK;
+}
+#endif // !_BOOT_MODE
+
+
 // #pragma mark -
 
 
@@ -149,6 +149,9 @@ enum bplustree_traversing {
 class BPlusTree;
 struct TreeCheck;
 class TreeIterator;
+#if !_BOOT_MODE
+class TreeBuilder;
+#endif
 
 
 #if !_BOOT_MODE
@@ -362,6 +365,9 @@ private:
 			friend class TreeIterator;
 			friend class CachedNode;
 			friend class TreeCheck;
+#if !_BOOT_MODE
+			friend class TreeBuilder;
+#endif
 
 			Inode*				fStream;
 			bplustree_header	fHeader;
@@ -427,6 +433,75 @@ private:
 };
 
 
+#if !_BOOT_MODE
+struct builder_chunk;
+struct builder_entry;
+struct builder_key;
+
+
+/*!	Fills a B+tree with many entries at once: the entries are collected in
+	memory, sorted, and then written bottom up into completely packed nodes,
+	instead of being inserted one by one.
+*/
+class TreeBuilder {
+public:
+								TreeBuilder(BPlusTree* tree);
+								~TreeBuilder();
+
+			status_t			Add(const uint8* key, uint16 keyLength,
+									off_t value);
+			status_t			Flush();
+			status_t			Finish();
+
+			BPlusTree*			Tree() const { return fTree; }
+			size_t				MemoryUsed() const { return fMemoryUsed; }
+
+private:
+			void				_MakeEmpty();
+			status_t			_Reserve(size_t size);
+			status_t			_Sort();
+			int32				_Compare(const builder_entry* a,
+									const builder_entry* b);
+			bool				_TreeIsEmpty();
+			bool				_Fits(int32 keyCount, uint32 keyLength) const;
+
+			status_t			_Insert(const uint8* key, uint16 keyLength,
+									off_t value);
+			status_t			_InsertEntries();
+			status_t			_Build();
+			status_t			_BuildLeaves(Transaction& transaction,
+									builder_key** _keys, int32* _count);
+			status_t			_BuildLevel(Transaction& transaction,
+									builder_key* keys, int32* _count);
+			status_t			_DuplicateLink(Transaction& transaction,
+									int32 first, int32 count, off_t* _link);
+
+			status_t			_AllocateNode(Transaction& transaction,
+									off_t* _offset);
+			status_t			_WriteNode(Transaction& transaction,
+									off_t offset, const bplustree_node* node);
+			status_t			_WriteFragments(Transaction& transaction);
+			status_t			_RestartTransaction(Transaction& transaction);
+
+private:
+			BPlusTree*			fTree;
+			builder_chunk*		fChunks;
+			size_t				fChunkUsed;
+			builder_entry**		fEntries;
+			int32				fCount;
+			int32				fCapacity;
+			size_t				fMemoryUsed;
+
+			// only used while the tree is built
+			off_t				fNextOffset;
+			int32				fNodesWritten;
+			bplustree_node*		fFragments;
+			off_t				fFragmentsOffset;
+			uint32				fFragmentIndex;
+};
+#endif // !_BOOT_MODE
+
+
 //	#pragma mark - BPlusTree's inline functions
 //	(most of them may not be needed)
 
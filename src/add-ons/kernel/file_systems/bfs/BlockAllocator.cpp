@@ -172,13 +172,15 @@ private:
 struct check_index {
 	check_index()
 		:
-		inode(NULL)
+		inode(NULL),
+		builder(NULL)
 	{
 	}
 
 	char				name[B_FILE_NAME_LENGTH];
 	block_run			run;
 	Inode*				inode;
+	TreeBuilder*		builder;
 };
 
 
@@ -222,32 +224,78 @@ private:
 };
 
 
+struct free_range {
+	int32	start;
+	int32	length;
+};
+
+// The maximum number of free ranges an allocation group keeps track of; if
+// its free space is more fragmented than that, the block bitmap is scanned
+// instead.
+static const int32 kMaxFreeRanges = 64;
+
+// The data of new files is spread over this many allocation groups following
+// the one of their inode.
+static const int32 kFileDataGroups = 4;
+
+// The memory all index builders of a check may use together; when they use
+// more, the entries of the largest one are written to its index.
+static const size_t kMaxIndexBuilderMemory = 32 * 1024 * 1024;
+
+
 class AllocationGroup {
 public:
 	AllocationGroup();
+	~AllocationGroup();
 
+	void StartScan();
 	void AddFreeRange(int32 start, int32 blocks);
+	void FinishScan();
+	status_t Rescan(Volume* volume);
+
 	bool IsFull() const { return fFreeBits == 0; }
+	bool HasFreeRanges() const { return fRangesValid; }
+	bool ShouldRescan() const { return fFreeBits > fRescanFreeBits; }
+	void InvalidateFreeRanges();
+	void FindFreeRange(int32 start, int32 maximum, int32& _start,
+		int32& _length) const;
 
 	status_t Allocate(Transaction& transaction, uint16 start, int32 length);
 	status_t Free(Transaction& transaction, uint16 start, int32 length);
+	status_t Reserve(Transaction& transaction, uint16 start, int32 length);
 
 	uint32 NumBits() const { return fNumBits; }
 	uint32 NumBlocks() const { return fNumBlocks; }
 	int32 Start() const { return fStart; }
 
+private:
+	int32 _FindRange(int32 start) const;
+	bool _InsertRange(int32 index, int32 start, int32 length);
+	void _RemoveRange(int32 index);
+	void _AllocateRange(int32 start, int32 length);
+	void _FreeRange(int32 start, int32 length);
+	void _UpdateFromRanges();
+
 private:
 	friend class BlockAllocator;
 
+	mutex	fLock;
 	uint32	fNumBits;
 	uint32	fNumBlocks;
 	int32	fStart;
 	int32	fFirstFree;
 	int32	fFreeBits;
+	uint32	fChangeCount;
 
 	int32	fLargestStart;
 	int32	fLargestLength;
 	bool	fLargestValid;
+
+	free_range* fRanges;
+	int32	fRangeCount;
+	int32	fRangeCapacity;
+	bool	fRangesValid;
+	int32	fRescanFreeBits;
 };
 
 
@@ -377,8 +425,37 @@ AllocationGroup::AllocationGroup()
 	:
 	fFirstFree(-1),
 	fFreeBits(0),
-	fLargestValid(false)
+	fChangeCount(0),
+	fLargestValid(false),
+	fRanges(NULL),
+	fRangeCount(0),
+	fRangeCapacity(0),
+	fRangesValid(false),
+	fRescanFreeBits(-1)
+{
+	mutex_init(&fLock, "bfs allocation group");
+}
+
+
+AllocationGroup::~AllocationGroup()
+{
+	mutex_destroy(&fLock);
+	free(fRanges);
+}
+
+
+/*!	Forgets everything the group knows about its free space. The free ranges
+	must then be added in ascending order via AddFreeRange(), followed by a
+	call to FinishScan().
+*/
+void
+AllocationGroup::StartScan()
 {
+	fFirstFree = -1;
+	fFreeBits = 0;
+	fLargestValid = false;
+	fRangeCount = 0;
+	fRangesValid = true;
 }
 
 
@@ -397,15 +474,263 @@ AllocationGroup::AddFreeRange(int32 start, int32 blocks)
 		fLargestValid = true;
 	}
 
+	if (fRangesValid && !_InsertRange(fRangeCount, start, blocks))
+		InvalidateFreeRanges();
+
 	fFreeBits += blocks;
 }
 
 
+void
+AllocationGroup::FinishScan()
+{
+	if (fFirstFree == -1)
+		fFirstFree = fNumBits;
+
+	// If the group has too many free ranges, there is no use in scanning it
+	// again before some blocks have been freed.
+	fRescanFreeBits = fFreeBits;
+	fChangeCount++;
+}
+
+
+/*!	Rebuilds the free space information of the group from its block bitmap
+	as found in the block cache.
+	The group's lock must be held.
+*/
+status_t
+AllocationGroup::Rescan(Volume* volume)
+{
+	AllocationBlock cached(volume);
+	int32 freeBits = fFreeBits;
+	int32 firstFree = fFirstFree;
+	int32 start = -1, range = 0, bit = 0;
+
+	StartScan();
+
+	for (uint32 block = 0; block < fNumBlocks; block++) {
+		if (cached.SetTo(*this, block) != B_OK) {
+			fFreeBits = freeBits;
+			fFirstFree = firstFree;
+			fLargestValid = false;
+			InvalidateFreeRanges();
+			RETURN_ERROR(B_IO_ERROR);
+		}
+
+		for (uint32 i = 0; i < cached.NumBlockBits(); i++, bit++) {
+			if (cached.IsUsed(i)) {
+				// block is in use
+				if (range > 0) {
+					AddFreeRange(start, range);
+					range = 0;
+				}
+			} else if (range++ == 0) {
+				// block is free, start new free range
+				start = bit;
+			}
+		}
+	}
+	if (range > 0)
+		AddFreeRange(start, range);
+
+	FinishScan();
+	return B_OK;
+}
+
+
+void
+AllocationGroup::InvalidateFreeRanges()
+{
+	fRangesValid = false;
+	fRangeCount = 0;
+}
+
+
+/*!	Returns the first free range at or after \a start that can hold
+	\a maximum blocks, or the largest one if there is no such range.
+	\a _length is zero if there is no free block after \a start at all.
+	The free ranges must be valid.
+*/
+void
+AllocationGroup::FindFreeRange(int32 start, int32 maximum, int32& _start,
+	int32& _length) const
+{
+	ASSERT(fRangesValid);
+
+	_start = -1;
+	_length = 0;
+
+	for (int32 i = 0; i < fRangeCount; i++) {
+		int32 rangeStart = max_c(fRanges[i].start, start);
+		int32 length = fRanges[i].start + fRanges[i].length - rangeStart;
+		if (length <= _length)
+			continue;
+
+		_start = rangeStart;
+		_length = length;
+
+		if (length >= maximum)
+			return;
+	}
+}
+
+
+/*!	Returns the index of the last free range that starts at or before
+	\a start, or -1 if there is none.
+*/
+int32
+AllocationGroup::_FindRange(int32 start) const
+{
+	int32 low = 0;
+	int32 high = fRangeCount - 1;
+
+	while (low <= high) {
+		int32 middle = (low + high) / 2;
+		if (fRanges[middle].start <= start)
+			low = middle + 1;
+		else
+			high = middle - 1;
+	}
+
+	return high;
+}
+
+
+bool
+AllocationGroup::_InsertRange(int32 index, int32 start, int32 length)
+{
+	if (fRangeCount == fRangeCapacity) {
+		if (fRangeCapacity == kMaxFreeRanges)
+			return false;
+
+		int32 capacity = fRangeCapacity == 0 ? 4 : fRangeCapacity * 2;
+		free_range* ranges = (free_range*)realloc(fRanges,
+			capacity * sizeof(free_range));
+		if (ranges == NULL)
+			return false;
+
+		fRanges = ranges;
+		fRangeCapacity = capacity;
+	}
+
+	memmove(&fRanges[index + 1], &fRanges[index],
+		(fRangeCount - index) * sizeof(free_range));
+
+	fRanges[index].start = start;
+	fRanges[index].length = length;
+	fRangeCount++;
+	return true;
+}
+
+
+void
+AllocationGroup::_RemoveRange(int32 index)
+{
+	fRangeCount--;
+	memmove(&fRanges[index], &fRanges[index + 1],
+		(fRangeCount - index) * sizeof(free_range));
+}
+
+
+/*!	Removes the given range from the free ranges, and splits the range
+	it was part of, if necessary.
+*/
+void
+AllocationGroup::_AllocateRange(int32 start, int32 length)
+{
+	int32 index = _FindRange(start);
+	if (index < 0
+		|| start + length > fRanges[index].start + fRanges[index].length) {
+		// The range is not completely free as far as we know; we can no
+		// longer trust our free ranges.
+		InvalidateFreeRanges();
+		return;
+	}
+
+	free_range& range = fRanges[index];
+	int32 end = start + length;
+	int32 rangeEnd = range.start + range.length;
+
+	if (start == range.start) {
+		if (end == rangeEnd)
+			_RemoveRange(index);
+		else {
+			range.start = end;
+			range.length = rangeEnd - end;
+		}
+		return;
+	}
+
+	range.length = start - range.start;
+	if (end < rangeEnd && !_InsertRange(index + 1, end, rangeEnd - end))
+		InvalidateFreeRanges();
+}
+
+
+/*!	Adds the given range to the free ranges, and joins it with its
+	neighbours, if possible.
+*/
+void
+AllocationGroup::_FreeRange(int32 start, int32 length)
+{
+	int32 index = _FindRange(start);
+	int32 end = start + length;
+	bool joinPrevious = false;
+	bool joinNext = false;
+
+	if (index >= 0) {
+		int32 previousEnd = fRanges[index].start + fRanges[index].length;
+		if (previousEnd > start) {
+			// the range is already free as far as we know
+			InvalidateFreeRanges();
+			return;
+		}
+		joinPrevious = previousEnd == start;
+	}
+	if (index + 1 < fRangeCount) {
+		if (fRanges[index + 1].start < end) {
+			InvalidateFreeRanges();
+			return;
+		}
+		joinNext = fRanges[index + 1].start == end;
+	}
+
+	if (joinPrevious && joinNext) {
+		fRanges[index].length += length + fRanges[index + 1].length;
+		_RemoveRange(index + 1);
+	} else if (joinPrevious)
+		fRanges[index].length += length;
+	else if (joinNext) {
+		fRanges[index + 1].start = start;
+		fRanges[index + 1].length += length;
+	} else if (!_InsertRange(index + 1, start, length))
+		InvalidateFreeRanges();
+}
+
+
+/*!	Updates the first free and largest range hints from the free ranges. */
+void
+AllocationGroup::_UpdateFromRanges()
+{
+	fFirstFree = fRangeCount > 0 ? fRanges[0].start : fNumBits;
+	fLargestValid = fRangeCount > 0;
+	fLargestLength = 0;
+
+	for (int32 i = 0; i < fRangeCount; i++) {
+		if (fRanges[i].length > fLargestLength) {
+			fLargestStart = fRanges[i].start;
+			fLargestLength = fRanges[i].length;
+		}
+	}
+}
+
+
 /*!	Allocates the specified run in the allocation group.
 	Doesn't check if the run is valid or already allocated partially, nor
-	does it maintain the free ranges hints or the volume's used blocks count.
-	It only does the low-level work of allocating some bits in the block bitmap.
-	Assumes that the block bitmap lock is hold.
+	does it maintain the volume's used blocks count.
+	Besides the group's free space information, it only does the low-level
+	work of allocating some bits in the block bitmap.
+	Assumes that the group's lock is held.
 */
 status_t
 AllocationGroup::Allocate(Transaction& transaction, uint16 start, int32 length)
@@ -414,29 +739,38 @@ AllocationGroup::Allocate(Transaction& transaction, uint16 start, int32 length)
 
 	// Update the allocation group info
 	// TODO: this info will be incorrect if something goes wrong later
-	// Note, the fFirstFree block doesn't have to be really free
-	if (start == fFirstFree)
-		fFirstFree = start + length;
 	fFreeBits -= length;
-
-	if (fLargestValid) {
-		bool cut = false;
-		if (fLargestStart == start) {
-			// cut from start
-			fLargestStart += length;
-			fLargestLength -= length;
-			cut = true;
-		} else if (start > fLargestStart
-			&& start < fLargestStart + fLargestLength) {
-			// cut from end
-			fLargestLength = start - fLargestStart;
-			cut = true;
-		}
-		if (cut && (fLargestLength < fLargestStart
-				|| fLargestLength
-						< (int32)fNumBits - (fLargestStart + fLargestLength))) {
-			// might not be the largest block anymore
-			fLargestValid = false;
+	fChangeCount++;
+
+	if (fRangesValid)
+		_AllocateRange(start, length);
+
+	if (fRangesValid)
+		_UpdateFromRanges();
+	else {
+		// Note, the fFirstFree block doesn't have to be really free
+		if (start == fFirstFree)
+			fFirstFree = start + length;
+
+		if (fLargestValid) {
+			bool cut = false;
+			if (fLargestStart == start) {
+				// cut from start
+				fLargestStart += length;
+				fLargestLength -= length;
+				cut = true;
+			} else if (start > fLargestStart
+				&& start < fLargestStart + fLargestLength) {
+				// cut from end
+				fLargestLength = start - fLargestStart;
+				cut = true;
+			}
+			if (cut && (fLargestLength < fLargestStart
+					|| fLargestLength < (int32)fNumBits
+						- (fLargestStart + fLargestLength))) {
+				// might not be the largest block anymore
+				fLargestValid = false;
+			}
 		}
 	}
 
@@ -452,6 +786,8 @@ AllocationGroup::Allocate(Transaction& transaction, uint16 start, int32 length)
 	while (length > 0) {
 		if (cached.SetToWritable(transaction, *this, block) < B_OK) {
 			fLargestValid = false;
+			InvalidateFreeRanges();
+			fRescanFreeBits = -1;
 			RETURN_ERROR(B_IO_ERROR);
 		}
 
@@ -472,9 +808,10 @@ AllocationGroup::Allocate(Transaction& transaction, uint16 start, int32 length)
 
 /*!	Frees the specified run in the allocation group.
 	Doesn't check if the run is valid or was not completely allocated, nor
-	does it maintain the free ranges hints or the volume's used blocks count.
-	It only does the low-level work of freeing some bits in the block bitmap.
-	Assumes that the block bitmap lock is hold.
+	does it maintain the volume's used blocks count.
+	Besides the group's free space information, it only does the low-level
+	work of freeing some bits in the block bitmap.
+	Assumes that the group's lock is held.
 */
 status_t
 AllocationGroup::Free(Transaction& transaction, uint16 start, int32 length)
@@ -483,22 +820,31 @@ AllocationGroup::Free(Transaction& transaction, uint16 start, int32 length)
 
 	// Update the allocation group info
 	// TODO: this info will be incorrect if something goes wrong later
-	if (fFirstFree > start)
-		fFirstFree = start;
 	fFreeBits += length;
+	fChangeCount++;
 
 	// The range to be freed cannot be part of the valid largest range
 	ASSERT(!fLargestValid || start + length <= fLargestStart
 		|| start > fLargestStart);
 
-	if (fLargestValid
-		&& (start + length == fLargestStart
-			|| fLargestStart + fLargestLength == start
-			|| (start < fLargestStart && fLargestStart > fLargestLength)
-			|| (start > fLargestStart
-				&& (int32)fNumBits - (fLargestStart + fLargestLength)
-						> fLargestLength))) {
-		fLargestValid = false;
+	if (fRangesValid)
+		_FreeRange(start, length);
+
+	if (fRangesValid)
+		_UpdateFromRanges();
+	else {
+		if (fFirstFree > start)
+			fFirstFree = start;
+
+		if (fLargestValid
+			&& (start + length == fLargestStart
+				|| fLargestStart + fLargestLength == start
+				|| (start < fLargestStart && fLargestStart > fLargestLength)
+				|| (start > fLargestStart
+					&& (int32)fNumBits - (fLargestStart + fLargestLength)
+							> fLargestLength))) {
+			fLargestValid = false;
+		}
 	}
 
 	Volume* volume = transaction.GetVolume();
@@ -530,6 +876,40 @@ AllocationGroup::Free(Transaction& transaction, uint16 start, int32 length)
 }
 
 
+/*!	Sets the bits of the specified run in the block bitmap that aren't set
+	yet. Unlike Allocate(), it leaves the group's free space information
+	alone, as it is meant for blocks that have been counted as used already.
+	Assumes that the group's lock is held.
+*/
+status_t
+AllocationGroup::Reserve(Transaction& transaction, uint16 start, int32 length)
+{
+	ASSERT(start + length <= (int32)fNumBits);
+
+	Volume* volume = transaction.GetVolume();
+	uint32 bitsPerBlock = volume->BlockSize() << 3;
+	uint32 block = start / bitsPerBlock;
+	uint32 bit = start % bitsPerBlock;
+
+	AllocationBlock cached(volume);
+
+	while (length > 0) {
+		if (cached.SetToWritable(transaction, *this, block) < B_OK)
+			RETURN_ERROR(B_IO_ERROR);
+
+		for (; bit < cached.NumBlockBits() && length > 0; bit++, length--) {
+			if (!cached.IsUsed(bit))
+				cached.Allocate(bit, 1);
+		}
+
+		bit = 0;
+		block++;
+	}
+
+	return B_OK;
+}
+
+
 //	#pragma mark -
 
 
@@ -541,12 +921,14 @@ BlockAllocator::BlockAllocator(Volume* volume)
 	fCheckCookie(NULL)
 {
 	recursive_lock_init(&fLock, "bfs allocator");
+	mutex_init(&fUsedBlocksLock, "bfs used blocks");
 }
 
 
 BlockAllocator::~BlockAllocator()
 {
 	recursive_lock_destroy(&fLock);
+	mutex_destroy(&fUsedBlocksLock);
 	delete[] fGroups;
 }
 
@@ -567,7 +949,8 @@ BlockAllocator::Initialize(bool full)
 		return B_OK;
 
 	recursive_lock_lock(&fLock);
-		// the lock will be released by the _Initialize() method
+	_LockGroups();
+		// the locks will be released by the _Initialize() method
 
 	thread_id id = spawn_kernel_thread((thread_func)BlockAllocator::_Initialize,
 		"bfs block allocator", B_LOW_PRIORITY, this);
@@ -575,6 +958,8 @@ BlockAllocator::Initialize(bool full)
 		return _Initialize(this);
 
 	recursive_lock_transfer_lock(&fLock, id);
+	for (int32 i = 0; i < fNumGroups; i++)
+		mutex_transfer_lock(&fGroups[i].fLock, id);
 
 	return resume_thread(id);
 }
@@ -618,9 +1003,9 @@ BlockAllocator::InitializeAndClearBitmap(Transaction& transaction)
 			fGroups[i].fNumBlocks = fBlocksPerGroup;
 		}
 		fGroups[i].fStart = offset;
-		fGroups[i].fFirstFree = fGroups[i].fLargestStart = 0;
-		fGroups[i].fFreeBits = fGroups[i].fLargestLength = fGroups[i].fNumBits;
-		fGroups[i].fLargestValid = true;
+		fGroups[i].StartScan();
+		fGroups[i].AddFreeRange(0, fGroups[i].fNumBits);
+		fGroups[i].FinishScan();
 
 		offset += fBlocksPerGroup;
 	}
@@ -643,7 +1028,7 @@ BlockAllocator::InitializeAndClearBitmap(Transaction& transaction)
 status_t
 BlockAllocator::_Initialize(BlockAllocator* allocator)
 {
-	// The lock must already be held at this point
+	// The locks must already be held at this point
 	RecursiveLocker locker(allocator->fLock, true);
 
 	Volume* volume = allocator->fVolume;
@@ -652,14 +1037,20 @@ BlockAllocator::_Initialize(BlockAllocator* allocator)
 	off_t freeBlocks = 0;
 
 	uint32* buffer = (uint32*)malloc(blocks << blockShift);
-	if (buffer == NULL)
+	if (buffer == NULL) {
+		allocator->_UnlockGroups();
 		RETURN_ERROR(B_NO_MEMORY);
+	}
 
 	AllocationGroup* groups = allocator->fGroups;
 	off_t offset = 1;
 	uint32 bitsPerGroup = 8 * (blocks << blockShift);
 	int32 numGroups = allocator->fNumGroups;
 
+	// the block bitmap and the log are at the start of the first group
+	uint32 reservedBlocks = volume->Log().Start() + volume->Log().Length();
+	bool reservedMissing = false;
+
 	for (int32 i = 0; i < numGroups; i++) {
 		if (read_pos(volume->Device(), offset << blockShift, buffer,
 				blocks << blockShift) < B_OK)
@@ -675,6 +1066,20 @@ BlockAllocator::_Initialize(BlockAllocator* allocator)
 			groups[i].fNumBlocks = blocks;
 		}
 		groups[i].fStart = offset;
+		groups[i].StartScan();
+
+		if (i == 0) {
+			// The block bitmap and the log must not be handed out, even if
+			// they aren't marked in the bitmap; that is fixed below, once
+			// the groups are unlocked, and a transaction can be started.
+			uint32 count = min_c(reservedBlocks, groups[i].fNumBits);
+			for (uint32 bit = 0; bit < count; bit++) {
+				if ((buffer[bit >> 5] & (1UL << (bit % 32))) == 0) {
+					buffer[bit >> 5] |= 1UL << (bit % 32);
+					reservedMissing = true;
+				}
+			}
+		}
 
 		// finds all free ranges in this allocation group
 		int32 start = -1, range = 0;
@@ -698,22 +1103,37 @@ BlockAllocator::_Initialize(BlockAllocator* allocator)
 		if (range)
 			groups[i].AddFreeRange(start, range);
 
+		groups[i].FinishScan();
 		freeBlocks += groups[i].fFreeBits;
 
 		offset += blocks;
 	}
 	free(buffer);
 
-	// check if block bitmap and log area are reserved
-	uint32 reservedBlocks = volume->Log().Start() + volume->Log().Length();
+	off_t usedBlocks = volume->NumBlocks() - freeBlocks;
+	if (volume->UsedBlocks() != usedBlocks) {
+		// If the disk in a dirty state at mount time, it's
+		// normal that the values don't match
+		INFORM(("volume reports %" B_PRIdOFF " used blocks, correct is %"
+			B_PRIdOFF "\n", volume->UsedBlocks(), usedBlocks));
+		volume->SuperBlock().used_blocks = HOST_ENDIAN_TO_BFS_INT64(usedBlocks);
+	}
+
+	allocator->_UnlockGroups();
 
-	if (allocator->CheckBlocks(0, reservedBlocks) != B_OK) {
+	if (reservedMissing) {
 		if (volume->IsReadOnly()) {
 			FATAL(("Space for block bitmap or log area is not reserved "
 				"(volume is mounted read-only)!\n"));
 		} else {
 			Transaction transaction(volume, 0);
-			if (groups[0].Allocate(transaction, 0, reservedBlocks) != B_OK) {
+
+			mutex_lock(&groups[0].fLock);
+			status_t status = groups[0].Reserve(transaction, 0,
+				min_c(reservedBlocks, groups[0].fNumBits));
+			mutex_unlock(&groups[0].fLock);
+
+			if (status != B_OK) {
 				FATAL(("Could not allocate reserved space for block "
 					"bitmap/log!\n"));
 				volume->Panic();
@@ -725,15 +1145,6 @@ BlockAllocator::_Initialize(BlockAllocator* allocator)
 		}
 	}
 
-	off_t usedBlocks = volume->NumBlocks() - freeBlocks;
-	if (volume->UsedBlocks() != usedBlocks) {
-		// If the disk in a dirty state at mount time, it's
-		// normal that the values don't match
-		INFORM(("volume reports %" B_PRIdOFF " used blocks, correct is %"
-			B_PRIdOFF "\n", volume->UsedBlocks(), usedBlocks));
-		volume->SuperBlock().used_blocks = HOST_ENDIAN_TO_BFS_INT64(usedBlocks);
-	}
-
 	return B_OK;
 }
 
@@ -753,6 +1164,9 @@ BlockAllocator::Uninitialize()
 
 	The number of allocated blocks is always a multiple of \a minimum which
 	has to be a power of two value.
+
+	Only one allocation group is locked at a time, so that other threads can
+	allocate blocks from the other groups in the meantime.
 */
 status_t
 BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
@@ -764,168 +1178,253 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 	FUNCTION_START(("group = %ld, start = %u, maximum = %u, minimum = %u\n",
 		groupIndex, start, maximum, minimum));
 
-	AllocationBlock cached(fVolume);
-	RecursiveLocker lock(fLock);
+	int32 firstGroup = groupIndex;
+	uint16 firstStart = start;
+
+	while (true) {
+		// Find the block_run that can fulfill the request best
+		int32 bestGroup = -1;
+		int32 bestStart = -1;
+		int32 bestLength = -1;
+		uint32 bestChangeCount = 0;
+
+		groupIndex = firstGroup;
+		start = firstStart;
+
+		for (int32 i = 0; i < fNumGroups + 1; i++, groupIndex++, start = 0) {
+			groupIndex = groupIndex % fNumGroups;
+			AllocationGroup& group = fGroups[groupIndex];
+
+			MutexLocker groupLocker(group.fLock);
+
+			int32 groupStart;
+			int32 groupLength;
+			status_t status = _FindInGroup(groupIndex, start, maximum,
+				bestLength, groupStart, groupLength);
+			if (status != B_OK)
+				return status;
+
+			if (groupLength <= bestLength)
+				continue;
 
+			if (groupLength >= maximum) {
+				// This is as good as it gets, take it while we have the lock
+				return _AllocateInGroup(transaction, groupIndex, groupStart,
+					groupLength, maximum, minimum, run);
+			}
+
+			bestGroup = groupIndex;
+			bestStart = groupStart;
+			bestLength = groupLength;
+			bestChangeCount = group.fChangeCount;
+		}
+
+		if (bestLength < minimum)
+			return B_DEVICE_FULL;
+
+		AllocationGroup& group = fGroups[bestGroup];
+		MutexLocker groupLocker(group.fLock);
+
+		// If the group has been changed in the meantime, our range might no
+		// longer be free, and we have to start over
+		if (group.fChangeCount == bestChangeCount) {
+			return _AllocateInGroup(transaction, bestGroup, bestStart,
+				bestLength, maximum, minimum, run);
+		}
+	}
+}
+
+
+/*!	Looks for free space in the given allocation group, starting at \a start.
+	If the group contains a range that is larger than \a bestLength, it is
+	returned in \a _start, and \a _length; the search stops as soon as a
+	range of \a maximum blocks is found. Otherwise, \a _length is set to -1.
+	The group's lock must be held.
+*/
+status_t
+BlockAllocator::_FindInGroup(int32 groupIndex, uint16 start, uint16 maximum,
+	int32 bestLength, int32& _start, int32& _length)
+{
+	AllocationGroup& group = fGroups[groupIndex];
+	AllocationBlock cached(fVolume);
 	uint32 bitsPerFullBlock = fVolume->BlockSize() << 3;
 
-	// Find the block_run that can fulfill the request best
-	int32 bestGroup = -1;
-	int32 bestStart = -1;
-	int32 bestLength = -1;
+	_start = -1;
+	_length = -1;
 
-	for (int32 i = 0; i < fNumGroups + 1; i++, groupIndex++, start = 0) {
-		groupIndex = groupIndex % fNumGroups;
-		AllocationGroup& group = fGroups[groupIndex];
+	CHECK_ALLOCATION_GROUP(groupIndex);
 
-		CHECK_ALLOCATION_GROUP(groupIndex);
+	if (!group.HasFreeRanges() && group.ShouldRescan()) {
+		// Blocks have been freed since we last knew the free ranges of
+		// this group -- see if we can get to know them again
+		if (group.Rescan(fVolume) != B_OK)
+			RETURN_ERROR(B_ERROR);
+	}
 
-		if (start >= group.NumBits() || group.IsFull())
-			continue;
+	if (start >= group.NumBits() || group.IsFull())
+		return B_OK;
 
-		// The wanted maximum is smaller than the largest free block in the
-		// group or already smaller than the minimum
+	// The wanted maximum is smaller than the largest free block in the
+	// group or already smaller than the minimum
 
-		if (start < group.fFirstFree)
-			start = group.fFirstFree;
+	if (start < group.fFirstFree)
+		start = group.fFirstFree;
 
-		if (group.fLargestValid) {
-			if (group.fLargestLength < bestLength)
-				continue;
+	if (group.HasFreeRanges()) {
+		// We know all free ranges of this group, no need to look at the
+		// block bitmap
+		int32 rangeStart;
+		int32 rangeLength;
+		group.FindFreeRange(start, maximum, rangeStart, rangeLength);
 
-			if (group.fLargestStart >= start) {
-				if (group.fLargestLength >= bestLength) {
-					bestGroup = groupIndex;
-					bestStart = group.fLargestStart;
-					bestLength = group.fLargestLength;
+		if (rangeLength > 0 && rangeLength > bestLength) {
+			_start = rangeStart;
+			_length = rangeLength;
+		}
+		return B_OK;
+	}
 
-					if (bestLength >= maximum)
-						break;
-				}
+	if (group.fLargestValid) {
+		if (group.fLargestLength < bestLength)
+			return B_OK;
 
-				// We know everything about this group we have to, let's skip
-				// to the next
-				continue;
+		if (group.fLargestStart >= start) {
+			if (group.fLargestLength > bestLength) {
+				_start = group.fLargestStart;
+				_length = group.fLargestLength;
 			}
+
+			// We know everything about this group we have to, let's skip
+			// to the next
+			return B_OK;
 		}
+	}
 
-		// There may be more than one block per allocation group - and
-		// we iterate through it to find a place for the allocation.
-		// (one allocation can't exceed one allocation group)
-
-		uint32 block = start / (fVolume->BlockSize() << 3);
-		int32 currentStart = 0, currentLength = 0;
-		int32 groupLargestStart = -1;
-		int32 groupLargestLength = -1;
-		int32 currentBit = start;
-		bool canFindGroupLargest = start == 0;
-
-		for (; block < group.NumBlocks(); block++) {
-			if (cached.SetTo(group, block) < B_OK)
-				RETURN_ERROR(B_ERROR);
-
-			T(Block("alloc-in", group.Start() + block, cached.Block(),
-				fVolume->BlockSize(), groupIndex, currentStart));
-
-			// find a block large enough to hold the allocation
-			for (uint32 bit = start % bitsPerFullBlock;
-					bit < cached.NumBlockBits(); bit++) {
-				if (!cached.IsUsed(bit)) {
-					if (currentLength == 0) {
-						// start new range
-						currentStart = currentBit;
-					}
+	// There may be more than one block per allocation group - and
+	// we iterate through it to find a place for the allocation.
+	// (one allocation can't exceed one allocation group)
+
+	uint32 block = start / (fVolume->BlockSize() << 3);
+	int32 currentStart = 0, currentLength = 0;
+	int32 groupLargestStart = -1;
+	int32 groupLargestLength = -1;
+	int32 currentBit = start;
+	bool canFindGroupLargest = start == 0;
+
+	for (; block < group.NumBlocks(); block++) {
+		if (cached.SetTo(group, block) < B_OK)
+			RETURN_ERROR(B_ERROR);
+
+		T(Block("alloc-in", group.Start() + block, cached.Block(),
+			fVolume->BlockSize(), groupIndex, currentStart));
+
+		// find a block large enough to hold the allocation
+		for (uint32 bit = start % bitsPerFullBlock;
+				bit < cached.NumBlockBits(); bit++) {
+			if (!cached.IsUsed(bit)) {
+				if (currentLength == 0) {
+					// start new range
+					currentStart = currentBit;
+				}
 
-					// have we found a range large enough to hold numBlocks?
-					if (++currentLength >= maximum) {
-						bestGroup = groupIndex;
-						bestStart = currentStart;
+				// have we found a range large enough to hold numBlocks?
+				if (++currentLength >= maximum) {
+					bestLength = currentLength;
+					_start = currentStart;
+					_length = currentLength;
+					break;
+				}
+			} else {
+				if (currentLength) {
+					// end of a range
+					if (currentLength > bestLength) {
 						bestLength = currentLength;
-						break;
-					}
-				} else {
-					if (currentLength) {
-						// end of a range
-						if (currentLength > bestLength) {
-							bestGroup = groupIndex;
-							bestStart = currentStart;
-							bestLength = currentLength;
-						}
-						if (currentLength > groupLargestLength) {
-							groupLargestStart = currentStart;
-							groupLargestLength = currentLength;
-						}
-						currentLength = 0;
+						_start = currentStart;
+						_length = currentLength;
 					}
-					if ((int32)group.NumBits() - currentBit
-							<= groupLargestLength) {
-						// We can't find a bigger block in this group anymore,
-						// let's skip the rest.
-						block = group.NumBlocks();
-						break;
+					if (currentLength > groupLargestLength) {
+						groupLargestStart = currentStart;
+						groupLargestLength = currentLength;
 					}
+					currentLength = 0;
+				}
+				if ((int32)group.NumBits() - currentBit
+						<= groupLargestLength) {
+					// We can't find a bigger block in this group anymore,
+					// let's skip the rest.
+					block = group.NumBlocks();
+					break;
 				}
-				currentBit++;
 			}
+			currentBit++;
+		}
 
-			T(Block("alloc-out", block, cached.Block(),
-				fVolume->BlockSize(), groupIndex, currentStart));
+		T(Block("alloc-out", block, cached.Block(),
+			fVolume->BlockSize(), groupIndex, currentStart));
 
-			if (bestLength >= maximum) {
-				canFindGroupLargest = false;
-				break;
-			}
-
-			// start from the beginning of the next block
-			start = 0;
+		if (bestLength >= maximum) {
+			canFindGroupLargest = false;
+			break;
 		}
 
-		if (currentBit == (int32)group.NumBits()) {
-			if (currentLength > bestLength) {
-				bestGroup = groupIndex;
-				bestStart = currentStart;
-				bestLength = currentLength;
-			}
-			if (canFindGroupLargest && currentLength > groupLargestLength) {
-				groupLargestStart = currentStart;
-				groupLargestLength = currentLength;
-			}
-		}
+		// start from the beginning of the next block
+		start = 0;
+	}
 
-		if (canFindGroupLargest && !group.fLargestValid
-			&& groupLargestLength >= 0) {
-			group.fLargestStart = groupLargestStart;
-			group.fLargestLength = groupLargestLength;
-			group.fLargestValid = true;
+	if (currentBit == (int32)group.NumBits()) {
+		if (currentLength > bestLength) {
+			_start = currentStart;
+			_length = currentLength;
+		}
+		if (canFindGroupLargest && currentLength > groupLargestLength) {
+			groupLargestStart = currentStart;
+			groupLargestLength = currentLength;
 		}
+	}
 
-		if (bestLength >= maximum)
-			break;
+	if (canFindGroupLargest && !group.fLargestValid
+		&& groupLargestLength >= 0) {
+		group.fLargestStart = groupLargestStart;
+		group.fLargestLength = groupLargestLength;
+		group.fLargestValid = true;
 	}
 
-	// If we found a suitable range, mark the blocks as in use, and
-	// write the updated block bitmap back to disk
-	if (bestLength < minimum)
-		return B_DEVICE_FULL;
+	return B_OK;
+}
 
-	if (bestLength > maximum)
-		bestLength = maximum;
+
+/*!	Marks the blocks of the range found by _FindInGroup() as in use, and
+	fills in \a run accordingly.
+	The group's lock must be held.
+*/
+status_t
+BlockAllocator::_AllocateInGroup(Transaction& transaction, int32 groupIndex,
+	int32 start, int32 length, uint16 maximum, uint16 minimum, block_run& run)
+{
+	AllocationGroup& group = fGroups[groupIndex];
+
+	if (length > maximum)
+		length = maximum;
 	else if (minimum > 1) {
-		// make sure bestLength is a multiple of minimum
-		bestLength = round_down(bestLength, minimum);
+		// make sure length is a multiple of minimum
+		length = round_down(length, minimum);
 	}
 
-	if (fGroups[bestGroup].Allocate(transaction, bestStart, bestLength) != B_OK)
+	if (group.Allocate(transaction, start, length) != B_OK)
 		RETURN_ERROR(B_IO_ERROR);
 
-	CHECK_ALLOCATION_GROUP(bestGroup);
+	CHECK_ALLOCATION_GROUP(groupIndex);
 
-	run.allocation_group = HOST_ENDIAN_TO_BFS_INT32(bestGroup);
-	run.start = HOST_ENDIAN_TO_BFS_INT16(bestStart);
-	run.length = HOST_ENDIAN_TO_BFS_INT16(bestLength);
+	run.allocation_group = HOST_ENDIAN_TO_BFS_INT32(groupIndex);
+	run.start = HOST_ENDIAN_TO_BFS_INT16(start);
+	run.length = HOST_ENDIAN_TO_BFS_INT16(length);
 
-	fVolume->SuperBlock().used_blocks
-		= HOST_ENDIAN_TO_BFS_INT64(fVolume->UsedBlocks() + bestLength);
+	if (transaction.AddAllocation(run) != B_OK) {
+		group.Free(transaction, start, length);
+		return B_NO_MEMORY;
+	}
+
+	_UpdateUsedBlocks(length);
 		// We are not writing back the disk's superblock - it's
 		// either done by the journaling code, or when the disk
 		// is unmounted.
@@ -942,6 +1441,37 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 }
 
 
+void
+BlockAllocator::_UpdateUsedBlocks(off_t change)
+{
+	MutexLocker locker(fUsedBlocksLock);
+
+	fVolume->SuperBlock().used_blocks
+		= HOST_ENDIAN_TO_BFS_INT64(fVolume->UsedBlocks() + change);
+}
+
+
+/*!	Locks all allocation groups in ascending order. The allocator's lock must
+	be held.
+*/
+void
+BlockAllocator::_LockGroups()
+{
+	ASSERT_LOCKED_RECURSIVE(&fLock);
+
+	for (int32 i = 0; i < fNumGroups; i++)
+		mutex_lock(&fGroups[i].fLock);
+}
+
+
+void
+BlockAllocator::_UnlockGroups()
+{
+	for (int32 i = fNumGroups; i-- > 0;)
+		mutex_unlock(&fGroups[i].fLock);
+}
+
+
 status_t
 BlockAllocator::AllocateForInode(Transaction& transaction,
 	const block_run* parent, mode_t type, block_run& run)
@@ -994,8 +1524,6 @@ BlockAllocator::Allocate(Transaction& transaction, Inode* inode,
 	// last one)
 	if (inode->Size() > 0) {
 		const data_stream& data = inode->Node().data;
-		// TODO: we currently don't care for when the data stream
-		// is already grown into the indirect ranges
 		if (data.max_double_indirect_range == 0
 			&& data.max_indirect_range == 0) {
 			// Since size > 0, there must be a valid block run in this stream
@@ -1006,14 +1534,29 @@ BlockAllocator::Allocate(Transaction& transaction, Inode* inode,
 
 			group = data.direct[last].AllocationGroup();
 			start = data.direct[last].Start() + data.direct[last].Length();
+		} else {
+			// The stream has grown into the indirect ranges; look up the
+			// run that contains its last allocated block, so that the file
+			// can continue right behind it
+			off_t end = data.MaxDoubleIndirectRange() > 0
+				? data.MaxDoubleIndirectRange() : data.MaxIndirectRange();
+			block_run last;
+			off_t offset;
+			if (inode->FindBlockRun(end - 1, last, offset) == B_OK) {
+				group = last.AllocationGroup();
+				start = last.Start() + last.Length();
+			}
 		}
 	} else if (inode->IsContainer() || inode->IsSymLink()) {
 		// directory and symbolic link data will go in the same allocation
 		// group as the inode is in but after the inode data
 		start = inode->BlockRun().Start();
 	} else {
-		// file data will start in the next allocation group
-		group = inode->BlockRun().AllocationGroup() + 1;
+		// File data will start in one of the next allocation groups; which
+		// one depends on the inode, so that files that are written at the
+		// same time don't all compete for the same group
+		group = inode->BlockRun().AllocationGroup() + 1
+			+ inode->BlockRun().Start() % kFileDataGroups;
 	}
 
 	return AllocateBlocks(transaction, group, start, numBlocks, minimum, run);
@@ -1023,8 +1566,6 @@ BlockAllocator::Allocate(Transaction& transaction, Inode* inode,
 status_t
 BlockAllocator::Free(Transaction& transaction, block_run run)
 {
-	RecursiveLocker lock(fLock);
-
 	int32 group = run.AllocationGroup();
 	uint16 start = run.Start();
 	uint16 length = run.Length();
@@ -1058,6 +1599,12 @@ BlockAllocator::Free(Transaction& transaction, block_run run)
 		return B_BAD_DATA;
 #endif
 
+	// other independent transactions must not get the blocks before we're done
+	if (transaction.DeferFree(run))
+		return B_OK;
+
+	MutexLocker groupLocker(fGroups[group].fLock);
+
 	CHECK_ALLOCATION_GROUP(group);
 
 	if (fGroups[group].Free(transaction, start, length) != B_OK)
@@ -1072,12 +1619,33 @@ BlockAllocator::Free(Transaction& transaction, block_run run)
 	}
 #endif
 
-	fVolume->SuperBlock().used_blocks =
-		HOST_ENDIAN_TO_BFS_INT64(fVolume->UsedBlocks() - run.Length());
+	groupLocker.Unlock();
+
+	_UpdateUsedBlocks(-(off_t)run.Length());
 	return B_OK;
 }
 
 
+/*!	Makes the allocation groups forget what they know about their free
+	ranges, so that they will have to look at the block bitmap again.
+	This is necessary whenever the block bitmap has been changed behind the
+	groups' back, for example when a transaction has been aborted.
+*/
+void
+BlockAllocator::InvalidateFreeRanges()
+{
+	for (int32 i = 0; i < fNumGroups; i++) {
+		AllocationGroup& group = fGroups[i];
+		MutexLocker groupLocker(group.fLock);
+
+		group.InvalidateFreeRanges();
+		group.fLargestValid = false;
+		group.fFirstFree = 0;
+		group.fRescanFreeBits = -1;
+	}
+}
+
+
 size_t
 BlockAllocator::BitmapSize() const
 {
@@ -1112,6 +1680,8 @@ BlockAllocator::Fragment()
 			transaction.Done();
 		}
 	}
+
+	InvalidateFreeRanges();
 }
 #endif	// DEBUG_FRAGMENTER
 
@@ -1121,15 +1691,15 @@ void
 BlockAllocator::_CheckGroup(int32 groupIndex) const
 {
 	AllocationBlock cached(fVolume);
-	ASSERT_LOCKED_RECURSIVE(&fLock);
-
 	AllocationGroup& group = fGroups[groupIndex];
+	ASSERT_LOCKED_MUTEX(&group.fLock);
 
 	int32 currentStart = 0, currentLength = 0;
 	int32 firstFree = -1;
 	int32 largestStart = -1;
 	int32 largestLength = 0;
 	int32 currentBit = 0;
+	int32 rangeIndex = 0;
 
 	for (uint32 block = 0; block < group.NumBlocks(); block++) {
 		if (cached.SetTo(group, block) < B_OK) {
@@ -1141,7 +1711,7 @@ BlockAllocator::_CheckGroup(int32 groupIndex) const
 			if (!cached.IsUsed(bit)) {
 				if (firstFree < 0) {
 					firstFree = currentBit;
-					if (!group.fLargestValid) {
+					if (!group.fLargestValid && !group.fRangesValid) {
 						if (firstFree >= 0 && firstFree < group.fFirstFree) {
 							// mostly harmless but noteworthy
 							dprintf("group %d first free too late: should be "
@@ -1159,6 +1729,8 @@ BlockAllocator::_CheckGroup(int32 groupIndex) const
 				currentLength++;
 			} else if (currentLength) {
 				// end of a range
+				_CheckFreeRange(groupIndex, rangeIndex++, currentStart,
+					currentLength);
 				if (currentLength > largestLength) {
 					largestStart = currentStart;
 					largestLength = currentLength;
@@ -1169,6 +1741,15 @@ BlockAllocator::_CheckGroup(int32 groupIndex) const
 		}
 	}
 
+	if (currentLength > 0) {
+		_CheckFreeRange(groupIndex, rangeIndex++, currentStart,
+			currentLength);
+	}
+	if (group.fRangesValid && rangeIndex != group.fRangeCount) {
+		panic("bfs %p: group %d has %d free ranges, checked %d.\n", fVolume,
+			(int)groupIndex, (int)group.fRangeCount, (int)rangeIndex);
+	}
+
 	if (currentLength > largestLength) {
 		largestStart = currentStart;
 		largestLength = currentLength;
@@ -1187,6 +1768,25 @@ BlockAllocator::_CheckGroup(int32 groupIndex) const
 			(int)group.fLargestLength, (int)largestStart, (int)largestLength);
 	}
 }
+
+
+void
+BlockAllocator::_CheckFreeRange(int32 groupIndex, int32 index, int32 start,
+	int32 length) const
+{
+	AllocationGroup& group = fGroups[groupIndex];
+	if (!group.fRangesValid)
+		return;
+
+	if (index >= group.fRangeCount || group.fRanges[index].start != start
+		|| group.fRanges[index].length != length) {
+		panic("bfs %p: group %d free range %d differs: %d.%d, checked "
+			"%d.%d.\n", fVolume, (int)groupIndex, (int)index,
+			index < group.fRangeCount ? (int)group.fRanges[index].start : -1,
+			index < group.fRangeCount ? (int)group.fRanges[index].length : -1,
+			(int)start, (int)length);
+	}
+}
 #endif	// DEBUG_ALLOCATION_GROUPS
 
 
@@ -1202,6 +1802,9 @@ BlockAllocator::Trim(uint64 offset, uint64 size, uint64& trimmedSize)
 	MemoryDeleter deleter(trimData);
 	RecursiveLocker locker(fLock);
 
+	// Nothing may be allocated while we're trimming
+	_LockGroups();
+
 	// TODO: take given offset and size into account!
 	int32 lastGroup = fNumGroups - 1;
 	uint32 firstBlock = 0;
@@ -1229,8 +1832,10 @@ BlockAllocator::Trim(uint64 offset, uint64 size, uint64& trimmedSize)
 						status_t status = _TrimNext(*trimData, kTrimRanges,
 							firstFree << blockShift, freeLength << blockShift,
 							false, trimmedSize);
-						if (status != B_OK)
+						if (status != B_OK) {
+							_UnlockGroups();
 							return status;
+						}
 
 						freeLength = 0;
 					}
@@ -1247,8 +1852,11 @@ BlockAllocator::Trim(uint64 offset, uint64 size, uint64& trimmedSize)
 		firstBit = 0;
 	}
 
-	return _TrimNext(*trimData, kTrimRanges, firstFree << blockShift,
-		freeLength << blockShift, true, trimmedSize);
+	status_t status = _TrimNext(*trimData, kTrimRanges,
+		firstFree << blockShift, freeLength << blockShift, true, trimmedSize);
+
+	_UnlockGroups();
+	return status;
 }
 
 
@@ -1313,11 +1921,30 @@ BlockAllocator::StartChecking(const check_control* control)
 	}
 
 	fCheckCookie->pass = BFS_CHECK_PASS_BITMAP;
-	fCheckCookie->stack.Push(fVolume->Root());
-	fCheckCookie->stack.Push(fVolume->Indices());
 	fCheckCookie->iterator = NULL;
 	fCheckCookie->control.stats.block_size = fVolume->BlockSize();
 
+	if ((control->flags & BFS_REBUILD_INDEX) != 0) {
+		// Skip the bitmap pass, and only fill the requested index
+		status_t status = _StartRebuildingIndex(fCheckCookie->control.name);
+		if (status != B_OK) {
+			_FreeIndices();
+			delete fCheckCookie;
+			fCheckCookie = NULL;
+			free(fCheckBitmap);
+			fCheckBitmap = NULL;
+			recursive_lock_unlock(&fLock);
+			fVolume->GetJournal(0)->Unlock(NULL, true);
+
+			return status;
+		}
+
+		return B_OK;
+	}
+
+	fCheckCookie->stack.Push(fVolume->Root());
+	fCheckCookie->stack.Push(fVolume->Indices());
+
 	// Put removed vnodes to the stack -- they are not reachable by traversing
 	// the file system anymore.
 	InodeList::Iterator iterator = fVolume->RemovedInodes().GetIterator();
@@ -1433,6 +2060,15 @@ BlockAllocator::CheckNextNode(check_control* control)
 					continue;
 				}
 
+				if (fCheckCookie->pass == BFS_CHECK_PASS_INDEX) {
+					// All entries have been collected, write the indices
+					status_t status = _FinishIndices();
+					if (status != B_OK) {
+						fCheckCookie->control.status = status;
+						return status;
+					}
+				}
+
 				fCheckCookie->control.status = B_ENTRY_NOT_FOUND;
 				return B_ENTRY_NOT_FOUND;
 			}
@@ -1690,7 +2326,6 @@ BlockAllocator::_WriteBackCheckBitmap()
 	size_t size = BitmapSize();
 	off_t usedBlocks = 0LL;
 
-	// TODO: update the allocation groups used blocks info
 	for (uint32 i = size >> 2; i-- > 0;) {
 		uint32 compare = 1;
 		// Count the number of bits set
@@ -1747,10 +2382,14 @@ BlockAllocator::_WriteBackCheckBitmap()
 				(uint8*)fCheckBitmap + i * blockSize, blocksToWrite);
 			if (status < B_OK) {
 				FATAL(("error writing bitmap: %s\n", strerror(status)));
+				InvalidateFreeRanges();
 				return status;
 			}
 			transaction.Done();
 		}
+
+		// the allocation groups have to learn about the new block bitmap
+		InvalidateFreeRanges();
 	}
 
 	return B_OK;
@@ -2113,6 +2752,11 @@ BlockAllocator::_PrepareIndices()
 			continue;
 		}
 
+		// The index is filled in one go once all entries have been seen
+		index->builder = new(std::nothrow) TreeBuilder(tree);
+		if (index->builder == NULL)
+			return B_NO_MEMORY;
+
 		status = tree->MakeEmpty();
 		if (status != B_OK)
 			return status;
@@ -2135,26 +2779,90 @@ BlockAllocator::_FreeIndices()
 			put_vnode(fVolume->FSVolume(),
 				fVolume->ToVnode(index->inode->BlockRun()));
 		}
+
+		delete index->builder;
+		delete index;
 	}
 	fCheckCookie->indices.MakeEmpty();
 }
 
 
+/*!	Prepares the index pass to completely rebuild the index  name, without
+	checking the rest of the file system first.
+*/
 status_t
-BlockAllocator::_AddInodeToIndex(Inode* inode)
+BlockAllocator::_StartRebuildingIndex(const char* name)
 {
-	Transaction transaction(fVolume, inode->BlockNumber());
+	if (fVolume->IsReadOnly())
+		return B_READ_ONLY_DEVICE;
+
+	Inode* indices = fVolume->IndicesNode();
+	if (indices == NULL)
+		return B_ENTRY_NOT_FOUND;
+
+	BPlusTree* tree = indices->Tree();
+	if (tree == NULL)
+		return B_BAD_VALUE;
+
+	ino_t id;
+	status_t status = tree->Find((uint8*)name, (uint16)strlen(name), &id);
+	if (status != B_OK)
+		return status;
 
+	check_index* index = new(std::nothrow) check_index;
+	if (index == NULL)
+		return B_NO_MEMORY;
+
+	strlcpy(index->name, name, sizeof(index->name));
+	index->run = fVolume->ToBlockRun(id);
+	fCheckCookie->indices.Push(index);
+
+	status = _PrepareIndices();
+	if (status != B_OK)
+		return status;
+
+	fCheckCookie->pass = BFS_CHECK_PASS_INDEX;
+	fCheckCookie->control.pass = BFS_CHECK_PASS_INDEX;
+	fCheckCookie->stack.Push(fVolume->Root());
+	return B_OK;
+}
+
+
+/*!	Writes the entries that were collected during the index pass into
+	their indices.
+*/
+status_t
+BlockAllocator::_FinishIndices()
+{
 	for (int32 i = 0; i < fCheckCookie->indices.CountItems(); i++) {
 		check_index* index = fCheckCookie->indices.Array()[i];
-		if (index->inode == NULL)
+		if (index->builder == NULL)
 			continue;
 
-		index->inode->WriteLockInTransaction(transaction);
+		status_t status = index->builder->Finish();
 
-		BPlusTree* tree = index->inode->Tree();
-		if (tree == NULL)
-			return B_ERROR;
+		delete index->builder;
+		index->builder = NULL;
+
+		if (status != B_OK) {
+			FATAL(("check: Could not write index \"%s\": %s\n", index->name,
+				strerror(status)));
+			return status;
+		}
+	}
+
+	return B_OK;
+}
+
+
+status_t
+BlockAllocator::_AddInodeToIndex(Inode* inode)
+{
+	for (int32 i = 0; i < fCheckCookie->indices.CountItems(); i++) {
+		check_index* index = fCheckCookie->indices.Array()[i];
+		TreeBuilder* builder = index->builder;
+		if (builder == NULL)
+			continue;
 
 		status_t status = B_OK;
 
@@ -2164,22 +2872,27 @@ BlockAllocator::_AddInodeToIndex(Inode* inode)
 				if (inode->GetName(name, B_FILE_NAME_LENGTH) != B_OK)
 					return B_ERROR;
 
-				status = tree->Insert(transaction, name, inode->ID());
+				status = builder->Add((uint8*)name, strlen(name), inode->ID());
 			}
 		} else if (!strcmp(index->name, "last_modified")) {
 			if (inode->InLastModifiedIndex()) {
-				status = tree->Insert(transaction, inode->OldLastModified(),
+				int64 modified = inode->OldLastModified();
+				status = builder->Add((uint8*)&modified, sizeof(modified),
 					inode->ID());
 			}
 		} else if (!strcmp(index->name, "size")) {
-			if (inode->InSizeIndex())
-				status = tree->Insert(transaction, inode->Size(), inode->ID());
+			if (inode->InSizeIndex()) {
+				int64 size = inode->Size();
+				status = builder->Add((uint8*)&size, sizeof(size),
+					inode->ID());
+			}
 		} else {
 			uint8 key[BPLUSTREE_MAX_KEY_LENGTH];
 			size_t keyLength = BPLUSTREE_MAX_KEY_LENGTH;
 			if (inode->ReadAttribute(index->name, B_ANY_TYPE, 0, key,
-					&keyLength) == B_OK) {
-				status = tree->Insert(transaction, key, keyLength, inode->ID());
+					&keyLength) == B_OK && keyLength > 0) {
+				// Empty attributes are not part of any index
+				status = builder->Add(key, keyLength, inode->ID());
 			}
 		}
 
@@ -2187,7 +2900,39 @@ BlockAllocator::_AddInodeToIndex(Inode* inode)
 			return status;
 	}
 
-	return transaction.Done();
+	return _LimitIndexMemory();
+}
+
+
+/*!	Keeps the memory used by all index builders together below
+	kMaxIndexBuilderMemory, by writing out the entries of the builder that
+	uses the most.
+*/
+status_t
+BlockAllocator::_LimitIndexMemory()
+{
+	while (true) {
+		TreeBuilder* largest = NULL;
+		size_t used = 0;
+
+		for (int32 i = 0; i < fCheckCookie->indices.CountItems(); i++) {
+			TreeBuilder* builder = fCheckCookie->indices.Array()[i]->builder;
+			if (builder == NULL)
+				continue;
+
+			used += builder->MemoryUsed();
+			if (largest == NULL
+				|| builder->MemoryUsed() > largest->MemoryUsed())
+				largest = builder;
+		}
+
+		if (largest == NULL || used <= kMaxIndexBuilderMemory)
+			return B_OK;
+
+		status_t status = largest->Flush();
+		if (status != B_OK)
+			return status;
+	}
 }
 
 
@@ -2265,6 +3010,12 @@ BlockAllocator::Dump(int32 index)
 			group.fLargestValid ? "" : "  (invalid)");
 		kprintf("      largest length: %" B_PRId32 "\n", group.fLargestLength);
 		kprintf("      free bits:      %" B_PRId32 "\n", group.fFreeBits);
+		kprintf("      free ranges:    %" B_PRId32 "%s\n", group.fRangeCount,
+			group.fRangesValid ? "" : "  (invalid)");
+		for (int32 j = 0; j < group.fRangeCount; j++) {
+			kprintf("        %" B_PRId32 ".%" B_PRId32 "\n",
+				group.fRanges[j].start, group.fRanges[j].length);
+		}
 	}
 }
 
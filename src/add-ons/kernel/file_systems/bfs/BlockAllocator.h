@@ -49,6 +49,8 @@ public:
 			status_t		Trim(uint64 offset, uint64 size,
 								uint64& trimmedSize);
 
+			void			InvalidateFreeRanges();
+
 			status_t		StartChecking(const check_control* control);
 			status_t		StopChecking(check_control* control);
 			status_t		CheckNextNode(check_control* control);
@@ -70,10 +72,23 @@ public:
 #endif
 
 private:
+			status_t		_FindInGroup(int32 groupIndex, uint16 start,
+								uint16 maximum, int32 bestLength,
+								int32& _start, int32& _length);
+			status_t		_AllocateInGroup(Transaction& transaction,
+								int32 groupIndex, int32 start, int32 length,
+								uint16 maximum, uint16 minimum,
+								block_run& run);
+			void			_UpdateUsedBlocks(off_t change);
+			void			_LockGroups();
+			void			_UnlockGroups();
+
 			status_t		_RemoveInvalidNode(Inode* parent, BPlusTree* tree,
 								Inode* inode, const char* name);
 #ifdef DEBUG_ALLOCATION_GROUPS
 			void			_CheckGroup(int32 group) const;
+			void			_CheckFreeRange(int32 group, int32 index,
+								int32 start, int32 length) const;
 #endif
 			bool			_IsValidCheckControl(const check_control* control);
 			bool			_CheckBitmapIsUsedAt(off_t block) const;
@@ -82,7 +97,10 @@ private:
 			status_t		_FinishBitmapPass();
 			status_t		_PrepareIndices();
 			void			_FreeIndices();
+			status_t		_StartRebuildingIndex(const char* name);
+			status_t		_FinishIndices();
 			status_t		_AddInodeToIndex(Inode* inode);
+			status_t		_LimitIndexMemory();
 			status_t		_WriteBackCheckBitmap();
 			status_t		_AddTrim(fs_trim_data& trimData, uint32 maxRanges,
 								uint64 offset, uint64 size);
@@ -95,6 +113,7 @@ private:
 private:
 			Volume*			fVolume;
 			recursive_lock	fLock;
+			mutex			fUsedBlocksLock;
 			AllocationGroup* fGroups;
 			int32			fNumGroups;
 			uint32			fBlocksPerGroup;
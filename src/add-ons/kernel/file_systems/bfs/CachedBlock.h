@@ -164,6 +164,9 @@ CachedBlock::SetToWritable(Transaction& transaction, off_t block, off_t base,
 	Unset();
 	fBlockNumber = block;
 
+	if (transaction.WillWriteBlock(block) != B_OK)
+		return NULL;
+
 	if (empty) {
 		fBlock = (uint8*)block_cache_get_empty(fVolume->BlockCache(),
 			block, transaction.ID());
@@ -196,6 +199,10 @@ CachedBlock::MakeWritable(Transaction& transaction)
 	if (fBlock == NULL)
 		return B_NO_INIT;
 
+	status_t status = transaction.WillWriteBlock(fBlockNumber);
+	if (status != B_OK)
+		return status;
+
 	return block_cache_make_writable(fVolume->BlockCache(), fBlockNumber,
 		transaction.ID());
 }
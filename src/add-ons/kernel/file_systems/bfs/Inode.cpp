@@ -134,6 +134,9 @@ private:
 #endif
 
 
+static const off_t kMaxFilePreallocation = 64 * 1024 * 1024;
+
+
 /*!	A helper class used by Inode::Create() to keep track of the belongings
 	of an inode creation in progress.
 	This class will make sure everything is cleaned up properly.
@@ -467,19 +470,28 @@ Inode::InitCheck(bool checkNode) const
 void
 Inode::WriteLockInTransaction(Transaction& transaction)
 {
-	// These flags can only change while holding the transaction lock
-	if ((Flags() & INODE_IN_TRANSACTION) != 0)
+	// Since independent transactions can run concurrently, the inode might
+	// be part of another thread's transaction
+	if ((Flags() & INODE_IN_TRANSACTION) != 0
+		&& Lock().holder == find_thread(NULL))
 		return;
 
-	// We share the same list link with the removed list, so we have to remove
-	// the inode from that list here (and add it back when we no longer need it)
-	if ((Flags() & INODE_DELETED) != 0)
-		fVolume->RemovedInodes().Remove(this);
+	// Independent transactions must lock the indices after any other inode
+	if (IsIndex())
+		transaction.LockIndices();
 
 	if (!fVolume->IsInitializing())
 		acquire_vnode(fVolume->FSVolume(), ID());
 
 	rw_lock_write_lock(&Lock());
+
+	// We share the same list link with the removed list, so we have to remove
+	// the inode from that list here (and add it back when we no longer need it)
+	if ((Flags() & INODE_DELETED) != 0) {
+		MutexLocker locker(fVolume->RemovedInodesLock());
+		fVolume->RemovedInodes().Remove(this);
+	}
+
 	Node().flags |= HOST_ENDIAN_TO_BFS_INT32(INODE_IN_TRANSACTION);
 
 	transaction.AddListener(this);
@@ -1762,19 +1774,20 @@ Inode::_GrowStream(Transaction& transaction, off_t size)
 		&& fVolume->FreeBlocks() > 128) {
 		off_t roundTo = 0;
 		if (IsFile()) {
-			// Request preallocated blocks depending on the file size and growth
-			if (size < 1 * 1024 * 1024 && bytes < 512 * 1024) {
-				// Preallocate 64 KB for file sizes <1 MB and grow rates <512 KB
-				roundTo = 65536 >> fVolume->BlockShift();
-			} else if (size < 32 * 1024 * 1024 && bytes <= 1 * 1024 * 1024) {
-				// Preallocate 512 KB for file sizes between 1 MB and 32 MB, and
-				// grow rates smaller than 1 MB
-				roundTo = (512 * 1024) >> fVolume->BlockShift();
-			} else {
-				// Preallocate 1/16 of the file size (ie. 4 MB for 64 MB,
-				// 64 MB for 1 GB)
-				roundTo = size >> (fVolume->BlockShift() + 4);
-			}
+			// Preallocate as much as the file already has, at least 64 KB,
+			// and at most 64 MB. A file that keeps growing will therefore
+			// get exponentially larger runs, even if other files are
+			// written at the same time, and the data of a growing file
+			// stays in a few large runs. Whatever is not used is trimmed
+			// again when the file is closed.
+			roundTo = max_c(size, 65536);
+			if (roundTo > kMaxFilePreallocation)
+				roundTo = kMaxFilePreallocation;
+			roundTo >>= fVolume->BlockShift();
+
+			// Leave enough room for the other files, too
+			if (roundTo > fVolume->FreeBlocks() / 16)
+				roundTo = fVolume->FreeBlocks() / 16;
 		} else if (IsIndex()) {
 			// Always preallocate 64 KB for index directories
 			roundTo = 65536 >> fVolume->BlockShift();
@@ -2476,8 +2489,10 @@ Inode::RemovedFromTransaction()
 	Node().flags &= ~HOST_ENDIAN_TO_BFS_INT32(INODE_IN_TRANSACTION);
 
 	// See AddInode() why we do this here
-	if ((Flags() & INODE_DELETED) != 0)
+	if ((Flags() & INODE_DELETED) != 0) {
+		MutexLocker locker(fVolume->RemovedInodesLock());
 		fVolume->RemovedInodes().Add(this);
+	}
 
 	rw_lock_write_unlock(&Lock());
 
@@ -86,6 +86,58 @@ private:
 };
 
 
+struct block_image : DoublyLinkedListLinkImpl<block_image> {
+	off_t		block;
+	uint8		data[0];
+};
+
+typedef DoublyLinkedList<block_image> BlockImageList;
+
+/*!	The state of an independent transaction. Since it shares the journal's
+	cache transaction with other independent transactions, it cannot be
+	aborted through the block cache. Instead, it saves every block before it
+	changes it, and records the blocks it allocates, so that it can undo its
+	changes itself. The blocks it frees are only freed once it succeeded, as
+	other transactions could reuse them otherwise.
+	Since the block cache does not allow to reuse a block that has been
+	changed in the current sub transaction, freed blocks are only given back
+	to the block allocator when the last of the independent transactions
+	sharing it is done (see Journal::_UnlockIndependent()).
+*/
+class IndependentTransaction
+	: public DoublyLinkedListLinkImpl<IndependentTransaction> {
+public:
+							IndependentTransaction(Transaction* owner);
+							~IndependentTransaction();
+
+			Transaction*	Owner() const { return fOwner; }
+			thread_id		Thread() const { return fThread; }
+
+			bool			IndicesLocked() const { return fIndicesLocked; }
+			void			SetIndicesLocked() { fIndicesLocked = true; }
+
+			status_t		SaveBlock(Volume* volume, off_t blockNumber);
+			status_t		AddAllocation(block_run run);
+			bool			DeferFree(block_run run);
+
+			void			Commit(Volume* volume,
+								Stack<block_run>& frees);
+			void			Undo(Volume* volume, int32 transactionID,
+								Stack<block_run>& frees);
+
+private:
+			bool			_IsAllocated(Volume* volume, off_t blockNumber);
+
+			Transaction*	fOwner;
+			thread_id		fThread;
+			BlockImageList	fImages;
+			Stack<block_run> fAllocations;
+			Stack<block_run> fFrees;
+			bool			fIndicesLocked;
+			bool			fDone;
+};
+
+
 #if BFS_TRACING && !defined(FS_SHELL) && !defined(_BOOT_MODE)
 namespace BFSJournalTracing {
 
@@ -393,6 +445,152 @@ RunArrays::MaxArrayLength()
 }
 
 
+//	#pragma mark - IndependentTransaction
+
+
+IndependentTransaction::IndependentTransaction(Transaction* owner)
+	:
+	fOwner(owner),
+	fThread(find_thread(NULL)),
+	fIndicesLocked(false),
+	fDone(false)
+{
+}
+
+
+IndependentTransaction::~IndependentTransaction()
+{
+	while (block_image* image = fImages.RemoveHead())
+		free(image);
+}
+
+
+/*!	Saves the current contents of the block, unless that has already been
+	done, or the transaction does not need to restore it when it fails.
+*/
+status_t
+IndependentTransaction::SaveBlock(Volume* volume, off_t blockNumber)
+{
+	// The block bitmap is shared by all transactions, allocations are undone
+	// through the block allocator instead
+	if (fDone || blockNumber < volume->ToBlock(volume->Log())
+		|| _IsAllocated(volume, blockNumber)) {
+		return B_OK;
+	}
+
+	BlockImageList::Iterator iterator = fImages.GetIterator();
+	while (block_image* image = iterator.Next()) {
+		if (image->block == blockNumber)
+			return B_OK;
+	}
+
+	block_image* image = (block_image*)malloc(sizeof(block_image)
+		+ volume->BlockSize());
+	if (image == NULL)
+		return B_NO_MEMORY;
+
+	const void* data = block_cache_get(volume->BlockCache(), blockNumber);
+	if (data == NULL) {
+		free(image);
+		return B_IO_ERROR;
+	}
+
+	image->block = blockNumber;
+	memcpy(image->data, data, volume->BlockSize());
+	block_cache_put(volume->BlockCache(), blockNumber);
+
+	fImages.Add(image);
+	return B_OK;
+}
+
+
+status_t
+IndependentTransaction::AddAllocation(block_run run)
+{
+	if (fDone)
+		return B_OK;
+
+	return fAllocations.Push(run);
+}
+
+
+/*!	Returns \c true if the run will be freed when the transaction succeeds,
+	and \c false if the caller has to free it right away.
+*/
+bool
+IndependentTransaction::DeferFree(block_run run)
+{
+	if (fDone)
+		return false;
+
+	return fFrees.Push(run) == B_OK;
+}
+
+
+/*!	Adds the blocks that have been freed during the transaction to
+	\a frees.
+*/
+void
+IndependentTransaction::Commit(Volume* volume, Stack<block_run>& frees)
+{
+	fDone = true;
+
+	block_run run;
+	while (fFrees.Pop(&run)) {
+		if (frees.Push(run) != B_OK)
+			volume->Free(*fOwner, run);
+	}
+}
+
+
+/*!	Restores all blocks the transaction has changed, and adds the blocks it
+	allocated to \a frees. The blocks it freed stay in use.
+*/
+void
+IndependentTransaction::Undo(Volume* volume, int32 transactionID,
+	Stack<block_run>& frees)
+{
+	fDone = true;
+
+	while (block_image* image = fImages.RemoveHead()) {
+		void* data = block_cache_get_writable(volume->BlockCache(),
+			image->block, transactionID);
+		if (data != NULL) {
+			memcpy(data, image->data, volume->BlockSize());
+			block_cache_put(volume->BlockCache(), image->block);
+		} else {
+			FATAL(("could not restore block %" B_PRIdOFF "!\n",
+				image->block));
+		}
+
+		free(image);
+	}
+
+	fFrees.MakeEmpty();
+
+	block_run run;
+	while (fAllocations.Pop(&run)) {
+		if (frees.Push(run) != B_OK)
+			volume->Free(*fOwner, run);
+	}
+}
+
+
+bool
+IndependentTransaction::_IsAllocated(Volume* volume, off_t blockNumber)
+{
+	for (int32 i = 0; i < fAllocations.CountItems(); i++) {
+		const block_run& run = fAllocations.Array()[i];
+		off_t start = volume->ToBlock(run);
+
+		if (blockNumber >= start && blockNumber < start + run.Length())
+			return true;
+	}
+
+	return false;
+}
+
+
 //	#pragma mark - Journal
 
 
@@ -408,6 +606,9 @@ Journal::Journal(Volume* volume)
 	fSeparateSubTransactions(false)
 {
 	recursive_lock_init(&fLock, "bfs journal");
+	rw_lock_init(&fTransactionLock, "bfs transactions");
+	mutex_init(&fIndependentLock, "bfs independent transactions");
+	mutex_init(&fIndexLock, "bfs journal indices");
 	mutex_init(&fEntriesLock, "bfs journal entries");
 }
 
@@ -417,6 +618,9 @@ Journal::~Journal()
 	FlushLogAndBlocks();
 
 	recursive_lock_destroy(&fLock);
+	rw_lock_destroy(&fTransactionLock);
+	mutex_destroy(&fIndependentLock);
+	mutex_destroy(&fIndexLock);
 	mutex_destroy(&fEntriesLock);
 }
 
@@ -915,6 +1119,11 @@ Journal::_WriteTransactionToLog()
 status_t
 Journal::_FlushLog(bool canWait, bool flushBlocks)
 {
+	if (_CurrentIndependentTransaction() != NULL) {
+		// we cannot wait for our own transaction to end
+		return B_OK;
+	}
+
 	status_t status = canWait ? recursive_lock_lock(&fLock)
 		: recursive_lock_trylock(&fLock);
 	if (status != B_OK)
@@ -926,6 +1135,9 @@ Journal::_FlushLog(bool canWait, bool flushBlocks)
 		return B_OK;
 	}
 
+	// wait until all independent transactions are done
+	rw_lock_write_lock(&fTransactionLock);
+
 	// write the current log entry to disk
 
 	if (fUnwrittenTransactions != 0 && _TransactionSize() != 0) {
@@ -937,7 +1149,7 @@ Journal::_FlushLog(bool canWait, bool flushBlocks)
 	if (flushBlocks)
 		status = fVolume->FlushDevice();
 
-	recursive_lock_unlock(&fLock);
+	_Unlock();
 	return status;
 }
 
@@ -952,13 +1164,37 @@ Journal::FlushLogAndBlocks()
 }
 
 
+/*!	Starts a transaction for \a owner. Exclusive transactions wait until all
+	independent ones are done, and keep new ones from starting until they are
+	done themselves. Independent transactions can only be started outside of
+	an exclusive transaction. A transaction started in a thread that is
+	already in a transaction becomes part of that one.
+*/
 status_t
-Journal::Lock(Transaction* owner, bool separateSubTransactions)
+Journal::Lock(Transaction* owner, bool separateSubTransactions,
+	transaction_mode mode)
 {
+	if (owner != NULL && recursive_lock_get_recursion(&fLock) < 0) {
+		IndependentTransaction* independent = _CurrentIndependentTransaction();
+		if (independent != NULL) {
+			owner->SetParent(independent->Owner());
+			owner->SetIndependent(independent);
+			return B_OK;
+		}
+
+		if (mode == INDEPENDENT_TRANSACTION && _StartIndependent(owner) == B_OK)
+			return B_OK;
+	}
+
 	status_t status = recursive_lock_lock(&fLock);
 	if (status != B_OK)
 		return status;
 
+	if (recursive_lock_get_recursion(&fLock) == 1) {
+		// wait until all independent transactions are done
+		rw_lock_write_lock(&fTransactionLock);
+	}
+
 	if (!fSeparateSubTransactions && recursive_lock_get_recursion(&fLock) > 1) {
 		// we'll just use the current transaction again
 		return B_OK;
@@ -988,7 +1224,7 @@ Journal::Lock(Transaction* owner, bool separateSubTransactions)
 			fTransactionID = cache_start_transaction(fVolume->BlockCache());
 
 		if (fTransactionID < B_OK) {
-			recursive_lock_unlock(&fLock);
+			_Unlock();
 			return fTransactionID;
 		}
 
@@ -1002,6 +1238,9 @@ Journal::Lock(Transaction* owner, bool separateSubTransactions)
 status_t
 Journal::Unlock(Transaction* owner, bool success)
 {
+	if (owner != NULL && owner->IsIndependent())
+		return _UnlockIndependent(owner, success);
+
 	if (fSeparateSubTransactions || recursive_lock_get_recursion(&fLock) == 1) {
 		// we only end the transaction if we would really unlock it
 		// TODO: what about failing transactions that do not unlock?
@@ -1031,7 +1270,170 @@ Journal::Unlock(Transaction* owner, bool success)
 	} else
 		owner->MoveListenersTo(fOwner);
 
+	_Unlock();
+	return B_OK;
+}
+
+
+/*!	Independent transactions change the index trees only while holding the
+	index lock, which they keep until they are done. Since they lock the
+	indices only after any other inode they change, this cannot deadlock.
+*/
+void
+Journal::LockIndices(Transaction* owner)
+{
+	IndependentTransaction* independent = owner->Independent();
+	if (independent->IndicesLocked())
+		return;
+
+	mutex_lock(&fIndexLock);
+	independent->SetIndicesLocked();
+}
+
+
+//!	Unlocks the journal from an exclusive transaction.
+void
+Journal::_Unlock()
+{
+	if (recursive_lock_get_recursion(&fLock) == 1)
+		rw_lock_write_unlock(&fTransactionLock);
+
 	recursive_lock_unlock(&fLock);
+}
+
+
+//!	Returns the independent transaction the current thread is in, if any.
+IndependentTransaction*
+Journal::_CurrentIndependentTransaction()
+{
+	thread_id thread = find_thread(NULL);
+
+	MutexLocker locker(fIndependentLock);
+
+	IndependentTransactionList::Iterator iterator
+		= fIndependentTransactions.GetIterator();
+	while (IndependentTransaction* independent = iterator.Next()) {
+		if (independent->Thread() == thread)
+			return independent;
+	}
+
+	return NULL;
+}
+
+
+/*!	Starts an independent transaction. It joins the current cache
+	transaction, or starts it, if there is none yet.
+	Returns \c B_BUSY, if the current one is already too large to take more
+	changes; the caller has to start an exclusive transaction instead.
+*/
+status_t
+Journal::_StartIndependent(Transaction* owner)
+{
+	IndependentTransaction* independent
+		= new(std::nothrow) IndependentTransaction(owner);
+	if (independent == NULL)
+		return B_NO_MEMORY;
+
+	rw_lock_read_lock(&fTransactionLock);
+	MutexLocker locker(fIndependentLock);
+
+	// The changes of a group can only be written to the log together, so it
+	// must not grow much beyond the size at which it is written anyway.
+	if ((fUnwrittenTransactions > 0 || !fIndependentTransactions.IsEmpty())
+		&& _TransactionSize() >= fMaxTransactionSize) {
+		locker.Unlock();
+		rw_lock_read_unlock(&fTransactionLock);
+		delete independent;
+		return B_BUSY;
+	}
+
+	if (fIndependentTransactions.IsEmpty()) {
+		int32 id = fTransactionID;
+		status_t status;
+		if (fUnwrittenTransactions == 0)
+			status = id = cache_start_transaction(fVolume->BlockCache());
+		else {
+			// start a sub transaction, as Lock() does
+			status = cache_start_sub_transaction(fVolume->BlockCache(), id);
+			if (status == B_OK)
+				fHasSubtransaction = true;
+		}
+		if (status < B_OK) {
+			locker.Unlock();
+			rw_lock_read_unlock(&fTransactionLock);
+			delete independent;
+			return status;
+		}
+
+		fTransactionID = id;
+	}
+
+	cache_add_transaction_listener(fVolume->BlockCache(), fTransactionID,
+		TRANSACTION_IDLE, _TransactionIdle, this);
+
+	fIndependentTransactions.Add(independent);
+
+	owner->SetParent(NULL);
+	owner->SetIndependent(independent);
+	return B_OK;
+}
+
+
+status_t
+Journal::_UnlockIndependent(Transaction* owner, bool success)
+{
+	IndependentTransaction* independent = owner->Independent();
+	if (independent->Owner() != owner) {
+		// a nested transaction is only done with its outer transaction
+		owner->MoveListenersTo(owner->Parent());
+		owner->SetIndependent(NULL);
+		return B_OK;
+	}
+
+	MutexLocker locker(fIndependentLock);
+	if (success)
+		independent->Commit(fVolume, fPendingFrees);
+	else
+		independent->Undo(fVolume, fTransactionID, fPendingFrees);
+	locker.Unlock();
+
+	// Unlocking the inodes might start new transactions in this thread; they
+	// will just become part of this one, which cannot fail anymore.
+	owner->NotifyListeners(success);
+
+	locker.Lock();
+	fIndependentTransactions.Remove(independent);
+
+	if (fIndependentTransactions.IsEmpty()) {
+		// No one can reuse the freed blocks in the current sub transaction
+		// anymore
+		block_run run;
+		while (fPendingFrees.Pop(&run))
+			fVolume->Free(*owner, run);
+	}
+
+	// Up to a maximum size, the transactions are batched together, and
+	// written to the log at once
+	fUnwrittenTransactions++;
+	uint32 size = _TransactionSize();
+	locker.Unlock();
+
+	if (size < fMaxTransactionSize && size > FreeLogBlocks())
+		cache_sync_transaction(fVolume->BlockCache(), fTransactionID);
+
+	if (independent->IndicesLocked())
+		mutex_unlock(&fIndexLock);
+	rw_lock_read_unlock(&fTransactionLock);
+
+	owner->SetIndependent(NULL);
+	delete independent;
+
+	if (size >= fMaxTransactionSize) {
+		// The changes of this transaction are final already, but the caller
+		// still has to learn when they could not be written to the log.
+		return _FlushLog(true, false);
+	}
+
 	return B_OK;
 }
 
@@ -1063,6 +1465,8 @@ Journal::_TransactionDone(bool success)
 			fUnwrittenTransactions = 0;
 		}
 
+		// The block bitmap might have been reverted as well
+		fVolume->Allocator().InvalidateFreeRanges();
 		return B_OK;
 	}
 
@@ -1104,6 +1508,8 @@ Journal::Dump()
 	kprintf("  transaction ID:       %" B_PRId32 "\n", fTransactionID);
 	kprintf("  has subtransaction:   %d\n", fHasSubtransaction);
 	kprintf("  separate sub-trans.:  %d\n", fSeparateSubTransactions);
+	kprintf("  independent trans.:   %" B_PRId32 "\n",
+		fIndependentTransactions.Count());
 	kprintf("entries:\n");
 	kprintf("  address        id  start length\n");
 
@@ -1154,14 +1560,14 @@ TransactionListener::~TransactionListener()
 
 
 status_t
-Transaction::Start(Volume* volume, off_t refBlock)
+Transaction::Start(Volume* volume, off_t refBlock, transaction_mode mode)
 {
 	// has it already been started?
 	if (fJournal != NULL)
 		return B_OK;
 
 	fJournal = volume->GetJournal(refBlock);
-	if (fJournal != NULL && fJournal->Lock(this, false) == B_OK)
+	if (fJournal != NULL && fJournal->Lock(this, false, mode) == B_OK)
 		return B_OK;
 
 	fJournal = NULL;
@@ -1169,6 +1575,36 @@ Transaction::Start(Volume* volume, off_t refBlock)
 }
 
 
+/*!	Tells an independent transaction about blocks it allocated, so that it can
+	free them again when it fails.
+*/
+status_t
+Transaction::AddAllocation(block_run run)
+{
+	if (fIndependent == NULL)
+		return B_OK;
+
+	return fIndependent->AddAllocation(run);
+}
+
+
+/*!	Returns \c true if freeing the run has to wait until the (independent)
+	transaction is done.
+*/
+bool
+Transaction::DeferFree(block_run run)
+{
+	return fIndependent != NULL && fIndependent->DeferFree(run);
+}
+
+
+status_t
+Transaction::_SaveBlock(off_t blockNumber)
+{
+	return fIndependent->SaveBlock(GetVolume(), blockNumber);
+}
+
+
 void
 Transaction::AddListener(TransactionListener* listener)
 {
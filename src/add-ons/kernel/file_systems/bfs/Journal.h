@@ -13,9 +13,21 @@
 
 
 struct run_array;
+class IndependentTransaction;
 class Inode;
 class LogEntry;
 typedef DoublyLinkedList<LogEntry> LogEntryList;
+typedef DoublyLinkedList<IndependentTransaction> IndependentTransactionList;
+
+
+enum transaction_mode {
+	EXCLUSIVE_TRANSACTION,
+		// the transaction runs alone, and may change anything
+	INDEPENDENT_TRANSACTION
+		// the transaction may run concurrently with other independent
+		// transactions; it must write lock every inode it changes
+		// (see Inode::WriteLockInTransaction())
+};
 
 
 class Journal {
@@ -26,9 +38,13 @@ public:
 			status_t		InitCheck();
 
 			status_t		Lock(Transaction* owner,
-								bool separateSubTransactions);
+								bool separateSubTransactions,
+								transaction_mode mode
+									= EXCLUSIVE_TRANSACTION);
 			status_t		Unlock(Transaction* owner, bool success);
 
+			void			LockIndices(Transaction* owner);
+
 			status_t		ReplayLog();
 
 			Transaction*	CurrentTransaction() const { return fOwner; }
@@ -56,6 +72,12 @@ private:
 			status_t		_ReplayRunArray(int32* start);
 			status_t		_TransactionDone(bool success);
 
+			void			_Unlock();
+			IndependentTransaction* _CurrentIndependentTransaction();
+			status_t		_StartIndependent(Transaction* owner);
+			status_t		_UnlockIndependent(Transaction* owner,
+								bool success);
+
 	static	void			_TransactionWritten(int32 transactionID,
 								int32 event, void* _logEntry);
 	static	void			_TransactionIdle(int32 transactionID, int32 event,
@@ -65,6 +87,13 @@ private:
 private:
 			Volume*			fVolume;
 			recursive_lock	fLock;
+			rw_lock			fTransactionLock;
+				// held for writing by exclusive transactions, and for
+				// reading by independent ones
+			mutex			fIndependentLock;
+			IndependentTransactionList fIndependentTransactions;
+			Stack<block_run> fPendingFrees;
+			mutex			fIndexLock;
 			Transaction*	fOwner;
 			uint32			fLogSize;
 			uint32			fMaxTransactionSize;
@@ -103,18 +132,21 @@ typedef DoublyLinkedList<TransactionListener> TransactionListeners;
 
 class Transaction {
 public:
-	Transaction(Volume* volume, off_t refBlock)
+	Transaction(Volume* volume, off_t refBlock,
+			transaction_mode mode = EXCLUSIVE_TRANSACTION)
 		:
 		fJournal(NULL),
-		fParent(NULL)
+		fParent(NULL),
+		fIndependent(NULL)
 	{
-		Start(volume, refBlock);
+		Start(volume, refBlock, mode);
 	}
 
 	Transaction(Volume* volume, block_run refRun)
 		:
 		fJournal(NULL),
-		fParent(NULL)
+		fParent(NULL),
+		fIndependent(NULL)
 	{
 		Start(volume, volume->ToBlock(refRun));
 	}
@@ -122,7 +154,8 @@ public:
 	Transaction()
 		:
 		fJournal(NULL),
-		fParent(NULL)
+		fParent(NULL),
+		fIndependent(NULL)
 	{
 	}
 
@@ -132,8 +165,10 @@ public:
 			fJournal->Unlock(this, false);
 	}
 
-	status_t Start(Volume* volume, off_t refBlock);
+	status_t Start(Volume* volume, off_t refBlock,
+		transaction_mode mode = EXCLUSIVE_TRANSACTION);
 	bool IsStarted() const { return fJournal != NULL; }
+	bool IsIndependent() const { return fIndependent != NULL; }
 
 	status_t Done()
 	{
@@ -166,6 +201,9 @@ public:
 		size_t blockSize = GetVolume()->BlockSize();
 
 		for (size_t i = 0; i < numBlocks; i++) {
+			if (WillWriteBlock(blockNumber + i) != B_OK)
+				return B_NO_MEMORY;
+
 			void* block = block_cache_get_empty(cache, blockNumber + i,
 				ID());
 			if (block == NULL)
@@ -196,14 +234,42 @@ public:
 	Transaction* Parent() const
 		{ return fParent; }
 
+	// Independent transactions cannot be aborted through the block cache,
+	// as they share the cache transaction with others; they undo their
+	// changes themselves, and need to be told about them.
+
+	status_t WillWriteBlock(off_t blockNumber)
+	{
+		if (fIndependent == NULL)
+			return B_OK;
+		return _SaveBlock(blockNumber);
+	}
+
+	status_t AddAllocation(block_run run);
+	bool DeferFree(block_run run);
+
+	void LockIndices()
+	{
+		if (fIndependent != NULL)
+			fJournal->LockIndices(this);
+	}
+
+	void SetIndependent(IndependentTransaction* independent)
+		{ fIndependent = independent; }
+	IndependentTransaction* Independent() const
+		{ return fIndependent; }
+
 private:
 	Transaction(const Transaction& other);
 	Transaction& operator=(const Transaction& other);
 		// no implementation
 
+	status_t _SaveBlock(off_t blockNumber);
+
 	Journal*				fJournal;
 	TransactionListeners	fListeners;
 	Transaction*			fParent;
+	IndependentTransaction*	fIndependent;
 };
 
 
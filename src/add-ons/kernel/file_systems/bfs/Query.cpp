@@ -70,6 +70,53 @@ union value {
 };
 
 
+// the maximum number of inodes that are collected from an index to narrow
+// down a query
+static const int32 kMaxQueryCandidates = 16384;
+
+// how many index entries of the other terms we are willing to look at for
+// every inode the current equation would have to read
+static const int32 kIndexEntriesPerInode = 1;
+
+// a range of another term needs to cover no more than this fraction of the
+// values in its index to be worth collecting
+static const int32 kMaxRangeFraction = 8;
+
+
+/*!	A sorted set of inode IDs that could match a part of a query. It is
+	collected from the B+tree indices of that part alone, without reading
+	any inodes, and lets a query skip all entries of the index it iterates
+	that could not match anyway.
+*/
+class CandidateSet {
+public:
+							CandidateSet(int32 limit = kMaxQueryCandidates);
+							~CandidateSet();
+
+			status_t		Add(ino_t id);
+			void			Sort();
+
+			void			IntersectWith(const CandidateSet& other);
+			status_t		UnionWith(const CandidateSet& other);
+			void			TakeOver(CandidateSet& other);
+
+			bool			Contains(ino_t id) const;
+			int32			Count() const { return fCount; }
+			int32			Limit() const { return fLimit; }
+			ino_t			IDAt(int32 index) const { return fIDs[index]; }
+
+private:
+							CandidateSet(const CandidateSet& other);
+							CandidateSet& operator=(const CandidateSet& other);
+								// no implementation
+
+			ino_t*			fIDs;
+			int32			fCount;
+			int32			fCapacity;
+			int32			fLimit;
+};
+
+
 /*!	Abstract base class for the operator/equation classes.
 */
 class Term {
@@ -90,6 +137,9 @@ public:
 	virtual	void		CalculateScore(Index& index) = 0;
 	virtual	int32		Score() const = 0;
 
+	virtual	status_t	CollectCandidates(Volume* volume,
+							CandidateSet& candidates, bool narrowing) = 0;
+
 	virtual	status_t	InitCheck() = 0;
 
 #ifdef DEBUG
@@ -131,11 +181,18 @@ public:
 			status_t	PrepareQuery(Volume* volume, Index& index,
 							TreeIterator** iterator, bool queryNonIndexed);
 			status_t	GetNextMatching(Volume* volume, TreeIterator* iterator,
+							const CandidateSet* candidates,
+							struct dirent* dirent, size_t bufferSize);
+			status_t	GetNextCandidate(Volume* volume,
+							const CandidateSet& candidates, int32& index,
 							struct dirent* dirent, size_t bufferSize);
 
 	virtual	void		CalculateScore(Index &index);
 	virtual	int32		Score() const { return fScore; }
 
+	virtual	status_t	CollectCandidates(Volume* volume,
+							CandidateSet& candidates, bool narrowing);
+
 #ifdef DEBUG
 	virtual	void		PrintToStream();
 #endif
@@ -149,6 +206,9 @@ private:
 			bool		CompareTo(const uint8* value, uint16 size);
 			uint8*		Value() const { return (uint8*)&fValue; }
 			status_t	MatchEmptyString();
+			status_t	MatchInode(Volume* volume, off_t offset,
+							bool matchSelf, struct dirent* dirent);
+			bool		IsSelective(BPlusTree* tree);
 
 			char*		fAttribute;
 			char*		fString;
@@ -182,6 +242,9 @@ public:
 	virtual	void		CalculateScore(Index& index);
 	virtual	int32		Score() const;
 
+	virtual	status_t	CollectCandidates(Volume* volume,
+							CandidateSet& candidates, bool narrowing);
+
 	virtual	status_t	InitCheck();
 
 #ifdef DEBUG
@@ -201,6 +264,211 @@ private:
 //	#pragma mark -
 
 
+/*!	Returns the integer \a key of an index of the given \a type as an int64
+	that keeps the order and the proportions of the keys. Returns false for
+	other types.
+*/
+static bool
+get_integer_key(type_code type, const void* key, int64& _value)
+{
+	switch (type) {
+		case B_INT32_TYPE:
+			_value = *(const int32*)key;
+			return true;
+		case B_UINT32_TYPE:
+			_value = *(const uint32*)key;
+			return true;
+		case B_INT64_TYPE:
+			_value = *(const int64*)key;
+			return true;
+		case B_UINT64_TYPE:
+			_value = (int64)(*(const uint64*)key >> 1);
+			return true;
+	}
+
+	return false;
+}
+
+
+static int
+compare_ids(const void* _a, const void* _b)
+{
+	ino_t a = *(const ino_t*)_a;
+	ino_t b = *(const ino_t*)_b;
+
+	if (a < b)
+		return -1;
+	if (a > b)
+		return 1;
+	return 0;
+}
+
+
+CandidateSet::CandidateSet(int32 limit)
+	:
+	fIDs(NULL),
+	fCount(0),
+	fCapacity(0),
+	fLimit(limit)
+{
+}
+
+
+CandidateSet::~CandidateSet()
+{
+	free(fIDs);
+}
+
+
+/*!	Adds \a id to the set; call Sort() after you added all of them.
+	The set can only hold up to the number of entries it has been limited
+	to, if you try to add more, B_BUFFER_OVERFLOW is returned. A larger set
+	would be too expensive to collect for what it could save.
+*/
+status_t
+CandidateSet::Add(ino_t id)
+{
+	if (fCount == fLimit)
+		return B_BUFFER_OVERFLOW;
+
+	if (fCount == fCapacity) {
+		int32 capacity = fCapacity > 0 ? fCapacity * 2 : 256;
+		if (capacity > fLimit)
+			capacity = fLimit;
+
+		ino_t* ids = (ino_t*)realloc(fIDs, capacity * sizeof(ino_t));
+		if (ids == NULL)
+			return B_NO_MEMORY;
+
+		fIDs = ids;
+		fCapacity = capacity;
+	}
+
+	fIDs[fCount++] = id;
+	return B_OK;
+}
+
+
+//!	Sorts the set, and removes all duplicates from it.
+void
+CandidateSet::Sort()
+{
+	if (fCount < 2)
+		return;
+
+	qsort(fIDs, fCount, sizeof(ino_t), &compare_ids);
+
+	int32 count = 1;
+	for (int32 i = 1; i < fCount; i++) {
+		if (fIDs[i] != fIDs[count - 1])
+			fIDs[count++] = fIDs[i];
+	}
+	fCount = count;
+}
+
+
+//!	Only keeps the IDs that are also part of the sorted set \a other.
+void
+CandidateSet::IntersectWith(const CandidateSet& other)
+{
+	int32 count = 0;
+	int32 otherIndex = 0;
+
+	for (int32 i = 0; i < fCount; i++) {
+		while (otherIndex < other.fCount && other.fIDs[otherIndex] < fIDs[i])
+			otherIndex++;
+		if (otherIndex == other.fCount)
+			break;
+
+		if (other.fIDs[otherIndex] == fIDs[i])
+			fIDs[count++] = fIDs[i];
+	}
+
+	fCount = count;
+}
+
+
+//!	Adds all IDs of the sorted set \a other.
+status_t
+CandidateSet::UnionWith(const CandidateSet& other)
+{
+	if (other.fCount == 0)
+		return B_OK;
+
+	int32 capacity = fCount + other.fCount;
+	if (capacity > fLimit)
+		return B_BUFFER_OVERFLOW;
+
+	ino_t* ids = (ino_t*)malloc(capacity * sizeof(ino_t));
+	if (ids == NULL)
+		return B_NO_MEMORY;
+
+	int32 count = 0;
+	int32 i = 0;
+	int32 otherIndex = 0;
+
+	while (i < fCount || otherIndex < other.fCount) {
+		if (otherIndex == other.fCount
+			|| (i < fCount && fIDs[i] < other.fIDs[otherIndex])) {
+			ids[count++] = fIDs[i++];
+		} else if (i == fCount || other.fIDs[otherIndex] < fIDs[i]) {
+			ids[count++] = other.fIDs[otherIndex++];
+		} else {
+			// both sets contain this ID
+			ids[count++] = fIDs[i++];
+			otherIndex++;
+		}
+	}
+
+	free(fIDs);
+	fIDs = ids;
+	fCount = count;
+	fCapacity = capacity;
+	return B_OK;
+}
+
+
+//!	Moves the contents of \a other into this set; \a other will be empty.
+void
+CandidateSet::TakeOver(CandidateSet& other)
+{
+	free(fIDs);
+
+	fIDs = other.fIDs;
+	fCount = other.fCount;
+	fCapacity = other.fCapacity;
+	fLimit = other.fLimit;
+
+	other.fIDs = NULL;
+	other.fCount = 0;
+	other.fCapacity = 0;
+}
+
+
+bool
+CandidateSet::Contains(ino_t id) const
+{
+	int32 first = 0;
+	int32 last = fCount - 1;
+
+	while (first <= last) {
+		int32 middle = (first + last) / 2;
+		if (fIDs[middle] == id)
+			return true;
+
+		if (fIDs[middle] < id)
+			first = middle + 1;
+		else
+			last = middle - 1;
+	}
+
+	return false;
+}
+
+
+//	#pragma mark -
+
+
 Equation::Equation(char** expr)
 	:
 	Term(OP_EQUATION),
@@ -771,7 +1039,7 @@ Equation::PrepareQuery(Volume* /*volume*/, Index& index,
 
 status_t
 Equation::GetNextMatching(Volume* volume, TreeIterator* iterator,
-	struct dirent* dirent, size_t bufferSize)
+	const CandidateSet* candidates, struct dirent* dirent, size_t bufferSize)
 {
 	while (true) {
 		union value indexValue;
@@ -802,77 +1070,243 @@ Equation::GetNextMatching(Volume* volume, TreeIterator* iterator,
 			continue;
 		}
 
-		Vnode vnode(volume, offset);
-		Inode* inode;
-		if ((status = vnode.Get(&inode)) != B_OK) {
-			REPORT_ERROR(status);
-			FATAL(("could not get inode %" B_PRIdOFF " in index \"%s\"!\n",
-				offset, fAttribute));
-			// try with next
+		if (candidates != NULL && !candidates->Contains(offset)) {
+			// The other indices of the query told us already that this
+			// inode cannot match, no need to read it
 			continue;
 		}
 
-		// TODO: check user permissions here - but which one?!
-		// we could filter out all those where we don't have
-		// read access... (we should check for every parent
-		// directory if the X_OK is allowed)
-		// Although it's quite expensive to open all parents,
-		// it's likely that the application that runs the
-		// query will do something similar (and we don't have
-		// to do it for root, either).
-
-		// go up in the tree until a &&-operator is found, and check if the
-		// inode matches with the rest of the expression - we don't have to
-		// check ||-operators for that
-		Term* term = this;
-		status = MATCH_OK;
-
-		if (!fHasIndex)
-			status = Match(inode);
-
-		while (term != NULL && status == MATCH_OK) {
-			Operator* parent = (Operator*)term->Parent();
-			if (parent == NULL)
-				break;
+		if (MatchInode(volume, offset, !fHasIndex, dirent) == MATCH_OK)
+			return B_OK;
+	}
+	RETURN_ERROR(B_ERROR);
+}
 
-			if (parent->Op() == OP_AND) {
-				// choose the other child of the parent
-				Term* other = parent->Right();
-				if (other == term)
-					other = parent->Left();
 
-				if (other == NULL) {
-					FATAL(("&&-operator has only one child... (parent = %p)\n",
-						parent));
-					break;
-				}
-				status = other->Match(inode);
-				if (status < 0) {
-					REPORT_ERROR(status);
-					status = NO_MATCH;
-				}
+/*!	Like GetNextMatching(), but instead of iterating the index, it walks
+	through \a candidates starting at \a index, which must already contain
+	all inodes whose index entry matches this equation.
+*/
+status_t
+Equation::GetNextCandidate(Volume* volume, const CandidateSet& candidates,
+	int32& index, struct dirent* dirent, size_t bufferSize)
+{
+	while (index < candidates.Count()) {
+		if (MatchInode(volume, candidates.IDAt(index++), false, dirent)
+				== MATCH_OK)
+			return B_OK;
+	}
+
+	return B_ENTRY_NOT_FOUND;
+}
+
+
+/*!	Reads the inode \a offset, and checks if it matches the rest of the
+	query, that is, all terms this equation is and-ed with, and, if
+	\a matchSelf is true, this equation, too.
+	If it does, \a dirent is filled in, and MATCH_OK is returned.
+*/
+status_t
+Equation::MatchInode(Volume* volume, off_t offset, bool matchSelf,
+	struct dirent* dirent)
+{
+	Vnode vnode(volume, offset);
+	Inode* inode;
+	status_t status = vnode.Get(&inode);
+	if (status != B_OK) {
+		REPORT_ERROR(status);
+		FATAL(("could not get inode %" B_PRIdOFF " in index \"%s\"!\n",
+			offset, fAttribute));
+		return status;
+	}
+
+	// TODO: check user permissions here - but which one?!
+	// we could filter out all those where we don't have
+	// read access... (we should check for every parent
+	// directory if the X_OK is allowed)
+	// Although it's quite expensive to open all parents,
+	// it's likely that the application that runs the
+	// query will do something similar (and we don't have
+	// to do it for root, either).
+
+	// go up in the tree until a &&-operator is found, and check if the
+	// inode matches with the rest of the expression - we don't have to
+	// check ||-operators for that
+	Term* term = this;
+	status = MATCH_OK;
+
+	if (matchSelf)
+		status = Match(inode);
+
+	while (term != NULL && status == MATCH_OK) {
+		Operator* parent = (Operator*)term->Parent();
+		if (parent == NULL)
+			break;
+
+		if (parent->Op() == OP_AND) {
+			// choose the other child of the parent
+			Term* other = parent->Right();
+			if (other == term)
+				other = parent->Left();
+
+			if (other == NULL) {
+				FATAL(("&&-operator has only one child... (parent = %p)\n",
+					parent));
+				break;
+			}
+			status = other->Match(inode);
+			if (status < 0) {
+				REPORT_ERROR(status);
+				status = NO_MATCH;
 			}
-			term = (Term*)parent;
 		}
+		term = (Term*)parent;
+	}
 
-		if (status == MATCH_OK) {
-			dirent->d_dev = volume->ID();
-			dirent->d_ino = offset;
-			dirent->d_pdev = volume->ID();
-			dirent->d_pino = volume->ToVnode(inode->Parent());
+	if (status == MATCH_OK) {
+		dirent->d_dev = volume->ID();
+		dirent->d_ino = offset;
+		dirent->d_pdev = volume->ID();
+		dirent->d_pino = volume->ToVnode(inode->Parent());
 
-			if (inode->GetName(dirent->d_name) < B_OK) {
-				FATAL(("inode %" B_PRIdOFF " in query has no name!\n",
-					inode->BlockNumber()));
-			}
+		if (inode->GetName(dirent->d_name) < B_OK) {
+			FATAL(("inode %" B_PRIdOFF " in query has no name!\n",
+				inode->BlockNumber()));
+		}
+
+		dirent->d_reclen = sizeof(struct dirent) + strlen(dirent->d_name);
+	}
+
+	return status;
+}
+
+
+/*!	Returns whether walking the index of this equation is likely to rule
+	out enough inodes of another one to be worth it. The walk of an
+	equality, or of a pattern is limited by the entries of the other
+	equation anyway, and usually ends well before. Ranges of integer values
+	are estimated by the part of the values in \a tree they cover; other
+	ranges are too hard to guess.
+*/
+bool
+Equation::IsSelective(BPlusTree* tree)
+{
+	if (fOp == OP_EQUAL)
+		return true;
+
+	int64 value;
+	if (!get_integer_key(fType, Value(), value))
+		return false;
+
+	// get the smallest and the largest key of the index
+	TreeIterator iterator(tree);
+	union value key;
+	uint16 keyLength;
+	off_t offset;
+	int64 first;
+	int64 last;
+	if (iterator.Goto(BPLUSTREE_BEGIN) != B_OK
+		|| iterator.GetNextEntry(&key, &keyLength, (uint16)sizeof(key),
+			&offset) != B_OK
+		|| !get_integer_key(fType, &key, first)
+		|| iterator.Goto(BPLUSTREE_END) != B_OK
+		|| iterator.GetPreviousEntry(&key, &keyLength, (uint16)sizeof(key),
+			&offset) != B_OK
+		|| !get_integer_key(fType, &key, last)) {
+		return false;
+	}
+
+	int64 low = first;
+	int64 high = last;
+	if (fOp == OP_LESS_THAN || fOp == OP_LESS_THAN_OR_EQUAL)
+		high = min_c(high, value);
+	else
+		low = max_c(low, value);
+
+	uint64 range = high > low ? (uint64)high - (uint64)low : 0;
+	return range <= ((uint64)last - (uint64)first) / kMaxRangeFraction;
+}
+
+
+/*!	Collects the IDs of all inodes whose index entry matches this equation
+	into \a candidates, without reading the inodes themselves.
+	This is only possible if there is an index for the attribute, and if
+	inodes that don't have the attribute at all cannot match, as those are
+	not part of the index.
+	If \a narrowing is true, the candidates are only used to narrow down
+	another equation that drives the query. In this case, the "size", and
+	"last_modified" indices are refused: they are only updated when a file
+	is closed, so files that are open for writing would be ruled out, even
+	though the driving equation would have found them matching. So are
+	equations that likely don't rule out enough to pay off, see
+	IsSelective().
+*/
+status_t
+Equation::CollectCandidates(Volume* volume, CandidateSet& candidates,
+	bool narrowing)
+{
+	if (fOp == OP_UNEQUAL)
+		return B_BAD_VALUE;
+
+	if (narrowing && (fIsSpecialTime || !strcmp(fAttribute, "size")))
+		return B_NOT_ALLOWED;
+
+	Index index(volume);
+	if (index.SetTo(fAttribute) != B_OK)
+		return B_ENTRY_NOT_FOUND;
+
+	TreeIterator* iterator = NULL;
+	status_t status = PrepareQuery(volume, index, &iterator, false);
+	ObjectDeleter<TreeIterator> iteratorDeleter(iterator);
+
+	if (status != B_OK && status != B_ENTRY_NOT_FOUND)
+		return status;
+	if (iterator == NULL)
+		return B_ERROR;
+
+	if (fType == B_STRING_TYPE && CompareTo((const uint8*)"", 0))
+		return B_BAD_VALUE;
+
+	if (status == B_ENTRY_NOT_FOUND) {
+		// there is no entry with this exact value
+		return B_OK;
+	}
+
+	if (narrowing && !IsSelective(iterator->Tree()))
+		return B_NOT_ALLOWED;
+
+	while (true) {
+		union value indexValue;
+		uint16 keyLength;
+		uint16 duplicate;
+		off_t offset;
+
+		status = iterator->GetNextEntry(&indexValue, &keyLength,
+			(uint16)sizeof(indexValue), &offset, &duplicate);
+		if (status == B_ENTRY_NOT_FOUND)
+			break;
+		if (status != B_OK)
+			return status;
+
+		if (duplicate < 2 && !CompareTo((uint8*)&indexValue, keyLength)) {
+			// see GetNextMatching()
+			if (fOp == OP_LESS_THAN
+				|| fOp == OP_LESS_THAN_OR_EQUAL
+				|| (fOp == OP_EQUAL && !fIsPattern))
+				break;
 
-			dirent->d_reclen = sizeof(struct dirent) + strlen(dirent->d_name);
+			if (duplicate > 0)
+				iterator->SkipDuplicates();
+			continue;
 		}
 
-		if (status == MATCH_OK)
-			return B_OK;
+		status = candidates.Add(offset);
+		if (status != B_OK)
+			return status;
 	}
-	RETURN_ERROR(B_ERROR);
+
+	candidates.Sort();
+	return B_OK;
 }
 
 
@@ -970,6 +1404,42 @@ Operator::Score() const
 }
 
 
+/*!	For OP_AND, the candidates of both sides are intersected, but one side
+	is enough to narrow down the result. For OP_OR, both sides must be able
+	to deliver their candidates, and they are joined.
+*/
+status_t
+Operator::CollectCandidates(Volume* volume, CandidateSet& candidates,
+	bool narrowing)
+{
+	status_t status = fLeft->CollectCandidates(volume, candidates, narrowing);
+
+	if (fOp == OP_AND) {
+		CandidateSet right(candidates.Limit());
+		status_t rightStatus = fRight->CollectCandidates(volume, right,
+			narrowing);
+		if (rightStatus != B_OK)
+			return status;
+
+		if (status == B_OK)
+			candidates.IntersectWith(right);
+		else
+			candidates.TakeOver(right);
+		return B_OK;
+	}
+
+	if (status != B_OK)
+		return status;
+
+	CandidateSet right(candidates.Limit());
+	status = fRight->CollectCandidates(volume, right, narrowing);
+	if (status == B_OK)
+		status = candidates.UnionWith(right);
+
+	return status;
+}
+
+
 status_t
 Operator::InitCheck()
 {
@@ -1222,6 +1692,8 @@ Query::Query(Volume* volume, Expression* expression, uint32 flags)
 	fExpression(expression),
 	fCurrent(NULL),
 	fIterator(NULL),
+	fCandidates(NULL),
+	fCandidateIndex(-1),
 	fIndex(volume),
 	fFlags(flags),
 	fPort(-1)
@@ -1247,6 +1719,9 @@ Query::~Query()
 {
 	if ((fFlags & B_LIVE_QUERY) != 0)
 		fVolume->RemoveQuery(this);
+
+	delete fIterator;
+	delete fCandidates;
 }
 
 
@@ -1261,6 +1736,10 @@ Query::Rewind()
 	fIterator = NULL;
 	fCurrent = NULL;
 
+	delete fCandidates;
+	fCandidates = NULL;
+	fCandidateIndex = -1;
+
 	// put the whole expression on the stack
 
 	Stack<Term*> stack;
@@ -1311,16 +1790,29 @@ Query::GetNextEntry(struct dirent* dirent, size_t size)
 
 			if (status != B_OK)
 				return status;
+
+			_CollectCandidates();
 		}
 		if (fCurrent == NULL)
 			RETURN_ERROR(B_ERROR);
 
-		status_t status = fCurrent->GetNextMatching(fVolume, fIterator, dirent,
-			size);
+		status_t status;
+		if (fCandidateIndex >= 0) {
+			// we already know all inodes the current equation would find
+			status = fCurrent->GetNextCandidate(fVolume, *fCandidates,
+				fCandidateIndex, dirent, size);
+		} else {
+			status = fCurrent->GetNextMatching(fVolume, fIterator, fCandidates,
+				dirent, size);
+		}
 		if (status != B_OK) {
 			delete fIterator;
 			fIterator = NULL;
 			fCurrent = NULL;
+
+			delete fCandidates;
+			fCandidates = NULL;
+			fCandidateIndex = -1;
 		} else {
 			// only return if we have another entry
 			return B_OK;
@@ -1329,6 +1821,71 @@ Query::GetNextEntry(struct dirent* dirent, size_t size)
 }
 
 
+/*!	Every inode the current equation finds also has to match the terms it
+	is and-ed with. If those have indices, too, the inodes that could match
+	them are collected from their indices first, and the current equation
+	only needs to look at the inodes in the intersection of these sets.
+	If the current equation doesn't find too many inodes, those are
+	collected as well, and the query can then just walk the intersection.
+	The other indices are only looked at as long as this is cheaper than
+	reading the inodes the current equation would find on its own, and if
+	they can be trusted to contain every inode that matches.
+*/
+void
+Query::_CollectCandidates()
+{
+	delete fCandidates;
+	fCandidates = NULL;
+	fCandidateIndex = -1;
+
+	CandidateSet* candidates = new(std::nothrow) CandidateSet;
+	if (candidates == NULL)
+		return;
+
+	int32 limit = kMaxQueryCandidates;
+	bool complete = fCurrent->CollectCandidates(fVolume, *candidates, false)
+		== B_OK;
+	if (complete) {
+		if (candidates->Count() < kMaxQueryCandidates / kIndexEntriesPerInode)
+			limit = candidates->Count() * kIndexEntriesPerInode;
+	} else {
+		delete candidates;
+		candidates = NULL;
+	}
+
+	Term* term = fCurrent;
+	while (limit > 0) {
+		Operator* parent = (Operator*)term->Parent();
+		if (parent == NULL)
+			break;
+
+		if (parent->Op() == OP_AND) {
+			Term* other = parent->Right();
+			if (other == term)
+				other = parent->Left();
+
+			CandidateSet otherCandidates(limit);
+			if (other->CollectCandidates(fVolume, otherCandidates, true)
+					== B_OK) {
+				if (candidates == NULL) {
+					candidates = new(std::nothrow) CandidateSet;
+					if (candidates == NULL)
+						break;
+
+					candidates->TakeOver(otherCandidates);
+				} else
+					candidates->IntersectWith(otherCandidates);
+			}
+		}
+		term = parent;
+	}
+
+	fCandidates = candidates;
+	if (complete && candidates != NULL)
+		fCandidateIndex = 0;
+}
+
+
 void
 Query::SetLiveMode(port_id port, int32 token)
 {
@@ -11,6 +11,7 @@
 
 
 class Volume;
+class CandidateSet;
 class Term;
 class Equation;
 class TreeIterator;
@@ -63,11 +64,16 @@ public:
 
 			Expression*		GetExpression() const { return fExpression; }
 
+private:
+			void			_CollectCandidates();
+
 private:
 			Volume*			fVolume;
 			Expression*		fExpression;
 			Equation*		fCurrent;
 			TreeIterator*	fIterator;
+			CandidateSet*	fCandidates;
+			int32			fCandidateIndex;
 			Index			fIndex;
 			Stack<Equation*> fStack;
 
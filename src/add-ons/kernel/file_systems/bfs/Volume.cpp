@@ -286,11 +286,13 @@ Volume::Volume(fs_volume* volume)
 {
 	mutex_init(&fLock, "bfs volume");
 	mutex_init(&fQueryLock, "bfs queries");
+	mutex_init(&fRemovedInodesLock, "bfs removed inodes");
 }
 
 
 Volume::~Volume()
 {
+	mutex_destroy(&fRemovedInodesLock);
 	mutex_destroy(&fQueryLock);
 	mutex_destroy(&fLock);
 }
@@ -96,7 +96,10 @@ public:
 			status_t		CreateVolumeID(Transaction& transaction);
 
 			InodeList&		RemovedInodes() { return fRemovedInodes; }
-				// This list is guarded by the transaction lock
+			mutex&			RemovedInodesLock()
+								{ return fRemovedInodesLock; }
+				// This list is guarded by its own lock, as independent
+				// transactions may change it concurrently
 
 			// block bitmap
 			BlockAllocator&	Allocator();
@@ -173,6 +176,7 @@ protected:
 			void*			fBlockCache;
 			thread_id		fCheckingThread;
 
+			mutex			fRemovedInodesLock;
 			InodeList		fRemovedInodes;
 };
 
@@ -84,6 +84,10 @@ struct check_control {
 	 */
 #define BFS_FIX_NAME_MISMATCHES	8
 #define BFS_FIX_BPLUSTREES		16
+#define BFS_REBUILD_INDEX		32
+	/* completely rebuilds the index given in the "name" field from all
+	 * files of the volume; nothing else is checked.
+	 */
 
 /* values for the errors field */
 #define BFS_MISSING_BLOCKS		1
@@ -357,7 +357,8 @@ bfs_remove_vnode(fs_volume* _volume, fs_vnode* _node, bool reenter)
 	// If the inode isn't in use anymore, we were called before
 	// bfs_unlink() returns - in this case, we can just use the
 	// transaction which has already deleted the inode.
-	Transaction transaction(volume, volume->ToBlock(inode->Parent()));
+	Transaction transaction(volume, volume->ToBlock(inode->Parent()),
+		INDEPENDENT_TRANSACTION);
 
 	// The file system check functionality uses this flag to prevent the space
 	// used up by the inode from being freed - this flag is set only in
@@ -378,7 +379,9 @@ bfs_remove_vnode(fs_volume* _volume, fs_vnode* _node, bool reenter)
 		status = transaction.Done();
 	}
 
+	mutex_lock(&volume->RemovedInodesLock());
 	volume->RemovedInodes().Remove(inode);
+	mutex_unlock(&volume->RemovedInodesLock());
 
 	// TODO: the VFS currently does not allow this to fail
 	delete inode;
@@ -819,7 +822,11 @@ bfs_write_stat(fs_volume* _volume, fs_vnode* _node, const struct stat* stat,
 	bool isOwnerOrRoot = uid == 0 || uid == (uid_t)node.UserID();
 	bool hasWriteAccess = inode->CheckPermissions(W_OK) == B_OK;
 
-	Transaction transaction(volume, inode->BlockNumber());
+	// Changing the size has to unlock the inode in between, so it can only
+	// be done in an exclusive transaction
+	Transaction transaction(volume, inode->BlockNumber(),
+		(mask & B_STAT_SIZE) != 0
+			? EXCLUSIVE_TRANSACTION : INDEPENDENT_TRANSACTION);
 	inode->WriteLockInTransaction(transaction);
 
 	if ((mask & B_STAT_SIZE) != 0 && inode->Size() != stat->st_size) {
@@ -957,7 +964,8 @@ bfs_create(fs_volume* _volume, fs_vnode* _directory, const char* name,
 	cookie->last_size = 0;
 	cookie->last_notification = system_time();
 
-	Transaction transaction(volume, directory->BlockNumber());
+	Transaction transaction(volume, directory->BlockNumber(),
+		INDEPENDENT_TRANSACTION);
 
 	Inode* inode;
 	bool created;
@@ -1011,7 +1019,8 @@ bfs_create_symlink(fs_volume* _volume, fs_vnode* _directory, const char* name,
 	if (status < B_OK)
 		RETURN_ERROR(status);
 
-	Transaction transaction(volume, directory->BlockNumber());
+	Transaction transaction(volume, directory->BlockNumber(),
+		INDEPENDENT_TRANSACTION);
 
 	Inode* link;
 	off_t id;
@@ -1083,7 +1092,8 @@ bfs_unlink(fs_volume* _volume, fs_vnode* _directory, const char* name)
 	if (status < B_OK)
 		return status;
 
-	Transaction transaction(volume, directory->BlockNumber());
+	Transaction transaction(volume, directory->BlockNumber(),
+		INDEPENDENT_TRANSACTION);
 
 	off_t id;
 	status = directory->Remove(transaction, name, &id);
@@ -1115,7 +1125,11 @@ bfs_rename(fs_volume* _volume, fs_vnode* _oldDir, const char* oldName,
 	if (oldDirectory == newDirectory && !strcmp(oldName, newName))
 		return B_OK;
 
-	Transaction transaction(volume, oldDirectory->BlockNumber());
+	// Moving an entry to another directory needs to lock two directories,
+	// which only an exclusive transaction can do without risking deadlocks
+	Transaction transaction(volume, oldDirectory->BlockNumber(),
+		oldDirectory == newDirectory
+			? INDEPENDENT_TRANSACTION : EXCLUSIVE_TRANSACTION);
 
 	oldDirectory->WriteLockInTransaction(transaction);
 	if (oldDirectory != newDirectory)
@@ -1144,6 +1158,9 @@ bfs_rename(fs_volume* _volume, fs_vnode* _oldDir, const char* oldName,
 	if (vnode.Get(&inode) != B_OK)
 		return B_IO_ERROR;
 
+	// Removing a clobbered entry will lock the indices, which must come last
+	inode->WriteLockInTransaction(transaction);
+
 	// Don't move a directory into one of its children - we soar up
 	// from the newDirectory to either the root node or the old
 	// directory, whichever comes first.
@@ -1217,8 +1234,6 @@ bfs_rename(fs_volume* _volume, fs_vnode* _oldDir, const char* oldName,
 	if (status != B_OK)
 		return status;
 
-	inode->WriteLockInTransaction(transaction);
-
 	volume->UpdateLiveQueriesRenameMove(inode, oldDirectory->ID(), oldName,
 		newDirectory->ID(), newName);
 
@@ -1325,7 +1340,8 @@ bfs_open(fs_volume* _volume, fs_vnode* _node, int openMode, void** _cookie)
 		if ((openMode & O_RWMASK) == O_RDONLY)
 			return B_NOT_ALLOWED;
 
-		Transaction transaction(volume, inode->BlockNumber());
+		Transaction transaction(volume, inode->BlockNumber(),
+			INDEPENDENT_TRANSACTION);
 		inode->WriteLockInTransaction(transaction);
 
 		status_t status = inode->SetFileSize(transaction, 0);
@@ -1575,7 +1591,8 @@ bfs_create_dir(fs_volume* _volume, fs_vnode* _directory, const char* name,
 	if (status < B_OK)
 		RETURN_ERROR(status);
 
-	Transaction transaction(volume, directory->BlockNumber());
+	Transaction transaction(volume, directory->BlockNumber(),
+		INDEPENDENT_TRANSACTION);
 
 	// Inode::Create() locks the inode if we pass the "id" parameter, but we
 	// need it anyway
@@ -1606,7 +1623,8 @@ bfs_remove_dir(fs_volume* _volume, fs_vnode* _directory, const char* name)
 	Volume* volume = (Volume*)_volume->private_volume;
 	Inode* directory = (Inode*)_directory->private_node;
 
-	Transaction transaction(volume, directory->BlockNumber());
+	Transaction transaction(volume, directory->BlockNumber(),
+		INDEPENDENT_TRANSACTION);
 
 	off_t id;
 	status_t status = directory->Remove(transaction, name, &id, true);
@@ -1882,7 +1900,9 @@ bfs_write_attr(fs_volume* _volume, fs_vnode* _file, void* _cookie,
 	Volume* volume = (Volume*)_volume->private_volume;
 	Inode* inode = (Inode*)_file->private_node;
 
-	Transaction transaction(volume, inode->BlockNumber());
+	Transaction transaction(volume, inode->BlockNumber(),
+		INDEPENDENT_TRANSACTION);
+	inode->WriteLockInTransaction(transaction);
 	Attribute attribute(inode, cookie);
 
 	bool created;
@@ -1953,7 +1973,9 @@ bfs_remove_attr(fs_volume* _volume, fs_vnode* _node, const char* name)
 	if (status != B_OK)
 		return status;
 
-	Transaction transaction(volume, inode->BlockNumber());
+	Transaction transaction(volume, inode->BlockNumber(),
+		INDEPENDENT_TRANSACTION);
+	inode->WriteLockInTransaction(transaction);
 
 	status = inode->RemoveAttribute(transaction, name);
 	if (status == B_OK)
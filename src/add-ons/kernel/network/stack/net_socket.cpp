@@ -1494,6 +1494,113 @@ socket_send(net_socket* socket, msghdr* header, const void* data, size_t length,
 }
 
 
+/*!	Sends up to \a length bytes to a connected stream socket, like
+	socket_send(), but lets \a read fill the data into the buffers, so that it
+	is copied only once, directly from its source into the buffers that are
+	passed on to the protocol. \a read returns the number of bytes it put into
+	\a data, or an error code; a short read ends the transfer.
+	Returns \c B_NOT_SUPPORTED, if the socket's protocol doesn't take buffers,
+	or needs the data in atomic messages.
+*/
+ssize_t
+socket_send_from(net_socket* socket, size_t length, int flags,
+	ssize_t (*read)(void* cookie, void* data, size_t length), void* cookie)
+{
+	if (length > SSIZE_MAX)
+		return B_BAD_VALUE;
+
+	if (socket->first_info->send_data_no_buffer != NULL
+		|| (socket->first_info->flags & NET_PROTOCOL_ATOMIC_MESSAGES) != 0) {
+		return B_NOT_SUPPORTED;
+	}
+
+	if (socket->peer.ss_len == 0)
+		return ENOTCONN;
+
+	// Keep the buffers small enough for their nodes to fit the vector below.
+	const size_t kMaxBufferSize = 64 * 1024;
+	const uint32 kMaxVecs = 64;
+	iovec vecs[kMaxVecs];
+
+	ssize_t bytesSent = 0;
+	bool shortRead = false;
+
+	while ((size_t)bytesSent < length && !shortRead) {
+		size_t bufferSize = min_c(length - bytesSent,
+			min_c(socket->send.buffer_size, kMaxBufferSize));
+
+		net_buffer* buffer = gNetBufferModule.create(256);
+		if (buffer == NULL)
+			return bytesSent > 0 ? bytesSent : ENOBUFS;
+
+		uint32 vecCount = 0;
+		if (gNetBufferModule.append_size(buffer, bufferSize, NULL) == B_OK)
+			vecCount = gNetBufferModule.count_iovecs(buffer);
+		if (vecCount == 0 || vecCount > kMaxVecs) {
+			gNetBufferModule.free(buffer);
+			return bytesSent > 0 ? bytesSent : ENOBUFS;
+		}
+		gNetBufferModule.get_iovecs(buffer, vecs, vecCount);
+
+		// let the source fill in the buffer's nodes
+		size_t filled = 0;
+		status_t status = B_OK;
+		for (uint32 i = 0; i < vecCount; i++) {
+			ssize_t bytesRead = read(cookie, vecs[i].iov_base,
+				vecs[i].iov_len);
+			if (bytesRead < 0) {
+				status = bytesRead;
+				break;
+			}
+
+			filled += bytesRead;
+
+			if ((size_t)bytesRead < vecs[i].iov_len) {
+				// Send what we have and stop; it's the end of the data, or
+				// all the source has for now.
+				shortRead = true;
+				break;
+			}
+		}
+
+		if (filled == 0) {
+			gNetBufferModule.free(buffer);
+			if (status != B_OK && bytesSent == 0)
+				return status;
+			break;
+		}
+
+		if (filled < bufferSize)
+			gNetBufferModule.trim(buffer, filled);
+
+		buffer->flags = flags;
+		memcpy(buffer->source, &socket->address, socket->address.ss_len);
+		memcpy(buffer->destination, &socket->peer, socket->peer.ss_len);
+
+		size_t sizeBeforeSend = buffer->size;
+		status_t sendStatus = socket->first_info->send_data(
+			socket->first_protocol, buffer);
+		if (sendStatus != B_OK) {
+			size_t sizeAfterSend = buffer->size;
+			gNetBufferModule.free(buffer);
+
+			// The data that was read but couldn't be sent is lost, so report
+			// what has been sent.
+			if (sizeAfterSend != sizeBeforeSend || bytesSent > 0)
+				return bytesSent + (sizeBeforeSend - sizeAfterSend);
+			return sendStatus;
+		}
+
+		bytesSent += sizeBeforeSend;
+
+		if (status != B_OK)
+			break;
+	}
+
+	return bytesSent;
+}
+
+
 status_t
 socket_set_option(net_socket* socket, int level, int option, const void* value,
 	int length)
@@ -1773,6 +1880,7 @@ net_socket_module_info gNetSocketModule = {
 	socket_send,
 	socket_setsockopt,
 	socket_shutdown,
-	socket_socketpair
+	socket_socketpair,
+	socket_send_from
 };
 
@@ -244,6 +244,14 @@ stack_interface_get_next_socket_stat(int family, uint32* cookie,
 }
 
 
+static ssize_t
+stack_interface_send_from(net_socket* socket, size_t length, int flags,
+	ssize_t (*read)(void* cookie, void* data, size_t length), void* cookie)
+{
+	return gNetSocketModule.send_from(socket, length, flags, read, cookie);
+}
+
+
 static status_t
 stack_interface_std_ops(int32 op, ...)
 {
@@ -298,5 +306,7 @@ net_stack_interface_module_info gNetStackInterfaceModule = {
 	&stack_interface_select,
 	&stack_interface_deselect,
 
-	&stack_interface_get_next_socket_stat
+	&stack_interface_get_next_socket_stat,
+
+	&stack_interface_send_from
 };
@@ -720,6 +720,10 @@ ModelLoader::_ProcessEvent(uint32 event, uint32 cpu, const void* buffer,
 			_HandleIOOperationFinished((io_operation_finished*)buffer);
 			break;
 
+		case B_SYSTEM_PROFILER_ICI_STATS:
+			// not interesting for the model (yet)
+			break;
+
 		default:
 			printf("unsupported event type %" B_PRIu32 ", size: %" B_PRIuSIZE
 				"\n", event, size);
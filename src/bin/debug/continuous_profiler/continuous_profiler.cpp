@@ -0,0 +1,795 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <OS.h>
+
+#include <continuous_profiler_defs.h>
+#include <debug_support.h>
+#include <syscalls.h>
+
+
+// The profile file consists of a profile_file_header followed by records,
+// each starting with a profile_record_header. Stacks and the symbols they
+// consist of are written once, when they are first seen; after that a stack
+// costs only a few bytes per period in which it was sampled.
+
+#define PROFILE_FILE_MAGIC		"CPRF"
+#define PROFILE_FILE_VERSION	1
+
+#define DEFAULT_FREQUENCY		99
+#define DEFAULT_STACK_DEPTH		64
+#define DEFAULT_RING_SIZE		256		// KB per CPU
+#define DEFAULT_PERIOD			10		// seconds
+#define DRAIN_INTERVAL			100000	// us
+
+
+struct profile_file_header {
+	char		magic[4];
+	uint32		version;
+	bigtime_t	start_time;				// real time, in us since the epoch
+	bigtime_t	interval;
+	uint32		flags;
+	uint32		cpu_count;
+};
+
+enum {
+	PROFILE_RECORD_SYMBOL	= 1,
+	PROFILE_RECORD_TEAM,
+	PROFILE_RECORD_THREAD,
+	PROFILE_RECORD_STACK,
+	PROFILE_RECORD_PERIOD
+};
+
+struct profile_record_header {
+	uint32		type;
+	uint32		size;					// of the record excluding the header
+};
+
+// PROFILE_RECORD_SYMBOL
+struct profile_symbol {
+	uint32		id;
+	char		name[0];
+};
+
+// PROFILE_RECORD_TEAM
+struct profile_team {
+	team_id		team;
+	char		name[0];
+};
+
+// PROFILE_RECORD_THREAD
+struct profile_thread {
+	thread_id	thread;
+	team_id		team;
+	char		name[0];
+};
+
+// PROFILE_RECORD_STACK
+struct profile_stack {
+	uint32		id;
+	team_id		team;
+	thread_id	thread;
+	uint16		kernel_depth;
+	uint16		user_depth;
+	uint32		symbols[0];				// kernel frames followed by the user
+										// ones, innermost first
+};
+
+// PROFILE_RECORD_PERIOD
+struct profile_stack_count {
+	uint32		stack;
+	uint32		count;					// samples during the period
+};
+
+struct profile_period {
+	bigtime_t	end_time;				// system time
+	uint64		dropped_samples;		// during this period
+	profile_stack_count counts[0];
+};
+
+
+extern const char* __progname;
+const char* kCommandName = __progname;
+
+
+static const char* kUsage =
+	"Usage: %s [ <options> ] <output file>\n"
+	"       %s --fold <profile file>\n"
+	"Samples the stacks of all running threads until interrupted and writes\n"
+	"them to <output file>. With --fold, converts such a file into folded\n"
+	"stacks on stdout, the input format of flame graph generators.\n"
+	"\n"
+	"Options:\n"
+	"  -f <frequency> - Samples per second and CPU (default: %d).\n"
+	"  -s <depth>     - Maximum stack depth to sample (default: %d).\n"
+	"  -k             - Sample kernel stacks only.\n"
+	"  -u             - Sample user stacks only.\n"
+	"  -i             - Also sample the idle threads.\n"
+	"  -b <size>      - Size of the sample buffer per CPU in KB\n"
+	"                   (default: %d).\n"
+	"  -p <seconds>   - Interval at which the sample counts are written\n"
+	"                   (default: %d).\n"
+	"  --fold         - Convert a profile file to folded stacks.\n"
+	"  -h, --help     - Print this usage info.\n"
+;
+
+
+static void
+print_usage_and_exit(bool error)
+{
+	fprintf(error ? stderr : stdout, kUsage, kCommandName, kCommandName,
+		DEFAULT_FREQUENCY, DEFAULT_STACK_DEPTH, DEFAULT_RING_SIZE,
+		DEFAULT_PERIOD);
+	exit(error ? 1 : 0);
+}
+
+
+class Recorder {
+public:
+	Recorder()
+		:
+		fOutput(NULL),
+		fFlags(B_CONTINUOUS_PROFILER_KERNEL_STACKS
+			| B_CONTINUOUS_PROFILER_USER_STACKS),
+		fFrequency(DEFAULT_FREQUENCY),
+		fStackDepth(DEFAULT_STACK_DEPTH),
+		fRingSize(DEFAULT_RING_SIZE * 1024),
+		fPeriod(DEFAULT_PERIOD * 1000000LL),
+		fHeader(NULL),
+		fRings(NULL),
+		fRingData(NULL),
+		fDroppedSamples(0),
+		fCaughtDeadlySignal(false)
+	{
+	}
+
+	~Recorder()
+	{
+		for (ContextMap::iterator it = fLookupContexts.begin();
+				it != fLookupContexts.end(); ++it) {
+			if (it->second.context != NULL)
+				debug_delete_symbol_lookup_context(it->second.context);
+		}
+
+		if (fOutput != NULL)
+			fclose(fOutput);
+	}
+
+	void SetFlags(uint32 flags)			{ fFlags = flags; }
+	uint32 Flags() const				{ return fFlags; }
+	void SetFrequency(int32 frequency)	{ fFrequency = frequency; }
+	void SetStackDepth(int32 depth)		{ fStackDepth = depth; }
+	void SetRingSize(size_t size)		{ fRingSize = size; }
+	void SetPeriod(bigtime_t period)	{ fPeriod = period; }
+
+	status_t Init(const char* outputFile)
+	{
+		fOutput = fopen(outputFile, "w");
+		if (fOutput == NULL) {
+			fprintf(stderr, "Error: Failed to open \"%s\": %s\n", outputFile,
+				strerror(errno));
+			return errno;
+		}
+
+		return B_OK;
+	}
+
+	void Run()
+	{
+		// install signal handlers so we can exit gracefully
+		struct sigaction action;
+		action.sa_handler = (__sighandler_t)_SignalHandler;
+		action.sa_flags = 0;
+		sigemptyset(&action.sa_mask);
+		action.sa_userdata = this;
+		if (sigaction(SIGHUP, &action, NULL) < 0
+			|| sigaction(SIGINT, &action, NULL) < 0
+			|| sigaction(SIGQUIT, &action, NULL) < 0
+			|| sigaction(SIGTERM, &action, NULL) < 0) {
+			fprintf(stderr, "%s: Failed to install signal handlers: %s\n",
+				kCommandName, strerror(errno));
+			exit(1);
+		}
+
+		// create an area for the sample rings
+		system_info info;
+		get_system_info(&info);
+
+		size_t dataOffset = sizeof(continuous_profiler_header)
+			+ info.cpu_count * sizeof(continuous_profiler_ring);
+		dataOffset = (dataOffset + B_CONTINUOUS_PROFILER_RING_ALIGNMENT - 1)
+			/ B_CONTINUOUS_PROFILER_RING_ALIGNMENT
+			* B_CONTINUOUS_PROFILER_RING_ALIGNMENT;
+		size_t areaSize = (dataOffset + info.cpu_count * fRingSize
+			+ B_PAGE_SIZE - 1) / B_PAGE_SIZE * B_PAGE_SIZE;
+
+		uint8* areaBase;
+		area_id area = create_area("continuous profiler samples",
+			(void**)&areaBase, B_ANY_ADDRESS, areaSize, B_NO_LOCK,
+			B_READ_AREA | B_WRITE_AREA);
+		if (area < 0) {
+			fprintf(stderr, "%s: Failed to create sample area: %s\n",
+				kCommandName, strerror(area));
+			exit(1);
+		}
+
+		// start profiling
+		continuous_profiler_parameters parameters;
+		parameters.buffer_area = area;
+		parameters.flags = fFlags;
+		parameters.interval = 1000000 / fFrequency;
+		parameters.stack_depth = fStackDepth;
+
+		status_t error = _kern_continuous_profiler_start(&parameters);
+		if (error != B_OK) {
+			fprintf(stderr, "%s: Failed to start profiling: %s\n",
+				kCommandName, strerror(error));
+			exit(1);
+		}
+
+		fHeader = (continuous_profiler_header*)areaBase;
+		fRings = (continuous_profiler_ring*)(fHeader + 1);
+		fRingData = areaBase + fHeader->data_offset;
+
+		profile_file_header fileHeader;
+		memcpy(fileHeader.magic, PROFILE_FILE_MAGIC, 4);
+		fileHeader.version = PROFILE_FILE_VERSION;
+		fileHeader.start_time = real_time_clock_usecs();
+		fileHeader.interval = parameters.interval;
+		fileHeader.flags = fFlags;
+		fileHeader.cpu_count = fHeader->cpu_count;
+		fwrite(&fileHeader, sizeof(fileHeader), 1, fOutput);
+
+		// main loop
+		bigtime_t periodEnd = system_time() + fPeriod;
+		while (!fCaughtDeadlySignal) {
+			snooze(DRAIN_INTERVAL);
+			_DrainRings();
+
+			if (system_time() >= periodEnd) {
+				if (!_WritePeriod())
+					break;
+				periodEnd += fPeriod;
+			}
+		}
+
+		// stop profiling and write what's left
+		_kern_continuous_profiler_stop();
+		_DrainRings();
+		_WritePeriod();
+
+		delete_area(area);
+	}
+
+private:
+	struct LookupContext {
+		debug_symbol_lookup_context*	context;
+		bigtime_t						creation_time;
+	};
+
+	typedef std::map<std::string, uint32> StackMap;
+	typedef std::map<std::pair<team_id, addr_t>, uint32> SymbolMap;
+	typedef std::map<team_id, LookupContext> ContextMap;
+	typedef std::map<uint32, uint32> CountMap;
+
+	void _DrainRings()
+	{
+		for (uint32 cpu = 0; cpu < fHeader->cpu_count; cpu++) {
+			continuous_profiler_ring& ring = fRings[cpu];
+			uint8* data = fRingData + cpu * fHeader->ring_size;
+
+			uint32 head = (uint32)atomic_get(&ring.head);
+			uint32 tail = (uint32)ring.tail;
+			while (tail != head) {
+				continuous_profiler_sample* sample
+					= (continuous_profiler_sample*)(data
+						+ (tail & (fHeader->ring_size - 1)));
+				if (sample->team >= 0)
+					_AddSample(sample);
+				tail += sample->size;
+			}
+
+			// hand the space back to the kernel
+			atomic_set(&ring.tail, (int32)tail);
+		}
+	}
+
+	void _AddSample(const continuous_profiler_sample* sample)
+	{
+		int32 depth = sample->kernel_depth + sample->user_depth;
+
+		// The stack is identified by the thread and the return addresses.
+		std::string key((const char*)&sample->thread, sizeof(thread_id));
+		key.append((const char*)&sample->kernel_depth, 1);
+		key.append((const char*)sample->addresses, depth * sizeof(addr_t));
+
+		uint32 stack;
+		StackMap::iterator it = fStacks.find(key);
+		if (it != fStacks.end())
+			stack = it->second;
+		else {
+			stack = fStacks.size();
+			fStacks[key] = stack;
+			_WriteStack(stack, sample);
+		}
+
+		fCounts[stack]++;
+	}
+
+	void _WriteStack(uint32 id, const continuous_profiler_sample* sample)
+	{
+		if (fTeams.insert(sample->team).second)
+			_WriteTeam(sample->team);
+		if (fThreads.insert(sample->thread).second)
+			_WriteThread(sample->thread, sample->team);
+
+		int32 depth = sample->kernel_depth + sample->user_depth;
+		size_t size = sizeof(profile_stack) + depth * sizeof(uint32);
+		profile_stack* stack = (profile_stack*)malloc(size);
+		if (stack == NULL)
+			return;
+
+		stack->id = id;
+		stack->team = sample->team;
+		stack->thread = sample->thread;
+		stack->kernel_depth = sample->kernel_depth;
+		stack->user_depth = sample->user_depth;
+		for (int32 i = 0; i < depth; i++) {
+			stack->symbols[i] = _SymbolFor(
+				i < sample->kernel_depth ? B_SYSTEM_TEAM : sample->team,
+				sample->addresses[i]);
+		}
+
+		_WriteRecord(PROFILE_RECORD_STACK, stack, size);
+		free(stack);
+	}
+
+	void _WriteTeam(team_id team)
+	{
+		team_info info;
+		if (get_team_info(team, &info) != B_OK)
+			snprintf(info.args, sizeof(info.args), "team %" B_PRId32, team);
+
+		_WriteNamedRecord(PROFILE_RECORD_TEAM, &team, sizeof(team),
+			info.args);
+	}
+
+	void _WriteThread(thread_id thread, team_id team)
+	{
+		thread_info info;
+		if (get_thread_info(thread, &info) != B_OK) {
+			snprintf(info.name, sizeof(info.name), "thread %" B_PRId32,
+				thread);
+		}
+
+		profile_thread record;
+		record.thread = thread;
+		record.team = team;
+		_WriteNamedRecord(PROFILE_RECORD_THREAD, &record, sizeof(record),
+			info.name);
+	}
+
+	uint32 _SymbolFor(team_id team, addr_t address)
+	{
+		std::pair<team_id, addr_t> key(team, address);
+		SymbolMap::iterator it = fSymbols.find(key);
+		if (it != fSymbols.end())
+			return it->second;
+
+		uint32 id = fSymbols.size();
+		fSymbols[key] = id;
+
+		char name[B_OS_NAME_LENGTH + 1024];
+		_LookupSymbol(team, address, name, sizeof(name));
+		_WriteNamedRecord(PROFILE_RECORD_SYMBOL, &id, sizeof(id), name);
+
+		return id;
+	}
+
+	void _LookupSymbol(team_id team, addr_t address, char* name,
+		size_t nameSize)
+	{
+		char symbolName[1024];
+		char imageName[B_PATH_NAME_LENGTH];
+		void* baseAddress;
+		bool exactMatch;
+
+		// Retry with a fresh lookup context, if the team may have loaded the
+		// image since the context was created.
+		for (int32 attempt = 0; attempt < 2; attempt++) {
+			debug_symbol_lookup_context* context
+				= _LookupContextFor(team, attempt > 0);
+			if (context == NULL)
+				break;
+
+			if (debug_lookup_symbol_address(context, (void*)address,
+					&baseAddress, symbolName, sizeof(symbolName), imageName,
+					sizeof(imageName), &exactMatch) == B_OK) {
+				const char* image = strrchr(imageName, '/');
+				image = image != NULL ? image + 1 : imageName;
+				if (symbolName[0] != '\0')
+					snprintf(name, nameSize, "%s`%s", image, symbolName);
+				else {
+					snprintf(name, nameSize, "%s`%#" B_PRIxADDR, image,
+						address - (addr_t)baseAddress);
+				}
+				return;
+			}
+		}
+
+		snprintf(name, nameSize, "%#" B_PRIxADDR, address);
+	}
+
+	debug_symbol_lookup_context* _LookupContextFor(team_id team, bool renew)
+	{
+		ContextMap::iterator it = fLookupContexts.find(team);
+		if (it != fLookupContexts.end()) {
+			LookupContext& context = it->second;
+			if (!renew || system_time() - context.creation_time < 1000000)
+				return renew ? NULL : context.context;
+
+			if (context.context != NULL)
+				debug_delete_symbol_lookup_context(context.context);
+			fLookupContexts.erase(it);
+		}
+
+		// A team that is already gone gets a NULL context, so we don't try
+		// again for each of its addresses.
+		LookupContext context;
+		if (debug_create_symbol_lookup_context(team, -1, &context.context)
+				!= B_OK) {
+			context.context = NULL;
+		}
+		context.creation_time = system_time();
+		fLookupContexts[team] = context;
+
+		return context.context;
+	}
+
+	bool _WritePeriod()
+	{
+		uint64 dropped = 0;
+		for (uint32 cpu = 0; cpu < fHeader->cpu_count; cpu++)
+			dropped += atomic_get64(&fRings[cpu].dropped_samples);
+
+		size_t size = sizeof(profile_period)
+			+ fCounts.size() * sizeof(profile_stack_count);
+		profile_period* period = (profile_period*)malloc(size);
+		if (period == NULL)
+			return false;
+
+		period->end_time = system_time();
+		period->dropped_samples = dropped - fDroppedSamples;
+		fDroppedSamples = dropped;
+
+		int32 i = 0;
+		for (CountMap::iterator it = fCounts.begin(); it != fCounts.end();
+				++it, i++) {
+			period->counts[i].stack = it->first;
+			period->counts[i].count = it->second;
+		}
+		fCounts.clear();
+
+		if (period->dropped_samples > 0) {
+			fprintf(stderr, "%s: %" B_PRIu64 " samples dropped\n",
+				kCommandName, period->dropped_samples);
+		}
+
+		bool success = _WriteRecord(PROFILE_RECORD_PERIOD, period, size)
+			&& fflush(fOutput) == 0;
+		free(period);
+
+		if (!success) {
+			fprintf(stderr, "%s: Failed to write profile: %s\n", kCommandName,
+				strerror(errno));
+		}
+		return success;
+	}
+
+	bool _WriteNamedRecord(uint32 type, const void* data, size_t size,
+		const char* name)
+	{
+		size_t nameLength = strlen(name) + 1;
+		profile_record_header header;
+		header.type = type;
+		header.size = size + nameLength;
+
+		return fwrite(&header, sizeof(header), 1, fOutput) == 1
+			&& fwrite(data, size, 1, fOutput) == 1
+			&& fwrite(name, nameLength, 1, fOutput) == 1;
+	}
+
+	bool _WriteRecord(uint32 type, const void* data, size_t size)
+	{
+		profile_record_header header;
+		header.type = type;
+		header.size = size;
+
+		return fwrite(&header, sizeof(header), 1, fOutput) == 1
+			&& fwrite(data, size, 1, fOutput) == 1;
+	}
+
+	static void _SignalHandler(int signal, void* data)
+	{
+		Recorder* self = (Recorder*)data;
+		self->fCaughtDeadlySignal = true;
+	}
+
+private:
+	FILE*						fOutput;
+	uint32						fFlags;
+	int32						fFrequency;
+	int32						fStackDepth;
+	size_t						fRingSize;
+	bigtime_t					fPeriod;
+	continuous_profiler_header*	fHeader;
+	continuous_profiler_ring*	fRings;
+	uint8*						fRingData;
+	StackMap					fStacks;
+	SymbolMap					fSymbols;
+	ContextMap					fLookupContexts;
+	std::set<team_id>			fTeams;
+	std::set<thread_id>			fThreads;
+	CountMap					fCounts;
+	uint64						fDroppedSamples;
+	volatile bool				fCaughtDeadlySignal;
+};
+
+
+// #pragma mark - folding
+
+
+struct FoldedStack {
+	team_id					team;
+	thread_id				thread;
+	uint16					kernel_depth;
+	std::vector<uint32>		symbols;
+	uint64					count;
+};
+
+
+static int
+fold_profile(const char* inputFile)
+{
+	FILE* input = fopen(inputFile, "r");
+	if (input == NULL) {
+		fprintf(stderr, "%s: Failed to open \"%s\": %s\n", kCommandName,
+			inputFile, strerror(errno));
+		return 1;
+	}
+
+	profile_file_header fileHeader;
+	if (fread(&fileHeader, sizeof(fileHeader), 1, input) != 1
+		|| memcmp(fileHeader.magic, PROFILE_FILE_MAGIC, 4) != 0
+		|| fileHeader.version != PROFILE_FILE_VERSION) {
+		fprintf(stderr, "%s: \"%s\" is not a profile file\n", kCommandName,
+			inputFile);
+		fclose(input);
+		return 1;
+	}
+
+	std::map<uint32, std::string> symbols;
+	std::map<team_id, std::string> teams;
+	std::map<thread_id, std::string> threads;
+	std::map<uint32, FoldedStack> stacks;
+
+	std::vector<uint8> buffer;
+	profile_record_header header;
+	while (fread(&header, sizeof(header), 1, input) == 1) {
+		buffer.resize(header.size + 1);
+		if (header.size > 0 && fread(&buffer[0], header.size, 1, input) != 1)
+			break;
+		buffer[header.size] = '\0';
+		void* data = &buffer[0];
+
+		switch (header.type) {
+			case PROFILE_RECORD_SYMBOL:
+			{
+				profile_symbol* symbol = (profile_symbol*)data;
+				symbols[symbol->id] = symbol->name;
+				break;
+			}
+
+			case PROFILE_RECORD_TEAM:
+			{
+				profile_team* team = (profile_team*)data;
+				// only the executable's name
+				std::string name = team->name;
+				name = name.substr(0, name.find(' '));
+				size_t slash = name.rfind('/');
+				if (slash != std::string::npos)
+					name = name.substr(slash + 1);
+				teams[team->team] = name;
+				break;
+			}
+
+			case PROFILE_RECORD_THREAD:
+			{
+				profile_thread* thread = (profile_thread*)data;
+				threads[thread->thread] = thread->name;
+				break;
+			}
+
+			case PROFILE_RECORD_STACK:
+			{
+				profile_stack* record = (profile_stack*)data;
+				FoldedStack& stack = stacks[record->id];
+				stack.team = record->team;
+				stack.thread = record->thread;
+				stack.kernel_depth = record->kernel_depth;
+				stack.symbols.assign(record->symbols, record->symbols
+					+ record->kernel_depth + record->user_depth);
+				stack.count = 0;
+				break;
+			}
+
+			case PROFILE_RECORD_PERIOD:
+			{
+				profile_period* period = (profile_period*)data;
+				size_t count = (header.size - sizeof(profile_period))
+					/ sizeof(profile_stack_count);
+				for (size_t i = 0; i < count; i++) {
+					std::map<uint32, FoldedStack>::iterator it
+						= stacks.find(period->counts[i].stack);
+					if (it != stacks.end())
+						it->second.count += period->counts[i].count;
+				}
+				break;
+			}
+
+			default:
+				// skip unknown records
+				break;
+		}
+	}
+
+	fclose(input);
+
+	// Fold the stacks, outermost frame first, and merge the identical ones.
+	// Different return addresses within the same function make for different
+	// stacks in the file, but not here.
+	std::map<std::string, uint64> folded;
+	for (std::map<uint32, FoldedStack>::iterator it = stacks.begin();
+			it != stacks.end(); ++it) {
+		FoldedStack& stack = it->second;
+		if (stack.count == 0)
+			continue;
+
+		std::string line = teams[stack.team];
+		line += ';';
+		line += threads[stack.thread];
+
+		for (int32 i = (int32)stack.symbols.size() - 1; i >= 0; i--) {
+			line += ';';
+			line += symbols[stack.symbols[i]];
+			if (i < stack.kernel_depth)
+				line += "_[k]";
+		}
+
+		folded[line] += stack.count;
+	}
+
+	for (std::map<std::string, uint64>::iterator it = folded.begin();
+			it != folded.end(); ++it) {
+		printf("%s %" B_PRIu64 "\n", it->first.c_str(), it->second);
+	}
+
+	return 0;
+}
+
+
+int
+main(int argc, const char* const* argv)
+{
+	Recorder recorder;
+	bool fold = false;
+
+	while (true) {
+		static struct option sLongOptions[] = {
+			{ "help", no_argument, 0, 'h' },
+			{ "fold", no_argument, 0, 'F' },
+			{ 0, 0, 0, 0 }
+		};
+
+		opterr = 0; // don't print errors
+		int c = getopt_long(argc, (char**)argv, "+b:f:hikp:s:u", sLongOptions,
+			NULL);
+		if (c == -1)
+			break;
+
+		switch (c) {
+			case 'b':
+			{
+				int32 size = atol(optarg);
+				if (size < 4)
+					print_usage_and_exit(true);
+				recorder.SetRingSize((size_t)size * 1024);
+				break;
+			}
+			case 'f':
+			{
+				int32 frequency = atol(optarg);
+				if (frequency < 1)
+					print_usage_and_exit(true);
+				recorder.SetFrequency(frequency);
+				break;
+			}
+			case 'F':
+				fold = true;
+				break;
+			case 'h':
+				print_usage_and_exit(false);
+				break;
+			case 'i':
+				recorder.SetFlags(recorder.Flags()
+					| B_CONTINUOUS_PROFILER_IDLE_THREADS);
+				break;
+			case 'k':
+				recorder.SetFlags(recorder.Flags()
+					& ~(uint32)B_CONTINUOUS_PROFILER_USER_STACKS);
+				break;
+			case 'p':
+			{
+				int32 period = atol(optarg);
+				if (period < 1)
+					print_usage_and_exit(true);
+				recorder.SetPeriod(period * 1000000LL);
+				break;
+			}
+			case 's':
+			{
+				int32 depth = atol(optarg);
+				if (depth < 1)
+					print_usage_and_exit(true);
+				recorder.SetStackDepth(depth);
+				break;
+			}
+			case 'u':
+				recorder.SetFlags(recorder.Flags()
+					& ~(uint32)B_CONTINUOUS_PROFILER_KERNEL_STACKS);
+				break;
+
+			default:
+				print_usage_and_exit(true);
+				break;
+		}
+	}
+
+	// The remaining argument should be the file.
+	if (optind != argc - 1)
+		print_usage_and_exit(true);
+
+	if (fold)
+		return fold_profile(argv[optind]);
+
+	if ((recorder.Flags() & (B_CONTINUOUS_PROFILER_KERNEL_STACKS
+			| B_CONTINUOUS_PROFILER_USER_STACKS)) == 0) {
+		fprintf(stderr, "%s: -k and -u are mutually exclusive\n",
+			kCommandName);
+		exit(1);
+	}
+
+	// prepare for battle
+	if (recorder.Init(argv[optind]) != B_OK)
+		exit(1);
+
+	// start the action
+	recorder.Run();
+
+	return 0;
+}
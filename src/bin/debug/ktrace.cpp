@@ -0,0 +1,86 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include <syscalls.h>
+
+
+extern const char* __progname;
+
+static const char* const kUsage =
+	"Usage: %s [ -f ] [ -i <interval> ]\n"
+	"Prints the entries recorded in the kernel tracing buffers, oldest first.\n"
+	"\n"
+	"  -f             - Keep running and print new entries as they are\n"
+	"                   recorded.\n"
+	"  -i <interval>  - The interval in ms at which to poll for new entries\n"
+	"                   with -f. Defaults to 100.\n";
+
+static const size_t kBufferSize = 64 * 1024;
+
+
+static void
+print_usage_and_exit(bool error)
+{
+	fprintf(error ? stderr : stdout, kUsage, __progname);
+	exit(error ? 1 : 0);
+}
+
+
+int
+main(int argc, const char* const* argv)
+{
+	bool follow = false;
+	bigtime_t interval = 100000;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0)
+			print_usage_and_exit(false);
+		else if (strcmp(argv[i], "-f") == 0)
+			follow = true;
+		else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+			interval = atol(argv[++i]) * 1000LL;
+			if (interval <= 0)
+				print_usage_and_exit(true);
+		} else
+			print_usage_and_exit(true);
+	}
+
+	char* buffer = (char*)malloc(kBufferSize);
+	if (buffer == NULL) {
+		fprintf(stderr, "%s: Out of memory\n", __progname);
+		return 1;
+	}
+
+	bool fromStart = true;
+	while (true) {
+		ssize_t bytesRead = _kern_ktrace_read(buffer, kBufferSize, fromStart);
+		if (bytesRead < 0) {
+			fprintf(stderr, "%s: Reading the tracing buffers failed: %s\n",
+				__progname, strerror(bytesRead));
+			return 1;
+		}
+		fromStart = false;
+
+		if (bytesRead > 0) {
+			fwrite(buffer, 1, bytesRead, stdout);
+			continue;
+		}
+
+		if (!follow)
+			break;
+
+		fflush(stdout);
+		snooze(interval);
+	}
+
+	return 0;
+}
@@ -99,6 +99,11 @@ Options gOptions;
 
 static bool sCaughtDeadlySignal = false;
 
+// first and last ICI counters seen per CPU, when profiling the whole system
+static system_profiler_ici_stats sFirstICIStats[B_MAX_CPU_COUNT];
+static system_profiler_ici_stats sLastICIStats[B_MAX_CPU_COUNT];
+static int32 sICIStatsCPUCount = 0;
+
 
 class ThreadManager : private ProfiledEntity {
 public:
@@ -524,6 +529,52 @@ get_id(const char *str, int32 &id)
 */
 
 
+static void
+add_ici_stats(const system_profiler_ici_stats* event)
+{
+	if (event->cpu < 0 || event->cpu >= B_MAX_CPU_COUNT)
+		return;
+
+	if (event->cpu >= sICIStatsCPUCount) {
+		for (int32 i = sICIStatsCPUCount; i <= event->cpu; i++)
+			sFirstICIStats[i].time = -1;
+		sICIStatsCPUCount = event->cpu + 1;
+	}
+
+	if (sFirstICIStats[event->cpu].time < 0)
+		sFirstICIStats[event->cpu] = *event;
+	sLastICIStats[event->cpu] = *event;
+}
+
+
+static void
+print_ici_stats()
+{
+	if (sICIStatsCPUCount == 0)
+		return;
+
+	fprintf(gOptions.output, "\ninter-CPU interrupts:\n");
+	fprintf(gOptions.output, "  CPU        sent   TLB    received   TLB  "
+		"sync waits  avg wait\n");
+
+	for (int32 i = 0; i < sICIStatsCPUCount; i++) {
+		const system_profiler_ici_stats& first = sFirstICIStats[i];
+		const system_profiler_ici_stats& last = sLastICIStats[i];
+		if (first.time < 0)
+			continue;
+
+		uint64 syncWaits = last.sync_waits - first.sync_waits;
+		bigtime_t waitTime = last.sync_wait_time - first.sync_wait_time;
+		fprintf(gOptions.output, "  %3" B_PRId32 " %11" B_PRIu64 " %5" B_PRIu64
+			" %11" B_PRIu64 " %5" B_PRIu64 " %11" B_PRIu64 " %7" B_PRId64
+			" us\n", i, last.sent - first.sent, last.sent_tlb - first.sent_tlb,
+			last.received - first.received,
+			last.received_tlb - first.received_tlb, syncWaits,
+			syncWaits > 0 ? waitTime / (bigtime_t)syncWaits : 0);
+	}
+}
+
+
 static bool
 process_event_buffer(ThreadManager& threadManager, uint8* buffer,
 	size_t bufferSize, team_id mainTeam)
@@ -628,6 +679,10 @@ process_event_buffer(ThreadManager& threadManager, uint8* buffer,
 				break;
 			}
 
+			case B_SYSTEM_PROFILER_ICI_STATS:
+				add_ici_stats((system_profiler_ici_stats*)buffer);
+				break;
+
 			case B_SYSTEM_PROFILER_BUFFER_END:
 			{
 				// Marks the end of the ring buffer -- we need to ignore the
@@ -707,7 +762,7 @@ profile_all(const char* const* programArgs, int programArgCount)
 	profilerParameters.buffer_area = area;
 	profilerParameters.flags = B_SYSTEM_PROFILER_TEAM_EVENTS
 		| B_SYSTEM_PROFILER_THREAD_EVENTS | B_SYSTEM_PROFILER_IMAGE_EVENTS
-		| B_SYSTEM_PROFILER_SAMPLING_EVENTS;
+		| B_SYSTEM_PROFILER_SAMPLING_EVENTS | B_SYSTEM_PROFILER_ICI_EVENTS;
 	profilerParameters.interval = gOptions.interval;
 	profilerParameters.stack_depth = gOptions.stack_depth;
 
@@ -773,6 +828,7 @@ profile_all(const char* const* programArgs, int programArgCount)
 	}
 
 	threadManager.PrintSummaryResults();
+	print_ici_stats();
 }
 
 
@@ -839,6 +895,7 @@ dump_recorded()
 	}
 
 	threadManager.PrintSummaryResults();
+	print_ici_stats();
 }
 
 
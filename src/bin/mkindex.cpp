@@ -19,17 +19,22 @@
 #include <Path.h>
 #include <Volume.h>
 
+#include <fcntl.h>
 #include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
+
+#include "bfs_control.h"
 
 
 static struct option const kLongOptions[] = {
 	{"volume", required_argument, 0, 'd'},
 	{"type", required_argument, 0, 't'},
 	{"copy-from", required_argument, 0, 'f'},
+	{"populate", no_argument, 0, 'p'},
 	{"verbose", no_argument, 0, 'v'},
 	{"help", no_argument, 0, 'h'},
 	{NULL}
@@ -75,6 +80,57 @@ copy_indexes(dev_t from, dev_t to, bool verbose)
 }
 
 
+/*!	Lets BFS fill the new index with all files of the volume that have the
+	indexed attribute; other file systems do not support this.
+*/
+static status_t
+populate_index(dev_t device, const char *indexName)
+{
+	fs_info info;
+	if (fs_stat_dev(device, &info) != 0)
+		return errno;
+	if (strcmp(info.fsh_name, "bfs"))
+		return B_NOT_SUPPORTED;
+
+	BVolume volume(device);
+	BDirectory root;
+	volume.GetRootDirectory(&root);
+	BPath path(&root, NULL);
+
+	int fd = open(path.Path(), O_RDONLY);
+	if (fd < 0)
+		return errno;
+
+	struct check_control control;
+	memset(&control, 0, sizeof(control));
+	control.magic = BFS_IOCTL_CHECK_MAGIC;
+	control.flags = BFS_REBUILD_INDEX;
+	strlcpy(control.name, indexName, sizeof(control.name));
+
+	if (ioctl(fd, BFS_IOCTL_START_CHECKING, &control, sizeof(control)) != 0) {
+		status_t status = errno;
+		close(fd);
+		return status;
+	}
+
+	status_t status = B_OK;
+	while (ioctl(fd, BFS_IOCTL_CHECK_NEXT_NODE, &control,
+			sizeof(control)) == 0) {
+		if (control.status != B_OK && status == B_OK)
+			status = control.status;
+	}
+	if (errno != B_ENTRY_NOT_FOUND && status == B_OK)
+		status = errno;
+
+	if (ioctl(fd, BFS_IOCTL_STOP_CHECKING, &control, sizeof(control)) != 0
+		&& status == B_OK)
+		status = errno;
+
+	close(fd);
+	return status;
+}
+
+
 static void
 usage(int status)
 {
@@ -88,6 +144,8 @@ usage(int status)
 		"\t\t\t\"llong\", \"string\", \"float\", or \"double\".\n"
 		"\t\t\tDefaults to \"string\".\n"
 		"      --copy-from\tpath to volume to copy the indexes from.\n"
+		"  -p, --populate\tadd all existing files with this attribute to the\n"
+		"\t\t\tnew index (BFS only).\n"
 		"  -v, --verbose\t\tprint information about the index being created\n",
 		kProgramName);
 
@@ -102,10 +160,11 @@ main(int argc, char **argv)
 	int indexType = B_STRING_TYPE;
 	char *indexName = NULL;
 	bool verbose = false;
+	bool populate = false;
 	dev_t device = -1, copyFromDevice = -1;
 
 	int c;
-	while ((c = getopt_long(argc, argv, "d:ht:v", kLongOptions, NULL)) != -1) {
+	while ((c = getopt_long(argc, argv, "d:hpt:v", kLongOptions, NULL)) != -1) {
 		switch (c) {
 			case 0:
 				break;
@@ -128,6 +187,9 @@ main(int argc, char **argv)
 			case 'h':
 				usage(0);
 				break;
+			case 'p':
+				populate = true;
+				break;
 			case 't':
 				indexTypeName = optarg;
 				if (strncmp("int", optarg, 3) == 0)
@@ -185,8 +247,22 @@ main(int argc, char **argv)
 			indexName, indexTypeName, path.Path());
 	}
 
-	if (fs_create_index(device, indexName, indexType, 0) != 0)
+	if (fs_create_index(device, indexName, indexType, 0) != 0) {
 		fprintf(stderr, "%s: Could not create index: %s\n", kProgramName, strerror(errno));
+		return 0;
+	}
+
+	if (populate) {
+		if (verbose)
+			printf("Adding existing files to index \"%s\".\n", indexName);
+
+		status_t status = populate_index(device, indexName);
+		if (status != B_OK) {
+			fprintf(stderr, "%s: Could not populate index: %s\n", kProgramName,
+				strerror(status));
+			return 1;
+		}
+	}
 
 	return 0;
 }
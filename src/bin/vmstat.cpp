@@ -9,7 +9,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <syscalls.h>
 #include <system_info.h>
+#include <vm_defs.h>
 
 
 static struct option const kLongOptions[] = {
@@ -82,6 +84,30 @@ main(int argc, char** argv)
 	printf("free swap space:\t%Lu\n", info.free_swap_pages * B_PAGE_SIZE);
 	printf("page faults:\t\t%lu\n", info.page_faults);
 
+	compressed_swap_info swapInfo;
+	if (_kern_get_compressed_swap_info(&swapInfo, sizeof(swapInfo)) == B_OK
+		&& swapInfo.algorithm[0] != '\0') {
+		printf("compressed swap:\t%s\n", swapInfo.algorithm);
+		printf("  pool size:\t\t%" B_PRIu64 " of %" B_PRIu64 "\n",
+			swapInfo.pool_size, swapInfo.max_pool_size);
+		printf("  stored pages:\t\t%" B_PRIu64 "\n", swapInfo.stored_pages);
+		if (swapInfo.pool_size > 0) {
+			printf("  compression ratio:\t%.2f\n",
+				(double)swapInfo.stored_pages * B_PAGE_SIZE
+					/ swapInfo.pool_size);
+		}
+		printf("  rejected pages:\t%" B_PRIu64 "\n", swapInfo.rejected_pages);
+		printf("  demoted pages:\t%" B_PRIu64 "\n", swapInfo.demoted_pages);
+		if (swapInfo.pool_faults > 0) {
+			printf("  pool fault latency:\t%" B_PRId64 " us\n",
+				swapInfo.pool_fault_time / (bigtime_t)swapInfo.pool_faults);
+		}
+		if (swapInfo.disk_faults > 0) {
+			printf("  disk fault latency:\t%" B_PRId64 " us\n",
+				swapInfo.disk_fault_time / (bigtime_t)swapInfo.disk_faults);
+		}
+	}
+
 	if (periodically) {
 		puts("\npage faults  used memory    used swap  block cache");
 		system_info lastInfo = info;
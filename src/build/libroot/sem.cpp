@@ -1,23 +1,45 @@
 
 #include <BeOSBuildCompatibility.h>
 
+#include <errno.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include <OS.h>
 #include <SupportDefs.h>
 
-// We assume that everything is single-threaded, so we don't need real
-// semaphores. Simple fakes are sufficient.
+// Most users are single-threaded, but some tools spawn threads (see
+// thread.cpp), so the semaphores are real. Since they are not used much,
+// a single lock for all of them is sufficient.
 
 struct semaphore {
-	char*	name;
-	int32	count;
-	bool	inUse;
+	char*			name;
+	int32			count;
+	bool			inUse;
+	bool			hasCondition;
+	pthread_cond_t	condition;
 };
 
 static const int kSemaphoreCount = 40960;
 static semaphore sSemaphores[kSemaphoreCount];
+static pthread_mutex_t sSemaphoreLock = PTHREAD_MUTEX_INITIALIZER;
+
+// implemented in thread.cpp
+extern bool has_spawned_threads();
+
+
+struct SemaphoreLocker {
+	SemaphoreLocker()
+	{
+		pthread_mutex_lock(&sSemaphoreLock);
+	}
+
+	~SemaphoreLocker()
+	{
+		pthread_mutex_unlock(&sSemaphoreLock);
+	}
+};
 
 
 static bool
@@ -32,6 +54,8 @@ check_sem(sem_id id)
 sem_id
 create_sem(int32 count, const char *name)
 {
+	SemaphoreLocker locker;
+
 	for (int i = 0; i < kSemaphoreCount; i++) {
 		semaphore &sem = sSemaphores[i];
 		if (!sem.inUse) {
@@ -42,6 +66,13 @@ create_sem(int32 count, const char *name)
 			sem.inUse = true;
 			sem.count = count;
 
+			// the condition is kept when the semaphore is deleted, as
+			// there might still be waiting threads
+			if (!sem.hasCondition) {
+				pthread_cond_init(&sem.condition, NULL);
+				sem.hasCondition = true;
+			}
+
 			return i;
 		}
 	}
@@ -53,6 +84,8 @@ create_sem(int32 count, const char *name)
 status_t
 delete_sem(sem_id id)
 {
+	SemaphoreLocker locker;
+
 	if (!check_sem(id))
 		return B_BAD_SEM_ID;
 
@@ -60,6 +93,8 @@ delete_sem(sem_id id)
 	free(sSemaphores[id].name);
 	sSemaphores[id].name = NULL;
 
+	// wake up the waiting threads, they'll notice that the semaphore is gone
+	pthread_cond_broadcast(&sSemaphores[id].condition);
 	return B_OK;
 }
 
@@ -74,6 +109,8 @@ acquire_sem(sem_id id)
 status_t
 acquire_sem_etc(sem_id id, int32 count, uint32 flags, bigtime_t timeout)
 {
+	SemaphoreLocker locker;
+
 	if (!check_sem(id))
 		return B_BAD_SEM_ID;
 
@@ -112,18 +149,33 @@ acquire_sem_etc(sem_id id, int32 count, uint32 flags, bigtime_t timeout)
 	}
 
 	// no timeout?
-	if (noTimeout) {
+	if (noTimeout && !has_spawned_threads()) {
 		debugger("Would block on a semaphore without timeout in a "
 			"single-threaded context!");
 		return B_ERROR;
 	}
 
-	// wait for the time out time
-	status_t error = snooze_until(timeout, B_SYSTEM_TIMEBASE);
-	if (error != B_OK)
-		return error;
+	// system_time() is the real time, too
+	timespec until;
+	until.tv_sec = timeout / 1000000;
+	until.tv_nsec = (timeout % 1000000) * 1000;
+
+	while (true) {
+		int result = noTimeout
+			? pthread_cond_wait(&sem.condition, &sSemaphoreLock)
+			: pthread_cond_timedwait(&sem.condition, &sSemaphoreLock, &until);
 
-	return B_TIMED_OUT;
+		if (!check_sem(id))
+			return B_BAD_SEM_ID;
+
+		if (sem.count >= count) {
+			sem.count -= count;
+			return B_OK;
+		}
+
+		if (result == ETIMEDOUT)
+			return B_TIMED_OUT;
+	}
 }
 
 // release_sem
@@ -137,6 +189,8 @@ release_sem(sem_id id)
 status_t
 release_sem_etc(sem_id id, int32 count, uint32 flags)
 {
+	SemaphoreLocker locker;
+
 	if (!check_sem(id))
 		return B_BAD_SEM_ID;
 
@@ -146,6 +200,7 @@ release_sem_etc(sem_id id, int32 count, uint32 flags)
 	semaphore &sem = sSemaphores[id];
 	sem.count += count;
 
+	pthread_cond_broadcast(&sem.condition);
 	return B_OK;
 }
 
@@ -153,6 +208,8 @@ release_sem_etc(sem_id id, int32 count, uint32 flags)
 status_t
 get_sem_count(sem_id id, int32 *threadCount)
 {
+	SemaphoreLocker locker;
+
 	if (!check_sem(id))
 		return B_BAD_SEM_ID;
 
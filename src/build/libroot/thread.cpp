@@ -1,9 +1,140 @@
 
 #include <BeOSBuildCompatibility.h>
 
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include <OS.h>
 
+// Threads are mapped to pthreads. Like on Haiku, they are spawned suspended,
+// and only started by resume_thread() or wait_for_thread().
+
+struct thread_entry_info {
+	thread_func	function;
+	void*		argument;
+	pthread_t	thread;
+	status_t	result;
+	bool		inUse;
+	bool		started;
+};
+
 static const thread_id kMainThreadID = 3;
+static const int kThreadCount = 1024;
+
+static thread_entry_info sThreads[kThreadCount];
+static pthread_mutex_t sThreadLock = PTHREAD_MUTEX_INITIALIZER;
+static bool sThreadsSpawned = false;
+static __thread thread_id sCurrentThread = kMainThreadID;
+
+
+static inline thread_id
+index_to_thread(int index)
+{
+	return kMainThreadID + 1 + index;
+}
+
+
+static inline thread_entry_info*
+get_thread(thread_id thread)
+{
+	int index = thread - kMainThreadID - 1;
+	if (index < 0 || index >= kThreadCount || !sThreads[index].inUse)
+		return NULL;
+
+	return &sThreads[index];
+}
+
+
+static void*
+pthread_entry(void* data)
+{
+	thread_entry_info* info = (thread_entry_info*)data;
+	sCurrentThread = index_to_thread(info - sThreads);
+
+	info->result = info->function(info->argument);
+	return NULL;
+}
+
+
+//!	Must be called with the thread lock held.
+static status_t
+start_thread(thread_entry_info* info)
+{
+	if (info->started)
+		return B_OK;
+
+	if (pthread_create(&info->thread, NULL, &pthread_entry, info) != 0)
+		return B_NO_MORE_THREADS;
+
+	info->started = true;
+	return B_OK;
+}
+
+
+//!	Used by the semaphores to find out if another thread could release them.
+bool
+has_spawned_threads()
+{
+	return sThreadsSpawned;
+}
+
+
+// spawn_thread
+thread_id
+spawn_thread(thread_func function, const char *name, int32 priority,
+	void *argument)
+{
+	if (function == NULL)
+		return B_BAD_VALUE;
+
+	pthread_mutex_lock(&sThreadLock);
+
+	for (int i = 0; i < kThreadCount; i++) {
+		thread_entry_info& info = sThreads[i];
+		if (!info.inUse) {
+			info.function = function;
+			info.argument = argument;
+			info.result = B_OK;
+			info.inUse = true;
+			info.started = false;
+			sThreadsSpawned = true;
+
+			pthread_mutex_unlock(&sThreadLock);
+			return index_to_thread(i);
+		}
+	}
+
+	pthread_mutex_unlock(&sThreadLock);
+	return B_NO_MORE_THREADS;
+}
+
+// wait_for_thread
+status_t
+wait_for_thread(thread_id thread, status_t *_returnValue)
+{
+	pthread_mutex_lock(&sThreadLock);
+
+	thread_entry_info* info = get_thread(thread);
+	status_t status = info != NULL ? start_thread(info) : B_BAD_THREAD_ID;
+	if (status != B_OK) {
+		pthread_mutex_unlock(&sThreadLock);
+		return status;
+	}
+
+	pthread_t pthread = info->thread;
+	pthread_mutex_unlock(&sThreadLock);
+
+	pthread_join(pthread, NULL);
+
+	pthread_mutex_lock(&sThreadLock);
+	if (_returnValue != NULL)
+		*_returnValue = info->result;
+	info->inUse = false;
+	pthread_mutex_unlock(&sThreadLock);
+
+	return B_OK;
+}
 
 
 // kill_thread
@@ -17,7 +148,13 @@ kill_thread(thread_id thread)
 status_t
 resume_thread(thread_id thread)
 {
-	return B_BAD_VALUE;
+	pthread_mutex_lock(&sThreadLock);
+
+	thread_entry_info* info = get_thread(thread);
+	status_t status = info != NULL ? start_thread(info) : B_BAD_THREAD_ID;
+
+	pthread_mutex_unlock(&sThreadLock);
+	return status;
 }
 
 // suspend_thread
@@ -33,8 +170,8 @@ find_thread(const char *name)
 {
 	if (name != NULL)
 		return B_ENTRY_NOT_FOUND;
-	
-	return kMainThreadID;
+
+	return sCurrentThread;
 }
 
 // _get_thread_info
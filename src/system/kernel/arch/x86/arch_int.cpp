@@ -291,6 +291,15 @@ x86_page_fault_exception(struct iframe* frame)
 	} else if ((frame->flags & 0x200) == 0) {
 		// interrupts disabled
 
+		// If this CPU has a fault handler, debug_call_with_fault_handler()
+		// is in charge.
+		cpu_ent* cpu = &gCPU[smp_get_current_cpu()];
+		if (cpu->fault_handler != 0) {
+			frame->ip = cpu->fault_handler;
+			frame->bp = cpu->fault_handler_stack_pointer;
+			return;
+		}
+
 		// If a page fault handler is installed, we're allowed to be here.
 		// TODO: Now we are generally allowing user_memcpy() with interrupts
 		// disabled, which in most cases is a bug. We should add some thread
@@ -132,6 +132,51 @@ x86_get_current_iframe(void)
 }
 
 
+/*!	Makes \a toPagingStructures the paging structures the CPU uses.
+	Interrupts must be disabled.
+*/
+static void
+set_paging_structures(cpu_ent* cpuData, X86PagingStructures* toPagingStructures)
+{
+	X86PagingStructures* activePagingStructures
+		= cpuData->arch.active_paging_structures;
+
+	// update on which CPUs the address space is used
+	int cpu = cpuData->cpu_num;
+	activePagingStructures->active_on_cpus.ClearBitAtomic(cpu);
+	toPagingStructures->active_on_cpus.SetBitAtomic(cpu);
+
+	// assign the new paging structures to the CPU
+	toPagingStructures->AddReference();
+	cpuData->arch.active_paging_structures = toPagingStructures;
+
+	// set the page directory, if it changes
+	addr_t newPageDirectory = toPagingStructures->pgdir_phys;
+	if (newPageDirectory != activePagingStructures->pgdir_phys)
+		x86_swap_pgdir(newPageDirectory);
+
+	// This CPU no longer uses the previous paging structures.
+	activePagingStructures->RemoveReference();
+}
+
+
+/*!	Switches the CPU to the kernel's paging structures, if it still uses
+	\a pagingStructures. Only a CPU running a kernel thread may do so.
+	Interrupts must be disabled.
+*/
+void
+x86_leave_paging_structures(cpu_ent* cpuData,
+	X86PagingStructures* pagingStructures)
+{
+	if (cpuData->arch.active_paging_structures != pagingStructures)
+		return;
+
+	atomic_set(&cpuData->arch.lazy_paging_state, 0);
+	set_paging_structures(cpuData, static_cast<X86VMTranslationMap*>(
+		VMAddressSpace::Kernel()->TranslationMap())->PagingStructures());
+}
+
+
 phys_addr_t
 x86_next_page_directory(Thread* from, Thread* to)
 {
@@ -220,31 +265,30 @@ arch_thread_context_switch(Thread* from, Thread* to)
 	if (to->user_local_storage != 0)
 		x86_set_tls_context(to);
 
-	X86PagingStructures* activePagingStructures
-		= cpuData->arch.active_paging_structures;
 	VMAddressSpace* toAddressSpace = to->team->address_space;
-
-	X86PagingStructures* toPagingStructures;
-	if (toAddressSpace != NULL
-		&& (toPagingStructures = static_cast<X86VMTranslationMap*>(
-				toAddressSpace->TranslationMap())->PagingStructures())
-					!= activePagingStructures) {
-		// update on which CPUs the address space is used
-		int cpu = cpuData->cpu_num;
-		activePagingStructures->active_on_cpus.ClearBitAtomic(cpu);
-		toPagingStructures->active_on_cpus.SetBitAtomic(cpu);
-
-		// assign the new paging structures to the CPU
-		toPagingStructures->AddReference();
-		cpuData->arch.active_paging_structures = toPagingStructures;
-
-		// set the page directory, if it changes
-		addr_t newPageDirectory = toPagingStructures->pgdir_phys;
-		if (newPageDirectory != activePagingStructures->pgdir_phys)
-			x86_swap_pgdir(newPageDirectory);
-
-		// This CPU no longer uses the previous paging structures.
-		activePagingStructures->RemoveReference();
+	if (toAddressSpace != NULL) {
+		X86PagingStructures* toPagingStructures
+			= static_cast<X86VMTranslationMap*>(
+				toAddressSpace->TranslationMap())->PagingStructures();
+
+		if (toPagingStructures == cpuData->arch.active_paging_structures) {
+			// If we only used the structures lazily, the TLB invalidations
+			// we missed in the meantime have to be made up for.
+			if (cpuData->arch.lazy_paging_state != 0
+				&& (atomic_get_and_set(&cpuData->arch.lazy_paging_state, 0)
+					& X86_LAZY_PAGING_FLUSH) != 0) {
+				arch_cpu_user_TLB_invalidate();
+			}
+		} else if (toAddressSpace == VMAddressSpace::Kernel()) {
+			// Kernel threads don't access userland memory, and the userland
+			// paging structures contain all kernel mappings, so we can keep
+			// using them. That saves switching the page directory twice and
+			// losing the TLB contents, when we return to the same team next.
+			atomic_or(&cpuData->arch.lazy_paging_state, X86_LAZY_PAGING);
+		} else {
+			atomic_set(&cpuData->arch.lazy_paging_state, 0);
+			set_paging_structures(cpuData, toPagingStructures);
+		}
 	}
 
 #ifndef __x86_64__
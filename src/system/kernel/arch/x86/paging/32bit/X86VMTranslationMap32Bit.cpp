@@ -49,6 +49,8 @@ X86VMTranslationMap32Bit::~X86VMTranslationMap32Bit()
 	if (fPagingStructures == NULL)
 		return;
 
+	ReleaseLazyCPUs();
+
 	if (fPageMapper != NULL)
 		fPageMapper->Delete();
 
@@ -32,6 +32,14 @@
 #endif
 
 
+static inline bool
+is_collapsed_large_page(uint64 pde)
+{
+	return (pde & (X86_64_PDE_LARGE_PAGE | X86_64_PDE_COLLAPSED))
+		== (X86_64_PDE_LARGE_PAGE | X86_64_PDE_COLLAPSED);
+}
+
+
 // #pragma mark - X86VMTranslationMap64Bit
 
 
@@ -39,6 +47,7 @@ X86VMTranslationMap64Bit::X86VMTranslationMap64Bit()
 	:
 	fPagingStructures(NULL)
 {
+	fLargePageReservation.count = 0;
 }
 
 
@@ -49,6 +58,8 @@ X86VMTranslationMap64Bit::~X86VMTranslationMap64Bit()
 	if (fPagingStructures == NULL)
 		return;
 
+	ReleaseLazyCPUs();
+
 	if (fPageMapper != NULL) {
 		phys_addr_t address;
 		vm_page* page;
@@ -68,8 +79,12 @@ X86VMTranslationMap64Bit::~X86VMTranslationMap64Bit()
 				uint64* virtualPageDir = (uint64*)fPageMapper->GetPageTableAt(
 					virtualPDPT[j] & X86_64_PDPTE_ADDRESS_MASK);
 				for (uint32 k = 0; k < 512; k++) {
-					if ((virtualPageDir[k] & X86_64_PDE_PRESENT) == 0)
+					if ((virtualPageDir[k] & X86_64_PDE_PRESENT) == 0
+						|| (virtualPageDir[k] & X86_64_PDE_LARGE_PAGE) != 0) {
+						// The pages of a large page belong to the area's
+						// cache.
 						continue;
+					}
 
 					address = virtualPageDir[k] & X86_64_PDE_ADDRESS_MASK;
 					page = vm_lookup_page(address / B_PAGE_SIZE);
@@ -107,6 +122,8 @@ X86VMTranslationMap64Bit::~X86VMTranslationMap64Bit()
 		fPageMapper->Delete();
 	}
 
+	vm_page_unreserve_pages(&fLargePageReservation);
+
 	fPagingStructures->RemoveReference();
 }
 
@@ -235,6 +252,8 @@ X86VMTranslationMap64Bit::Unmap(addr_t start, addr_t end)
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
+		_SplitLargePage(start);
+
 		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
 			fPagingStructures->VirtualPML4(), start, fIsKernelMap, false,
 			NULL, fPageMapper, fMapCount);
@@ -285,6 +304,8 @@ X86VMTranslationMap64Bit::DebugMarkRangePresent(addr_t start, addr_t end,
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
+		_SplitLargePage(start);
+
 		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
 			fPagingStructures->VirtualPML4(), start, fIsKernelMap, false,
 			NULL, fPageMapper, fMapCount);
@@ -324,6 +345,85 @@ X86VMTranslationMap64Bit::DebugMarkRangePresent(addr_t start, addr_t end,
 }
 
 
+size_t
+X86VMTranslationMap64Bit::LargePageSize() const
+{
+	return k64BitPageTableRange;
+}
+
+
+status_t
+X86VMTranslationMap64Bit::CollapseLargePage(addr_t address)
+{
+	ASSERT(address % k64BitPageTableRange == 0);
+
+	TRACE("X86VMTranslationMap64Bit::CollapseLargePage(%#" B_PRIxADDR ")\n",
+		address);
+
+	RecursiveLocker locker(fLock);
+	ThreadCPUPinner pinner(thread_get_current_thread());
+
+	uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+		fPagingStructures->VirtualPML4(), address, fIsKernelMap, false, NULL,
+		fPageMapper, fMapCount);
+	if (pde == NULL || (*pde & X86_64_PDE_PRESENT) == 0)
+		return B_ENTRY_NOT_FOUND;
+	if ((*pde & X86_64_PDE_LARGE_PAGE) != 0)
+		return B_OK;
+
+	phys_addr_t physicalPageTable = *pde & X86_64_PDE_ADDRESS_MASK;
+	uint64* pageTable = (uint64*)fPageMapper->GetPageTableAt(
+		physicalPageTable);
+
+	// All entries must map the physically contiguous, large page aligned
+	// range with the same flags. The PAT bit of a page table entry is the
+	// large page bit of a page directory entry, so we don't support it.
+	const uint64 flagsMask = X86_64_PTE_PRESENT | X86_64_PTE_PROTECTION_MASK
+		| X86_64_PTE_MEMORY_TYPE_MASK | X86_64_PTE_GLOBAL | X86_64_PTE_PAT;
+	uint64 firstEntry = pageTable[0];
+	phys_addr_t physicalAddress = firstEntry & X86_64_PTE_ADDRESS_MASK;
+	if ((firstEntry & X86_64_PTE_PRESENT) == 0
+		|| (firstEntry & X86_64_PTE_PAT) != 0
+		|| physicalAddress % k64BitPageTableRange != 0) {
+		return B_BAD_VALUE;
+	}
+
+	uint64 accessedAndDirty = 0;
+	for (uint32 i = 0; i < k64BitTableEntryCount; i++) {
+		uint64 entry = pageTable[i];
+		if ((entry & X86_64_PTE_ADDRESS_MASK)
+				!= physicalAddress + i * B_PAGE_SIZE
+			|| (entry & flagsMask) != (firstEntry & flagsMask)) {
+			return B_BAD_VALUE;
+		}
+
+		accessedAndDirty
+			|= entry & (X86_64_PTE_ACCESSED | X86_64_PTE_DIRTY);
+	}
+
+	X86PagingMethod64Bit::SetTableEntry(pde, physicalAddress
+		| (firstEntry & flagsMask) | accessedAndDirty
+		| X86_64_PDE_LARGE_PAGE | X86_64_PDE_COLLAPSED);
+
+	// The page table must not be in use by any CPU anymore, when we free it,
+	// not even by a lazy one.
+	InvalidatePageTable(address);
+	Flush();
+
+	// Keep the page table reserved, so that splitting the large page again
+	// can't fail.
+	vm_page* page = vm_lookup_page(physicalPageTable / B_PAGE_SIZE);
+	DEBUG_PAGE_ACCESS_START(page);
+	vm_page_free_etc(NULL, page, &fLargePageReservation);
+
+	fMapCount--;
+	fLargePageCount++;
+	atomic_add(&gMappedLargePagesCount, 1);
+
+	return B_OK;
+}
+
+
 status_t
 X86VMTranslationMap64Bit::UnmapPage(VMArea* area, addr_t address,
 	bool updatePageQueue)
@@ -334,6 +434,8 @@ X86VMTranslationMap64Bit::UnmapPage(VMArea* area, addr_t address,
 
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
+	_SplitLargePage(address);
+
 	// Look up the page table for the virtual address.
 	uint64* entry = X86PagingMethod64Bit::PageTableEntryForAddress(
 		fPagingStructures->VirtualPML4(), address, fIsKernelMap,
@@ -402,6 +504,8 @@ X86VMTranslationMap64Bit::UnmapPages(VMArea* area, addr_t base, size_t size,
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
+		_SplitLargePage(start);
+
 		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
 			fPagingStructures->VirtualPML4(), start, fIsKernelMap, false,
 			NULL, fPageMapper, fMapCount);
@@ -535,6 +639,8 @@ X86VMTranslationMap64Bit::UnmapArea(VMArea* area, bool deletingAddressSpace,
 			addr_t address = area->Base()
 				+ ((page->cache_offset * B_PAGE_SIZE) - area->cache_offset);
 
+			_SplitLargePage(address);
+
 			uint64* entry = X86PagingMethod64Bit::PageTableEntryForAddress(
 				fPagingStructures->VirtualPML4(), address, fIsKernelMap,
 				false, NULL, fPageMapper, fMapCount);
@@ -683,6 +789,44 @@ X86VMTranslationMap64Bit::Protect(addr_t start, addr_t end, uint32 attributes,
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
+		if (fLargePageCount > 0) {
+			uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+				fPagingStructures->VirtualPML4(), start, fIsKernelMap, false,
+				NULL, fPageMapper, fMapCount);
+			if (pde != NULL && is_collapsed_large_page(*pde)) {
+				if (start % k64BitPageTableRange == 0
+					&& end - start >= k64BitPageTableRange - 1) {
+					// The large page is covered completely, so we can just
+					// change its protection. The protection and memory type
+					// bits are the same for page directory and table entries.
+					uint64 entry = *pde;
+					while (true) {
+						uint64 oldEntry
+							= X86PagingMethod64Bit::TestAndSetTableEntry(pde,
+								(entry & ~(X86_64_PTE_PROTECTION_MASK
+										| X86_64_PTE_MEMORY_TYPE_MASK))
+									| newProtectionFlags
+									| X86PagingMethod64Bit
+										::MemoryTypeToPageTableEntryFlags(
+											memoryType),
+								entry);
+						if (oldEntry == entry)
+							break;
+						entry = oldEntry;
+					}
+
+					if ((entry & X86_64_PDE_ACCESSED) != 0)
+						InvalidatePage(start);
+
+					start += k64BitPageTableRange;
+					continue;
+				}
+
+				// Only a part of the large page changes -- split it.
+				_SplitLargePage(start);
+			}
+		}
+
 		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
 			fPagingStructures->VirtualPML4(), start, fIsKernelMap, false,
 			NULL, fPageMapper, fMapCount);
@@ -740,6 +884,8 @@ X86VMTranslationMap64Bit::ClearFlags(addr_t address, uint32 flags)
 
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
+	_SplitLargePage(address);
+
 	uint64* entry = X86PagingMethod64Bit::PageTableEntryForAddress(
 		fPagingStructures->VirtualPML4(), address, fIsKernelMap,
 		false, NULL, fPageMapper, fMapCount);
@@ -771,6 +917,8 @@ X86VMTranslationMap64Bit::ClearAccessedAndModified(VMArea* area, addr_t address,
 	RecursiveLocker locker(fLock);
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
+	_SplitLargePage(address);
+
 	uint64* entry = X86PagingMethod64Bit::PageTableEntryForAddress(
 		fPagingStructures->VirtualPML4(), address, fIsKernelMap,
 		false, NULL, fPageMapper, fMapCount);
@@ -843,3 +991,71 @@ X86VMTranslationMap64Bit::PagingStructures() const
 {
 	return fPagingStructures;
 }
+
+
+/*!	If \a address is mapped by a large page that CollapseLargePage()
+	created, replaces it by a page table that maps the same pages with the
+	same flags. Other large pages, like the ones of the physical memory map
+	the boot loader set up, are left alone.
+	The thread must be pinned to the current CPU.
+*/
+void
+X86VMTranslationMap64Bit::_SplitLargePage(addr_t address)
+{
+	if (fLargePageCount == 0)
+		return;
+
+	RecursiveLocker locker(fLock);
+
+	uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+		fPagingStructures->VirtualPML4(), address, fIsKernelMap, false, NULL,
+		fPageMapper, fMapCount);
+	if (pde == NULL || !is_collapsed_large_page(*pde))
+		return;
+
+	TRACE("X86VMTranslationMap64Bit::_SplitLargePage(%#" B_PRIxADDR ")\n",
+		address);
+
+	// The page table was freed into our reservation when the large page was
+	// created, so this doesn't fail.
+	vm_page* page = vm_page_allocate_page(&fLargePageReservation,
+		PAGE_STATE_WIRED);
+	DEBUG_PAGE_ACCESS_END(page);
+
+	phys_addr_t physicalPageTable
+		= (phys_addr_t)page->physical_page_number * B_PAGE_SIZE;
+	uint64* pageTable = (uint64*)fPageMapper->GetPageTableAt(
+		physicalPageTable);
+
+	uint64 entry = *pde;
+	while (true) {
+		// Apart from the large page bit, which is the PAT bit in a page table
+		// entry, the flags are at the same positions. The accessed and dirty
+		// flags are inherited by all pages.
+		phys_addr_t physicalAddress = entry & X86_64_PDE_ADDRESS_MASK;
+		uint64 flags = entry & ~(X86_64_PDE_ADDRESS_MASK
+			| X86_64_PDE_LARGE_PAGE | X86_64_PDE_COLLAPSED);
+		for (uint32 i = 0; i < k64BitTableEntryCount; i++)
+			pageTable[i] = (physicalAddress + i * B_PAGE_SIZE) | flags;
+
+		uint64 oldEntry = X86PagingMethod64Bit::TestAndSetTableEntry(pde,
+			(physicalPageTable & X86_64_PDE_ADDRESS_MASK)
+				| X86_64_PDE_PRESENT
+				| X86_64_PDE_WRITABLE
+				| X86_64_PDE_USER,
+			entry);
+		if (oldEntry == entry)
+			break;
+
+		// the accessed or dirty flag has been set in the meantime
+		entry = oldEntry;
+	}
+
+	fMapCount++;
+	fLargePageCount--;
+	atomic_add(&gMappedLargePagesCount, -1);
+
+	// The page table maps the same pages, so it doesn't matter, if a CPU
+	// keeps using the large page TLB entry until the caller flushes.
+	InvalidatePage(ROUNDDOWN(address, k64BitPageTableRange));
+}
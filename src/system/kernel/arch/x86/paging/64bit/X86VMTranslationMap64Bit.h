@@ -7,6 +7,8 @@
 #define KERNEL_ARCH_X86_PAGING_64BIT_X86_VM_TRANSLATION_MAP_64BIT_H
 
 
+#include <vm/vm_page.h>
+
 #include "paging/X86VMTranslationMap.h"
 
 
@@ -31,6 +33,9 @@ struct X86VMTranslationMap64Bit final : X86VMTranslationMap {
 	virtual	status_t			DebugMarkRangePresent(addr_t start, addr_t end,
 									bool markPresent);
 
+	virtual	size_t				LargePageSize() const;
+	virtual	status_t			CollapseLargePage(addr_t address);
+
 	virtual	status_t			UnmapPage(VMArea* area, addr_t address,
 									bool updatePageQueue);
 	virtual	void				UnmapPages(VMArea* area, addr_t base,
@@ -61,8 +66,14 @@ struct X86VMTranslationMap64Bit final : X86VMTranslationMap {
 	inline	X86PagingStructures64Bit* PagingStructures64Bit() const
 									{ return fPagingStructures; }
 
+private:
+			void				_SplitLargePage(addr_t address);
+
 private:
 			X86PagingStructures64Bit* fPagingStructures;
+			vm_page_reservation	fLargePageReservation;
+									// one page per large page, to get the
+									// page table back when splitting it
 };
 
 
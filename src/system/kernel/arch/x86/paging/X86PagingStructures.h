@@ -17,11 +17,27 @@
 #include <smp.h>
 
 
+struct cpu_ent;
+
+
+// flags for arch_cpu_info::lazy_paging_state
+enum {
+	X86_LAZY_PAGING			= 0x01,
+		// The CPU runs a kernel thread and still has the paging structures of
+		// the last userland thread loaded. It doesn't get TLB invalidations
+		// for them.
+	X86_LAZY_PAGING_FLUSH	= 0x02
+		// The paging structures have been changed in the meantime. The CPU
+		// must flush its TLB before running a thread using them again.
+};
+
+
 struct X86PagingStructures : DeferredDeletable {
 	phys_addr_t					pgdir_phys;
 	int32						ref_count;
 	CPUSet						active_on_cpus;
-		// mask indicating on which CPUs the map is currently used
+		// mask indicating on which CPUs the map is currently loaded, possibly
+		// lazily
 
 								X86PagingStructures();
 	virtual						~X86PagingStructures();
@@ -48,4 +64,9 @@ X86PagingStructures::RemoveReference()
 }
 
 
+// implemented in arch_thread.cpp
+void x86_leave_paging_structures(cpu_ent* cpu,
+	X86PagingStructures* pagingStructures);
+
+
 #endif	// KERNEL_ARCH_X86_PAGING_X86_PAGING_STRUCTURES_H
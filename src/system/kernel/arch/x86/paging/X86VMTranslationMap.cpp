@@ -10,6 +10,7 @@
 
 #include "paging/X86VMTranslationMap.h"
 
+#include <cpu.h>
 #include <thread.h>
 #include <smp.h>
 
@@ -24,10 +25,52 @@
 #endif
 
 
+/*!	Removes the CPUs from \a cpuMask that use the paging structures only
+	lazily. Instead of being interrupted now, they flush their TLB when they
+	return to the structures, no matter how many invalidations they missed.
+	That is only enough for changed page table entries: a lazy CPU may still
+	cache the paging structure entries leading to a page table, so they must
+	be interrupted before a page table is freed.
+*/
+static void
+defer_lazy_cpus(CPUSet& cpuMask)
+{
+	int32 cpuCount = smp_get_num_cpus();
+	for (int32 i = 0; i < cpuCount; i++) {
+		if (!cpuMask.GetBit(i))
+			continue;
+
+		// The flag must only be set while the CPU is still lazy, otherwise it
+		// has to get the ICI.
+		int32* state = &gCPU[i].arch.lazy_paging_state;
+		int32 oldState = atomic_get(state);
+		while ((oldState & X86_LAZY_PAGING) != 0) {
+			int32 previousState = atomic_test_and_set(state,
+				oldState | X86_LAZY_PAGING_FLUSH, oldState);
+			if (previousState == oldState) {
+				cpuMask.ClearBit(i);
+				break;
+			}
+			oldState = previousState;
+		}
+	}
+}
+
+
+static void
+leave_paging_structures_ici(addr_t pagingStructures, int32 currentCPU,
+	addr_t, addr_t)
+{
+	x86_leave_paging_structures(&gCPU[currentCPU],
+		(X86PagingStructures*)pagingStructures);
+}
+
+
 X86VMTranslationMap::X86VMTranslationMap()
 	:
 	fPageMapper(NULL),
-	fInvalidPagesCount(0)
+	fInvalidPagesCount(0),
+	fPageTablesInvalidated(false)
 {
 }
 
@@ -58,6 +101,7 @@ X86VMTranslationMap::Lock()
 		// we were the first one to grab the lock
 		TRACE("clearing invalidated page count\n");
 		fInvalidPagesCount = 0;
+		fPageTablesInvalidated = false;
 	}
 
 	return true;
@@ -82,6 +126,37 @@ X86VMTranslationMap::Unlock()
 }
 
 
+/*!	Makes sure that no CPU uses the map's paging structures anymore, so that
+	the page tables can be freed. When a userland team goes away, CPUs that
+	have been running kernel threads since may still have them loaded.
+*/
+void
+X86VMTranslationMap::ReleaseLazyCPUs()
+{
+	X86PagingStructures* pagingStructures = PagingStructures();
+
+	Thread* thread = thread_get_current_thread();
+	thread_pin_to_current_cpu(thread);
+
+	int32 cpu = smp_get_current_cpu();
+
+	cpu_status state = disable_interrupts();
+	x86_leave_paging_structures(&gCPU[cpu], pagingStructures);
+	restore_interrupts(state);
+
+	CPUSet cpuMask = pagingStructures->active_on_cpus;
+	cpuMask.ClearBit(cpu);
+
+	if (!cpuMask.IsEmpty()) {
+		smp_send_multicast_ici(cpuMask, SMP_MSG_CALL_FUNCTION,
+			(addr_t)pagingStructures, 0, 0, (void*)&leave_paging_structures_ici,
+			SMP_MSG_FLAG_SYNC);
+	}
+
+	thread_unpin_from_current_cpu(thread);
+}
+
+
 addr_t
 X86VMTranslationMap::MappedSize() const
 {
@@ -115,6 +190,8 @@ X86VMTranslationMap::Flush()
 			int cpu = smp_get_current_cpu();
 			CPUSet cpuMask = PagingStructures()->active_on_cpus;
 			cpuMask.ClearBit(cpu);
+			if (!fPageTablesInvalidated)
+				defer_lazy_cpus(cpuMask);
 
 			if (!cpuMask.IsEmpty()) {
 				smp_send_multicast_ici(cpuMask, SMP_MSG_USER_INVALIDATE_PAGES,
@@ -135,6 +212,8 @@ X86VMTranslationMap::Flush()
 			int cpu = smp_get_current_cpu();
 			CPUSet cpuMask = PagingStructures()->active_on_cpus;
 			cpuMask.ClearBit(cpu);
+			if (!fPageTablesInvalidated)
+				defer_lazy_cpus(cpuMask);
 
 			if (!cpuMask.IsEmpty()) {
 				smp_send_multicast_ici(cpuMask, SMP_MSG_INVALIDATE_PAGE_LIST,
@@ -144,6 +223,7 @@ X86VMTranslationMap::Flush()
 		}
 	}
 	fInvalidPagesCount = 0;
+	fPageTablesInvalidated = false;
 
 	thread_unpin_from_current_cpu(thread);
 }
@@ -37,11 +37,16 @@ struct X86VMTranslationMap : VMTranslationMap {
 	virtual	X86PagingStructures* PagingStructures() const = 0;
 
 	inline	void				InvalidatePage(addr_t address);
+	inline	void				InvalidatePageTable(addr_t address);
+
+protected:
+			void				ReleaseLazyCPUs();
 
 protected:
 			TranslationMapPhysicalPageMapper* fPageMapper;
 			int					fInvalidPagesCount;
 			addr_t				fInvalidPages[PAGE_INVALIDATE_CACHE_SIZE];
+			bool				fPageTablesInvalidated;
 			bool				fIsKernelMap;
 };
 
@@ -56,4 +61,17 @@ X86VMTranslationMap::InvalidatePage(addr_t address)
 }
 
 
+/*!	Like InvalidatePage(), but \a address was mapped through a page table
+	that is going to be freed. The next Flush() then interrupts the CPUs that
+	use the paging structures only lazily as well, as they may still cache
+	the entries leading to the page table.
+*/
+void
+X86VMTranslationMap::InvalidatePageTable(addr_t address)
+{
+	InvalidatePage(address);
+	fPageTablesInvalidated = true;
+}
+
+
 #endif	// KERNEL_ARCH_X86_X86_VM_TRANSLATION_MAP_H
@@ -576,7 +576,6 @@ X86PagingMethodPAE::X86PagingMethodPAE()
 	:
 	fPhysicalPageMapper(NULL),
 	fKernelPhysicalPageMapper(NULL),
-	fFreePages(NULL),
 	fFreePagesCount(0)
 {
 	mutex_init(&fFreePagesLock, "x86 PAE free pages");
@@ -840,10 +839,8 @@ X86PagingMethodPAE::Allocate32BitPage(phys_addr_t& _physicalAddress,
 {
 	// get a free page
 	MutexLocker locker(fFreePagesLock);
-	vm_page* page;
-	if (fFreePages != NULL) {
-		page = fFreePages;
-		fFreePages = page->cache_next;
+	vm_page* page = fFreePages.RemoveHead();
+	if (page != NULL) {
 		fFreePagesCount--;
 		locker.Unlock();
 	} else {
@@ -868,8 +865,7 @@ X86PagingMethodPAE::Allocate32BitPage(phys_addr_t& _physicalAddress,
 			!= B_OK) {
 		// mapping failed -- free page
 		locker.Lock();
-		page->cache_next = fFreePages;
-		fFreePages = page;
+		fFreePages.Add(page);
 		fFreePagesCount++;
 		return NULL;
 	}
@@ -891,8 +887,7 @@ X86PagingMethodPAE::Free32BitPage(void* address, phys_addr_t physicalAddress,
 	MutexLocker locker(fFreePagesLock);
 	if (fFreePagesCount < kMaxFree32BitPagesCount) {
 		// cache not full yet -- cache it
-		page->cache_next = fFreePages;
-		fFreePages = page;
+		fFreePages.Add(page);
 		fFreePagesCount++;
 	} else {
 		// cache full -- free it
@@ -24,6 +24,11 @@ class X86PhysicalPageMapper;
 
 
 class X86PagingMethodPAE : public X86PagingMethod {
+public:
+	typedef DoublyLinkedList<vm_page,
+		DoublyLinkedListMemberGetLink<vm_page, &vm_page::queue_link> >
+			PageList;
+
 public:
 								X86PagingMethodPAE();
 	virtual						~X86PagingMethodPAE();
@@ -121,7 +126,7 @@ private:
 			pae_page_table_entry* fFreeVirtualSlotPTE;
 
 			mutex				fFreePagesLock;
-			vm_page*			fFreePages;
+			PageList			fFreePages;
 			page_num_t			fFreePagesCount;
 };
 
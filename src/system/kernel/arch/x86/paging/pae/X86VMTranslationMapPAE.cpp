@@ -237,6 +237,8 @@ X86VMTranslationMapPAE::~X86VMTranslationMapPAE()
 	if (fPagingStructures == NULL)
 		return;
 
+	ReleaseLazyCPUs();
+
 	if (fPageMapper != NULL)
 		fPageMapper->Delete();
 
@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/uio.h>
 
 #include <KernelExport.h>
 #include <fs_cache.h>
@@ -26,10 +27,19 @@
 
 #include "kernel_debug_config.h"
 
+#if defined(_KERNEL_MODE) && !defined(BUILDING_USERLAND_FS_SERVER)
+#	include "IORequest.h"
+#	define BLOCK_CACHE_ASYNC_WRITES	1
+		// Runs of adjacent blocks are written back via asynchronous
+		// IORequests, instead of waiting for each of them in turn.
+#else
+#	define BLOCK_CACHE_ASYNC_WRITES	0
+#endif
+
 
 // TODO: this is a naive but growing implementation to test the API:
-//	block reading/writing is not at all optimized for speed, it will
-//	just read and write single blocks.
+//	block reading is not at all optimized for speed, it will just read
+//	single blocks.
 // TODO: the retrieval/copy of the original data could be delayed until the
 //		new data must be written, ie. in low memory situations.
 
@@ -49,6 +59,16 @@
 static const bigtime_t kTransactionIdleTime = 2000000LL;
 	// a transaction is considered idle after 2 seconds of inactivity
 
+#if !BLOCK_CACHE_DEBUG_CHANGED \
+	&& !(BLOCK_CACHE_BLOCK_TRACING && !defined(BUILDING_USERLAND_FS_SERVER))
+#	define BLOCK_CACHE_LOCKLESS_LOOKUP	1
+		// Gets and puts of already referenced blocks don't need to acquire
+		// the cache lock. This is disabled when the debugging code needs to
+		// look at the block on every access.
+#else
+#	define BLOCK_CACHE_LOCKLESS_LOOKUP	0
+#endif
+
 
 namespace {
 
@@ -124,18 +144,25 @@ struct cache_notification : DoublyLinkedListLinkImpl<cache_notification> {
 
 typedef DoublyLinkedList<cache_notification> NotificationList;
 
+static const uint32 kBlockTableShardShift = 4;
+static const uint32 kBlockTableShardCount = 1 << kBlockTableShardShift;
+	// The block hash is split into this many independently locked shards, so
+	// that lookups of already referenced blocks don't have to go through the
+	// cache lock.
+
 struct BlockHash {
 	typedef off_t			KeyType;
 	typedef	cached_block	ValueType;
 
 	size_t HashKey(KeyType key) const
 	{
-		return key;
+		// the lower bits already select the shard
+		return key >> kBlockTableShardShift;
 	}
 
 	size_t Hash(ValueType* block) const
 	{
-		return block->block_number;
+		return HashKey(block->block_number);
 	}
 
 	bool Compare(KeyType key, ValueType* block) const
@@ -152,6 +179,85 @@ struct BlockHash {
 typedef BOpenHashTable<BlockHash> BlockTable;
 
 
+/*!	A hash table of cached blocks that is split into several shards.
+	Any change to the table requires the block_cache::lock to be held, and
+	additionally write locks the affected shard. Therefore, lookups with the
+	cache lock held don't need any further locking, while lookups without it
+	have to hold the read lock of the shard for as long as they access the
+	block (see get_referenced_cached_block()).
+*/
+class ShardedBlockTable {
+public:
+								ShardedBlockTable();
+								~ShardedBlockTable();
+
+			status_t			Init(size_t initialSize);
+
+			rw_lock&			ShardLock(off_t blockNumber)
+									{ return _Shard(blockNumber).lock; }
+
+			cached_block*		Lookup(off_t blockNumber) const
+									{ return _Shard(blockNumber).table.Lookup(
+										blockNumber); }
+			status_t			Insert(cached_block* block);
+			void				Remove(cached_block* block);
+			cached_block*		Clear();
+
+	class Iterator {
+	public:
+		Iterator(const ShardedBlockTable* table)
+			:
+			fTable(table),
+			fShard(0),
+			fIterator(&table->fShards[0].table)
+		{
+			_SkipEmptyShards();
+		}
+
+		bool HasNext() const
+		{
+			return fIterator.HasNext();
+		}
+
+		cached_block* Next()
+		{
+			cached_block* block = fIterator.Next();
+			_SkipEmptyShards();
+			return block;
+		}
+
+	private:
+		void _SkipEmptyShards()
+		{
+			while (!fIterator.HasNext()
+				&& ++fShard < kBlockTableShardCount) {
+				fIterator = BlockTable::Iterator(&fTable->fShards[fShard].table);
+			}
+		}
+
+		const ShardedBlockTable* fTable;
+		uint32				fShard;
+		BlockTable::Iterator fIterator;
+	};
+
+private:
+	struct Shard {
+		rw_lock			lock;
+		BlockTable		table;
+	};
+
+			Shard&				_Shard(off_t blockNumber)
+									{ return fShards[blockNumber
+										& (kBlockTableShardCount - 1)]; }
+			const Shard&		_Shard(off_t blockNumber) const
+									{ return fShards[blockNumber
+										& (kBlockTableShardCount - 1)]; }
+
+private:
+			Shard				fShards[kBlockTableShardCount];
+};
+
+
 struct TransactionHash {
 	typedef int32				KeyType;
 	typedef	cache_transaction	ValueType;
@@ -170,7 +276,7 @@ typedef BOpenHashTable<TransactionHash> TransactionTable;
 
 
 struct block_cache : DoublyLinkedListLinkImpl<block_cache> {
-	BlockTable*		hash;
+	ShardedBlockTable* hash;
 	mutex			lock;
 	int				fd;
 	off_t			max_blocks;
@@ -270,8 +376,25 @@ public:
 									cached_block* block);
 
 private:
+#if BLOCK_CACHE_ASYNC_WRITES
+			struct PendingWrite {
+				IORequest*		request;
+				status_t		status;
+				uint32			index;
+				uint32			count;
+			};
+#endif
+
 			void*				_Data(cached_block* block) const;
-			status_t			_WriteBlock(cached_block* block);
+			uint32				_RunLength(uint32 index) const;
+			void				_WriteBlocks(uint32 index, uint32 count);
+#if BLOCK_CACHE_ASYNC_WRITES
+			bool				_StartWriteBlocks(uint32 index, uint32 count,
+									PendingWrite& pending);
+			void				_FinishWriteBlocks(PendingWrite& pending);
+#endif
+			void				_WriteFailed(uint32 index, uint32 count,
+									status_t status);
 			void				_BlockDone(cached_block* block,
 									cache_transaction* transaction);
 			void				_UnmarkWriting(cached_block* block);
@@ -281,6 +404,10 @@ private:
 
 private:
 	static	const size_t		kBufferSize = 64;
+	static	const uint32		kMaxRunLength = 64;
+		// maximum number of adjacent blocks written with a single request
+	static	const uint32		kMaxPendingWrites = 8;
+		// maximum number of asynchronous requests in flight
 
 			block_cache*		fCache;
 			cached_block*		fBuffer[kBufferSize];
@@ -1058,6 +1185,86 @@ cached_block::CanBeWritten() const
 }
 
 
+//	#pragma mark - ShardedBlockTable
+
+
+ShardedBlockTable::ShardedBlockTable()
+{
+	for (uint32 i = 0; i < kBlockTableShardCount; i++)
+		rw_lock_init(&fShards[i].lock, "block cache shard");
+}
+
+
+ShardedBlockTable::~ShardedBlockTable()
+{
+	for (uint32 i = 0; i < kBlockTableShardCount; i++)
+		rw_lock_destroy(&fShards[i].lock);
+}
+
+
+status_t
+ShardedBlockTable::Init(size_t initialSize)
+{
+	size_t shardSize = initialSize / kBlockTableShardCount;
+	if (shardSize == 0)
+		shardSize = 1;
+
+	for (uint32 i = 0; i < kBlockTableShardCount; i++) {
+		status_t status = fShards[i].table.Init(shardSize);
+		if (status != B_OK)
+			return status;
+	}
+
+	return B_OK;
+}
+
+
+/*!	The block_cache::lock must be held. */
+status_t
+ShardedBlockTable::Insert(cached_block* block)
+{
+	Shard& shard = _Shard(block->block_number);
+	WriteLocker locker(shard.lock);
+
+	return shard.table.Insert(block);
+}
+
+
+/*!	The block_cache::lock must be held. */
+void
+ShardedBlockTable::Remove(cached_block* block)
+{
+	Shard& shard = _Shard(block->block_number);
+	WriteLocker locker(shard.lock);
+
+	shard.table.Remove(block);
+}
+
+
+/*!	Removes all blocks from the table, and returns them as a list linked
+	via cached_block::next.
+*/
+cached_block*
+ShardedBlockTable::Clear()
+{
+	cached_block* blocks = NULL;
+
+	for (uint32 i = 0; i < kBlockTableShardCount; i++) {
+		WriteLocker locker(fShards[i].lock);
+
+		cached_block* block = fShards[i].table.Clear(true);
+		while (block != NULL) {
+			cached_block* next = block->next;
+			block->next = blocks;
+			blocks = block;
+			block = next;
+		}
+	}
+
+	return blocks;
+}
+
+
 //	#pragma mark - BlockWriter
 
 
@@ -1180,19 +1387,39 @@ BlockWriter::Write(cache_transaction* transaction, bool canUnlock)
 	qsort(fBlocks, fCount, sizeof(void*), &_CompareBlocks);
 	fDeletedTransaction = false;
 
-	for (uint32 i = 0; i < fCount; i++) {
-		status_t status = _WriteBlock(fBlocks[i]);
-		if (status != B_OK) {
-			// propagate to global error handling
-			if (fStatus == B_OK)
-				fStatus = status;
+	// Coalesce adjacent blocks into a single write each, and keep a few of
+	// those in flight at the same time
 
-			_UnmarkWriting(fBlocks[i]);
-			fBlocks[i] = NULL;
-				// This block will not be marked clean
+#if BLOCK_CACHE_ASYNC_WRITES
+	PendingWrite pending[kMaxPendingWrites];
+	uint32 pendingCount = 0;
+#endif
+
+	for (uint32 index = 0; index < fCount;) {
+		uint32 count = _RunLength(index);
+
+#if BLOCK_CACHE_ASYNC_WRITES
+		if (pendingCount == kMaxPendingWrites) {
+			// wait for the oldest write to finish
+			_FinishWriteBlocks(pending[0]);
+			memmove(pending, pending + 1,
+				--pendingCount * sizeof(PendingWrite));
 		}
+
+		if (_StartWriteBlocks(index, count, pending[pendingCount]))
+			pendingCount++;
+		else
+#endif
+			_WriteBlocks(index, count);
+
+		index += count;
 	}
 
+#if BLOCK_CACHE_ASYNC_WRITES
+	for (uint32 i = 0; i < pendingCount; i++)
+		_FinishWriteBlocks(pending[i]);
+#endif
+
 	if (canUnlock)
 		mutex_lock(&fCache->lock);
 
@@ -1229,31 +1456,154 @@ BlockWriter::_Data(cached_block* block) const
 }
 
 
-status_t
-BlockWriter::_WriteBlock(cached_block* block)
+/*!	Returns the number of blocks starting at \a index that are adjacent on
+	disk, and can therefore be written back in a single request.
+*/
+uint32
+BlockWriter::_RunLength(uint32 index) const
+{
+	uint32 count = 1;
+	while (index + count < fCount && count < kMaxRunLength
+		&& fBlocks[index + count]->block_number
+			== fBlocks[index]->block_number + count) {
+		count++;
+	}
+
+	return count;
+}
+
+
+/*!	Synchronously writes back the \a count adjacent blocks starting at
+	\a index.
+*/
+void
+BlockWriter::_WriteBlocks(uint32 index, uint32 count)
 {
-	ASSERT(block->busy_writing);
+	size_t blockSize = fCache->block_size;
+	iovec vecs[kMaxRunLength];
+
+	for (uint32 i = 0; i < count; i++) {
+		cached_block* block = fBlocks[index + i];
+		ASSERT(block->busy_writing);
+
+		TRACE(("BlockWriter::_WriteBlocks(block %" B_PRIdOFF ")\n",
+			block->block_number));
+		TB(Write(fCache, block));
+		TB2(BlockData(fCache, block, "before write"));
+
+		vecs[i].iov_base = _Data(block);
+		vecs[i].iov_len = blockSize;
+	}
+
+	ssize_t written = writev_pos(fCache->fd,
+		fBlocks[index]->block_number * blockSize, vecs, count);
+
+	if (written != (ssize_t)(count * blockSize)) {
+		TB(Error(fCache, fBlocks[index]->block_number, "write failed",
+			written));
+		TRACE_ALWAYS(("could not write back blocks %" B_PRIdOFF " - %"
+			B_PRIdOFF " (%s)\n", fBlocks[index]->block_number,
+			fBlocks[index]->block_number + count - 1, strerror(errno)));
+
+		_WriteFailed(index, count, written < 0 ? errno : B_IO_ERROR);
+	}
+}
+
+
+#if BLOCK_CACHE_ASYNC_WRITES
 
-	TRACE(("BlockWriter::_WriteBlock(block %" B_PRIdOFF ")\n", block->block_number));
-	TB(Write(fCache, block));
-	TB2(BlockData(fCache, block, "before write"));
+
+/*!	Starts writing back the \a count adjacent blocks starting at \a index
+	asynchronously; _FinishWriteBlocks() must be called with \a pending to
+	wait for its completion.
+	Returns \c false if the request could not be created, in which case the
+	blocks have to be written synchronously instead.
+*/
+bool
+BlockWriter::_StartWriteBlocks(uint32 index, uint32 count,
+	PendingWrite& pending)
+{
+	IORequest* request = IORequest::Create(false);
+	if (request == NULL)
+		return false;
 
 	size_t blockSize = fCache->block_size;
+	generic_io_vec vecs[kMaxRunLength];
 
-	ssize_t written = write_pos(fCache->fd,
-		block->block_number * blockSize, _Data(block), blockSize);
+	for (uint32 i = 0; i < count; i++) {
+		cached_block* block = fBlocks[index + i];
+		ASSERT(block->busy_writing);
 
-	if (written != (ssize_t)blockSize) {
-		TB(Error(fCache, block->block_number, "write failed", written));
-		TRACE_ALWAYS(("could not write back block %" B_PRIdOFF " (%s)\n", block->block_number,
-			strerror(errno)));
-		if (written < 0)
-			return errno;
+		vecs[i].base = (generic_addr_t)_Data(block);
+		vecs[i].length = blockSize;
+	}
 
-		return B_IO_ERROR;
+	status_t status = request->Init(fBlocks[index]->block_number * blockSize,
+		vecs, count, count * blockSize, true, 0);
+	if (status != B_OK) {
+		delete request;
+		return false;
 	}
 
-	return B_OK;
+	for (uint32 i = 0; i < count; i++) {
+		TRACE(("BlockWriter::_StartWriteBlocks(block %" B_PRIdOFF ")\n",
+			fBlocks[index + i]->block_number));
+		TB(Write(fCache, fBlocks[index + i]));
+		TB2(BlockData(fCache, fBlocks[index + i], "before write"));
+	}
+
+	pending.request = request;
+	pending.index = index;
+	pending.count = count;
+	pending.status = do_fd_io(fCache->fd, request);
+
+	return true;
+}
+
+
+void
+BlockWriter::_FinishWriteBlocks(PendingWrite& pending)
+{
+	status_t status = pending.status;
+	if (status == B_OK)
+		status = pending.request->Wait();
+	if (status == B_OK && pending.request->TransferredBytes()
+			!= pending.count * fCache->block_size) {
+		status = B_IO_ERROR;
+	}
+
+	delete pending.request;
+
+	if (status != B_OK) {
+		cached_block* block = fBlocks[pending.index];
+
+		TB(Error(fCache, block->block_number, "write failed", status));
+		TRACE_ALWAYS(("could not write back blocks %" B_PRIdOFF " - %"
+			B_PRIdOFF " (%s)\n", block->block_number,
+			block->block_number + pending.count - 1, strerror(status)));
+
+		_WriteFailed(pending.index, pending.count, status);
+	}
+}
+
+
+#endif	// BLOCK_CACHE_ASYNC_WRITES
+
+
+/*!	Marks the \a count blocks starting at \a index as not written, and
+	propagates the error to the writer's status.
+*/
+void
+BlockWriter::_WriteFailed(uint32 index, uint32 count, status_t status)
+{
+	if (fStatus == B_OK)
+		fStatus = status;
+
+	for (uint32 i = index; i < index + count; i++) {
+		_UnmarkWriting(fBlocks[i]);
+		fBlocks[i] = NULL;
+			// This block will not be marked clean
+	}
 }
 
 
@@ -1402,7 +1752,7 @@ block_cache::Init()
 	if (buffer_cache == NULL)
 		return B_NO_MEMORY;
 
-	hash = new BlockTable();
+	hash = new(std::nothrow) ShardedBlockTable();
 	if (hash == NULL || hash->Init(1024) != B_OK)
 		return B_NO_MEMORY;
 
@@ -1803,12 +2153,14 @@ put_cached_block(block_cache* cache, cached_block* block)
 #endif
 	TB(Put(cache, block));
 
-	if (block->ref_count < 1) {
+	if (atomic_get(&block->ref_count) < 1) {
 		panic("Invalid ref_count for block %p, cache %p\n", block, cache);
 		return;
 	}
 
-	if (--block->ref_count == 0
+	// The reference count is also changed by the lockless paths, but those
+	// never let it drop to, or raise it from zero.
+	if (atomic_add(&block->ref_count, -1) == 1
 		&& block->transaction == NULL && block->previous_transaction == NULL) {
 		// This block is not used anymore, and not part of any transaction
 		block->is_writing = false;
@@ -1917,13 +2269,80 @@ retry:
 		mark_block_unbusy_reading(cache, block);
 	}
 
-	block->ref_count++;
-	block->last_accessed = system_time() / 1000000L;
+	atomic_add(&block->ref_count, 1);
+	atomic_set(&block->last_accessed, system_time() / 1000000L);
 
 	return block;
 }
 
 
+#if BLOCK_CACHE_LOCKLESS_LOOKUP
+
+/*!	Acquires another reference to the block \a blockNumber without holding
+	the cache lock. This only works for blocks that are already referenced
+	by someone else, and that are not busy reading; the block cannot be
+	removed from the cache in this case, nor can any of its transaction
+	state be changed in a way that matters to a reader.
+	Returns \c NULL if the slow path via get_cached_block() has to be taken.
+*/
+static cached_block*
+get_referenced_cached_block(block_cache* cache, off_t blockNumber)
+{
+	if (blockNumber < 0 || blockNumber >= cache->max_blocks)
+		return NULL;
+
+	ReadLocker locker(cache->hash->ShardLock(blockNumber));
+
+	cached_block* block = cache->hash->Lookup(blockNumber);
+	if (block == NULL || block->busy_reading || block->discard)
+		return NULL;
+
+	int32 count = atomic_get(&block->ref_count);
+	while (count > 0) {
+		int32 previous = atomic_test_and_set(&block->ref_count, count + 1,
+			count);
+		if (previous == count) {
+			atomic_set(&block->last_accessed, system_time() / 1000000L);
+			return block;
+		}
+		count = previous;
+	}
+
+	return NULL;
+}
+
+
+/*!	Releases a reference to the block \a blockNumber without holding the
+	cache lock, if that isn't the last reference to it.
+	Returns \c false if put_cached_block() has to be called instead.
+*/
+static bool
+put_referenced_cached_block(block_cache* cache, off_t blockNumber)
+{
+	if (blockNumber < 0 || blockNumber >= cache->max_blocks)
+		return false;
+
+	ReadLocker locker(cache->hash->ShardLock(blockNumber));
+
+	cached_block* block = cache->hash->Lookup(blockNumber);
+	if (block == NULL)
+		return false;
+
+	int32 count = atomic_get(&block->ref_count);
+	while (count > 1) {
+		int32 previous = atomic_test_and_set(&block->ref_count, count - 1,
+			count);
+		if (previous == count)
+			return true;
+		count = previous;
+	}
+
+	return false;
+}
+
+#endif	// BLOCK_CACHE_LOCKLESS_LOOKUP
+
+
 /*!	Returns the writable block data for the requested blockNumber.
 	If \a cleared is true, the block is not read from disk; an empty block
 	is returned.
@@ -2252,7 +2671,7 @@ dump_cache(int argc, char** argv)
 	uint32 count = 0;
 	uint32 dirty = 0;
 	uint32 discarded = 0;
-	BlockTable::Iterator iterator(cache->hash);
+	ShardedBlockTable::Iterator iterator(cache->hash);
 	while (iterator.HasNext()) {
 		cached_block* block = iterator.Next();
 		if (showBlocks)
@@ -2543,7 +2962,7 @@ block_notifier_and_writer(void* /*data*/)
 			if (cache->num_dirty_blocks) {
 				// This cache is not using transactions, we'll scan the blocks
 				// directly
-				BlockTable::Iterator iterator(cache->hash);
+				ShardedBlockTable::Iterator iterator(cache->hash);
 
 				while (iterator.HasNext()) {
 					cached_block* block = iterator.Next();
@@ -3324,7 +3743,7 @@ block_cache_delete(void* _cache, bool allowWrites)
 
 	// free all blocks
 
-	cached_block* block = cache->hash->Clear(true);
+	cached_block* block = cache->hash->Clear();
 	while (block != NULL) {
 		cached_block* next = block->next;
 		cache->FreeBlock(block);
@@ -3375,7 +3794,7 @@ block_cache_sync(void* _cache)
 	MutexLocker locker(&cache->lock);
 
 	BlockWriter writer(cache);
-	BlockTable::Iterator iterator(cache->hash);
+	ShardedBlockTable::Iterator iterator(cache->hash);
 
 	while (iterator.HasNext()) {
 		cached_block* block = iterator.Next();
@@ -3551,10 +3970,19 @@ const void*
 block_cache_get_etc(void* _cache, off_t blockNumber, off_t base, off_t length)
 {
 	block_cache* cache = (block_cache*)_cache;
+
+#if BLOCK_CACHE_LOCKLESS_LOOKUP
+	cached_block* block = get_referenced_cached_block(cache, blockNumber);
+	if (block != NULL)
+		return block->current_data;
+#else
+	cached_block* block;
+#endif
+
 	MutexLocker locker(&cache->lock);
 	bool allocated;
 
-	cached_block* block = get_cached_block(cache, blockNumber, &allocated);
+	block = get_cached_block(cache, blockNumber, &allocated);
 	if (block == NULL)
 		return NULL;
 
@@ -3611,6 +4039,12 @@ void
 block_cache_put(void* _cache, off_t blockNumber)
 {
 	block_cache* cache = (block_cache*)_cache;
+
+#if BLOCK_CACHE_LOCKLESS_LOOKUP
+	if (put_referenced_cached_block(cache, blockNumber))
+		return;
+#endif
+
 	MutexLocker locker(&cache->lock);
 
 	put_cached_block(cache, blockNumber);
@@ -42,6 +42,10 @@
 #define BYPASS_IO_SIZE		65536
 #define LAST_ACCESSES		3
 
+// read-ahead window sizes for sequential reads
+#define MIN_READ_AHEAD_SIZE	(MAX_IO_VECS * B_PAGE_SIZE)
+#define MAX_READ_AHEAD_SIZE	(2 * 1024 * 1024)
+
 struct file_cache_ref {
 	VMCache			*cache;
 	struct vnode	*vnode;
@@ -52,6 +56,16 @@ struct file_cache_ref {
 	int32			last_access_index;
 	uint16			disabled_count;
 
+	// sequential read stream detection, protected by the cache lock
+	off_t			next_read_offset;
+		// where the next read is expected to start if this is a stream
+	off_t			read_ahead_end;
+		// end of the last read-ahead window
+	off_t			read_ahead_trigger;
+		// reading beyond this offset starts the next read-ahead window
+	size_t			read_ahead_size;
+		// current window size, 0 if there is no sequential stream
+
 	inline void SetLastAccess(int32 index, off_t access, bool isWrite)
 	{
 		// we remember writes as negative offsets
@@ -671,6 +685,158 @@ write_to_file(file_cache_ref* ref, void* cookie, off_t offset, int32 pageOffset,
 }
 
 
+/*!	Asynchronously reads all pages of the given range that are not yet in
+	the cache. \a offset and \a size must be page aligned, and
+	\a reservation must contain enough pages for the whole range.
+	The cache must be locked; it will be unlocked temporarily while the I/O
+	requests are issued.
+*/
+static void
+precache_pages(file_cache_ref* ref, off_t offset, size_t size,
+	vm_page_reservation* reservation)
+{
+	VMCache* cache = ref->cache;
+	size_t bytesToRead = 0;
+	off_t lastOffset = offset;
+
+	while (true) {
+		// check if this page is already in memory
+		if (size > 0) {
+			vm_page* page = cache->LookupPage(offset);
+
+			offset += B_PAGE_SIZE;
+			size -= B_PAGE_SIZE;
+
+			if (page == NULL) {
+				bytesToRead += B_PAGE_SIZE;
+				continue;
+			}
+		}
+		if (bytesToRead != 0) {
+			// read the part before the current page (or the end of the request)
+			PrecacheIO* io = new(std::nothrow) PrecacheIO(ref, lastOffset,
+				bytesToRead);
+			if (io == NULL || io->Prepare(reservation) != B_OK) {
+				delete io;
+				break;
+			}
+
+			// we must not have the cache locked during I/O
+			cache->Unlock();
+			io->ReadAsync();
+			cache->Lock();
+
+			bytesToRead = 0;
+		}
+
+		if (size == 0) {
+			// we have reached the end of the request
+			break;
+		}
+
+		lastOffset = offset;
+	}
+}
+
+
+/*!	Updates the sequential stream state of \a ref for a read of \a size
+	bytes at \a offset. If the read crosses the read-ahead trigger of the
+	stream, the window is grown, and \c true is returned together with the
+	range that should be read ahead next.
+	The cache must be locked.
+*/
+static bool
+update_read_ahead(file_cache_ref* ref, off_t offset, size_t size,
+	off_t& _aheadOffset, size_t& _aheadSize)
+{
+	off_t end = offset + size;
+
+	if (offset != ref->next_read_offset) {
+		// random access -- forget about the stream
+		ref->next_read_offset = end;
+		ref->read_ahead_size = 0;
+		ref->read_ahead_end = 0;
+		ref->read_ahead_trigger = 0;
+		return false;
+	}
+
+	ref->next_read_offset = end;
+
+	if (ref->read_ahead_size == 0) {
+		// start a new stream with a window of at least twice the read size
+		ref->read_ahead_size = max_c(MIN_READ_AHEAD_SIZE,
+			min_c(PAGE_ALIGN(2 * size), MAX_READ_AHEAD_SIZE));
+	} else if (end <= ref->read_ahead_trigger)
+		return false;
+	else {
+		ref->read_ahead_size = min_c(2 * ref->read_ahead_size,
+			MAX_READ_AHEAD_SIZE);
+	}
+
+	if (ref->read_ahead_end < end)
+		ref->read_ahead_end = PAGE_ALIGN(end);
+
+	off_t aheadOffset = ref->read_ahead_end;
+	off_t fileSize = ref->cache->virtual_end;
+	if (aheadOffset >= fileSize)
+		return false;
+
+	size_t aheadSize = min_c((off_t)ref->read_ahead_size,
+		PAGE_ALIGN(fileSize - aheadOffset));
+
+	// The next window is started as soon as the reader enters this one
+	ref->read_ahead_trigger = aheadOffset;
+	ref->read_ahead_end = aheadOffset + aheadSize;
+
+	_aheadOffset = aheadOffset;
+	_aheadSize = aheadSize;
+	return true;
+}
+
+
+/*!	Called after a successful read of \a size bytes at \a offset. Detects
+	sequential reads, and starts reading the next window of the file
+	asynchronously, so that the following reads will find their data already
+	in the cache.
+*/
+static void
+read_ahead(file_cache_ref* ref, off_t offset, size_t size)
+{
+	if (size == 0)
+		return;
+
+	VMCache* cache = ref->cache;
+	off_t aheadOffset;
+	size_t aheadSize;
+
+	AutoLocker<VMCache> locker(cache);
+
+	if (!update_read_ahead(ref, offset, size, aheadOffset, aheadSize))
+		return;
+
+	locker.Unlock();
+
+	// Don't make memory pressure worse, and don't wait for pages
+	uint32 reservePages = aheadSize / B_PAGE_SIZE;
+	if (low_resource_state(B_KERNEL_RESOURCE_PAGES) != B_NO_LOW_RESOURCE
+		|| vm_page_num_unused_pages() < 2 * reservePages) {
+		return;
+	}
+
+	vm_page_reservation reservation;
+	if (!vm_page_try_reserve_pages(&reservation, reservePages,
+			VM_PRIORITY_USER)) {
+		return;
+	}
+
+	locker.Lock();
+	precache_pages(ref, aheadOffset, aheadSize, &reservation);
+	locker.Unlock();
+
+	vm_page_unreserve_pages(&reservation);
+}
+
+
 static inline status_t
 satisfy_cache_io(file_cache_ref* ref, void* cookie, cache_func function,
 	off_t offset, addr_t buffer, bool useBuffer, int32 &pageOffset,
@@ -969,53 +1135,13 @@ cache_prefetch_vnode(struct vnode* vnode, off_t offset, size_t size)
 		return;
 	}
 
-	size_t bytesToRead = 0;
-	off_t lastOffset = offset;
-
 	vm_page_reservation reservation;
 	vm_page_reserve_pages(&reservation, reservePages, VM_PRIORITY_USER);
 
 	cache->Lock();
-
-	while (true) {
-		// check if this page is already in memory
-		if (size > 0) {
-			vm_page* page = cache->LookupPage(offset);
-
-			offset += B_PAGE_SIZE;
-			size -= B_PAGE_SIZE;
-
-			if (page == NULL) {
-				bytesToRead += B_PAGE_SIZE;
-				continue;
-			}
-		}
-		if (bytesToRead != 0) {
-			// read the part before the current page (or the end of the request)
-			PrecacheIO* io = new(std::nothrow) PrecacheIO(ref, lastOffset,
-				bytesToRead);
-			if (io == NULL || io->Prepare(&reservation) != B_OK) {
-				delete io;
-				break;
-			}
-
-			// we must not have the cache locked during I/O
-			cache->Unlock();
-			io->ReadAsync();
-			cache->Lock();
-
-			bytesToRead = 0;
-		}
-
-		if (size == 0) {
-			// we have reached the end of the request
-			break;
-		}
-
-		lastOffset = offset;
-	}
-
+	precache_pages(ref, offset, size, &reservation);
 	cache->ReleaseRefAndUnlock();
+
 	vm_page_unreserve_pages(&reservation);
 }
 
@@ -1133,6 +1259,10 @@ file_cache_create(dev_t mountID, ino_t vnodeID, off_t size)
 	memset(ref->last_access, 0, sizeof(ref->last_access));
 	ref->last_access_index = 0;
 	ref->disabled_count = 0;
+	ref->next_read_offset = 0;
+	ref->read_ahead_end = 0;
+	ref->read_ahead_trigger = 0;
+	ref->read_ahead_size = 0;
 
 	// TODO: delay VMCache creation until data is
 	//	requested/written for the first time? Listing lots of
@@ -1299,7 +1429,12 @@ file_cache_read(void* _cacheRef, void* cookie, off_t offset, void* buffer,
 		return error;
 	}
 
-	return cache_io(ref, cookie, offset, (addr_t)buffer, _size, false);
+	status_t status = cache_io(ref, cookie, offset, (addr_t)buffer, _size,
+		false);
+	if (status == B_OK)
+		read_ahead(ref, offset, *_size);
+
+	return status;
 }
 
 
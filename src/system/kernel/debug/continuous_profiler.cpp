@@ -0,0 +1,430 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <continuous_profiler.h>
+
+#include <new>
+
+#include <AutoDeleter.h>
+#include <Referenceable.h>
+
+#include <util/AutoLock.h>
+
+#include <continuous_profiler_defs.h>
+
+#include <cpu.h>
+#include <kernel.h>
+#include <lock.h>
+#include <Notifications.h>
+#include <smp.h>
+#include <team.h>
+#include <thread.h>
+#include <user_debugger.h>
+#include <vm/vm.h>
+
+#include <arch/debug.h>
+
+
+// This is the kernel-side implementation of the continuous profiler. Unlike
+// the system profiler it doesn't record any events besides stack samples and
+// it doesn't serialize the CPUs on a common buffer: every CPU appends its
+// samples to its own ring in the area provided by the userland reader, from
+// its profiling timer and without taking any lock. That keeps the overhead
+// low enough to leave it running on production systems.
+// The reader can write to that area, too, so the profiler never trusts
+// anything it reads back from it but the reader's tail.
+
+
+static const uint32 kMinRingSize = 4096;
+
+
+class ContinuousProfiler;
+
+static spinlock sContinuousProfilerLock = B_SPINLOCK_INITIALIZER;
+static ContinuousProfiler* sContinuousProfiler = NULL;
+
+
+class ContinuousProfiler : public BReferenceable,
+	private NotificationListener {
+public:
+								ContinuousProfiler(team_id team,
+									const area_info& userAreaInfo,
+									const continuous_profiler_parameters&
+										parameters);
+								~ContinuousProfiler();
+
+			team_id				TeamID() const	{ return fTeam; }
+
+			status_t			Init();
+
+private:
+    virtual	void				EventOccurred(NotificationService& service,
+									const KMessage* event);
+
+private:
+			struct CPUProfileData {
+				struct timer	timer;
+				uint32			head;
+					// the authoritative producer position, ring.head
+					// only gets a copy of it
+				addr_t			buffer[B_DEBUG_STACK_TRACE_DEPTH];
+			};
+
+	static	void				_InitTimers(void* cookie, int cpu);
+	static	void				_UninitTimers(void* cookie, int cpu);
+
+			void				_DoSample(int cpu);
+
+	static	int32				_ProfilingEvent(struct timer* timer);
+
+private:
+			team_id				fTeam;
+			area_id				fUserArea;
+			area_id				fKernelArea;
+			size_t				fAreaSize;
+			uint32				fFlags;
+			uint32				fStackDepth;
+			bigtime_t			fInterval;
+			continuous_profiler_header* fHeader;
+			continuous_profiler_ring* fRings;
+			uint8*				fRingData;
+			uint32				fRingSize;
+			uint32				fMaxSampleSize;
+			bool				fTeamNotificationsRequested;
+			bool				fTimersActive;
+			CPUProfileData		fCPUData[SMP_MAX_CPUS];
+};
+
+
+static inline uint32
+sample_size(int32 count)
+{
+	return (sizeof(continuous_profiler_sample) + count * sizeof(addr_t) + 7)
+		/ 8 * 8;
+}
+
+
+// #pragma mark - ContinuousProfiler
+
+
+ContinuousProfiler::ContinuousProfiler(team_id team,
+	const area_info& userAreaInfo,
+	const continuous_profiler_parameters& parameters)
+	:
+	fTeam(team),
+	fUserArea(userAreaInfo.area),
+	fKernelArea(-1),
+	fAreaSize(userAreaInfo.size),
+	fFlags(parameters.flags),
+	fStackDepth(parameters.stack_depth),
+	fInterval(parameters.interval),
+	fHeader(NULL),
+	fRings(NULL),
+	fRingData(NULL),
+	fRingSize(0),
+	fMaxSampleSize(sample_size(parameters.stack_depth)),
+	fTeamNotificationsRequested(false),
+	fTimersActive(false)
+{
+}
+
+
+ContinuousProfiler::~ContinuousProfiler()
+{
+	// Once call_all_cpus() returns, no profiling timer can be running anymore.
+	if (fTimersActive)
+		call_all_cpus(_UninitTimers, this);
+
+	if (fTeamNotificationsRequested) {
+		NotificationManager::Manager().RemoveListener("teams", NULL, *this);
+		fTeamNotificationsRequested = false;
+	}
+
+	if (fKernelArea >= 0) {
+		unlock_memory(fHeader, fAreaSize, B_READ_DEVICE);
+		delete_area(fKernelArea);
+	}
+}
+
+
+status_t
+ContinuousProfiler::Init()
+{
+	// clone the user area
+	void* areaBase;
+	fKernelArea = clone_area("continuous profiler samples", &areaBase,
+		B_ANY_KERNEL_ADDRESS, B_READ_AREA | B_WRITE_AREA, fUserArea);
+	if (fKernelArea < 0)
+		return fKernelArea;
+
+	// The timers write to it with interrupts disabled.
+	status_t error = lock_memory(areaBase, fAreaSize, B_READ_DEVICE);
+	if (error != B_OK) {
+		delete_area(fKernelArea);
+		fKernelArea = -1;
+		return error;
+	}
+
+	fHeader = (continuous_profiler_header*)areaBase;
+
+	// Split what remains after the headers into power of two sized rings,
+	// one per CPU.
+	int32 cpuCount = smp_get_num_cpus();
+	size_t dataOffset = ROUNDUP(sizeof(continuous_profiler_header)
+			+ cpuCount * sizeof(continuous_profiler_ring),
+		B_CONTINUOUS_PROFILER_RING_ALIGNMENT);
+	if (dataOffset >= fAreaSize)
+		return B_BAD_VALUE;
+
+	size_t available = (fAreaSize - dataOffset) / cpuCount;
+	uint32 ringSize = kMinRingSize;
+	if (available < ringSize)
+		return B_BAD_VALUE;
+	while (ringSize <= available / 2 && ringSize < 0x40000000)
+		ringSize *= 2;
+
+	fRings = (continuous_profiler_ring*)(fHeader + 1);
+	fRingData = (uint8*)areaBase + dataOffset;
+	fRingSize = ringSize;
+
+	memset(fHeader, 0, dataOffset);
+	fHeader->cpu_count = cpuCount;
+	fHeader->ring_size = ringSize;
+	fHeader->data_offset = dataOffset;
+
+	// uninstall ourselves when the reader goes away without stopping us
+	error = NotificationManager::Manager().AddListener("teams", TEAM_REMOVED,
+		*this);
+	if (error != B_OK)
+		return error;
+	fTeamNotificationsRequested = true;
+
+	// start sampling
+	call_all_cpus(_InitTimers, this);
+	fTimersActive = true;
+
+	return B_OK;
+}
+
+
+/*static*/ void
+ContinuousProfiler::_InitTimers(void* cookie, int cpu)
+{
+	ContinuousProfiler* self = (ContinuousProfiler*)cookie;
+
+	CPUProfileData& cpuData = self->fCPUData[cpu];
+	cpuData.head = 0;
+	cpuData.timer.user_data = self;
+	add_timer(&cpuData.timer, &_ProfilingEvent, self->fInterval,
+		B_PERIODIC_TIMER);
+}
+
+
+/*static*/ void
+ContinuousProfiler::_UninitTimers(void* cookie, int cpu)
+{
+	ContinuousProfiler* self = (ContinuousProfiler*)cookie;
+	cancel_timer(&self->fCPUData[cpu].timer);
+}
+
+
+/*!	Appends a sample of the current thread to the ring of \a cpu.
+	Called with interrupts disabled from the profiling timer of that CPU, which
+	is the only writer of the ring.
+*/
+void
+ContinuousProfiler::_DoSample(int cpu)
+{
+	Thread* thread = thread_get_current_thread();
+	if ((fFlags & B_CONTINUOUS_PROFILER_IDLE_THREADS) == 0
+		&& thread_is_idle_thread(thread)) {
+		return;
+	}
+
+	CPUProfileData& cpuData = fCPUData[cpu];
+	continuous_profiler_ring& ring = fRings[cpu];
+	uint32 head = cpuData.head;
+	uint32 tail = (uint32)atomic_get(&ring.tail);
+
+	// Don't bother walking the stack, if the reader is lagging behind anyway.
+	// The worst case is a padding record plus a full sized sample.
+	if (head - tail > fRingSize - 2 * fMaxSampleSize) {
+		ring.dropped_samples++;
+		return;
+	}
+
+	uint32 traceFlags = STACK_TRACE_KERNEL;
+	if ((fFlags & B_CONTINUOUS_PROFILER_USER_STACKS) != 0)
+		traceFlags |= STACK_TRACE_USER;
+
+	int32 count = arch_debug_get_stack_trace(cpuData.buffer, fStackDepth, 1,
+		0, traceFlags);
+
+	// The kernel return addresses come first.
+	int32 kernelDepth = 0;
+	while (kernelDepth < count
+		&& IS_KERNEL_ADDRESS(cpuData.buffer[kernelDepth])) {
+		kernelDepth++;
+	}
+
+	addr_t* addresses = cpuData.buffer;
+	if ((fFlags & B_CONTINUOUS_PROFILER_KERNEL_STACKS) == 0) {
+		addresses += kernelDepth;
+		count -= kernelDepth;
+		kernelDepth = 0;
+	}
+
+	uint32 size = sample_size(count);
+	uint32 offset = head & (fRingSize - 1);
+
+	if (fRingSize - offset < size) {
+		// pad the rest of the ring and start over at its beginning
+		continuous_profiler_sample* padding
+			= (continuous_profiler_sample*)(fRingData + cpu * fRingSize
+				+ offset);
+		padding->size = fRingSize - offset;
+		padding->team = -1;
+		head += fRingSize - offset;
+		offset = 0;
+	}
+
+	continuous_profiler_sample* sample
+		= (continuous_profiler_sample*)(fRingData + cpu * fRingSize + offset);
+	sample->size = size;
+	sample->kernel_depth = kernelDepth;
+	sample->user_depth = count - kernelDepth;
+	sample->team = thread->team->id;
+	sample->thread = thread->id;
+	memcpy(sample->addresses, addresses, count * sizeof(addr_t));
+
+	// publish the record
+	cpuData.head = head + size;
+	atomic_set(&ring.head, (int32)cpuData.head);
+}
+
+
+// #pragma mark - NotificationListener interface
+
+
+void
+ContinuousProfiler::EventOccurred(NotificationService& service,
+	const KMessage* event)
+{
+	int32 eventCode;
+	if (event->FindInt32("event", &eventCode) != B_OK
+		|| eventCode != TEAM_REMOVED) {
+		return;
+	}
+
+	Team* team = (Team*)event->GetPointer("teamStruct", NULL);
+	if (team == NULL || team->id != fTeam)
+		return;
+
+	// The reading team is gone -- uninstall the profiler!
+	InterruptsSpinLocker locker(sContinuousProfilerLock);
+	if (sContinuousProfiler != this)
+		return;
+
+	sContinuousProfiler = NULL;
+	locker.Unlock();
+
+	ReleaseReference();
+}
+
+
+/*static*/ int32
+ContinuousProfiler::_ProfilingEvent(struct timer* timer)
+{
+	ContinuousProfiler* self = (ContinuousProfiler*)timer->user_data;
+	self->_DoSample(timer->cpu);
+
+	return B_HANDLED_INTERRUPT;
+}
+
+
+// #pragma mark - syscalls
+
+
+status_t
+_user_continuous_profiler_start(
+	struct continuous_profiler_parameters* userParameters)
+{
+	// copy params to the kernel
+	struct continuous_profiler_parameters parameters;
+	if (userParameters == NULL || !IS_USER_ADDRESS(userParameters)
+		|| user_memcpy(&parameters, userParameters, sizeof(parameters))
+			!= B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	// check the parameters
+	team_id team = thread_get_current_thread()->team->id;
+
+	area_info areaInfo;
+	status_t error = get_area_info(parameters.buffer_area, &areaInfo);
+	if (error != B_OK)
+		return error;
+
+	if (areaInfo.team != team)
+		return B_BAD_VALUE;
+
+	if ((parameters.flags & (B_CONTINUOUS_PROFILER_KERNEL_STACKS
+			| B_CONTINUOUS_PROFILER_USER_STACKS)) == 0
+		|| parameters.stack_depth < 1) {
+		return B_BAD_VALUE;
+	}
+
+	if (parameters.interval < B_DEBUG_MIN_PROFILE_INTERVAL)
+		parameters.interval = B_DEBUG_MIN_PROFILE_INTERVAL;
+
+	if (parameters.stack_depth > B_DEBUG_STACK_TRACE_DEPTH)
+		parameters.stack_depth = B_DEBUG_STACK_TRACE_DEPTH;
+
+	// quick check to see whether we do already have a profiler installed
+	InterruptsSpinLocker locker(sContinuousProfilerLock);
+	if (sContinuousProfiler != NULL)
+		return B_BUSY;
+	locker.Unlock();
+
+	ContinuousProfiler* profiler = new(std::nothrow) ContinuousProfiler(team,
+		areaInfo, parameters);
+	if (profiler == NULL)
+		return B_NO_MEMORY;
+	ObjectDeleter<ContinuousProfiler> profilerDeleter(profiler);
+
+	error = profiler->Init();
+	if (error != B_OK)
+		return error;
+
+	// set the new profiler
+	locker.Lock();
+	if (sContinuousProfiler != NULL)
+		return B_BUSY;
+
+	sContinuousProfiler = profilerDeleter.Detach();
+	locker.Unlock();
+
+	return B_OK;
+}
+
+
+status_t
+_user_continuous_profiler_stop()
+{
+	team_id team = thread_get_current_thread()->team->id;
+
+	InterruptsSpinLocker locker(sContinuousProfilerLock);
+	if (sContinuousProfiler == NULL || sContinuousProfiler->TeamID() != team)
+		return B_BAD_VALUE;
+
+	ContinuousProfiler* profiler = sContinuousProfiler;
+	sContinuousProfiler = NULL;
+	locker.Unlock();
+
+	profiler->ReleaseReference();
+
+	return B_OK;
+}
@@ -1702,7 +1702,7 @@ debug_init_post_vm(kernel_args* args)
 	debug_variables_init();
 	frame_buffer_console_init(args);
 	arch_debug_console_init_settings(args);
-	tracing_init();
+	tracing_init(args);
 }
 
 
@@ -1884,7 +1884,8 @@ debug_is_kernel_memory_accessible(addr_t address, size_t size,
 
 
 /*!	Calls a function in a setjmp() + fault handler context.
-	May only be used in the kernel debugger.
+	May only be used in the kernel debugger, or, on x86, with interrupts
+	disabled.
 
 	\param jumpBuffer Buffer to be used for setjmp()/longjmp().
 	\param function The function to be called.
@@ -1900,7 +1901,7 @@ debug_call_with_fault_handler(jmp_buf jumpBuffer, void (*function)(void*),
 	void* parameter)
 {
 	// save current fault handler
-	cpu_ent* cpu = gCPU + sDebuggerOnCPU;
+	cpu_ent* cpu = gCPU + smp_get_current_cpu();
 	addr_t oldFaultHandler = cpu->fault_handler;
 	addr_t oldFaultHandlerStackPointer = cpu->fault_handler_stack_pointer;
 
@@ -105,6 +105,8 @@ private:
 			void				_WaitObjectCreated(addr_t object, uint32 type);
 			void				_WaitObjectUsed(addr_t object, uint32 type);
 
+			void				_RecordICIStats();
+
 	inline	void				_MaybeNotifyProfilerThreadLocked();
 	inline	void				_MaybeNotifyProfilerThread();
 
@@ -534,6 +536,12 @@ SystemProfiler::Init()
 		fIONotificationsEnabled = true;
 	}
 
+	// initial ICI counters
+	if ((fFlags & B_SYSTEM_PROFILER_ICI_EVENTS) != 0) {
+		InterruptsSpinLocker locker(fLock);
+		_RecordICIStats();
+	}
+
 	// activate the profiling timers on all CPUs
 	if ((fFlags & B_SYSTEM_PROFILER_SAMPLING_EVENTS) != 0)
 		call_all_cpus(_InitTimers, this);
@@ -559,6 +567,9 @@ SystemProfiler::NextBuffer(size_t bytesRead, uint64* _droppedEvents)
 	fHeader->size = fBufferSize;
 	fHeader->start = fBufferStart;
 
+	if ((fFlags & B_SYSTEM_PROFILER_ICI_EVENTS) != 0)
+		_RecordICIStats();
+
 	// already enough data in the buffer to return?
 	if (fBufferSize > fBufferCapacity / 2)
 		return B_OK;
@@ -1315,6 +1326,40 @@ SystemProfiler::_WaitObjectUsed(addr_t object, uint32 type)
 }
 
 
+/*!	Records the current ICI counters of all CPUs.
+	The caller must hold fLock.
+*/
+void
+SystemProfiler::_RecordICIStats()
+{
+	nanotime_t time = system_time_nsecs();
+
+	int32 cpuCount = smp_get_num_cpus();
+	for (int32 i = 0; i < cpuCount; i++) {
+		system_profiler_ici_stats* event = (system_profiler_ici_stats*)
+			_AllocateBuffer(sizeof(system_profiler_ici_stats),
+				B_SYSTEM_PROFILER_ICI_STATS, i, 0);
+		if (event == NULL)
+			return;
+
+		smp_ici_stats stats;
+		smp_get_ici_stats(i, &stats);
+
+		event->time = time;
+		event->cpu = i;
+		event->sent = stats.sent;
+		event->sent_tlb = stats.sent_tlb;
+		event->received = stats.received;
+		event->received_tlb = stats.received_tlb;
+		event->sync_waits = stats.sync_waits;
+		event->sync_wait_time = stats.sync_wait_time;
+		event->max_sync_wait_time = stats.max_sync_wait_time;
+	}
+
+	fHeader->size = fBufferSize;
+}
+
+
 /*static*/ bool
 SystemProfiler::_InitialImageIterator(struct image* image, void* cookie)
 {
@@ -1484,7 +1529,7 @@ start_system_profiler(size_t areaSize, uint32 stackDepth, bigtime_t interval)
 	sRecordedParameters->flags = B_SYSTEM_PROFILER_TEAM_EVENTS
 		| B_SYSTEM_PROFILER_THREAD_EVENTS | B_SYSTEM_PROFILER_IMAGE_EVENTS
 		| B_SYSTEM_PROFILER_IO_SCHEDULING_EVENTS
-		| B_SYSTEM_PROFILER_SAMPLING_EVENTS;
+		| B_SYSTEM_PROFILER_SAMPLING_EVENTS | B_SYSTEM_PROFILER_ICI_EVENTS;
 	sRecordedParameters->locking_lookup_size = 4096;
 	sRecordedParameters->interval = interval;
 	sRecordedParameters->stack_depth = stackDepth;
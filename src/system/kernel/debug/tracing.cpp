@@ -9,15 +9,20 @@
 #include <tracing.h>
 
 #include <stdlib.h>
+#include <unistd.h>
 
 #include <algorithm>
 
+#include <AutoDeleter.h>
+
 #include <arch/debug.h>
+#include <cpu.h>
 #include <debug.h>
 #include <debug_heap.h>
 #include <elf.h>
 #include <int.h>
 #include <kernel.h>
+#include <lock.h>
 #include <team.h>
 #include <thread.h>
 #include <util/AutoLock.h>
@@ -45,7 +50,6 @@ enum {
 
 
 static const size_t kTraceOutputBufferSize = 10240;
-static const size_t kBufferSize = MAX_TRACE_SIZE / sizeof(trace_entry);
 
 static const uint32 kMaxRecoveringErrorCount	= 100;
 static const addr_t kMetaDataBaseAddress		= 32 * 1024 * 1024;
@@ -80,11 +84,17 @@ private:
 };
 
 
-class TracingMetaData {
+/*!	The ring of trace entries of one CPU. Entries are only ever allocated by
+	the CPU owning the buffer, with interrupts disabled. The lock only
+	serializes that with readers walking the buffer outside of the kernel
+	debugger, so it is practically never contended.
+*/
+class TraceBuffer {
 public:
-	static	status_t			Create(TracingMetaData*& _metaData);
+			void				Init(trace_entry* buffer, size_t size);
+			bool				Recover(trace_entry* buffer, size_t size);
 
-	inline	bool				Lock();
+	inline	void				Lock();
 	inline	void				Unlock();
 
 	inline	trace_entry*		FirstEntry() const;
@@ -92,10 +102,10 @@ public:
 
 	inline	uint32				Entries() const;
 	inline	uint32				EntriesEver() const;
+	inline	uint32				Allocations() const;
+	inline	uint32				Frees() const;
 
-	inline	void				IncrementEntriesEver();
-
-	inline	char*				TraceOutputBuffer() const;
+	inline	trace_entry*		Buffer() const;
 
 			trace_entry*		NextEntry(trace_entry* entry);
 			trace_entry*		PreviousEntry(trace_entry* entry);
@@ -108,25 +118,64 @@ private:
 			bool				_FreeFirstEntry();
 			bool				_MakeSpace(size_t needed);
 
+private:
+			trace_entry*		fBuffer;
+			size_t				fSize;
+				// in trace_entry units
+			trace_entry*		fFirstEntry;
+			trace_entry*		fAfterLastEntry;
+			uint32				fEntries;
+			uint32				fEntriesEver;
+			uint32				fAllocations;
+			uint32				fFrees;
+				// all entries allocated/freed so far, including buffer
+				// entries; used by the live reader to validate its position
+			spinlock			fLock;
+} CACHE_LINE_ALIGN;
+
+
+class TracingMetaData {
+public:
+	static	status_t			Create(int32 bufferCount,
+									TracingMetaData*& _metaData);
+
+	inline	int32				BufferCount() const;
+	inline	TraceBuffer&		BufferAt(int32 index);
+
+			void				LockAll();
+			void				UnlockAll();
+
+			uint32				Entries() const;
+			uint32				EntriesEver() const;
+
+	inline	char*				TraceOutputBuffer() const;
+
+			trace_entry*		AllocateEntry(size_t size, uint16 flags);
+
+			bool				IsInBuffer(void* address, size_t size);
+			TraceBuffer*		BufferFor(void* address, size_t size);
+
+private:
 	static	status_t			_CreateMetaDataArea(bool findPrevious,
 									area_id& _area,
 									TracingMetaData*& _metaData);
 			bool				_InitPreviousTracingData();
 
+	static	size_t				_BufferSize(int32 bufferCount);
+
 private:
 			uint32				fMagic1;
-			trace_entry*		fBuffer;
-			trace_entry*		fFirstEntry;
-			trace_entry*		fAfterLastEntry;
-			uint32				fEntries;
+			int32				fBufferCount;
 			uint32				fMagic2;
-			uint32				fEntriesEver;
-			spinlock			fLock;
 			char*				fTraceOutputBuffer;
 			phys_addr_t			fPhysicalAddress;
 			uint32				fMagic3;
+			TraceBuffer			fBuffers[SMP_MAX_CPUS];
 };
 
+static const size_t kMetaDataSize
+	= ROUNDUP(sizeof(TracingMetaData), B_PAGE_SIZE);
+
 static TracingMetaData sFallbackTracingMetaData;
 static TracingMetaData* sTracingMetaData = &sFallbackTracingMetaData;
 static bool sTracingDataRecovered = false;
@@ -177,71 +226,96 @@ print_stack_trace(struct tracing_stack_trace* stackTrace,
 }
 
 
-// #pragma mark - TracingMetaData
+static inline bigtime_t
+entry_timestamp(trace_entry* entry)
+{
+	return *(bigtime_t*)(entry + 1);
+}
 
 
-bool
-TracingMetaData::Lock()
+// #pragma mark - TraceBuffer
+
+
+void
+TraceBuffer::Init(trace_entry* buffer, size_t size)
+{
+	fBuffer = buffer;
+	fSize = size;
+	fFirstEntry = buffer;
+	fAfterLastEntry = buffer;
+	fEntries = 0;
+	fEntriesEver = 0;
+	fAllocations = 0;
+	fFrees = 0;
+	B_INITIALIZE_SPINLOCK(&fLock);
+}
+
+
+void
+TraceBuffer::Lock()
 {
 	acquire_spinlock(&fLock);
-	return true;
 }
 
 
 void
-TracingMetaData::Unlock()
+TraceBuffer::Unlock()
 {
 	release_spinlock(&fLock);
 }
 
 
 trace_entry*
-TracingMetaData::FirstEntry() const
+TraceBuffer::FirstEntry() const
 {
 	return fFirstEntry;
 }
 
 
 trace_entry*
-TracingMetaData::AfterLastEntry() const
+TraceBuffer::AfterLastEntry() const
 {
 	return fAfterLastEntry;
 }
 
 
 uint32
-TracingMetaData::Entries() const
+TraceBuffer::Entries() const
 {
 	return fEntries;
 }
 
 
 uint32
-TracingMetaData::EntriesEver() const
+TraceBuffer::EntriesEver() const
 {
 	return fEntriesEver;
 }
 
 
-void
-TracingMetaData::IncrementEntriesEver()
+uint32
+TraceBuffer::Allocations() const
 {
-	fEntriesEver++;
-		// NOTE: Race condition on SMP machines! We should use atomic_add(),
-		// though that costs some performance and the information is for
-		// informational purpose anyway.
+	return fAllocations;
 }
 
 
-char*
-TracingMetaData::TraceOutputBuffer() const
+uint32
+TraceBuffer::Frees() const
 {
-	return fTraceOutputBuffer;
+	return fFrees;
 }
 
 
 trace_entry*
-TracingMetaData::NextEntry(trace_entry* entry)
+TraceBuffer::Buffer() const
+{
+	return fBuffer;
+}
+
+
+trace_entry*
+TraceBuffer::NextEntry(trace_entry* entry)
 {
 	entry += entry->size;
 	if ((entry->flags & WRAP_ENTRY) != 0)
@@ -255,29 +329,26 @@ TracingMetaData::NextEntry(trace_entry* entry)
 
 
 trace_entry*
-TracingMetaData::PreviousEntry(trace_entry* entry)
+TraceBuffer::PreviousEntry(trace_entry* entry)
 {
 	if (entry == fFirstEntry)
 		return NULL;
 
 	if (entry == fBuffer) {
 		// beginning of buffer -- previous entry is a wrap entry
-		entry = fBuffer + kBufferSize - entry->previous_size;
+		entry = fBuffer + fSize - entry->previous_size;
 	}
 
 	return entry - entry->previous_size;
 }
 
 
+/*!	Must be called with interrupts disabled on the CPU owning the buffer.
+*/
 trace_entry*
-TracingMetaData::AllocateEntry(size_t size, uint16 flags)
+TraceBuffer::AllocateEntry(size_t size, uint16 flags)
 {
-	if (fAfterLastEntry == NULL || size == 0
-		|| size >= kMaxTracingEntryByteSize) {
-		return NULL;
-	}
-
-	InterruptsSpinLocker _(fLock);
+	SpinLocker _(fLock);
 
 	size = (size + 3) >> 2;
 		// 4 byte aligned, don't store the lower 2 bits
@@ -293,9 +364,13 @@ TracingMetaData::AllocateEntry(size_t size, uint16 flags)
 	entry->flags = flags;
 	fAfterLastEntry += size;
 	fAfterLastEntry->previous_size = size;
+	fAllocations++;
 
-	if (!(flags & BUFFER_ENTRY))
+	if (!(flags & BUFFER_ENTRY)) {
+		*(bigtime_t*)(entry + 1) = system_time();
 		fEntries++;
+		fEntriesEver++;
+	}
 
 	TRACE(("  entry: %p, end %p, start %p, entries %ld\n", entry,
 		fAfterLastEntry, fFirstEntry, fEntries));
@@ -305,7 +380,7 @@ TracingMetaData::AllocateEntry(size_t size, uint16 flags)
 
 
 bool
-TracingMetaData::IsInBuffer(void* address, size_t size)
+TraceBuffer::IsInBuffer(void* address, size_t size)
 {
 	if (fEntries == 0)
 		return false;
@@ -313,7 +388,7 @@ TracingMetaData::IsInBuffer(void* address, size_t size)
 	addr_t start = (addr_t)address;
 	addr_t end = start + size;
 
-	if (start < (addr_t)fBuffer || end > (addr_t)(fBuffer + kBufferSize))
+	if (start < (addr_t)fBuffer || end > (addr_t)(fBuffer + fSize))
 		return false;
 
 	if (fFirstEntry > fAfterLastEntry)
@@ -324,7 +399,7 @@ TracingMetaData::IsInBuffer(void* address, size_t size)
 
 
 bool
-TracingMetaData::_FreeFirstEntry()
+TraceBuffer::_FreeFirstEntry()
 {
 	TRACE(("  skip start %p, %lu*4 bytes\n", fFirstEntry, fFirstEntry->size));
 
@@ -345,6 +420,8 @@ TracingMetaData::_FreeFirstEntry()
 		return false;
 	}
 
+	fFrees++;
+
 	if (newFirst == NULL) {
 		// everything is freed -- practically this can't happen, if
 		// the buffer is large enough to hold three max-sized entries
@@ -361,7 +438,7 @@ TracingMetaData::_FreeFirstEntry()
 	Returns \c false, if unable to free that much.
 */
 bool
-TracingMetaData::_MakeSpace(size_t needed)
+TraceBuffer::_MakeSpace(size_t needed)
 {
 	// we need space for fAfterLastEntry, too (in case we need to wrap around
 	// later)
@@ -369,7 +446,7 @@ TracingMetaData::_MakeSpace(size_t needed)
 
 	// If there's not enough space (free or occupied) after fAfterLastEntry,
 	// we free all entries in that region and wrap around.
-	if (fAfterLastEntry + needed > fBuffer + kBufferSize) {
+	if (fAfterLastEntry + needed > fBuffer + fSize) {
 		TRACE(("_MakeSpace(%lu), wrapping around: after last: %p\n", needed,
 			fAfterLastEntry));
 
@@ -391,7 +468,7 @@ TracingMetaData::_MakeSpace(size_t needed)
 		wrapEntry->size = 0;
 		wrapEntry->flags = WRAP_ENTRY;
 		fAfterLastEntry = fBuffer;
-		fAfterLastEntry->previous_size = fBuffer + kBufferSize - wrapEntry;
+		fAfterLastEntry->previous_size = fBuffer + fSize - wrapEntry;
 	}
 
 	if (fFirstEntry <= fAfterLastEntry) {
@@ -419,15 +496,241 @@ TracingMetaData::_MakeSpace(size_t needed)
 }
 
 
+/*!	Verifies and repairs the entry list of a buffer from a previous session.
+*/
+bool
+TraceBuffer::Recover(trace_entry* buffer, size_t size)
+{
+	if (fBuffer != buffer || fSize != size
+		|| (addr_t)fFirstEntry % sizeof(trace_entry) != 0
+		|| fFirstEntry < fBuffer
+		|| fFirstEntry + 1 >= fBuffer + fSize
+		|| (addr_t)fAfterLastEntry % sizeof(trace_entry) != 0
+		|| fAfterLastEntry < fBuffer
+		|| fAfterLastEntry > fBuffer + fSize) {
+		dprintf("Failed to init tracing meta data: Sanity checks "
+			"failed.\n");
+		return false;
+	}
+
+	// verify/repair the tracing entry list
+	uint32 errorCount = 0;
+	uint32 entryCount = 0;
+	uint32 nonBufferEntryCount = 0;
+	uint32 previousEntrySize = 0;
+	trace_entry* entry = fFirstEntry;
+	while (errorCount <= kMaxRecoveringErrorCount) {
+		// check previous entry size
+		if (entry->previous_size != previousEntrySize) {
+			if (entry != fFirstEntry) {
+				dprintf("ktrace recovering: entry %p: fixing previous_size "
+					"size: %" B_PRIu32 " (should be %" B_PRIu32 ")\n", entry,
+					entry->previous_size, previousEntrySize);
+				errorCount++;
+			}
+			entry->previous_size = previousEntrySize;
+		}
+
+		if (entry == fAfterLastEntry)
+			break;
+
+		// check size field
+		if ((entry->flags & WRAP_ENTRY) == 0 && entry->size == 0) {
+			dprintf("ktrace recovering: entry %p: non-wrap entry size is 0\n",
+				entry);
+			errorCount++;
+			fAfterLastEntry = entry;
+			break;
+		}
+
+		if (entry->size > uint32(fBuffer + fSize - entry)) {
+			dprintf("ktrace recovering: entry %p: size too big: %" B_PRIu32 "\n",
+				entry, entry->size);
+			errorCount++;
+			fAfterLastEntry = entry;
+			break;
+		}
+
+		if (entry < fAfterLastEntry && entry + entry->size > fAfterLastEntry) {
+			dprintf("ktrace recovering: entry %p: entry crosses "
+				"fAfterLastEntry (%p)\n", entry, fAfterLastEntry);
+			errorCount++;
+			fAfterLastEntry = entry;
+			break;
+		}
+
+		// check for wrap entry
+		if ((entry->flags & WRAP_ENTRY) != 0) {
+			if ((uint32)(fBuffer + fSize - entry)
+					> kMaxTracingEntryByteSize / sizeof(trace_entry)) {
+				dprintf("ktrace recovering: entry %p: wrap entry at invalid "
+					"buffer location\n", entry);
+				errorCount++;
+			}
+
+			if (entry->size != 0) {
+				dprintf("ktrace recovering: entry %p: invalid wrap entry "
+					"size: %" B_PRIu32 "\n", entry, entry->size);
+				errorCount++;
+				entry->size = 0;
+			}
+
+			previousEntrySize = fBuffer + fSize - entry;
+			entry = fBuffer;
+			continue;
+		}
+
+		if ((entry->flags & BUFFER_ENTRY) == 0) {
+			entry->flags |= CHECK_ENTRY;
+			nonBufferEntryCount++;
+		}
+
+		entryCount++;
+		previousEntrySize = entry->size;
+
+		entry += entry->size;
+	}
+
+	if (errorCount > kMaxRecoveringErrorCount) {
+		dprintf("ktrace recovering: Too many errors.\n");
+		fAfterLastEntry = entry;
+		fAfterLastEntry->previous_size = previousEntrySize;
+	}
+
+	dprintf("ktrace recovering: Recovered %" B_PRIu32 " entries + %" B_PRIu32
+		" buffer entries from previous session. Expected %" B_PRIu32
+		" entries.\n", nonBufferEntryCount, entryCount - nonBufferEntryCount,
+		fEntries);
+	fEntries = nonBufferEntryCount;
+	fAllocations = entryCount;
+	fFrees = 0;
+
+	B_INITIALIZE_SPINLOCK(&fLock);
+	return true;
+}
+
+
+// #pragma mark - TracingMetaData
+
+
+int32
+TracingMetaData::BufferCount() const
+{
+	return fBufferCount;
+}
+
+
+TraceBuffer&
+TracingMetaData::BufferAt(int32 index)
+{
+	return fBuffers[index];
+}
+
+
+/*!	Locks all buffers. Interrupts must be disabled.
+*/
+void
+TracingMetaData::LockAll()
+{
+	for (int32 i = 0; i < fBufferCount; i++)
+		fBuffers[i].Lock();
+}
+
+
+void
+TracingMetaData::UnlockAll()
+{
+	for (int32 i = fBufferCount - 1; i >= 0; i--)
+		fBuffers[i].Unlock();
+}
+
+
+uint32
+TracingMetaData::Entries() const
+{
+	uint32 entries = 0;
+	for (int32 i = 0; i < fBufferCount; i++)
+		entries += fBuffers[i].Entries();
+	return entries;
+}
+
+
+uint32
+TracingMetaData::EntriesEver() const
+{
+	uint32 entries = 0;
+	for (int32 i = 0; i < fBufferCount; i++)
+		entries += fBuffers[i].EntriesEver();
+	return entries;
+}
+
+
+char*
+TracingMetaData::TraceOutputBuffer() const
+{
+	return fTraceOutputBuffer;
+}
+
+
+trace_entry*
+TracingMetaData::AllocateEntry(size_t size, uint16 flags)
+{
+	if (fBufferCount == 0 || size == 0 || size >= kMaxTracingEntryByteSize)
+		return NULL;
+
+	InterruptsLocker _;
+
+	// Before the threading system is up, only the boot CPU is running.
+	Thread* thread = thread_get_current_thread();
+	int32 index = thread != NULL && thread->cpu != NULL
+		? thread->cpu->cpu_num : 0;
+	if (index >= fBufferCount)
+		return NULL;
+
+	return fBuffers[index].AllocateEntry(size, flags);
+}
+
+
+bool
+TracingMetaData::IsInBuffer(void* address, size_t size)
+{
+	return BufferFor(address, size) != NULL;
+}
+
+
+TraceBuffer*
+TracingMetaData::BufferFor(void* address, size_t size)
+{
+	for (int32 i = 0; i < fBufferCount; i++) {
+		if (fBuffers[i].IsInBuffer(address, size))
+			return &fBuffers[i];
+	}
+
+	return NULL;
+}
+
+
+/*static*/ size_t
+TracingMetaData::_BufferSize(int32 bufferCount)
+{
+	// split the tracing log among the CPUs
+	return MAX_TRACE_SIZE / bufferCount / sizeof(trace_entry);
+}
+
+
 /*static*/ status_t
-TracingMetaData::Create(TracingMetaData*& _metaData)
+TracingMetaData::Create(int32 bufferCount, TracingMetaData*& _metaData)
 {
+	if (bufferCount > SMP_MAX_CPUS)
+		bufferCount = SMP_MAX_CPUS;
+
 	// search meta data in memory (from previous session)
 	area_id area;
 	TracingMetaData* metaData;
 	status_t error = _CreateMetaDataArea(true, area, metaData);
 	if (error == B_OK) {
-		if (metaData->_InitPreviousTracingData()) {
+		if (metaData->fBufferCount == bufferCount
+			&& metaData->_InitPreviousTracingData()) {
 			_metaData = metaData;
 			return B_OK;
 		}
@@ -469,14 +772,12 @@ TracingMetaData::Create(TracingMetaData*& _metaData)
 		metaData->fPhysicalAddress = 0;
 	}
 
-	metaData->fBuffer = (trace_entry*)(metaData->fTraceOutputBuffer
+	trace_entry* buffer = (trace_entry*)(metaData->fTraceOutputBuffer
 		+ kTraceOutputBufferSize);
-	metaData->fFirstEntry = metaData->fBuffer;
-	metaData->fAfterLastEntry = metaData->fBuffer;
-
-	metaData->fEntries = 0;
-	metaData->fEntriesEver = 0;
-	B_INITIALIZE_SPINLOCK(&metaData->fLock);
+	size_t bufferSize = _BufferSize(bufferCount);
+	for (int32 i = 0; i < bufferCount; i++)
+		metaData->fBuffers[i].Init(buffer + i * bufferSize, bufferSize);
+	metaData->fBufferCount = bufferCount;
 
 	metaData->fMagic1 = kMetaDataMagic1;
 	metaData->fMagic2 = kMetaDataMagic2;
@@ -500,11 +801,12 @@ TracingMetaData::_CreateMetaDataArea(bool findPrevious, area_id& _area,
 		virtualRestrictions.address_specification = B_ANY_KERNEL_ADDRESS;
 		physical_address_restrictions physicalRestrictions = {};
 		physicalRestrictions.low_address = metaDataAddress;
-		physicalRestrictions.high_address = metaDataAddress + B_PAGE_SIZE;
+		physicalRestrictions.high_address = metaDataAddress + kMetaDataSize;
 		area_id area = create_area_etc(B_SYSTEM_TEAM, "tracing metadata",
-			B_PAGE_SIZE, B_FULL_LOCK, B_KERNEL_READ_AREA | B_KERNEL_WRITE_AREA,
-			CREATE_AREA_DONT_CLEAR, 0, &virtualRestrictions,
-			&physicalRestrictions, (void**)&metaData);
+			kMetaDataSize, B_CONTIGUOUS,
+			B_KERNEL_READ_AREA | B_KERNEL_WRITE_AREA, CREATE_AREA_DONT_CLEAR,
+			0, &virtualRestrictions, &physicalRestrictions,
+			(void**)&metaData);
 		if (area < 0)
 			continue;
 
@@ -552,14 +854,8 @@ TracingMetaData::_InitPreviousTracingData()
 		= (addr_t)fTraceOutputBuffer + kTraceOutputBufferSize;
 	addr_t bufferEnd = bufferStart + MAX_TRACE_SIZE;
 
-	if (bufferStart > bufferEnd || (addr_t)fBuffer != bufferStart
-		|| (addr_t)fFirstEntry % sizeof(trace_entry) != 0
-		|| (addr_t)fFirstEntry < bufferStart
-		|| (addr_t)fFirstEntry + sizeof(trace_entry) >= bufferEnd
-		|| (addr_t)fAfterLastEntry % sizeof(trace_entry) != 0
-		|| (addr_t)fAfterLastEntry < bufferStart
-		|| (addr_t)fAfterLastEntry > bufferEnd
-		|| fPhysicalAddress == 0) {
+	if (bufferStart > bufferEnd || fBufferCount <= 0
+		|| fBufferCount > SMP_MAX_CPUS || fPhysicalAddress == 0) {
 		dprintf("Failed to init tracing meta data: Sanity checks "
 			"failed.\n");
 		return false;
@@ -586,98 +882,15 @@ TracingMetaData::_InitPreviousTracingData()
 	dprintf("ktrace: Remapped tracing buffer at %p, size: %" B_PRIuSIZE "\n",
 		fTraceOutputBuffer, kTraceOutputBufferSize + MAX_TRACE_SIZE);
 
-	// verify/repair the tracing entry list
-	uint32 errorCount = 0;
-	uint32 entryCount = 0;
-	uint32 nonBufferEntryCount = 0;
-	uint32 previousEntrySize = 0;
-	trace_entry* entry = fFirstEntry;
-	while (errorCount <= kMaxRecoveringErrorCount) {
-		// check previous entry size
-		if (entry->previous_size != previousEntrySize) {
-			if (entry != fFirstEntry) {
-				dprintf("ktrace recovering: entry %p: fixing previous_size "
-					"size: %" B_PRIu32 " (should be %" B_PRIu32 ")\n", entry,
-					entry->previous_size, previousEntrySize);
-				errorCount++;
-			}
-			entry->previous_size = previousEntrySize;
-		}
-
-		if (entry == fAfterLastEntry)
-			break;
-
-		// check size field
-		if ((entry->flags & WRAP_ENTRY) == 0 && entry->size == 0) {
-			dprintf("ktrace recovering: entry %p: non-wrap entry size is 0\n",
-				entry);
-			errorCount++;
-			fAfterLastEntry = entry;
-			break;
-		}
-
-		if (entry->size > uint32(fBuffer + kBufferSize - entry)) {
-			dprintf("ktrace recovering: entry %p: size too big: %" B_PRIu32 "\n",
-				entry, entry->size);
-			errorCount++;
-			fAfterLastEntry = entry;
-			break;
-		}
-
-		if (entry < fAfterLastEntry && entry + entry->size > fAfterLastEntry) {
-			dprintf("ktrace recovering: entry %p: entry crosses "
-				"fAfterLastEntry (%p)\n", entry, fAfterLastEntry);
-			errorCount++;
-			fAfterLastEntry = entry;
-			break;
-		}
-
-		// check for wrap entry
-		if ((entry->flags & WRAP_ENTRY) != 0) {
-			if ((uint32)(fBuffer + kBufferSize - entry)
-					> kMaxTracingEntryByteSize / sizeof(trace_entry)) {
-				dprintf("ktrace recovering: entry %p: wrap entry at invalid "
-					"buffer location\n", entry);
-				errorCount++;
-			}
-
-			if (entry->size != 0) {
-				dprintf("ktrace recovering: entry %p: invalid wrap entry "
-					"size: %" B_PRIu32 "\n", entry, entry->size);
-				errorCount++;
-				entry->size = 0;
-			}
-
-			previousEntrySize = fBuffer + kBufferSize - entry;
-			entry = fBuffer;
-			continue;
-		}
-
-		if ((entry->flags & BUFFER_ENTRY) == 0) {
-			entry->flags |= CHECK_ENTRY;
-			nonBufferEntryCount++;
+	size_t bufferSize = _BufferSize(fBufferCount);
+	for (int32 i = 0; i < fBufferCount; i++) {
+		if (!fBuffers[i].Recover((trace_entry*)bufferStart + i * bufferSize,
+				bufferSize)) {
+			delete_area(area);
+			return false;
 		}
-
-		entryCount++;
-		previousEntrySize = entry->size;
-
-		entry += entry->size;
-	}
-
-	if (errorCount > kMaxRecoveringErrorCount) {
-		dprintf("ktrace recovering: Too many errors.\n");
-		fAfterLastEntry = entry;
-		fAfterLastEntry->previous_size = previousEntrySize;
 	}
 
-	dprintf("ktrace recovering: Recovered %" B_PRIu32 " entries + %" B_PRIu32
-		" buffer entries from previous session. Expected %" B_PRIu32
-		" entries.\n", nonBufferEntryCount, entryCount - nonBufferEntryCount,
-		fEntries);
-	fEntries = nonBufferEntryCount;
-
-	B_INITIALIZE_SPINLOCK(&fLock);
-
 	// TODO: Actually check the entries! Do that when first accessing the
 	// tracing buffer from the kernel debugger (when sTracingDataRecovered is
 	// true).
@@ -780,7 +993,10 @@ TraceEntry::Initialized()
 {
 #if ENABLE_TRACING
 	ToTraceEntry()->flags |= ENTRY_INITIALIZED;
-	sTracingMetaData->IncrementEntriesEver();
+
+	Thread* thread = thread_get_current_thread();
+	if (thread != NULL)
+		thread_unpin_from_current_cpu(thread);
 #endif
 }
 
@@ -789,9 +1005,22 @@ void*
 TraceEntry::operator new(size_t size, const std::nothrow_t&) throw()
 {
 #if ENABLE_TRACING
+	// Stay on this CPU until the entry is initialized, so that the buffers
+	// the constructor allocates end up in the same per-CPU buffer as the
+	// entry and aren't overwritten before it.
+	Thread* thread = thread_get_current_thread();
+	if (thread != NULL)
+		thread_pin_to_current_cpu(thread);
+
 	trace_entry* entry = sTracingMetaData->AllocateEntry(
-		size + sizeof(trace_entry), 0);
-	return entry != NULL ? entry + 1 : NULL;
+		size + sizeof(trace_entry) + sizeof(bigtime_t), 0);
+	if (entry == NULL) {
+		if (thread != NULL)
+			thread_unpin_from_current_cpu(thread);
+		return NULL;
+	}
+
+	return TraceEntry::FromTraceEntry(entry);
 #endif
 	return NULL;
 }
@@ -1205,13 +1434,36 @@ TraceEntry*
 TraceEntryIterator::Next()
 {
 	if (fIndex == 0) {
-		fEntry = _NextNonBufferEntry(sTracingMetaData->FirstEntry());
-		fIndex = 1;
-	} else if (fEntry != NULL) {
-		fEntry = _NextNonBufferEntry(sTracingMetaData->NextEntry(fEntry));
-		fIndex++;
+		for (int32 i = 0; i < sTracingMetaData->BufferCount(); i++) {
+			TraceBuffer& buffer = sTracingMetaData->BufferAt(i);
+			fNext[i] = buffer.Entries() > 0
+				? _NextNonBufferEntry(i, buffer.FirstEntry()) : NULL;
+		}
+	} else if (fEntry == NULL)
+		return NULL;
+
+	// pick the oldest of the buffers' next entries
+	int32 selected = -1;
+	for (int32 i = 0; i < sTracingMetaData->BufferCount(); i++) {
+		if (fNext[i] != NULL && (selected < 0
+				|| entry_timestamp(fNext[i])
+					< entry_timestamp(fNext[selected]))) {
+			selected = i;
+		}
+	}
+
+	fIndex++;
+
+	if (selected < 0) {
+		fEntry = NULL;
+		return NULL;
 	}
 
+	TraceBuffer& buffer = sTracingMetaData->BufferAt(selected);
+	fEntry = fNext[selected];
+	fEntryBuffer = selected;
+	fNext[selected] = _NextNonBufferEntry(selected, buffer.NextEntry(fEntry));
+
 	return Current();
 }
 
@@ -1220,12 +1472,29 @@ TraceEntry*
 TraceEntryIterator::Previous()
 {
 	if (fIndex == (int32)sTracingMetaData->Entries() + 1)
-		fEntry = sTracingMetaData->AfterLastEntry();
+		_SetToEnd();
+	else if (fEntry != NULL)
+		fNext[fEntryBuffer] = fEntry;
+	else
+		return NULL;
+
+	fIndex--;
+
+	// pick the newest of the entries preceding the buffers' next entries
+	fEntry = NULL;
+	for (int32 i = 0; i < sTracingMetaData->BufferCount(); i++) {
+		TraceBuffer& buffer = sTracingMetaData->BufferAt(i);
+		if (buffer.Entries() == 0)
+			continue;
 
-	if (fEntry != NULL) {
-		fEntry = _PreviousNonBufferEntry(
-			sTracingMetaData->PreviousEntry(fEntry));
-		fIndex--;
+		trace_entry* entry = _PreviousNonBufferEntry(i,
+			buffer.PreviousEntry(fNext[i] != NULL
+				? fNext[i] : buffer.AfterLastEntry()));
+		if (entry != NULL && (fEntry == NULL
+				|| entry_timestamp(entry) >= entry_timestamp(fEntry))) {
+			fEntry = entry;
+			fEntryBuffer = i;
+		}
 	}
 
 	return Current();
@@ -1239,8 +1508,10 @@ TraceEntryIterator::MoveTo(int32 index)
 		return Current();
 
 	if (index <= 0 || index > (int32)sTracingMetaData->Entries()) {
-		fIndex = (index <= 0 ? 0 : sTracingMetaData->Entries() + 1);
-		fEntry = NULL;
+		if (index <= 0)
+			Reset();
+		else
+			_SetToEnd();
 		return NULL;
 	}
 
@@ -1252,14 +1523,12 @@ TraceEntryIterator::MoveTo(int32 index)
 	if (index < distance) {
 		distance = index;
 		direction = 1;
-		fEntry = NULL;
-		fIndex = 0;
+		Reset();
 	}
 	if ((int32)sTracingMetaData->Entries() + 1 - fIndex < distance) {
 		distance = sTracingMetaData->Entries() + 1 - fIndex;
 		direction = -1;
-		fEntry = NULL;
-		fIndex = sTracingMetaData->Entries() + 1;
+		_SetToEnd();
 	}
 
 	// iterate to the index
@@ -1275,21 +1544,31 @@ TraceEntryIterator::MoveTo(int32 index)
 }
 
 
+void
+TraceEntryIterator::_SetToEnd()
+{
+	fEntry = NULL;
+	fIndex = sTracingMetaData->Entries() + 1;
+	for (int32 i = 0; i < sTracingMetaData->BufferCount(); i++)
+		fNext[i] = NULL;
+}
+
+
 trace_entry*
-TraceEntryIterator::_NextNonBufferEntry(trace_entry* entry)
+TraceEntryIterator::_NextNonBufferEntry(int32 buffer, trace_entry* entry)
 {
 	while (entry != NULL && (entry->flags & BUFFER_ENTRY) != 0)
-		entry = sTracingMetaData->NextEntry(entry);
+		entry = sTracingMetaData->BufferAt(buffer).NextEntry(entry);
 
 	return entry;
 }
 
 
 trace_entry*
-TraceEntryIterator::_PreviousNonBufferEntry(trace_entry* entry)
+TraceEntryIterator::_PreviousNonBufferEntry(int32 buffer, trace_entry* entry)
 {
 	while (entry != NULL && (entry->flags & BUFFER_ENTRY) != 0)
-		entry = sTracingMetaData->PreviousEntry(entry);
+		entry = sTracingMetaData->BufferAt(buffer).PreviousEntry(entry);
 
 	return entry;
 }
@@ -1728,17 +2007,26 @@ bool
 tracing_is_entry_valid(AbstractTraceEntry* candidate, bigtime_t entryTime)
 {
 #if ENABLE_TRACING
-	if (!sTracingMetaData->IsInBuffer(candidate, sizeof(*candidate)))
+	TraceBuffer* buffer = sTracingMetaData->BufferFor(candidate,
+		sizeof(*candidate));
+	if (buffer == NULL)
 		return false;
 
 	if (entryTime < 0)
 		return true;
 
-	TraceEntryIterator iterator;
-	while (TraceEntry* entry = iterator.Next()) {
-		AbstractTraceEntry* abstract = dynamic_cast<AbstractTraceEntry*>(entry);
-		if (abstract == NULL)
+	// The candidate is valid, if it isn't older than the oldest entry of its
+	// buffer.
+	trace_entry* entry = buffer->FirstEntry();
+	while (entry != NULL) {
+		AbstractTraceEntry* abstract = (entry->flags & BUFFER_ENTRY) == 0
+			? dynamic_cast<AbstractTraceEntry*>(
+				TraceEntry::FromTraceEntry(entry))
+			: NULL;
+		if (abstract == NULL) {
+			entry = buffer->NextEntry(entry);
 			continue;
+		}
 
 		if (abstract != candidate && abstract->Time() > entryTime)
 			return false;
@@ -1755,7 +2043,7 @@ void
 lock_tracing_buffer()
 {
 #if ENABLE_TRACING
-	sTracingMetaData->Lock();
+	sTracingMetaData->LockAll();
 #endif
 }
 
@@ -1764,16 +2052,17 @@ void
 unlock_tracing_buffer()
 {
 #if ENABLE_TRACING
-	sTracingMetaData->Unlock();
+	sTracingMetaData->UnlockAll();
 #endif
 }
 
 
 extern "C" status_t
-tracing_init(void)
+tracing_init(struct kernel_args* args)
 {
 #if	ENABLE_TRACING
-	status_t result = TracingMetaData::Create(sTracingMetaData);
+	status_t result = TracingMetaData::Create(args->num_cpus,
+		sTracingMetaData);
 	if (result != B_OK) {
 		memset(&sFallbackTracingMetaData, 0, sizeof(sFallbackTracingMetaData));
 		sTracingMetaData = &sFallbackTracingMetaData;
@@ -1858,3 +2147,277 @@ _user_ktrace_output(const char *message)
 #endif	// ENABLE_TRACING
 }
 
+
+
+#if ENABLE_TRACING
+
+// State of the live reader of the tracing buffers. There's only a single one
+// at a time; it belongs to a team and is taken over, when that team is gone.
+
+struct TracingReaderPosition {
+	trace_entry*	next;
+	uint32			allocation;
+		// allocation index of the entry at next
+	uint32			serial;
+		// index of the first non-buffer entry at or after next
+};
+
+static const size_t kMaxTracingReadSize = 64 * 1024;
+static const size_t kTracingReadLineSize = 512;
+
+static mutex sTracingReaderLock = MUTEX_INITIALIZER("tracing reader");
+static team_id sTracingReaderTeam = -1;
+static uint32 sTracingReaderLostEntries = 0;
+static TracingReaderPosition sTracingReaderPositions[SMP_MAX_CPUS];
+
+
+/*!	Moves the reader position of the given buffer to its first or after its
+	last entry. All buffers must be locked.
+*/
+static void
+tracing_reader_seek(int32 index, bool toStart)
+{
+	TraceBuffer& buffer = sTracingMetaData->BufferAt(index);
+	TracingReaderPosition& position = sTracingReaderPositions[index];
+
+	if (toStart) {
+		position.next = buffer.FirstEntry();
+		position.allocation = buffer.Frees();
+		position.serial = buffer.EntriesEver() - buffer.Entries();
+	} else {
+		position.next = buffer.AfterLastEntry();
+		position.allocation = buffer.Allocations();
+		position.serial = buffer.EntriesEver();
+	}
+}
+
+
+/*!	Returns the next entry the reader gets from the given buffer, or \c NULL,
+	if there is none yet. All buffers must be locked.
+*/
+static trace_entry*
+tracing_reader_peek(int32 index)
+{
+	TraceBuffer& buffer = sTracingMetaData->BufferAt(index);
+	TracingReaderPosition& position = sTracingReaderPositions[index];
+
+	// The reader is at the first entry of the buffer, or the entries it
+	// didn't get to have already been overwritten. Either way, resume at the
+	// first entry.
+	int32 behind = (int32)(buffer.Frees() - position.allocation);
+	if (behind >= 0) {
+		uint32 serial = position.serial;
+		tracing_reader_seek(index, true);
+		if (behind > 0)
+			sTracingReaderLostEntries += position.serial - serial;
+	}
+
+	// skip buffer entries
+	while (position.allocation != buffer.Allocations()) {
+		trace_entry* entry = position.next;
+		if ((entry->flags & WRAP_ENTRY) != 0) {
+			position.next = buffer.Buffer();
+			continue;
+		}
+
+		if ((entry->flags & BUFFER_ENTRY) == 0) {
+			// An entry still under construction blocks the buffer.
+			return (entry->flags & ENTRY_INITIALIZED) != 0 ? entry : NULL;
+		}
+
+		position.next += entry->size;
+		position.allocation++;
+	}
+
+	return NULL;
+}
+
+
+struct TracingReaderDumpParameters {
+	TraceEntry*		entry;
+	TraceOutput*	output;
+};
+
+
+static void
+tracing_reader_dump_trampoline(void* _parameters)
+{
+	TracingReaderDumpParameters* parameters
+		= (TracingReaderDumpParameters*)_parameters;
+	parameters->entry->Dump(*parameters->output);
+}
+
+
+/*!	Prints the copy of a trace entry to \a line. Since Dump() may follow
+	pointers the entry recorded, the entry is dumped with a fault handler,
+	like in the kernel debugger. Returns the length of the line.
+*/
+static size_t
+tracing_reader_dump(trace_entry* entry, char* line)
+{
+	TraceOutput out(line, kTracingReadLineSize, TRACE_OUTPUT_TEAM_ID);
+	TracingReaderDumpParameters parameters = {
+		TraceEntry::FromTraceEntry(entry), &out
+	};
+
+	jmp_buf jumpBuffer;
+	InterruptsLocker interruptsLocker;
+	if (debug_call_with_fault_handler(jumpBuffer,
+			&tracing_reader_dump_trampoline, &parameters) != 0) {
+		out.Print(" <fault>");
+	}
+
+	size_t length = out.Size();
+	if (length > 0 && line[length - 1] == '\n')
+		length--;
+	return length;
+}
+
+
+/*!	Prints the entries not read yet to \a buffer, oldest first, one entry per
+	line. Returns the number of bytes written.
+	An entry is only copied to \a entryBuffer while the buffers are locked;
+	it is printed afterwards.
+*/
+static size_t
+tracing_reader_read(char* buffer, size_t size, char* line,
+	trace_entry* entryBuffer)
+{
+	size_t bytesRead = 0;
+
+	while (true) {
+		InterruptsLocker interruptsLocker;
+		sTracingMetaData->LockAll();
+
+		// pick the oldest entry of all buffers
+		trace_entry* entry = NULL;
+		int32 selected = -1;
+		for (int32 i = 0; i < sTracingMetaData->BufferCount(); i++) {
+			trace_entry* candidate = tracing_reader_peek(i);
+			if (candidate != NULL && (entry == NULL
+					|| entry_timestamp(candidate) < entry_timestamp(entry))) {
+				entry = candidate;
+				selected = i;
+			}
+		}
+
+		if (sTracingReaderLostEntries > 0) {
+			int length = snprintf(line, kTracingReadLineSize,
+				"** %" B_PRIu32 " entries lost **\n",
+				sTracingReaderLostEntries);
+			if (bytesRead + length > size) {
+				sTracingMetaData->UnlockAll();
+				break;
+			}
+
+			memcpy(buffer + bytesRead, line, length);
+			bytesRead += length;
+			sTracingReaderLostEntries = 0;
+		}
+
+		if (entry == NULL) {
+			sTracingMetaData->UnlockAll();
+			break;
+		}
+
+		size_t entrySize = entry->size * sizeof(trace_entry);
+		memcpy(entryBuffer, entry, entrySize);
+
+		TracingReaderPosition& position = sTracingReaderPositions[selected];
+		position.next += entry->size;
+		position.allocation++;
+		position.serial++;
+
+		sTracingMetaData->UnlockAll();
+		interruptsLocker.Unlock();
+
+		size_t length = tracing_reader_dump(entryBuffer, line);
+		if (bytesRead + length + 1 > size) {
+			// Leave the entry for the next read. Only we move the position,
+			// so it is still right behind the entry.
+			interruptsLocker.Lock();
+			sTracingMetaData->LockAll();
+			position.next -= entryBuffer->size;
+			position.allocation--;
+			position.serial--;
+			sTracingMetaData->UnlockAll();
+			break;
+		}
+
+		memcpy(buffer + bytesRead, line, length);
+		buffer[bytesRead + length] = '\n';
+		bytesRead += length + 1;
+	}
+
+	return bytesRead;
+}
+
+#endif	// ENABLE_TRACING
+
+
+/*!	Reads the trace entries recorded since the last call as text, one entry
+	per line, merged from all CPUs by time. The first call of a team, or one
+	with \a fromStart set, starts with the oldest entry still recorded.
+	Only one team can read at a time, and only root may do so.
+*/
+ssize_t
+_user_ktrace_read(char* userBuffer, size_t size, bool fromStart)
+{
+#if	ENABLE_TRACING
+	if (geteuid() != 0)
+		return B_NOT_ALLOWED;
+
+	if (userBuffer == NULL || !IS_USER_ADDRESS(userBuffer))
+		return B_BAD_ADDRESS;
+
+	if (size < kTracingReadLineSize)
+		return B_BUFFER_OVERFLOW;
+	if (size > kMaxTracingReadSize)
+		size = kMaxTracingReadSize;
+
+	char* buffer = (char*)malloc(size + kTracingReadLineSize);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter bufferDeleter(buffer);
+
+	trace_entry* entryBuffer = (trace_entry*)malloc(kMaxTracingEntryByteSize);
+	if (entryBuffer == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter entryBufferDeleter(entryBuffer);
+
+	team_id team = thread_get_current_thread()->team->id;
+
+	MutexLocker locker(sTracingReaderLock);
+
+	if (sTracingReaderTeam != team) {
+		if (sTracingReaderTeam >= 0 && team_is_valid(sTracingReaderTeam))
+			return B_BUSY;
+
+		sTracingReaderTeam = team;
+		fromStart = true;
+	}
+
+	if (fromStart) {
+		InterruptsLocker interruptsLocker;
+		sTracingMetaData->LockAll();
+
+		for (int32 i = 0; i < sTracingMetaData->BufferCount(); i++)
+			tracing_reader_seek(i, true);
+		sTracingReaderLostEntries = 0;
+
+		sTracingMetaData->UnlockAll();
+	}
+
+	size_t bytesRead = tracing_reader_read(buffer, size, buffer + size,
+		entryBuffer);
+
+	locker.Unlock();
+
+	if (user_memcpy(userBuffer, buffer, bytesRead) != B_OK)
+		return B_BAD_ADDRESS;
+
+	return bytesRead;
+#else
+	return B_NOT_SUPPORTED;
+#endif	// ENABLE_TRACING
+}
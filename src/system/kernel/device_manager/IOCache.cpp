@@ -146,7 +146,7 @@ IOCache::MediaChanged()
 	AutoLocker<VMCache> cacheLocker(fCache);
 
 	// new media -- burn all cached data
-	while (vm_page* page = fCache->pages.Root()) {
+	while (vm_page* page = fCache->pages.First()) {
 		DEBUG_PAGE_ACCESS_START(page);
 		fCache->RemovePage(page);
 		vm_page_free(NULL, page);
@@ -0,0 +1,726 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Event queues: persistent, kernel resident sets of selected objects.
+
+	Unlike select(), poll() and wait_for_objects(), which select all objects
+	anew on every call, an event queue keeps its objects selected until they
+	are removed from it. The objects are selected with the same select_info
+	plumbing, but the notifications are collected in a list of ready events,
+	so that waiting only costs as much as there are events to report.
+*/
+
+
+#include <event_queue.h>
+
+#include <new>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include <AutoDeleter.h>
+
+#include <condition_variable.h>
+#include <fs/fd.h>
+#include <kernel.h>
+#include <lock.h>
+#include <syscall_restart.h>
+#include <team.h>
+#include <thread.h>
+#include <util/AutoLock.h>
+#include <util/DoublyLinkedList.h>
+#include <util/OpenHashTable.h>
+#include <wait_for_objects.h>
+
+
+//#define TRACE_EVENT_QUEUE
+#ifdef TRACE_EVENT_QUEUE
+#	define TRACE(x) dprintf x
+#else
+#	define TRACE(x) ;
+#endif
+
+
+static const int kMaxWaitInfos = 1024;
+	// the most infos a single wait returns, or a single select accepts
+
+static const uint32 kAlwaysSelectedEvents = B_EVENT_INVALID | B_EVENT_ERROR
+	| B_EVENT_DISCONNECTED;
+static const uint32 kBehaviorFlags = B_EVENT_LEVEL_TRIGGERED
+	| B_EVENT_ONE_SHOT;
+
+
+namespace {
+
+
+struct select_event : select_info, DoublyLinkedListLinkImpl<select_event> {
+	int32				object;
+	uint16				type;
+	uint16				requested_events;
+	uint32				behavior;
+	void*				user_data;
+	bool				selected;
+	bool				queued;
+	bool				dropped;
+		// the object dropped the event on its own, and may still use it
+	bool				orphaned;
+		// no longer part of the queue, but cannot be deleted yet
+	uint32				generation;
+		// the last dequeuing the event has been reported by
+	select_event*		hash_link;
+
+	uint64 Key() const
+	{
+		return ((uint64)type << 32) | (uint32)object;
+	}
+};
+
+typedef DoublyLinkedList<select_event> EventList;
+
+
+struct EventHashDefinition {
+	typedef uint64			KeyType;
+	typedef	select_event	ValueType;
+
+	size_t HashKey(uint64 key) const
+	{
+		return (size_t)(key ^ (key >> 29));
+	}
+
+	size_t Hash(select_event* value) const
+	{
+		return HashKey(value->Key());
+	}
+
+	bool Compare(uint64 key, select_event* value) const
+	{
+		return value->Key() == key;
+	}
+
+	select_event*& GetLink(select_event* value) const
+	{
+		return value->hash_link;
+	}
+};
+
+typedef BOpenHashTable<EventHashDefinition> EventTable;
+
+
+class EventQueue : public select_sync {
+public:
+								EventQueue(team_id team, bool kernel);
+	virtual						~EventQueue();
+
+			team_id				TeamID() const	{ return fTeam; }
+
+			status_t			Init();
+			void				Close();
+
+			status_t			Select(int32 object, uint16 type,
+									uint32 events, void* userData);
+			status_t			Query(int32 object, uint16 type,
+									uint32* _events, void** _userData);
+			status_t			Deselect(int32 object, uint16 type);
+
+			ssize_t				Wait(event_wait_info* infos, int numInfos,
+									uint32 flags, bigtime_t timeout);
+
+	virtual	status_t			Notify(select_info* info, uint16 events);
+
+private:
+			status_t			_SelectEvent(select_event* event);
+			void				_DeselectEvent(select_event* event);
+			void				_RemoveEvent(select_event* event);
+			void				_DeleteEvent(select_event* event);
+			ssize_t				_DequeueEvents(event_wait_info* infos,
+									int numInfos);
+
+private:
+			mutex				fLock;
+				// protects fEvents, and the selection of the events
+			spinlock			fQueueLock;
+				// protects fQueue and select_event::queued
+			EventTable			fEvents;
+			EventList			fQueue;
+			ConditionVariable	fQueueCondition;
+			select_event*		fOrphans;
+			uint32				fGeneration;
+			team_id				fTeam;
+			bool				fKernel;
+			bool				fClosed;
+};
+
+
+}	// namespace
+
+
+EventQueue::EventQueue(team_id team, bool kernel)
+	:
+	fOrphans(NULL),
+	fGeneration(0),
+	fTeam(team),
+	fKernel(kernel),
+	fClosed(false)
+{
+	mutex_init(&fLock, "event queue");
+	B_INITIALIZE_SPINLOCK(&fQueueLock);
+	fQueueCondition.Init(this, "event queue");
+}
+
+
+EventQueue::~EventQueue()
+{
+	// Close() has removed all other events already. The last reference to
+	// the queue is gone, so no object can use the orphans anymore.
+	while (fOrphans != NULL) {
+		select_event* next = fOrphans->hash_link;
+		delete fOrphans;
+		fOrphans = next;
+	}
+
+	mutex_destroy(&fLock);
+}
+
+
+status_t
+EventQueue::Init()
+{
+	return fEvents.Init();
+}
+
+
+/*!	Removes all events, and wakes up the waiting threads. Called when the
+	queue's file descriptor is closed.
+*/
+void
+EventQueue::Close()
+{
+	MutexLocker locker(fLock);
+
+	fClosed = true;
+
+	// File descriptors can only be deselected through the I/O context of the
+	// team that selected them. If another team closes the queue last, the
+	// owner drops the events when it closes the descriptors, or goes away.
+	bool ownTeam = team_get_current_team_id() == fTeam;
+
+	select_event* event = fEvents.Clear(true);
+	while (event != NULL) {
+		select_event* next = event->hash_link;
+		if (event->type == B_OBJECT_TYPE_FD && !ownTeam)
+			event->dropped = true;
+		else
+			_DeselectEvent(event);
+		_DeleteEvent(event);
+		event = next;
+	}
+
+	InterruptsSpinLocker queueLocker(fQueueLock);
+	fQueueCondition.NotifyAll(B_FILE_ERROR);
+}
+
+
+status_t
+EventQueue::Select(int32 object, uint16 type, uint32 events, void* userData)
+{
+	MutexLocker locker(fLock);
+	if (fClosed)
+		return B_FILE_ERROR;
+
+	select_event* event = fEvents.Lookup(((uint64)type << 32)
+		| (uint32)object);
+	if (event != NULL) {
+		// already selected -- select it anew with the changed events
+		_DeselectEvent(event);
+		if (event->dropped) {
+			// the object might still be using it, start over with a new one
+			fEvents.Remove(event);
+			_DeleteEvent(event);
+			event = NULL;
+		}
+	}
+
+	if (event == NULL) {
+		event = new(std::nothrow) select_event;
+		if (event == NULL)
+			return B_NO_MEMORY;
+
+		event->next = NULL;
+		event->sync = this;
+		event->object = object;
+		event->type = type;
+		event->selected = false;
+		event->queued = false;
+		event->dropped = false;
+		event->orphaned = false;
+		event->generation = 0;
+
+		status_t status = fEvents.Insert(event);
+		if (status != B_OK) {
+			delete event;
+			return status;
+		}
+	}
+
+	event->requested_events = events & ~kBehaviorFlags;
+	event->behavior = events & kBehaviorFlags;
+	event->user_data = userData;
+
+	status_t status = _SelectEvent(event);
+	if (status != B_OK)
+		_RemoveEvent(event);
+
+	return status;
+}
+
+
+status_t
+EventQueue::Query(int32 object, uint16 type, uint32* _events, void** _userData)
+{
+	MutexLocker locker(fLock);
+
+	select_event* event = fEvents.Lookup(((uint64)type << 32)
+		| (uint32)object);
+	if (event == NULL)
+		return B_ENTRY_NOT_FOUND;
+
+	*_events = event->requested_events | event->behavior;
+	*_userData = event->user_data;
+	return B_OK;
+}
+
+
+status_t
+EventQueue::Deselect(int32 object, uint16 type)
+{
+	MutexLocker locker(fLock);
+
+	select_event* event = fEvents.Lookup(((uint64)type << 32)
+		| (uint32)object);
+	if (event == NULL)
+		return B_ENTRY_NOT_FOUND;
+
+	_RemoveEvent(event);
+	return B_OK;
+}
+
+
+ssize_t
+EventQueue::Wait(event_wait_info* infos, int numInfos, uint32 flags,
+	bigtime_t timeout)
+{
+	while (true) {
+		MutexLocker locker(fLock);
+		if (fClosed)
+			return B_FILE_ERROR;
+
+		ssize_t count = _DequeueEvents(infos, numInfos);
+		if (count != 0)
+			return count;
+
+		if ((flags & B_RELATIVE_TIMEOUT) != 0 && timeout <= 0)
+			return B_WOULD_BLOCK;
+
+		// Nothing to report yet -- wait for a notification. The entry has to
+		// be added with the queue locked, or we might miss it.
+		ConditionVariableEntry entry;
+		InterruptsSpinLocker queueLocker(fQueueLock);
+		if (!fQueue.IsEmpty())
+			continue;
+
+		fQueueCondition.Add(&entry);
+		queueLocker.Unlock();
+		locker.Unlock();
+
+		status_t status = entry.Wait(flags, timeout);
+		if (status != B_OK)
+			return status;
+	}
+}
+
+
+/*!	Called by notify_select_events() whenever one of the queue's objects
+	reports events. May be called with spinlocks held, so it only puts the
+	event into the ready list.
+*/
+status_t
+EventQueue::Notify(select_info* info, uint16 events)
+{
+	select_event* event = static_cast<select_event*>(info);
+	if ((info->selected_events & events) == 0)
+		return B_OK;
+
+	InterruptsSpinLocker locker(fQueueLock);
+
+	if (!event->queued && !event->orphaned) {
+		fQueue.Add(event);
+		event->queued = true;
+		fQueueCondition.NotifyOne();
+	}
+
+	return B_OK;
+}
+
+
+/*!	fLock must be held. */
+status_t
+EventQueue::_SelectEvent(select_event* event)
+{
+	event->selected_events = event->requested_events | kAlwaysSelectedEvents;
+	event->events = 0;
+
+	status_t status = select_object(event->type, event->object, event,
+		fKernel);
+	if (status != B_OK)
+		return status;
+
+	event->selected = true;
+	return B_OK;
+}
+
+
+/*!	fLock must be held. Once the object is deselected it can't notify the
+	event anymore, so that the event can be taken out of the ready list for
+	good.
+	If the object has dropped the event on its own already, it may still be
+	about to notify it; the event is marked as dropped then, and must not be
+	deleted or selected again.
+*/
+void
+EventQueue::_DeselectEvent(select_event* event)
+{
+	if (event->selected) {
+		status_t status = deselect_object(event->type, event->object, event,
+			fKernel);
+		if (status != B_OK && (event->type == B_OBJECT_TYPE_FD
+				|| event->type == B_OBJECT_TYPE_THREAD)) {
+			// Only descriptors and threads notify their events outside of
+			// the lock that protects their select infos.
+			event->dropped = true;
+		}
+		event->selected = false;
+	}
+
+	InterruptsSpinLocker queueLocker(fQueueLock);
+	if (event->queued) {
+		fQueue.Remove(event);
+		event->queued = false;
+	}
+}
+
+
+/*!	fLock must be held. */
+void
+EventQueue::_RemoveEvent(select_event* event)
+{
+	_DeselectEvent(event);
+	fEvents.Remove(event);
+	_DeleteEvent(event);
+}
+
+
+/*!	Deletes an event that is no longer part of fEvents, unless an object
+	might still use it; it is kept until the queue goes away then.
+	fLock must be held.
+*/
+void
+EventQueue::_DeleteEvent(select_event* event)
+{
+	if (!event->dropped) {
+		delete event;
+		return;
+	}
+
+	InterruptsSpinLocker queueLocker(fQueueLock);
+	if (event->queued) {
+		fQueue.Remove(event);
+		event->queued = false;
+	}
+	event->orphaned = true;
+	queueLocker.Unlock();
+
+	event->hash_link = fOrphans;
+	fOrphans = event;
+}
+
+
+/*!	Moves up to \a numInfos events from the ready list into \a infos.
+	fLock must be held.
+*/
+ssize_t
+EventQueue::_DequeueEvents(event_wait_info* infos, int numInfos)
+{
+	uint32 generation = ++fGeneration;
+	ssize_t count = 0;
+
+	while (count < numInfos) {
+		InterruptsSpinLocker queueLocker(fQueueLock);
+		select_event* event = fQueue.Head();
+		if (event == NULL || event->generation == generation) {
+			// the rest has been queued again while we were at it
+			break;
+		}
+		fQueue.Remove(event);
+		event->queued = false;
+		queueLocker.Unlock();
+
+		uint16 events;
+		if ((event->behavior & B_EVENT_LEVEL_TRIGGERED) != 0) {
+			// Select the object anew, so that it reports whether the
+			// condition still persists. If so, the event is put back into
+			// the ready list right away.
+			_DeselectEvent(event);
+			if (!event->dropped && _SelectEvent(event) == B_OK) {
+				events = atomic_get(&event->events)
+					& event->selected_events;
+			} else
+				events = B_EVENT_INVALID;
+		} else {
+			events = atomic_get_and_set(&event->events, 0)
+				& event->selected_events;
+		}
+
+		if (events == 0) {
+			// already reported, or no longer pending
+			continue;
+		}
+
+		event->generation = generation;
+
+		infos[count].object = event->object;
+		infos[count].type = event->type;
+		infos[count].events = events;
+		infos[count].user_data = event->user_data;
+		count++;
+
+		if ((events & B_EVENT_INVALID) != 0
+			|| (event->behavior & B_EVENT_ONE_SHOT) != 0) {
+			_RemoveEvent(event);
+		}
+	}
+
+	return count;
+}
+
+
+// #pragma mark - file descriptor
+
+
+static status_t
+event_queue_close(file_descriptor* descriptor)
+{
+	EventQueue* queue = (EventQueue*)descriptor->cookie;
+	queue->Close();
+	return B_OK;
+}
+
+
+static void
+event_queue_free(file_descriptor* descriptor)
+{
+	EventQueue* queue = (EventQueue*)descriptor->cookie;
+	put_select_sync(queue);
+}
+
+
+static struct fd_ops sEventQueueFDOps = {
+	NULL,	// fd_read
+	NULL,	// fd_write
+	NULL,	// fd_seek
+	NULL,	// fd_ioctl
+	NULL,	// fd_set_flags
+	NULL,	// fd_select
+	NULL,	// fd_deselect
+	NULL,	// fd_read_dir
+	NULL,	// fd_rewind_dir
+	NULL,	// fd_read_stat
+	NULL,	// fd_write_stat
+	&event_queue_close,
+	&event_queue_free
+};
+
+
+static status_t
+get_event_queue_descriptor(int fd, bool kernel,
+	file_descriptor*& _descriptor)
+{
+	if (fd < 0)
+		return B_FILE_ERROR;
+
+	file_descriptor* descriptor = get_fd(get_current_io_context(kernel), fd);
+	if (descriptor == NULL)
+		return B_FILE_ERROR;
+
+	if (descriptor->type != FDTYPE_EVENT_QUEUE) {
+		put_fd(descriptor);
+		return B_BAD_VALUE;
+	}
+
+	// The selected descriptors belong to the I/O context of the team that
+	// created the queue.
+	EventQueue* queue = (EventQueue*)descriptor->cookie;
+	if (queue->TeamID() != team_get_current_team_id()) {
+		put_fd(descriptor);
+		return B_NOT_ALLOWED;
+	}
+
+	_descriptor = descriptor;
+	return B_OK;
+}
+
+
+//	#pragma mark - User syscalls
+
+
+int
+_user_event_queue_create(int openFlags)
+{
+	EventQueue* queue = new(std::nothrow) EventQueue(
+		team_get_current_team_id(), false);
+	if (queue == NULL)
+		return B_NO_MEMORY;
+
+	status_t status = queue->Init();
+	if (status != B_OK) {
+		delete queue;
+		return status;
+	}
+
+	file_descriptor* descriptor = alloc_fd();
+	if (descriptor == NULL) {
+		delete queue;
+		return B_NO_MEMORY;
+	}
+
+	descriptor->type = FDTYPE_EVENT_QUEUE;
+	descriptor->ops = &sEventQueueFDOps;
+	descriptor->cookie = queue;
+	descriptor->open_mode = O_RDWR;
+
+	io_context* context = get_current_io_context(false);
+	int fd = new_fd(context, descriptor);
+	if (fd < 0) {
+		free(descriptor);
+		delete queue;
+		return fd;
+	}
+
+	mutex_lock(&context->io_mutex);
+	fd_set_close_on_exec(context, fd, (openFlags & O_CLOEXEC) != 0);
+	mutex_unlock(&context->io_mutex);
+
+	TRACE(("_user_event_queue_create(): queue %p, fd %d\n", queue, fd));
+	return fd;
+}
+
+
+status_t
+_user_event_queue_select(int queue, event_wait_info* userInfos, int numInfos)
+{
+	if (numInfos <= 0 || numInfos > kMaxWaitInfos)
+		return B_BAD_VALUE;
+	if (userInfos == NULL || !IS_USER_ADDRESS(userInfos))
+		return B_BAD_ADDRESS;
+
+	file_descriptor* descriptor;
+	status_t status = get_event_queue_descriptor(queue, false, descriptor);
+	if (status != B_OK)
+		return status;
+
+	EventQueue* eventQueue = (EventQueue*)descriptor->cookie;
+
+	size_t bytes = sizeof(event_wait_info) * numInfos;
+	event_wait_info* infos = (event_wait_info*)malloc(bytes);
+	if (infos == NULL) {
+		put_fd(descriptor);
+		return B_NO_MEMORY;
+	}
+	MemoryDeleter infosDeleter(infos);
+
+	if (user_memcpy(infos, userInfos, bytes) != B_OK) {
+		put_fd(descriptor);
+		return B_BAD_ADDRESS;
+	}
+
+	status_t result = B_OK;
+	for (int i = 0; i < numInfos; i++) {
+		event_wait_info& info = infos[i];
+
+		if (info.events > 0) {
+			status = eventQueue->Select(info.object, info.type, info.events,
+				info.user_data);
+		} else if (info.events == 0) {
+			status = eventQueue->Deselect(info.object, info.type);
+		} else {
+			uint32 events;
+			status = eventQueue->Query(info.object, info.type, &events,
+				&info.user_data);
+			if (status == B_OK)
+				info.events = events;
+		}
+
+		if (status != B_OK) {
+			info.events = B_EVENT_INVALID;
+			result = status;
+		}
+	}
+
+	put_fd(descriptor);
+
+	if (user_memcpy(userInfos, infos, bytes) != B_OK)
+		return B_BAD_ADDRESS;
+
+	return result;
+}
+
+
+ssize_t
+_user_event_queue_wait(int queue, event_wait_info* userInfos, int numInfos,
+	uint32 flags, bigtime_t timeout)
+{
+	syscall_restart_handle_timeout_pre(flags, timeout);
+
+	if (numInfos <= 0)
+		return B_BAD_VALUE;
+	if (userInfos == NULL || !IS_USER_ADDRESS(userInfos))
+		return B_BAD_ADDRESS;
+
+	numInfos = min_c(numInfos, kMaxWaitInfos);
+
+	file_descriptor* descriptor;
+	status_t status = get_event_queue_descriptor(queue, false, descriptor);
+	if (status != B_OK)
+		return status;
+
+	EventQueue* eventQueue = (EventQueue*)descriptor->cookie;
+
+	event_wait_info* infos = (event_wait_info*)malloc(
+		sizeof(event_wait_info) * numInfos);
+	if (infos == NULL) {
+		put_fd(descriptor);
+		return B_NO_MEMORY;
+	}
+	MemoryDeleter infosDeleter(infos);
+
+	ssize_t result = eventQueue->Wait(infos, numInfos,
+		(flags & (B_RELATIVE_TIMEOUT | B_ABSOLUTE_TIMEOUT)) | B_CAN_INTERRUPT,
+		timeout);
+
+	put_fd(descriptor);
+
+	if (result < 0)
+		return syscall_restart_handle_timeout_post(result, timeout);
+
+	if (user_memcpy(userInfos, infos, sizeof(event_wait_info) * result)
+			!= B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	return result;
+}
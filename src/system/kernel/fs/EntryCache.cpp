@@ -8,12 +8,29 @@
 
 #include <new>
 
+#include <smp.h>
+
 
 static const int32 kEntriesPerGeneration = 1024;
 
 static const int32 kEntryNotInArray = -1;
 static const int32 kEntryRemoved = -2;
 
+// Lookups that hit an entry of the current generation don't lock the cache.
+// They run with interrupts disabled and validate what they have read against
+// fChangeCount, which writers increment before and after changing the table.
+// Since the lookup might still look at entries or tables the writers have
+// removed in the meantime, those are only freed after all CPUs have run an
+// inter-CPU interrupt, which can't happen while a lookup is in progress.
+
+static const int32 kMaxUnlockedChainLength = 32;
+
+
+static void
+entry_cache_quiescent(void* cookie, int cpu)
+{
+}
+
 
 // #pragma mark - EntryCacheGeneration
 
@@ -45,16 +62,61 @@ EntryCacheGeneration::Init()
 }
 
 
+// #pragma mark - EntryCacheRetiredList
+
+
+EntryCacheRetiredList::EntryCacheRetiredList()
+	:
+	count(0)
+{
+}
+
+
+EntryCacheRetiredList::~EntryCacheRetiredList()
+{
+	Free(false);
+}
+
+
+/*!	The caller must hold the cache's write lock.
+*/
+void
+EntryCacheRetiredList::Add(void* _memory)
+{
+	if (count == kCapacity)
+		Free(true);
+
+	memory[count++] = _memory;
+}
+
+
+void
+EntryCacheRetiredList::Free(bool synchronize)
+{
+	if (count == 0)
+		return;
+
+	// make sure no lock-free lookup is still looking at the memory
+	if (synchronize)
+		call_all_cpus_sync(&entry_cache_quiescent, NULL);
+
+	for (int32 i = 0; i < count; i++)
+		free(memory[i]);
+
+	count = 0;
+}
+
+
 // #pragma mark - EntryCache
 
 
 EntryCache::EntryCache()
 	:
+	fChangeCount(0),
+	fEntries(&fRetired),
 	fCurrentGeneration(0)
 {
 	rw_lock_init(&fLock, "entry cache");
-
-	new(&fEntries) EntryTable;
 }
 
 
@@ -98,6 +160,7 @@ EntryCache::Add(ino_t dirID, const char* name, ino_t nodeID, bool missing)
 
 	EntryCacheEntry* entry = fEntries.Lookup(key);
 	if (entry != NULL) {
+		_BeginChange();
 		entry->node_id = nodeID;
 		entry->missing = missing;
 		if (entry->generation != fCurrentGeneration) {
@@ -106,6 +169,7 @@ EntryCache::Add(ino_t dirID, const char* name, ino_t nodeID, bool missing)
 				_AddEntryToCurrentGeneration(entry);
 			}
 		}
+		_EndChange();
 		return B_OK;
 	}
 
@@ -120,9 +184,14 @@ EntryCache::Add(ino_t dirID, const char* name, ino_t nodeID, bool missing)
 	entry->index = kEntryNotInArray;
 	strcpy(entry->name, name);
 
+	// the entry must be complete before lock-free lookups can see it
+	memory_write_barrier();
+
+	_BeginChange();
 	fEntries.Insert(entry);
 
 	_AddEntryToCurrentGeneration(entry);
+	_EndChange();
 
 	return B_OK;
 }
@@ -139,12 +208,14 @@ EntryCache::Remove(ino_t dirID, const char* name)
 	if (entry == NULL)
 		return B_ENTRY_NOT_FOUND;
 
+	_BeginChange();
 	fEntries.Remove(entry);
+	_EndChange();
 
 	if (entry->index >= 0) {
 		// remove the entry from its generation and delete it
 		fGenerations[entry->generation].entries[entry->index] = NULL;
-		free(entry);
+		fRetired.Add(entry);
 	} else {
 		// We can't free it, since another thread is about to try to move it
 		// to another generation. We mark it removed and the other thread will
@@ -162,6 +233,10 @@ EntryCache::Lookup(ino_t dirID, const char* name, ino_t& _nodeID,
 {
 	EntryCacheKey key(dirID, name);
 
+	bool found;
+	if (_LookupUnlocked(key, _nodeID, _missing, found))
+		return found;
+
 	ReadLocker readLocker(fLock);
 
 	EntryCacheEntry* entry = fEntries.Lookup(key);
@@ -183,7 +258,7 @@ EntryCache::Lookup(ino_t dirID, const char* name, ino_t& _nodeID,
 	entry->index = kEntryNotInArray;
 
 	// add to the current generation
-	int32 index = atomic_add(&fGenerations[oldGeneration].next_index, 1);
+	int32 index = atomic_add(&fGenerations[fCurrentGeneration].next_index, 1);
 	if (index < kEntriesPerGeneration) {
 		fGenerations[fCurrentGeneration].entries[index] = entry;
 		entry->index = index;
@@ -199,11 +274,13 @@ EntryCache::Lookup(ino_t dirID, const char* name, ino_t& _nodeID,
 
 	if (entry->index == kEntryRemoved) {
 		// the entry has been removed in the meantime
-		free(entry);
+		fRetired.Add(entry);
 		return false;
 	}
 
+	_BeginChange();
 	_AddEntryToCurrentGeneration(entry);
+	_EndChange();
 
 	_nodeID = entry->node_id;
 	_missing = entry->missing;
@@ -227,6 +304,78 @@ EntryCache::DebugReverseLookup(ino_t nodeID, ino_t& _dirID)
 }
 
 
+/*!	Looks up the entry without locking the cache.
+	Returns \c false, if that wasn't possible and the caller needs to look the
+	entry up the locked way. Otherwise \a _found is set to whether the entry is
+	in the cache; only entries of the current generation are returned, since
+	the others need to be moved to it.
+*/
+bool
+EntryCache::_LookupUnlocked(const EntryCacheKey& key, ino_t& _nodeID,
+	bool& _missing, bool& _found)
+{
+	InterruptsLocker _;
+
+	int32 changeCount = atomic_get(&fChangeCount);
+	if (changeCount % 2 != 0)
+		return false;
+
+	// check that the table and its size belong together, before using them
+	EntryCacheEntry* const* bucket = fEntries.UnlockedBucket(key);
+	memory_read_barrier();
+	if (atomic_get(&fChangeCount) != changeCount)
+		return false;
+
+	if (bucket == NULL) {
+		_found = false;
+		return true;
+	}
+
+	EntryCacheEntry* entry = *(EntryCacheEntry* volatile*)bucket;
+	for (int32 i = 0; entry != NULL; i++) {
+		if (i == kMaxUnlockedChainLength)
+			return false;
+
+		if (entry->dir_id == key.dir_id && strcmp(entry->name, key.name) == 0)
+			break;
+
+		entry = *(EntryCacheEntry* volatile*)&entry->hash_link;
+	}
+
+	ino_t nodeID = 0;
+	bool missing = false;
+	bool current = true;
+	if (entry != NULL) {
+		nodeID = entry->node_id;
+		missing = entry->missing;
+		current = entry->generation == fCurrentGeneration;
+	}
+
+	memory_read_barrier();
+	if (atomic_get(&fChangeCount) != changeCount || !current)
+		return false;
+
+	_found = entry != NULL;
+	_nodeID = nodeID;
+	_missing = missing;
+	return true;
+}
+
+
+void
+EntryCache::_BeginChange()
+{
+	atomic_add(&fChangeCount, 1);
+}
+
+
+void
+EntryCache::_EndChange()
+{
+	atomic_add(&fChangeCount, 1);
+}
+
+
 void
 EntryCache::_AddEntryToCurrentGeneration(EntryCacheEntry* entry)
 {
@@ -248,7 +397,7 @@ EntryCache::_AddEntryToCurrentGeneration(EntryCacheEntry* entry)
 
 		fGenerations[newGeneration].entries[i] = NULL;
 		fEntries.Remove(otherEntry);
-		free(otherEntry);
+		fRetired.Add(otherEntry);
 	}
 
 	// set the new generation and add the entry
@@ -80,6 +80,69 @@ struct EntryCacheHashDefinition {
 };
 
 
+/*!	Memory that lock-free readers might still be looking at. It is freed
+	once all CPUs have passed through a point where they can't be in a
+	lock-free lookup anymore. The memory itself is left untouched until then.
+*/
+struct EntryCacheRetiredList {
+	static	const int32			kCapacity = 128;
+
+			void*				memory[kCapacity];
+			int32				count;
+
+								EntryCacheRetiredList();
+								~EntryCacheRetiredList();
+
+			void				Add(void* memory);
+			void				Free(bool synchronize);
+};
+
+
+struct EntryCacheTableAllocator {
+	EntryCacheTableAllocator(EntryCacheRetiredList* retiredList = NULL)
+		:
+		retired_list(retiredList)
+	{
+	}
+
+	void* Allocate(size_t size) const
+	{
+		return malloc(size);
+	}
+
+	void Free(void* memory) const
+	{
+		if (memory != NULL)
+			retired_list->Add(memory);
+	}
+
+	EntryCacheRetiredList* retired_list;
+};
+
+
+class EntryCacheTable : public BOpenHashTable<EntryCacheHashDefinition, true,
+	false, EntryCacheTableAllocator> {
+public:
+	EntryCacheTable(EntryCacheRetiredList* retiredList)
+		:
+		BOpenHashTable<EntryCacheHashDefinition, true, false,
+			EntryCacheTableAllocator>(EntryCacheHashDefinition(),
+				EntryCacheTableAllocator(retiredList))
+	{
+	}
+
+	EntryCacheEntry* const* UnlockedBucket(const EntryCacheKey& key) const
+	{
+		size_t tableSize = *(volatile size_t*)&fTableSize;
+		EntryCacheEntry** table = *(EntryCacheEntry** volatile*)&fTable;
+		if (tableSize == 0 || table == NULL)
+			return NULL;
+
+		return &table[key.hash & (tableSize - 1)];
+	}
+};
+
+
 class EntryCache {
 public:
 								EntryCache();
@@ -100,15 +163,25 @@ public:
 private:
 	static	const int32			kGenerationCount = 8;
 
-			typedef BOpenHashTable<EntryCacheHashDefinition> EntryTable;
+			typedef EntryCacheTable EntryTable;
 			typedef DoublyLinkedList<EntryCacheEntry> EntryList;
 
 private:
+			bool				_LookupUnlocked(const EntryCacheKey& key,
+									ino_t& _nodeID, bool& _missing,
+									bool& _found);
+
+	inline	void				_BeginChange();
+	inline	void				_EndChange();
+
 			void				_AddEntryToCurrentGeneration(
 									EntryCacheEntry* entry);
 
 private:
 			rw_lock				fLock;
+			int32				fChangeCount;
+				// odd while the table is being changed
+			EntryCacheRetiredList fRetired;
 			EntryTable			fEntries;
 			EntryCacheGeneration fGenerations[kGenerationCount];
 			int32				fCurrentGeneration;
@@ -40,8 +40,6 @@ static const size_t kMaxReadDirBufferSize = 64 * 1024;
 static struct file_descriptor* get_fd_locked(struct io_context* context,
 	int fd);
 static struct file_descriptor* remove_fd(struct io_context* context, int fd);
-static void deselect_select_infos(file_descriptor* descriptor,
-	select_info* infos, bool putSyncObjects);
 
 
 struct FDGetterLocking {
@@ -518,7 +516,11 @@ fd_ioctl(bool kernelFD, int fd, uint32 op, void* buffer, size_t length)
 }
 
 
-static void
+/*!	Deselects the given list of select infos of \a descriptor, and notifies
+	them of B_EVENT_INVALID. The infos must have been removed from the
+	descriptor's slot already.
+*/
+void
 deselect_select_infos(file_descriptor* descriptor, select_info* infos,
 	bool putSyncObjects)
 {
@@ -647,7 +649,7 @@ deselect_fd(int32 fd, struct select_info* info, bool kernel)
 
 	// If not found, someone else beat us to it.
 	if (*infoLocation != info)
-		return B_OK;
+		return B_ENTRY_NOT_FOUND;
 
 	*infoLocation = info->next;
 
@@ -837,6 +839,137 @@ common_user_vector_io(int fd, off_t pos, const iovec* userVecs, size_t count,
 }
 
 
+/*!	Copies up to \a length bytes from \a source to \a target through a kernel
+	buffer. Returns the number of bytes written to \a target, or an error
+	code, if nothing could be transferred.
+*/
+static ssize_t
+transfer_data_buffered(file_descriptor* source, off_t sourcePos,
+	file_descriptor* target, off_t targetPos, size_t length)
+{
+	const size_t kBufferSize = 64 * 1024;
+
+	void* buffer = malloc(min_c(length, kBufferSize));
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter _(buffer);
+
+	ssize_t bytesTransferred = 0;
+	status_t status = B_OK;
+
+	while ((size_t)bytesTransferred < length) {
+		size_t toRead = min_c(length - bytesTransferred, kBufferSize);
+		size_t bytesRead = toRead;
+		status = source->ops->fd_read(source, sourcePos, buffer, &bytesRead);
+		if (status != B_OK || bytesRead == 0)
+			break;
+
+		sourcePos += bytesRead;
+
+		size_t bytesWritten = 0;
+		while (bytesWritten < bytesRead) {
+			size_t toWrite = bytesRead - bytesWritten;
+			status = target->ops->fd_write(target, targetPos,
+				(uint8*)buffer + bytesWritten, &toWrite);
+			if (status != B_OK || toWrite == 0)
+				break;
+
+			bytesWritten += toWrite;
+			targetPos += toWrite;
+		}
+
+		bytesTransferred += bytesWritten;
+
+		// Whatever was read but not written is lost -- we can only report
+		// what arrived at the target. A short read means the source has no
+		// more data for now; don't wait for more.
+		if (bytesWritten < bytesRead || bytesRead < toRead)
+			break;
+	}
+
+	if (bytesTransferred == 0 && status != B_OK)
+		return status;
+
+	return bytesTransferred;
+}
+
+
+/*!	Transfers up to \a length bytes from \a sourceFD to \a targetFD without
+	passing them through the caller's memory. If the target is a stream
+	socket, the data is read directly into the network buffers, otherwise it
+	goes through a kernel buffer.
+	A position of -1 stands for the respective descriptor's current position,
+	which is moved by the number of bytes transferred.
+*/
+static ssize_t
+common_transfer_data(int sourceFD, off_t sourcePos, int targetFD,
+	off_t targetPos, size_t length, uint32 flags, bool kernel)
+{
+	if (flags != 0 || sourcePos < -1 || targetPos < -1)
+		return B_BAD_VALUE;
+
+	if (length > SSIZE_MAX)
+		length = SSIZE_MAX;
+
+	FDGetter sourceGetter;
+	struct file_descriptor* source = sourceGetter.SetTo(sourceFD, kernel);
+	if (source == NULL || (source->open_mode & O_DISCONNECTED) != 0
+		|| (source->open_mode & O_RWMASK) == O_WRONLY) {
+		return B_FILE_ERROR;
+	}
+
+	FDGetter targetGetter;
+	struct file_descriptor* target = targetGetter.SetTo(targetFD, kernel);
+	if (target == NULL || (target->open_mode & O_DISCONNECTED) != 0
+		|| (target->open_mode & O_RWMASK) == O_RDONLY) {
+		return B_FILE_ERROR;
+	}
+
+	if (source->ops->fd_read == NULL || target->ops->fd_write == NULL)
+		return B_BAD_VALUE;
+
+	bool moveSourcePosition = false;
+	if (sourcePos == -1) {
+		sourcePos = source->pos;
+		moveSourcePosition = true;
+	}
+
+	bool moveTargetPosition = false;
+	if (targetPos == -1) {
+		targetPos = target->pos;
+		moveTargetPosition = true;
+	}
+
+	if (length == 0)
+		return 0;
+
+	SyscallRestartWrapper<ssize_t> bytesTransferred;
+
+	{
+		// The descriptors are handed kernel buffers, which they would reject
+		// as bad user addresses when called on behalf of a syscall.
+		SyscallFlagUnsetter _;
+
+		bytesTransferred = socket_send_from_descriptor(target, source,
+			sourcePos, length);
+		if (bytesTransferred == B_NOT_SUPPORTED) {
+			bytesTransferred = transfer_data_buffered(source, sourcePos,
+				target, targetPos, length);
+		}
+	}
+
+	if (bytesTransferred < 0)
+		return bytesTransferred;
+
+	if (moveSourcePosition)
+		source->pos = sourcePos + bytesTransferred;
+	if (moveTargetPosition)
+		target->pos = targetPos + bytesTransferred;
+
+	return bytesTransferred;
+}
+
+
 status_t
 user_fd_kernel_ioctl(int fd, uint32 op, void* buffer, size_t length)
 {
@@ -877,6 +1010,15 @@ _user_writev(int fd, off_t pos, const iovec* userVecs, size_t count)
 }
 
 
+ssize_t
+_user_transfer_data(int sourceFD, off_t sourcePos, int targetFD,
+	off_t targetPos, size_t length, uint32 flags)
+{
+	return common_transfer_data(sourceFD, sourcePos, targetFD, targetPos,
+		length, flags, false);
+}
+
+
 off_t
 _user_seek(int fd, off_t pos, int seekType)
 {
@@ -1204,6 +1346,17 @@ _kern_writev(int fd, off_t pos, const iovec* vecs, size_t count)
 }
 
 
+ssize_t
+_kern_transfer_data(int sourceFD, off_t sourcePos, int targetFD,
+	off_t targetPos, size_t length, uint32 flags)
+{
+	SyscallFlagUnsetter _;
+
+	return common_transfer_data(sourceFD, sourcePos, targetFD, targetPos,
+		length, flags, true);
+}
+
+
 off_t
 _kern_seek(int fd, off_t pos, int seekType)
 {
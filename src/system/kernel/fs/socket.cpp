@@ -368,6 +368,49 @@ create_socket_fd(net_socket* socket, bool kernel)
 }
 
 
+struct send_source {
+	file_descriptor*	descriptor;
+	off_t				pos;
+};
+
+
+static ssize_t
+read_send_source(void* cookie, void* data, size_t length)
+{
+	send_source* source = (send_source*)cookie;
+
+	status_t status = source->descriptor->ops->fd_read(source->descriptor,
+		source->pos, data, &length);
+	if (status != B_OK)
+		return status;
+
+	if (source->pos != -1)
+		source->pos += length;
+	return length;
+}
+
+
+/*!	Sends up to \a length bytes read from \a source at \a pos over the socket
+	\a descriptor. The data is read directly into the stack's network buffers,
+	so that it is copied only once on its way from the source to the socket.
+	Returns \c B_NOT_SUPPORTED without having read anything, if the socket's
+	protocol can't be fed this way.
+*/
+ssize_t
+socket_send_from_descriptor(file_descriptor* descriptor,
+	file_descriptor* source, off_t pos, size_t length)
+{
+	if (descriptor->type != FDTYPE_SOCKET
+		|| source->ops->fd_read == NULL) {
+		return B_NOT_SUPPORTED;
+	}
+
+	send_source cookie = { source, pos };
+	return sStackInterface->send_from(descriptor->u.socket, length, 0,
+		&read_send_source, &cookie);
+}
+
+
 // #pragma mark - common sockets API implementation
 
 
@@ -413,6 +413,9 @@ static inline void put_vnode(struct vnode* vnode);
 static status_t fs_unmount(char* path, dev_t mountID, uint32 flags,
 	bool kernel);
 static int open_vnode(struct vnode* vnode, int openMode, bool kernel);
+static int file_create(int fd, char* path, int openMode, int perms,
+	bool kernel);
+static int file_open(int fd, char* path, int openMode, bool kernel);
 
 
 static struct fd_ops sFileOps = {
@@ -3611,6 +3614,17 @@ free_io_context(io_context* context)
 
 	mutex_lock(&context->io_mutex);
 
+	// Event queues may still have descriptors of the context selected. Drop
+	// all select infos before closing any descriptor, since closing a queue
+	// frees its infos.
+	for (i = 0; i < context->table_size; i++) {
+		select_info* selectInfos = context->select_infos[i];
+		if (selectInfos != NULL) {
+			context->select_infos[i] = NULL;
+			deselect_select_infos(context->fds[i], selectInfos, true);
+		}
+	}
+
 	for (i = 0; i < context->table_size; i++) {
 		if (struct file_descriptor* descriptor = context->fds[i]) {
 			close_fd(descriptor);
@@ -4221,6 +4235,26 @@ vfs_open_vnode(struct vnode* vnode, int openMode, bool kernel)
 }
 
 
+/*!	Opens the file at \a path, which must be in kernel memory, like open()
+	does, and returns a new file descriptor for it in the I/O context of the
+	kernel or the current team.
+*/
+int
+vfs_open(const char* path, int openMode, int perms, bool kernel)
+{
+	KPath pathBuffer(path, false, B_PATH_NAME_LENGTH + 1);
+	if (pathBuffer.InitCheck() != B_OK)
+		return B_NO_MEMORY;
+
+	if ((openMode & O_CREAT) != 0) {
+		return file_create(-1, pathBuffer.LockBuffer(), openMode, perms,
+			kernel);
+	}
+
+	return file_open(-1, pathBuffer.LockBuffer(), openMode, kernel);
+}
+
+
 /*!	Looks up a vnode with the given mount and vnode ID.
 	Must only be used with "in-use" vnodes as it doesn't grab a reference
 	to the node.
@@ -4841,18 +4875,25 @@ vfs_exec_io_context(io_context* context)
 		mutex_lock(&context->io_mutex);
 
 		struct file_descriptor* descriptor = context->fds[i];
+		select_info* selectInfos = NULL;
 		bool remove = false;
 
 		if (descriptor != NULL && fd_close_on_exec(context, i)) {
 			context->fds[i] = NULL;
 			context->num_used_fds--;
 
+			selectInfos = context->select_infos[i];
+			context->select_infos[i] = NULL;
+
 			remove = true;
 		}
 
 		mutex_unlock(&context->io_mutex);
 
 		if (remove) {
+			if (selectInfos != NULL)
+				deselect_select_infos(descriptor, selectInfos, true);
+
 			close_fd(descriptor);
 			put_fd(descriptor);
 		}
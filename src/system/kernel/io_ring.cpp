@@ -0,0 +1,894 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	I/O rings: batched, asynchronous I/O submission.
+
+	A team queues its operations in the submission ring of an area it shares
+	with the kernel -- the kernel creates the area and maps a clone of it
+	into the team, which the team can neither delete nor resize -- and hands
+	over any number of them with a single
+	_user_io_ring_enter() call. The operations are executed by a few worker
+	threads, which are kernel threads of the team, so that they resolve the
+	team's file descriptors and buffers and go through the usual VFS paths --
+	files are read and written through the file cache, just like with read()
+	and write(). The results are appended to the completion ring, from where
+	the team picks them up without entering the kernel.
+
+	Operations waiting for a socket to become readable (accept and recv)
+	don't tie up a worker while they wait: the ring selects the socket like
+	an event queue does, and only queues the operation for the workers once
+	the socket reports the event.
+
+	The ring's file descriptor is readable while there are completions to
+	harvest, so it can be waited for with poll() or in an event queue.
+*/
+
+
+#include <io_ring.h>
+
+#include <new>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+#include <Select.h>
+
+#include <condition_variable.h>
+#include <fs/fd.h>
+#include <fs/select_sync_pool.h>
+#include <io_ring_defs.h>
+#include <kernel.h>
+#include <ksignal.h>
+#include <lock.h>
+#include <syscall_restart.h>
+#include <team.h>
+#include <thread.h>
+#include <util/AutoLock.h>
+#include <util/DoublyLinkedList.h>
+#include <vfs.h>
+#include <vm/vm.h>
+#include <wait_for_objects.h>
+
+
+//#define TRACE_IO_RING
+#ifdef TRACE_IO_RING
+#	define TRACE(x) dprintf x
+#else
+#	define TRACE(x) ;
+#endif
+
+
+static const uint32 kDefaultWorkerCount = 4;
+
+static const uint32 kReadyEvents = B_EVENT_READ | B_EVENT_ERROR
+	| B_EVENT_DISCONNECTED | B_EVENT_INVALID;
+	// the events an operation waiting for a socket is started for
+
+
+namespace {
+
+
+struct io_ring_request : select_info,
+		DoublyLinkedListLinkImpl<io_ring_request> {
+	io_ring_submission	submission;
+	bool				selecting;
+		// the socket is being selected, protected by fQueueLock
+	bool				ready;
+		// the socket reported its events, protected by fQueueLock
+	bool				selected;
+		// the socket has to be deselected before the operation is executed
+};
+
+typedef DoublyLinkedList<io_ring_request> RequestList;
+
+
+class IORing : public select_sync {
+public:
+								IORing(team_id team,
+									const io_ring_parameters& parameters);
+	virtual						~IORing();
+
+			team_id				TeamID() const	{ return fTeam; }
+			area_id				UserArea() const { return fUserArea; }
+			void*				UserAddress() const
+									{ return fUserAddress; }
+
+			status_t			Init();
+			status_t			StartWorkers();
+			void				Close();
+
+			uint32				Submit(uint32 count);
+			status_t			WaitForCompletions(uint32 count,
+									uint32 flags, bigtime_t timeout);
+
+			status_t			Select(uint8 event, selectsync* sync);
+			status_t			Deselect(uint8 event, selectsync* sync);
+
+	virtual	status_t			Notify(select_info* info, uint16 events);
+
+private:
+	static	status_t			_WorkerThread(void* cookie);
+
+			io_ring_request*	_NextRequest();
+			void				_Execute(io_ring_request* request);
+
+			void				_Dispatch(io_ring_request* request);
+			void				_SelectSocket(io_ring_request* request);
+			void				_Queue(io_ring_request* request);
+
+			void				_Complete(io_ring_request* request,
+									int64 result);
+			void				_CompleteLocked(io_ring_request* request,
+									int64 result);
+			uint32				_PendingCompletions() const;
+
+private:
+			mutex				fLock;
+				// protects the rings, fFreeRequests, and fInFlight
+			mutex				fSelectLock;
+				// protects fSelectPool; it's a lock of its own, so that
+				// selecting the ring doesn't need fLock, which is held while
+				// the sockets are selected
+			spinlock			fQueueLock;
+				// protects fQueue, and the requests' selecting and ready
+				// flags; fClosed is written with both locks held
+			team_id				fTeam;
+			area_id				fUserArea;
+			void*				fUserAddress;
+			area_id				fKernelArea;
+			uint32				fWorkerCount;
+			io_ring_header*		fHeader;
+			io_ring_submission*	fSubmissions;
+			io_ring_completion*	fCompletions;
+			uint32				fSubmissionEntries;
+			uint32				fCompletionEntries;
+			uint32				fSubmissionHead;
+			uint32				fCompletionTail;
+				// our copies of the indices only we write
+			io_ring_request*	fRequests;
+			RequestList			fFreeRequests;
+			uint32				fInFlight;
+			RequestList			fQueue;
+			ConditionVariable	fQueueCondition;
+			ConditionVariable	fCompletionCondition;
+			select_sync_pool*	fSelectPool;
+			bool				fClosed;
+};
+
+
+}	// namespace
+
+
+static status_t
+check_socket(int fd)
+{
+	file_descriptor* descriptor = get_fd(get_current_io_context(false), fd);
+	if (descriptor == NULL)
+		return B_FILE_ERROR;
+
+	bool isSocket = descriptor->type == FDTYPE_SOCKET;
+	put_fd(descriptor);
+
+	return isSocket ? B_OK : ENOTSOCK;
+}
+
+
+IORing::IORing(team_id team, const io_ring_parameters& parameters)
+	:
+	fTeam(team),
+	fUserArea(-1),
+	fUserAddress(NULL),
+	fKernelArea(-1),
+	fWorkerCount(parameters.worker_count),
+	fHeader(NULL),
+	fSubmissions(NULL),
+	fCompletions(NULL),
+	fSubmissionEntries(parameters.submission_entries),
+	fCompletionEntries(parameters.completion_entries),
+	fSubmissionHead(0),
+	fCompletionTail(0),
+	fRequests(NULL),
+	fInFlight(0),
+	fSelectPool(NULL),
+	fClosed(false)
+{
+	mutex_init(&fLock, "io ring");
+	mutex_init(&fSelectLock, "io ring select");
+	B_INITIALIZE_SPINLOCK(&fQueueLock);
+	fQueueCondition.Init(this, "io ring queue");
+	fCompletionCondition.Init(this, "io ring completions");
+}
+
+
+IORing::~IORing()
+{
+	delete[] fRequests;
+
+	// If the team is gone already, so is its clone.
+	if (fUserArea >= 0)
+		vm_delete_area(fTeam, fUserArea, true);
+	if (fKernelArea >= 0)
+		delete_area(fKernelArea);
+
+	if (fSelectPool != NULL)
+		delete_select_sync_pool(fSelectPool);
+
+	mutex_destroy(&fSelectLock);
+	mutex_destroy(&fLock);
+}
+
+
+status_t
+IORing::Init()
+{
+	// The rings are only accessed with fLock held, so the area doesn't need
+	// to be locked.
+	size_t size = PAGE_ALIGN(io_ring_area_size(fSubmissionEntries,
+		fCompletionEntries));
+	void* areaBase;
+	fKernelArea = create_area("io ring", &areaBase, B_ANY_KERNEL_ADDRESS,
+		size, B_NO_LOCK, B_KERNEL_READ_AREA | B_KERNEL_WRITE_AREA);
+	if (fKernelArea < 0)
+		return fKernelArea;
+
+	// The team must not be able to unmap the rings, or to map something else
+	// in their place, so its clone is a kernel area.
+	fUserArea = vm_clone_area(fTeam, "io ring", &fUserAddress,
+		B_RANDOMIZED_ANY_ADDRESS, B_READ_AREA | B_WRITE_AREA | B_KERNEL_AREA,
+		REGION_NO_PRIVATE_MAP, fKernelArea, true);
+	if (fUserArea < 0)
+		return fUserArea;
+
+	uint32 completionOffset = io_ring_completion_offset(fSubmissionEntries);
+
+	fHeader = (io_ring_header*)areaBase;
+	fSubmissions = (io_ring_submission*)(fHeader + 1);
+	fCompletions = (io_ring_completion*)((uint8*)areaBase + completionOffset);
+
+	memset(fHeader, 0, sizeof(io_ring_header));
+	fHeader->submission_entries = fSubmissionEntries;
+	fHeader->submission_offset = sizeof(io_ring_header);
+	fHeader->completion_entries = fCompletionEntries;
+	fHeader->completion_offset = completionOffset;
+
+	// There can't be more operations in flight than there is room for their
+	// completions, so that's all the requests we'll ever need.
+	fRequests = new(std::nothrow) io_ring_request[fCompletionEntries];
+	if (fRequests == NULL)
+		return B_NO_MEMORY;
+
+	for (uint32 i = 0; i < fCompletionEntries; i++) {
+		fRequests[i].ready = false;
+		fRequests[i].selected = false;
+		fFreeRequests.Add(&fRequests[i]);
+	}
+
+	return B_OK;
+}
+
+
+status_t
+IORing::StartWorkers()
+{
+	for (uint32 i = 0; i < fWorkerCount; i++) {
+		// every worker keeps a reference to the ring
+		atomic_add(&ref_count, 1);
+
+		thread_id thread = spawn_kernel_thread_etc(&_WorkerThread,
+			"io ring worker", B_NORMAL_PRIORITY, this, fTeam);
+		if (thread < 0) {
+			atomic_add(&ref_count, -1);
+			return thread;
+		}
+
+		resume_thread(thread);
+	}
+
+	return B_OK;
+}
+
+
+/*!	Called when the ring's file descriptor is closed. Lets the workers quit
+	and deselects the sockets the ring is still waiting for. Operations the
+	workers are executing at the moment are still completed.
+*/
+void
+IORing::Close()
+{
+	MutexLocker locker(fLock);
+
+	RequestList selectedRequests;
+
+	InterruptsSpinLocker queueLocker(fQueueLock);
+	fClosed = true;
+
+	// Nobody is going to execute the queued requests anymore. Of the others
+	// only those whose sockets haven't reported yet are still selected.
+	while (io_ring_request* request = fQueue.RemoveHead()) {
+		if (request->selected)
+			selectedRequests.Add(request);
+	}
+
+	for (uint32 i = 0; i < fCompletionEntries; i++) {
+		io_ring_request* request = &fRequests[i];
+		if (request->selected && !request->ready) {
+			request->ready = true;
+			selectedRequests.Add(request);
+		}
+	}
+
+	fQueueCondition.NotifyAll(B_FILE_ERROR);
+	queueLocker.Unlock();
+
+	// When the team is going away, its I/O context has dropped the
+	// selections already -- and it isn't the current one anyway.
+	bool deselect = thread_get_current_thread()->team->id == fTeam;
+
+	while (io_ring_request* request = selectedRequests.RemoveHead()) {
+		if (deselect) {
+			deselect_object(B_OBJECT_TYPE_FD, request->submission.fd, request,
+				false);
+		}
+		request->selected = false;
+	}
+
+	fCompletionCondition.NotifyAll(B_FILE_ERROR);
+}
+
+
+/*!	Moves up to \a count entries from the submission ring to the workers.
+	Returns the number of entries consumed, which is less than \a count, if
+	the completion ring doesn't have room for more operations in flight.
+*/
+uint32
+IORing::Submit(uint32 count)
+{
+	MutexLocker locker(fLock);
+
+	uint32 tail = (uint32)atomic_get(&fHeader->submission_tail);
+	uint32 available = tail - fSubmissionHead;
+	if (available > fSubmissionEntries) {
+		// the team messed up the index
+		available = 0;
+	}
+
+	count = min_c(count, available);
+
+	uint32 submitted = 0;
+	while (submitted < count && !fClosed
+		&& fInFlight + _PendingCompletions() < fCompletionEntries) {
+		io_ring_request* request = fFreeRequests.RemoveHead();
+
+		// Copy the entry first -- the team may change it any time.
+		memcpy(&request->submission,
+			&fSubmissions[fSubmissionHead & (fSubmissionEntries - 1)],
+			sizeof(io_ring_submission));
+		fSubmissionHead++;
+		fInFlight++;
+		submitted++;
+
+		_Dispatch(request);
+	}
+
+	atomic_set(&fHeader->submission_head, (int32)fSubmissionHead);
+
+	return submitted;
+}
+
+
+status_t
+IORing::WaitForCompletions(uint32 count, uint32 flags, bigtime_t timeout)
+{
+	count = min_c(count, fCompletionEntries);
+
+	while (true) {
+		MutexLocker locker(fLock);
+		if (fClosed)
+			return B_FILE_ERROR;
+
+		if (_PendingCompletions() >= count)
+			return B_OK;
+
+		if ((flags & B_RELATIVE_TIMEOUT) != 0 && timeout <= 0)
+			return B_WOULD_BLOCK;
+
+		ConditionVariableEntry entry;
+		fCompletionCondition.Add(&entry);
+		locker.Unlock();
+
+		status_t status = entry.Wait(flags, timeout);
+		if (status != B_OK)
+			return status;
+	}
+}
+
+
+status_t
+IORing::Select(uint8 event, selectsync* sync)
+{
+	if (event != B_SELECT_READ)
+		return B_BAD_VALUE;
+
+	MutexLocker locker(fSelectLock);
+
+	status_t status = add_select_sync_pool_entry(&fSelectPool, sync, event);
+	if (status != B_OK)
+		return status;
+
+	if (_PendingCompletions() > 0)
+		notify_select_event(sync, event);
+
+	return B_OK;
+}
+
+
+status_t
+IORing::Deselect(uint8 event, selectsync* sync)
+{
+	MutexLocker locker(fSelectLock);
+	return remove_select_sync_pool_entry(&fSelectPool, sync, event);
+}
+
+
+/*!	Called when a socket an operation waits for reports its events. May be
+	called with spinlocks held, so it only queues the operation for the
+	workers.
+*/
+status_t
+IORing::Notify(select_info* info, uint16 events)
+{
+	io_ring_request* request = static_cast<io_ring_request*>(info);
+	if ((info->selected_events & events) == 0)
+		return B_OK;
+
+	InterruptsSpinLocker locker(fQueueLock);
+
+	if (request->ready || fClosed)
+		return B_OK;
+
+	request->ready = true;
+
+	// If the socket reported right when it was selected, _SelectSocket()
+	// queues the request itself.
+	if (!request->selecting)
+		_Queue(request);
+
+	return B_OK;
+}
+
+
+/*static*/ status_t
+IORing::_WorkerThread(void* cookie)
+{
+	IORing* ring = (IORing*)cookie;
+
+	// Signals sent to the team are meant for its userland threads.
+	Thread* thread = thread_get_current_thread();
+	InterruptsSpinLocker signalLocker(thread->team->signal_lock);
+	thread->sig_block_mask = ~KILL_SIGNALS;
+	signalLocker.Unlock();
+
+	while (true) {
+		io_ring_request* request = ring->_NextRequest();
+		if (request == NULL)
+			break;
+
+		ring->_Execute(request);
+	}
+
+	put_select_sync(ring);
+	return B_OK;
+}
+
+
+/*!	Returns the next request to execute, or \c NULL, when the worker shall
+	quit, because the ring has been closed or the team is going away.
+*/
+io_ring_request*
+IORing::_NextRequest()
+{
+	InterruptsSpinLocker locker(fQueueLock);
+
+	while (!fClosed) {
+		io_ring_request* request = fQueue.RemoveHead();
+		if (request != NULL)
+			return request;
+
+		ConditionVariableEntry entry;
+		fQueueCondition.Add(&entry);
+		locker.Unlock();
+
+		if (entry.Wait(B_KILL_CAN_INTERRUPT) == B_INTERRUPTED)
+			return NULL;
+
+		locker.Lock();
+	}
+
+	return NULL;
+}
+
+
+void
+IORing::_Execute(io_ring_request* request)
+{
+	io_ring_submission& submission = request->submission;
+
+	if (request->selected) {
+		deselect_object(B_OBJECT_TYPE_FD, submission.fd, request, false);
+		request->selected = false;
+	}
+
+	// The buffers are checked by the syscalls.
+	int64 result;
+	switch (submission.operation) {
+		case B_IO_RING_READ:
+			result = _user_read(submission.fd, submission.offset,
+				submission.buffer, submission.length);
+			break;
+		case B_IO_RING_WRITE:
+			result = _user_write(submission.fd, submission.offset,
+				submission.buffer, submission.length);
+			break;
+		case B_IO_RING_READV:
+			result = _user_readv(submission.fd, submission.offset,
+				(const iovec*)submission.buffer, submission.length);
+			break;
+		case B_IO_RING_WRITEV:
+			result = _user_writev(submission.fd, submission.offset,
+				(const iovec*)submission.buffer, submission.length);
+			break;
+		case B_IO_RING_FSYNC:
+			result = _user_fsync(submission.fd);
+			break;
+		case B_IO_RING_ACCEPT:
+			result = _user_accept(submission.fd, NULL, NULL);
+			break;
+		case B_IO_RING_RECV:
+			result = _user_recv(submission.fd, submission.buffer,
+				submission.length, submission.flags);
+			break;
+		case B_IO_RING_SEND:
+			result = _user_send(submission.fd, submission.buffer,
+				submission.length, submission.flags);
+			break;
+		default:
+			result = B_BAD_VALUE;
+			break;
+	}
+
+	_Complete(request, result);
+}
+
+
+/*!	fLock must be held. */
+void
+IORing::_Dispatch(io_ring_request* request)
+{
+	switch (request->submission.operation) {
+		case B_IO_RING_NOP:
+			_CompleteLocked(request, B_OK);
+			return;
+
+		case B_IO_RING_ACCEPT:
+		case B_IO_RING_RECV:
+			_SelectSocket(request);
+			return;
+
+		default:
+			if (request->submission.operation >= B_IO_RING_OPERATION_COUNT) {
+				_CompleteLocked(request, B_BAD_VALUE);
+				return;
+			}
+			break;
+	}
+
+	InterruptsSpinLocker queueLocker(fQueueLock);
+	_Queue(request);
+}
+
+
+/*!	Selects the socket \a request waits for, so that Notify() queues it once
+	the socket becomes readable. fLock must be held.
+*/
+void
+IORing::_SelectSocket(io_ring_request* request)
+{
+	// Other objects could call back into the ring while they are selected.
+	status_t status = check_socket(request->submission.fd);
+	if (status != B_OK) {
+		_CompleteLocked(request, status);
+		return;
+	}
+
+	request->next = NULL;
+	request->sync = this;
+	request->events = 0;
+	request->selected_events = kReadyEvents;
+
+	InterruptsSpinLocker queueLocker(fQueueLock);
+	request->selecting = true;
+	request->ready = false;
+	queueLocker.Unlock();
+
+	status = select_object(B_OBJECT_TYPE_FD, request->submission.fd, request,
+		false);
+
+	queueLocker.Lock();
+	request->selecting = false;
+
+	if (status != B_OK) {
+		queueLocker.Unlock();
+		_CompleteLocked(request, status);
+		return;
+	}
+
+	request->selected = true;
+	if (request->ready)
+		_Queue(request);
+}
+
+
+/*!	fQueueLock must be held. */
+void
+IORing::_Queue(io_ring_request* request)
+{
+	fQueue.Add(request);
+	fQueueCondition.NotifyOne();
+}
+
+
+void
+IORing::_Complete(io_ring_request* request, int64 result)
+{
+	MutexLocker locker(fLock);
+	_CompleteLocked(request, result);
+}
+
+
+/*!	Appends the completion of \a request to the completion ring, and returns
+	the request to the free list. fLock must be held.
+*/
+void
+IORing::_CompleteLocked(io_ring_request* request, int64 result)
+{
+	TRACE(("io ring %p: operation %u on fd %" B_PRId32 " completed: %"
+		B_PRId64 "\n", this, request->submission.operation,
+		request->submission.fd, result));
+
+	uint32 head = (uint32)atomic_get(&fHeader->completion_head);
+	if (fCompletionTail - head < fCompletionEntries) {
+		io_ring_completion& completion
+			= fCompletions[fCompletionTail & (fCompletionEntries - 1)];
+		completion.user_data = request->submission.user_data;
+		completion.result = result;
+
+		// publish the completion
+		fCompletionTail++;
+		atomic_set(&fHeader->completion_tail, (int32)fCompletionTail);
+	} else
+		atomic_add(&fHeader->completions_dropped, 1);
+
+	fInFlight--;
+	fFreeRequests.Add(request);
+
+	fCompletionCondition.NotifyAll();
+
+	MutexLocker selectLocker(fSelectLock);
+	if (fSelectPool != NULL)
+		notify_select_event_pool(fSelectPool, B_SELECT_READ);
+}
+
+
+/*!	Returns the number of completions the team hasn't consumed yet. A bogus
+	completion head counts as a full ring. fLock or fSelectLock must be held;
+	_CompleteLocked() notifies the select pool after publishing a completion.
+*/
+uint32
+IORing::_PendingCompletions() const
+{
+	uint32 pending = fCompletionTail
+		- (uint32)atomic_get(&fHeader->completion_head);
+	return min_c(pending, fCompletionEntries);
+}
+
+
+// #pragma mark - file descriptor
+
+
+static status_t
+io_ring_select(file_descriptor* descriptor, uint8 event, selectsync* sync)
+{
+	IORing* ring = (IORing*)descriptor->cookie;
+	return ring->Select(event, sync);
+}
+
+
+static status_t
+io_ring_deselect(file_descriptor* descriptor, uint8 event, selectsync* sync)
+{
+	IORing* ring = (IORing*)descriptor->cookie;
+	return ring->Deselect(event, sync);
+}
+
+
+static status_t
+io_ring_close(file_descriptor* descriptor)
+{
+	IORing* ring = (IORing*)descriptor->cookie;
+	ring->Close();
+	return B_OK;
+}
+
+
+static void
+io_ring_free(file_descriptor* descriptor)
+{
+	IORing* ring = (IORing*)descriptor->cookie;
+	put_select_sync(ring);
+}
+
+
+static struct fd_ops sIORingFDOps = {
+	NULL,	// fd_read
+	NULL,	// fd_write
+	NULL,	// fd_seek
+	NULL,	// fd_ioctl
+	NULL,	// fd_set_flags
+	&io_ring_select,
+	&io_ring_deselect,
+	NULL,	// fd_read_dir
+	NULL,	// fd_rewind_dir
+	NULL,	// fd_read_stat
+	NULL,	// fd_write_stat
+	&io_ring_close,
+	&io_ring_free
+};
+
+
+static status_t
+get_io_ring_descriptor(int fd, file_descriptor*& _descriptor)
+{
+	if (fd < 0)
+		return B_FILE_ERROR;
+
+	file_descriptor* descriptor = get_fd(get_current_io_context(false), fd);
+	if (descriptor == NULL)
+		return B_FILE_ERROR;
+
+	if (descriptor->type != FDTYPE_IO_RING) {
+		put_fd(descriptor);
+		return B_BAD_VALUE;
+	}
+
+	_descriptor = descriptor;
+	return B_OK;
+}
+
+
+//	#pragma mark - User syscalls
+
+
+int
+_user_io_ring_create(io_ring_parameters* userParameters)
+{
+	io_ring_parameters parameters;
+	if (userParameters == NULL || !IS_USER_ADDRESS(userParameters)
+		|| user_memcpy(&parameters, userParameters, sizeof(parameters))
+			!= B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	// check the parameters
+	uint32 submissionEntries = parameters.submission_entries;
+	uint32 completionEntries = parameters.completion_entries;
+	if (submissionEntries == 0 || submissionEntries > B_IO_RING_MAX_ENTRIES
+		|| (submissionEntries & (submissionEntries - 1)) != 0
+		|| completionEntries < submissionEntries
+		|| completionEntries > B_IO_RING_MAX_ENTRIES
+		|| (completionEntries & (completionEntries - 1)) != 0
+		|| parameters.worker_count > B_IO_RING_MAX_WORKERS
+		|| parameters.flags != 0) {
+		return B_BAD_VALUE;
+	}
+
+	if (parameters.worker_count == 0)
+		parameters.worker_count = kDefaultWorkerCount;
+
+	team_id team = thread_get_current_thread()->team->id;
+
+	IORing* ring = new(std::nothrow) IORing(team, parameters);
+	if (ring == NULL)
+		return B_NO_MEMORY;
+
+	status_t status = ring->Init();
+	if (status != B_OK) {
+		delete ring;
+		return status;
+	}
+
+	parameters.area = ring->UserArea();
+	parameters.address = ring->UserAddress();
+	if (user_memcpy(userParameters, &parameters, sizeof(parameters))
+			!= B_OK) {
+		delete ring;
+		return B_BAD_ADDRESS;
+	}
+
+	file_descriptor* descriptor = alloc_fd();
+	if (descriptor == NULL) {
+		delete ring;
+		return B_NO_MEMORY;
+	}
+
+	descriptor->type = FDTYPE_IO_RING;
+	descriptor->ops = &sIORingFDOps;
+	descriptor->cookie = ring;
+	descriptor->open_mode = O_RDWR;
+
+	io_context* context = get_current_io_context(false);
+	int fd = new_fd(context, descriptor);
+	if (fd < 0) {
+		free(descriptor);
+		delete ring;
+		return fd;
+	}
+
+	// The workers don't survive an exec(), so neither does the ring.
+	mutex_lock(&context->io_mutex);
+	fd_set_close_on_exec(context, fd, true);
+	mutex_unlock(&context->io_mutex);
+
+	status = ring->StartWorkers();
+	if (status != B_OK) {
+		close_fd_index(context, fd);
+		return status;
+	}
+
+	TRACE(("_user_io_ring_create(): ring %p, fd %d\n", ring, fd));
+	return fd;
+}
+
+
+ssize_t
+_user_io_ring_enter(int ring, uint32 toSubmit, uint32 minComplete,
+	uint32 flags, bigtime_t timeout)
+{
+	syscall_restart_handle_timeout_pre(flags, timeout);
+
+	file_descriptor* descriptor;
+	status_t status = get_io_ring_descriptor(ring, descriptor);
+	if (status != B_OK)
+		return status;
+
+	IORing* ioRing = (IORing*)descriptor->cookie;
+
+	// The workers belong to the team that created the ring.
+	if (ioRing->TeamID() != thread_get_current_thread()->team->id) {
+		put_fd(descriptor);
+		return B_NOT_ALLOWED;
+	}
+
+	uint32 submitted = 0;
+	if (toSubmit > 0)
+		submitted = ioRing->Submit(toSubmit);
+
+	if (minComplete > 0) {
+		status = ioRing->WaitForCompletions(minComplete,
+			(flags & (B_RELATIVE_TIMEOUT | B_ABSOLUTE_TIMEOUT))
+				| B_CAN_INTERRUPT, timeout);
+	}
+
+	put_fd(descriptor);
+
+	// Only fail, if nothing has been submitted, so that the team doesn't lose
+	// track of the entries.
+	if (status != B_OK && submitted == 0)
+		return syscall_restart_handle_timeout_post(status, timeout);
+
+	return submitted;
+}
@@ -9,12 +9,12 @@
 #include <user_mutex_defs.h>
 
 #include <condition_variable.h>
+#include <cpu.h>
 #include <kernel.h>
 #include <lock.h>
 #include <smp.h>
 #include <syscall_restart.h>
 #include <util/AutoLock.h>
-#include <util/OpenHashTable.h>
 #include <vm/vm.h>
 #include <vm/VMArea.h>
 
@@ -30,53 +30,80 @@ struct UserMutexEntry : public DoublyLinkedListLinkImpl<UserMutexEntry> {
 	UserMutexEntry*		hashNext;
 };
 
-struct UserMutexHashDefinition {
-	typedef addr_t			KeyType;
-	typedef UserMutexEntry	ValueType;
+/*!	The waiters are hashed into buckets by the physical address of the mutex,
+	and each bucket has its own lock, so that threads using unrelated mutexes
+	don't contend in the kernel. A bucket's entries are the first entries of
+	the addresses waited on, chained by UserMutexEntry::hashNext.
+*/
+struct UserMutexBucket {
+	mutex				lock;
+	UserMutexEntry*		entries;
+} CACHE_LINE_ALIGN;
 
-	size_t HashKey(addr_t key) const
-	{
-		return key >> 2;
-	}
 
-	size_t Hash(const UserMutexEntry* value) const
-	{
-		return HashKey(value->address);
-	}
+static const uint32 kUserMutexBucketShift = 8;
+static const uint32 kUserMutexBucketCount = 1 << kUserMutexBucketShift;
 
-	bool Compare(addr_t key, const UserMutexEntry* value) const
-	{
-		return value->address == key;
-	}
+static UserMutexBucket sUserMutexBuckets[kUserMutexBucketCount];
 
-	UserMutexEntry*& GetLink(UserMutexEntry* value) const
-	{
-		return value->hashNext;
-	}
-};
 
-typedef BOpenHashTable<UserMutexHashDefinition> UserMutexTable;
+static inline UserMutexBucket&
+user_mutex_bucket(addr_t physicalAddress)
+{
+	// Fibonacci hashing, so that mutexes at the same offset in different
+	// pages don't end up in the same bucket
+	uint32 hash = (uint32)(physicalAddress >> 2) * 0x9e3779b1U;
+	return sUserMutexBuckets[hash >> (32 - kUserMutexBucketShift)];
+}
+
+
+static UserMutexEntry*
+lookup_user_mutex_entry(UserMutexBucket& bucket, addr_t address)
+{
+	UserMutexEntry* entry = bucket.entries;
+	while (entry != NULL && entry->address != address)
+		entry = entry->hashNext;
+
+	return entry;
+}
+
+
+static void
+insert_user_mutex_entry(UserMutexBucket& bucket, UserMutexEntry* entry)
+{
+	entry->hashNext = bucket.entries;
+	bucket.entries = entry;
+}
+
 
+static void
+unlink_user_mutex_entry(UserMutexBucket& bucket, UserMutexEntry* entry)
+{
+	UserMutexEntry** link = &bucket.entries;
+	while (*link != entry)
+		link = &(*link)->hashNext;
 
-static UserMutexTable sUserMutexTable;
-static mutex sUserMutexTableLock = MUTEX_INITIALIZER("user mutex table");
+	*link = entry->hashNext;
+}
 
 
 static void
-add_user_mutex_entry(UserMutexEntry* entry)
+add_user_mutex_entry(UserMutexBucket& bucket, UserMutexEntry* entry)
 {
-	UserMutexEntry* firstEntry = sUserMutexTable.Lookup(entry->address);
+	UserMutexEntry* firstEntry = lookup_user_mutex_entry(bucket,
+		entry->address);
 	if (firstEntry != NULL)
 		firstEntry->otherEntries.Add(entry);
 	else
-		sUserMutexTable.Insert(entry);
+		insert_user_mutex_entry(bucket, entry);
 }
 
 
 static bool
-remove_user_mutex_entry(UserMutexEntry* entry)
+remove_user_mutex_entry(UserMutexBucket& bucket, UserMutexEntry* entry)
 {
-	UserMutexEntry* firstEntry = sUserMutexTable.Lookup(entry->address);
+	UserMutexEntry* firstEntry = lookup_user_mutex_entry(bucket,
+		entry->address);
 	if (firstEntry != entry) {
 		// The entry is not the first entry in the table. Just remove it from
 		// the first entry's list.
@@ -86,12 +113,12 @@ remove_user_mutex_entry(UserMutexEntry* entry)
 
 	// The entry is the first entry in the table. Remove it from the table and,
 	// if any, add the next entry to the table.
-	sUserMutexTable.Remove(entry);
+	unlink_user_mutex_entry(bucket, entry);
 
 	firstEntry = entry->otherEntries.RemoveHead();
 	if (firstEntry != NULL) {
 		firstEntry->otherEntries.MoveFrom(&entry->otherEntries);
-		sUserMutexTable.Insert(firstEntry);
+		insert_user_mutex_entry(bucket, firstEntry);
 		return true;
 	}
 
@@ -100,14 +127,15 @@ remove_user_mutex_entry(UserMutexEntry* entry)
 
 
 static status_t
-user_mutex_wait_locked(int32* mutex, addr_t physicalAddress, const char* name,
-	uint32 flags, bigtime_t timeout, MutexLocker& locker, bool& lastWaiter)
+user_mutex_wait_locked(UserMutexBucket& bucket, int32* mutex,
+	addr_t physicalAddress, const char* name, uint32 flags, bigtime_t timeout,
+	MutexLocker& locker, bool& lastWaiter)
 {
 	// add the entry to the table
 	UserMutexEntry entry;
 	entry.address = physicalAddress;
 	entry.locked = false;
-	add_user_mutex_entry(&entry);
+	add_user_mutex_entry(bucket, &entry);
 
 	// wait
 	ConditionVariableEntry waitEntry;
@@ -123,7 +151,7 @@ user_mutex_wait_locked(int32* mutex, addr_t physicalAddress, const char* name,
 
 	if (!entry.locked) {
 		// if nobody woke us up, we have to dequeue ourselves
-		lastWaiter = !remove_user_mutex_entry(&entry);
+		lastWaiter = !remove_user_mutex_entry(bucket, &entry);
 	} else {
 		// otherwise the waker has done the work of marking the
 		// mutex or semaphore uncontended
@@ -135,8 +163,9 @@ user_mutex_wait_locked(int32* mutex, addr_t physicalAddress, const char* name,
 
 
 static status_t
-user_mutex_lock_locked(int32* mutex, addr_t physicalAddress,
-	const char* name, uint32 flags, bigtime_t timeout, MutexLocker& locker)
+user_mutex_lock_locked(UserMutexBucket& bucket, int32* mutex,
+	addr_t physicalAddress, const char* name, uint32 flags, bigtime_t timeout,
+	MutexLocker& locker)
 {
 	// mark the mutex locked + waiting
 	int32 oldValue = atomic_or(mutex,
@@ -150,8 +179,8 @@ user_mutex_lock_locked(int32* mutex, addr_t physicalAddress,
 	}
 
 	bool lastWaiter;
-	status_t error = user_mutex_wait_locked(mutex, physicalAddress, name,
-		flags, timeout, locker, lastWaiter);
+	status_t error = user_mutex_wait_locked(bucket, mutex, physicalAddress,
+		name, flags, timeout, locker, lastWaiter);
 
 	if (lastWaiter)
 		atomic_and(mutex, ~(int32)B_USER_MUTEX_WAITING);
@@ -161,9 +190,10 @@ user_mutex_lock_locked(int32* mutex, addr_t physicalAddress,
 
 
 static void
-user_mutex_unlock_locked(int32* mutex, addr_t physicalAddress, uint32 flags)
+user_mutex_unlock_locked(UserMutexBucket& bucket, int32* mutex,
+	addr_t physicalAddress, uint32 flags)
 {
-	UserMutexEntry* entry = sUserMutexTable.Lookup(physicalAddress);
+	UserMutexEntry* entry = lookup_user_mutex_entry(bucket, physicalAddress);
 	if (entry == NULL) {
 		// no one is waiting -- clear locked flag
 		atomic_and(mutex, ~(int32)B_USER_MUTEX_LOCKED);
@@ -188,10 +218,10 @@ user_mutex_unlock_locked(int32* mutex, addr_t physicalAddress, uint32 flags)
 		}
 
 		// dequeue the first thread and mark the mutex uncontended
-		sUserMutexTable.Remove(entry);
+		unlink_user_mutex_entry(bucket, entry);
 		atomic_and(mutex, ~(int32)B_USER_MUTEX_WAITING);
 	} else {
-		bool otherWaiters = remove_user_mutex_entry(entry);
+		bool otherWaiters = remove_user_mutex_entry(bucket, entry);
 		if (!otherWaiters)
 			atomic_and(mutex, ~(int32)B_USER_MUTEX_WAITING);
 	}
@@ -199,8 +229,9 @@ user_mutex_unlock_locked(int32* mutex, addr_t physicalAddress, uint32 flags)
 
 
 static status_t
-user_mutex_sem_acquire_locked(int32* sem, addr_t physicalAddress,
-	const char* name, uint32 flags, bigtime_t timeout, MutexLocker& locker)
+user_mutex_sem_acquire_locked(UserMutexBucket& bucket, int32* sem,
+	addr_t physicalAddress, const char* name, uint32 flags, bigtime_t timeout,
+	MutexLocker& locker)
 {
 	// The semaphore may have been released in the meantime, and we also
 	// need to mark it as contended if it isn't already.
@@ -213,8 +244,8 @@ user_mutex_sem_acquire_locked(int32* sem, addr_t physicalAddress,
 	}
 
 	bool lastWaiter;
-	status_t error = user_mutex_wait_locked(sem, physicalAddress, name, flags,
-		timeout, locker, lastWaiter);
+	status_t error = user_mutex_wait_locked(bucket, sem, physicalAddress, name,
+		flags, timeout, locker, lastWaiter);
 
 	if (lastWaiter)
 		atomic_test_and_set(sem, 0, -1);
@@ -224,9 +255,10 @@ user_mutex_sem_acquire_locked(int32* sem, addr_t physicalAddress,
 
 
 static void
-user_mutex_sem_release_locked(int32* sem, addr_t physicalAddress)
+user_mutex_sem_release_locked(UserMutexBucket& bucket, int32* sem,
+	addr_t physicalAddress)
 {
-	UserMutexEntry* entry = sUserMutexTable.Lookup(physicalAddress);
+	UserMutexEntry* entry = lookup_user_mutex_entry(bucket, physicalAddress);
 	if (!entry) {
 		// no waiters - mark as uncontended and release
 		int32 oldValue = atomic_get(sem);
@@ -239,7 +271,7 @@ user_mutex_sem_release_locked(int32* sem, addr_t physicalAddress)
 		}
 	}
 
-	bool otherWaiters = remove_user_mutex_entry(entry);
+	bool otherWaiters = remove_user_mutex_entry(bucket, entry);
 
 	entry->locked = true;
 	entry->condition.NotifyOne();
@@ -263,9 +295,10 @@ user_mutex_lock(int32* mutex, const char* name, uint32 flags, bigtime_t timeout)
 
 	// get the lock
 	{
-		MutexLocker locker(sUserMutexTableLock);
-		error = user_mutex_lock_locked(mutex, wiringInfo.physicalAddress, name,
-			flags, timeout, locker);
+		UserMutexBucket& bucket = user_mutex_bucket(wiringInfo.physicalAddress);
+		MutexLocker locker(bucket.lock);
+		error = user_mutex_lock_locked(bucket, mutex,
+			wiringInfo.physicalAddress, name, flags, timeout, locker);
 	}
 
 	// unwire the page
@@ -293,14 +326,32 @@ user_mutex_switch_lock(int32* fromMutex, int32* toMutex, const char* name,
 		return error;
 	}
 
-	// unlock the first mutex and lock the second one
+	// Unlock the first mutex and lock the second one. Both buckets are
+	// locked, in a fixed order, so that nobody can get in between. Only the
+	// second one needs to stay locked until we're waiting, though.
 	{
-		MutexLocker locker(sUserMutexTableLock);
-		user_mutex_unlock_locked(fromMutex, fromWiringInfo.physicalAddress,
-			flags);
+		UserMutexBucket& fromBucket
+			= user_mutex_bucket(fromWiringInfo.physicalAddress);
+		UserMutexBucket& toBucket
+			= user_mutex_bucket(toWiringInfo.physicalAddress);
+
+		MutexLocker fromLocker;
+		MutexLocker toLocker;
+		if (&fromBucket < &toBucket) {
+			fromLocker.SetTo(fromBucket.lock, false);
+			toLocker.SetTo(toBucket.lock, false);
+		} else {
+			toLocker.SetTo(toBucket.lock, false);
+			if (&fromBucket != &toBucket)
+				fromLocker.SetTo(fromBucket.lock, false);
+		}
+
+		user_mutex_unlock_locked(fromBucket, fromMutex,
+			fromWiringInfo.physicalAddress, flags);
+		fromLocker.Unlock();
 
-		error = user_mutex_lock_locked(toMutex, toWiringInfo.physicalAddress,
-			name, flags, timeout, locker);
+		error = user_mutex_lock_locked(toBucket, toMutex,
+			toWiringInfo.physicalAddress, name, flags, timeout, toLocker);
 	}
 
 	// unwire the pages
@@ -317,8 +368,10 @@ user_mutex_switch_lock(int32* fromMutex, int32* toMutex, const char* name,
 void
 user_mutex_init()
 {
-	if (sUserMutexTable.Init() != B_OK)
-		panic("user_mutex_init(): Failed to init table!");
+	for (uint32 i = 0; i < kUserMutexBucketCount; i++) {
+		mutex_init(&sUserMutexBuckets[i].lock, "user mutex bucket");
+		sUserMutexBuckets[i].entries = NULL;
+	}
 }
 
 
@@ -355,8 +408,10 @@ _user_mutex_unlock(int32* mutex, uint32 flags)
 		return error;
 
 	{
-		MutexLocker locker(sUserMutexTableLock);
-		user_mutex_unlock_locked(mutex, wiringInfo.physicalAddress, flags);
+		UserMutexBucket& bucket = user_mutex_bucket(wiringInfo.physicalAddress);
+		MutexLocker locker(bucket.lock);
+		user_mutex_unlock_locked(bucket, mutex, wiringInfo.physicalAddress,
+			flags);
 	}
 
 	vm_unwire_page(&wiringInfo);
@@ -397,9 +452,11 @@ _user_mutex_sem_acquire(int32* sem, const char* name, uint32 flags,
 		return error;
 
 	{
-		MutexLocker locker(sUserMutexTableLock);
-		error = user_mutex_sem_acquire_locked(sem, wiringInfo.physicalAddress,
-			name, flags | B_CAN_INTERRUPT, timeout, locker);
+		UserMutexBucket& bucket = user_mutex_bucket(wiringInfo.physicalAddress);
+		MutexLocker locker(bucket.lock);
+		error = user_mutex_sem_acquire_locked(bucket, sem,
+			wiringInfo.physicalAddress, name, flags | B_CAN_INTERRUPT, timeout,
+			locker);
 	}
 
 	vm_unwire_page(&wiringInfo);
@@ -421,8 +478,9 @@ _user_mutex_sem_release(int32* sem)
 		return error;
 
 	{
-		MutexLocker locker(sUserMutexTableLock);
-		user_mutex_sem_release_locked(sem, wiringInfo.physicalAddress);
+		UserMutexBucket& bucket = user_mutex_bucket(wiringInfo.physicalAddress);
+		MutexLocker locker(bucket.lock);
+		user_mutex_sem_release_locked(bucket, sem, wiringInfo.physicalAddress);
 	}
 
 	vm_unwire_page(&wiringInfo);
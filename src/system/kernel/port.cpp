@@ -34,6 +34,7 @@
 #include <util/AutoLock.h>
 #include <util/list.h>
 #include <vm/vm.h>
+#include <vm/vm_page.h>
 #include <wait_for_objects.h>
 
 
@@ -94,7 +95,15 @@ struct port_message : DoublyLinkedListLinkImpl<port_message> {
 	uid_t				sender;
 	gid_t				sender_group;
 	team_id				sender_team;
+	uint32				page_count;
+		// if not 0, the message is stored in pages, and the buffer holds
+		// the vm_page array
 	char				buffer[0];
+
+	vm_page** Pages()
+	{
+		return (vm_page**)buffer;
+	}
 };
 
 typedef DoublyLinkedList<port_message> MessageList;
@@ -444,6 +453,10 @@ static const size_t kBufferGrowRate = kInitialPortBufferSize;
 #define MAX_QUEUE_LENGTH 4096
 #define PORT_MAX_MESSAGE_SIZE (256 * 1024)
 
+static const size_t kPagedMessageThreshold = 64 * 1024;
+	// messages of at least this size are stored in pages, so that they can
+	// be moved into the reader's buffer (B_REMAP_PORT_MESSAGE)
+
 static int32 sMaxPorts = 4096;
 static int32 sUsedPorts;
 
@@ -668,6 +681,18 @@ static void
 put_port_message(port_message* message)
 {
 	const size_t size = sizeof(port_message) + message->size;
+
+	for (uint32 i = 0; i < message->page_count; i++) {
+		vm_page* page = message->Pages()[i];
+		if (page == NULL) {
+			// moved into the reader's buffer
+			continue;
+		}
+
+		DEBUG_PAGE_ACCESS_START(page);
+		vm_page_set_state(page, PAGE_STATE_FREE);
+	}
+
 	free(message);
 
 	atomic_add(&sTotalSpaceCommited, -size);
@@ -676,6 +701,40 @@ put_port_message(port_message* message)
 }
 
 
+/*!	Allocates a message that stores its data in pages instead of its buffer.
+	Returns \c NULL, if the pages can't be reserved right away.
+*/
+static port_message*
+allocate_paged_port_message(size_t bufferSize)
+{
+	uint32 pageCount = (bufferSize + B_PAGE_SIZE - 1) / B_PAGE_SIZE;
+
+	port_message* message = (port_message*)malloc(sizeof(port_message)
+		+ pageCount * sizeof(vm_page*));
+	if (message == NULL)
+		return NULL;
+
+	vm_page_reservation reservation;
+	if (!vm_page_try_reserve_pages(&reservation, pageCount,
+			VM_PRIORITY_USER)) {
+		free(message);
+		return NULL;
+	}
+
+	for (uint32 i = 0; i < pageCount; i++) {
+		vm_page* page = vm_page_allocate_page(&reservation,
+			PAGE_STATE_WIRED);
+		DEBUG_PAGE_ACCESS_END(page);
+		message->Pages()[i] = page;
+	}
+
+	vm_page_unreserve_pages(&reservation);
+
+	message->page_count = pageCount;
+	return message;
+}
+
+
 /*! Port must be locked. */
 static status_t
 get_port_message(int32 code, size_t bufferSize, uint32 flags, bigtime_t timeout,
@@ -731,7 +790,14 @@ get_port_message(int32 code, size_t bufferSize, uint32 flags, bigtime_t timeout,
 		}
 
 		// Quota is fulfilled, try to allocate the buffer
-		port_message* message = (port_message*)malloc(size);
+		port_message* message = NULL;
+		if (bufferSize >= kPagedMessageThreshold)
+			message = allocate_paged_port_message(bufferSize);
+		if (message == NULL) {
+			message = (port_message*)malloc(size);
+			if (message != NULL)
+				message->page_count = 0;
+		}
 		if (message != NULL) {
 			message->code = code;
 			message->size = bufferSize;
@@ -766,9 +832,77 @@ fill_port_info(Port* port, port_info* info, size_t size)
 }
 
 
+/*!	Copies \a size bytes at \a offset of the message data from or to
+	\a buffer.
+*/
+static status_t
+copy_message_data(port_message* message, size_t offset, void* buffer,
+	size_t size, bool toMessage, bool userCopy)
+{
+	if (message->page_count == 0) {
+		void* data = message->buffer + offset;
+		if (userCopy) {
+			return toMessage ? user_memcpy(data, buffer, size)
+				: user_memcpy(buffer, data, size);
+		}
+
+		if (toMessage)
+			memcpy(data, buffer, size);
+		else
+			memcpy(buffer, data, size);
+		return B_OK;
+	}
+
+	while (size > 0) {
+		vm_page* page = message->Pages()[offset / B_PAGE_SIZE];
+		size_t pageOffset = offset % B_PAGE_SIZE;
+		size_t bytes = std::min(size, B_PAGE_SIZE - pageOffset);
+		phys_addr_t address = page->physical_page_number * B_PAGE_SIZE
+			+ pageOffset;
+
+		status_t status = toMessage
+			? vm_memcpy_to_physical(address, buffer, bytes, userCopy)
+			: vm_memcpy_from_physical(buffer, address, bytes, userCopy);
+		if (status != B_OK)
+			return status;
+
+		offset += bytes;
+		buffer = (uint8*)buffer + bytes;
+		size -= bytes;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Moves the whole pages of a paged message into the page aligned user
+	\a buffer, and copies the rest. Falls back to copying everything, if the
+	pages can't be moved.
+*/
+static ssize_t
+remap_port_message(port_message* message, void* buffer, size_t size)
+{
+	size_t pageCount = size / B_PAGE_SIZE;
+	if (pageCount > 0 && vm_move_pages_into_area(B_CURRENT_TEAM,
+			(addr_t)buffer, message->Pages(), pageCount) == B_OK) {
+		// the pages belong to the reader's area now
+		memset(message->Pages(), 0, pageCount * sizeof(vm_page*));
+	} else
+		pageCount = 0;
+
+	size_t offset = pageCount * B_PAGE_SIZE;
+	status_t status = copy_message_data(message, offset,
+		(uint8*)buffer + offset, size - offset, false, true);
+	if (status != B_OK)
+		return status;
+
+	return size;
+}
+
+
 static ssize_t
 copy_port_message(port_message* message, int32* _code, void* buffer,
-	size_t bufferSize, bool userCopy)
+	size_t bufferSize, bool userCopy, bool remap = false)
 {
 	// check output buffer size
 	size_t size = std::min(bufferSize, message->size);
@@ -778,12 +912,15 @@ copy_port_message(port_message* message, int32* _code, void* buffer,
 		*_code = message->code;
 
 	if (size > 0) {
-		if (userCopy) {
-			status_t status = user_memcpy(buffer, message->buffer, size);
-			if (status != B_OK)
-				return status;
-		} else
-			memcpy(buffer, message->buffer, size);
+		if (remap && userCopy && message->page_count > 0
+			&& (addr_t)buffer % B_PAGE_SIZE == 0) {
+			return remap_port_message(message, buffer, size);
+		}
+
+		status_t status = copy_message_data(message, 0, buffer, size, false,
+			userCopy);
+		if (status != B_OK)
+			return status;
 	}
 
 	return size;
@@ -1446,6 +1583,7 @@ read_port_etc(port_id id, int32* _code, void* buffer, size_t bufferSize,
 	bool userCopy = (flags & PORT_FLAG_USE_USER_MEMCPY) != 0;
 	bool peekOnly = !userCopy && (flags & B_PEEK_PORT_MESSAGE) != 0;
 		// TODO: we could allow peeking for user apps now
+	bool remap = (flags & B_REMAP_PORT_MESSAGE) != 0;
 
 	flags &= B_CAN_INTERRUPT | B_KILL_CAN_INTERRUPT | B_RELATIVE_TIMEOUT
 		| B_ABSOLUTE_TIMEOUT;
@@ -1528,7 +1666,7 @@ read_port_etc(port_id id, int32* _code, void* buffer, size_t bufferSize,
 	locker.Unlock();
 
 	size_t size = copy_port_message(message, _code, buffer, bufferSize,
-		userCopy);
+		userCopy, remap);
 
 	put_port_message(message);
 	return size;
@@ -1563,6 +1701,8 @@ writev_port_etc(port_id id, int32 msgCode, const iovec* msgVecs,
 	if (bufferSize > PORT_MAX_MESSAGE_SIZE)
 		return B_BAD_VALUE;
 
+	bool userCopy = (flags & PORT_FLAG_USE_USER_MEMCPY) != 0;
+
 	// mask irrelevant flags (for acquire_sem() usage)
 	flags &= B_CAN_INTERRUPT | B_KILL_CAN_INTERRUPT | B_RELATIVE_TIMEOUT
 		| B_ABSOLUTE_TIMEOUT;
@@ -1574,8 +1714,6 @@ writev_port_etc(port_id id, int32 msgCode, const iovec* msgVecs,
 		timeout += system_time();
 	}
 
-	bool userCopy = (flags & PORT_FLAG_USE_USER_MEMCPY) > 0;
-
 	status_t status;
 	port_message* message = NULL;
 
@@ -1649,15 +1787,12 @@ writev_port_etc(port_id id, int32 msgCode, const iovec* msgVecs,
 			if (bytes > bufferSize)
 				bytes = bufferSize;
 
-			if (userCopy) {
-				status_t status = user_memcpy(message->buffer + offset,
-					msgVecs[i].iov_base, bytes);
-				if (status != B_OK) {
-					put_port_message(message);
-					goto error;
-				}
-			} else
-				memcpy(message->buffer + offset, msgVecs[i].iov_base, bytes);
+			status = copy_message_data(message, offset, msgVecs[i].iov_base,
+				bytes, true, userCopy);
+			if (status != B_OK) {
+				put_port_message(message);
+				goto error;
+			}
 
 			bufferSize -= bytes;
 			if (bufferSize == 0)
@@ -0,0 +1,427 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef SCHEDULING_DOMAINS_H
+#define SCHEDULING_DOMAINS_H
+
+
+#include <new>
+
+#include <SupportDefs.h>
+
+
+/*!	The levels of the scheduling domain hierarchy, ordered by how expensive
+	it is to migrate a thread between two cores of a domain of that level.
+	The SMT level is not part of the hierarchy, the logical processors of a
+	core are already balanced by the core's CPU priority heap.
+*/
+enum scheduling_domain_level {
+	SCHEDULING_DOMAIN_LLC,
+	SCHEDULING_DOMAIN_PACKAGE,
+	SCHEDULING_DOMAIN_NODE,
+
+	SCHEDULING_DOMAIN_LEVELS
+};
+
+
+template<typename Core>
+struct SchedulingDomain {
+	scheduling_domain_level	level;
+	int32					id;
+	int32					index;
+	Core**					cores;
+	int32					coreCount;
+};
+
+
+#define SCHEDULING_DOMAINS_TEMPLATE_LIST	template<typename Core>
+#define SCHEDULING_DOMAINS_CLASS_NAME		SchedulingDomains<Core>
+
+
+/*!	Groups the cores into a hierarchy of domains sharing the last level
+	cache, the package and the memory node, and decides where threads should
+	go based on it: balancing is done within the smallest domain first, and
+	threads are preferably placed on the node their memory is on.
+
+	Core needs to provide CPUCount(), GetLoad() (only called if the core has
+	any CPUs) and IsIdle(). Domains that consist of a single core, contain
+	the same cores as their child domain or span all cores are left out of
+	the hierarchy, the latter are covered by the system wide balancing done
+	by the caller.
+*/
+template<typename Core>
+class SchedulingDomains {
+public:
+	typedef SchedulingDomain<Core> Domain;
+
+								SchedulingDomains();
+								~SchedulingDomains();
+
+			status_t			Init(Core* cores, int32 coreCount,
+									const int32* topologyIDs,
+									int32 highLoad);
+
+	inline	int32				NodeCount() const	{ return fNodeCount; }
+	inline	int32				NodeOf(const Core* core) const;
+	inline	int32				HomeNodeOf(const Core* core,
+									int32 homeNode) const;
+	inline	const Domain*		Node(int32 node) const;
+	inline	const Domain*		DomainOf(const Core* core,
+									scheduling_domain_level level) const;
+
+			Core*				ChooseIdleCore(Core* previous,
+									int32 homeNode) const;
+			Core*				Rebalance(Core* core, Core* leastLoaded,
+									int32 threadLoad, int32 loadDifference,
+									int32 homeNode) const;
+
+	static	int32				MigrationThreshold(
+									scheduling_domain_level level,
+									int32 loadDifference);
+
+private:
+	static	Core*				_IdleCore(const Domain* domain);
+	static	Core*				_LeastLoadedCore(const Domain* domain);
+	static	bool				_ShouldMigrate(Core* core, int32 coreLoad,
+									Core* other, int32 threadLoad,
+									int32 threshold);
+
+			void				_Free();
+
+			Core*				fCores;
+			int32				fCoreCount;
+			int32				fNodeCount;
+			int32				fHighLoad;
+
+			Domain*				fDomains;
+			Core**				fDomainCores;
+			const Domain**		fCoreDomains;
+			int32*				fCoreNodes;
+};
+
+
+SCHEDULING_DOMAINS_TEMPLATE_LIST
+SCHEDULING_DOMAINS_CLASS_NAME::SchedulingDomains()
+	:
+	fCores(NULL),
+	fCoreCount(0),
+	fNodeCount(0),
+	fHighLoad(0),
+	fDomains(NULL),
+	fDomainCores(NULL),
+	fCoreDomains(NULL),
+	fCoreNodes(NULL)
+{
+}
+
+
+SCHEDULING_DOMAINS_TEMPLATE_LIST
+SCHEDULING_DOMAINS_CLASS_NAME::~SchedulingDomains()
+{
+	_Free();
+}
+
+
+/*!	\a topologyIDs contains SCHEDULING_DOMAIN_LEVELS IDs for each of the
+	\a coreCount cores, the cores with the same ID on a level form a domain.
+	Cores loaded above \a highLoad are considered overloaded.
+*/
+SCHEDULING_DOMAINS_TEMPLATE_LIST
+status_t
+SCHEDULING_DOMAINS_CLASS_NAME::Init(Core* cores, int32 coreCount,
+	const int32* topologyIDs, int32 highLoad)
+{
+	_Free();
+
+	int32 entryCount = coreCount * SCHEDULING_DOMAIN_LEVELS;
+	fDomains = new(std::nothrow) Domain[entryCount];
+	fDomainCores = new(std::nothrow) Core*[entryCount];
+	fCoreDomains = new(std::nothrow) const Domain*[entryCount];
+	fCoreNodes = new(std::nothrow) int32[coreCount];
+	if (fDomains == NULL || fDomainCores == NULL || fCoreDomains == NULL
+		|| fCoreNodes == NULL) {
+		_Free();
+		return B_NO_MEMORY;
+	}
+
+	fCores = cores;
+	fCoreCount = coreCount;
+	fHighLoad = highLoad;
+
+	for (int32 level = 0; level < SCHEDULING_DOMAIN_LEVELS; level++) {
+		Domain* domains = &fDomains[level * coreCount];
+		Core** domainCores = &fDomainCores[level * coreCount];
+		int32 domainCount = 0;
+
+		for (int32 i = 0; i < coreCount; i++) {
+			int32 id = topologyIDs[i * SCHEDULING_DOMAIN_LEVELS + level];
+
+			bool found = false;
+			for (int32 j = 0; j < domainCount && !found; j++)
+				found = domains[j].id == id;
+			if (found)
+				continue;
+
+			Domain* domain = &domains[domainCount];
+			domain->level = (scheduling_domain_level)level;
+			domain->id = id;
+			domain->index = domainCount++;
+			domain->cores = domainCores;
+			domain->coreCount = 0;
+
+			for (int32 j = i; j < coreCount; j++) {
+				if (topologyIDs[j * SCHEDULING_DOMAIN_LEVELS + level] != id)
+					continue;
+
+				domain->cores[domain->coreCount++] = &cores[j];
+				fCoreDomains[j * SCHEDULING_DOMAIN_LEVELS + level] = domain;
+				if (level == SCHEDULING_DOMAIN_NODE)
+					fCoreNodes[j] = domain->index;
+			}
+
+			domainCores += domain->coreCount;
+		}
+
+		if (level == SCHEDULING_DOMAIN_NODE)
+			fNodeCount = domainCount;
+	}
+
+	// leave out the domains that wouldn't make a difference
+	for (int32 i = 0; i < coreCount; i++) {
+		const Domain** coreDomains
+			= &fCoreDomains[i * SCHEDULING_DOMAIN_LEVELS];
+		int32 childCoreCount = 1;
+
+		for (int32 level = 0; level < SCHEDULING_DOMAIN_LEVELS; level++) {
+			int32 domainCoreCount = coreDomains[level]->coreCount;
+			if (domainCoreCount <= childCoreCount
+				|| domainCoreCount == coreCount) {
+				coreDomains[level] = NULL;
+			} else
+				childCoreCount = domainCoreCount;
+		}
+	}
+
+	return B_OK;
+}
+
+
+SCHEDULING_DOMAINS_TEMPLATE_LIST
+int32
+SCHEDULING_DOMAINS_CLASS_NAME::NodeOf(const Core* core) const
+{
+	return fCoreNodes[core - fCores];
+}
+
+
+/*!	Returns the home node of a thread with the home node \a homeNode that is
+	placed on \a core. Memory is allocated on the node it is first touched
+	on, so a thread that doesn't have a home node yet (-1) gets the node it
+	first runs on, and keeps it from then on.
+*/
+SCHEDULING_DOMAINS_TEMPLATE_LIST
+int32
+SCHEDULING_DOMAINS_CLASS_NAME::HomeNodeOf(const Core* core,
+	int32 homeNode) const
+{
+	return homeNode >= 0 ? homeNode : NodeOf(core);
+}
+
+
+SCHEDULING_DOMAINS_TEMPLATE_LIST
+const typename SCHEDULING_DOMAINS_CLASS_NAME::Domain*
+SCHEDULING_DOMAINS_CLASS_NAME::Node(int32 node) const
+{
+	return &fDomains[SCHEDULING_DOMAIN_NODE * fCoreCount + node];
+}
+
+
+SCHEDULING_DOMAINS_TEMPLATE_LIST
+const typename SCHEDULING_DOMAINS_CLASS_NAME::Domain*
+SCHEDULING_DOMAINS_CLASS_NAME::DomainOf(const Core* core,
+	scheduling_domain_level level) const
+{
+	return fCoreDomains[(core - fCores) * SCHEDULING_DOMAIN_LEVELS + level];
+}
+
+
+/*!	Returns an idle core as close as possible to \a previous, if that is on
+	the thread's home node, or on the home node otherwise. Returns \c NULL if
+	there is none, the caller then falls back to its system wide choice.
+	\a homeNode may be -1 if the thread doesn't have one.
+*/
+SCHEDULING_DOMAINS_TEMPLATE_LIST
+Core*
+SCHEDULING_DOMAINS_CLASS_NAME::ChooseIdleCore(Core* previous,
+	int32 homeNode) const
+{
+	if (previous != NULL && (homeNode < 0 || NodeOf(previous) == homeNode)) {
+		if (previous->IsIdle())
+			return previous;
+
+		for (int32 level = 0; level < SCHEDULING_DOMAIN_LEVELS; level++) {
+			const Domain* domain
+				= DomainOf(previous, (scheduling_domain_level)level);
+			if (domain == NULL)
+				continue;
+
+			Core* core = _IdleCore(domain);
+			if (core != NULL)
+				return core;
+		}
+
+		return NULL;
+	}
+
+	if (homeNode >= 0 && fNodeCount > 1)
+		return _IdleCore(Node(homeNode));
+
+	return NULL;
+}
+
+
+/*!	Decides whether a thread currently on \a core should be moved elsewhere.
+	Threads that are away from their home node go back as soon as that
+	doesn't overload the home node, and they only leave it if their core is
+	overloaded. Other than that, the domains are checked from the smallest to
+	the largest one, the larger the domain the larger the imbalance has to be.
+	\a leastLoaded is the least loaded core in the system, it is considered
+	last.
+*/
+SCHEDULING_DOMAINS_TEMPLATE_LIST
+Core*
+SCHEDULING_DOMAINS_CLASS_NAME::Rebalance(Core* core, Core* leastLoaded,
+	int32 threadLoad, int32 loadDifference, int32 homeNode) const
+{
+	int32 coreLoad = core->GetLoad();
+
+	bool onHomeNode = true;
+	if (homeNode >= 0 && fNodeCount > 1 && NodeOf(core) != homeNode) {
+		Core* home = _LeastLoadedCore(Node(homeNode));
+		if (home != NULL && home->GetLoad() + threadLoad <= fHighLoad)
+			return home;
+
+		onHomeNode = false;
+	}
+
+	for (int32 level = 0; level < SCHEDULING_DOMAIN_LEVELS; level++) {
+		const Domain* domain = DomainOf(core, (scheduling_domain_level)level);
+		if (domain == NULL)
+			continue;
+
+		Core* other = _LeastLoadedCore(domain);
+		if (_ShouldMigrate(core, coreLoad, other, threadLoad,
+				MigrationThreshold(domain->level, loadDifference))) {
+			return other;
+		}
+	}
+
+	scheduling_domain_level systemLevel = SCHEDULING_DOMAIN_PACKAGE;
+	if (fNodeCount > 1 && leastLoaded != NULL
+		&& NodeOf(leastLoaded) != NodeOf(core)) {
+		if (homeNode >= 0 && onHomeNode && coreLoad <= fHighLoad)
+			return core;
+		systemLevel = SCHEDULING_DOMAIN_NODE;
+	}
+
+	if (_ShouldMigrate(core, coreLoad, leastLoaded, threadLoad,
+			MigrationThreshold(systemLevel, loadDifference))) {
+		return leastLoaded;
+	}
+
+	return core;
+}
+
+
+/*!	Returns the load difference between two cores of a domain of the given
+	level above which threads are moved between them.
+*/
+SCHEDULING_DOMAINS_TEMPLATE_LIST
+int32
+SCHEDULING_DOMAINS_CLASS_NAME::MigrationThreshold(
+	scheduling_domain_level level, int32 loadDifference)
+{
+	switch (level) {
+		case SCHEDULING_DOMAIN_LLC:
+			return loadDifference / 2;
+		case SCHEDULING_DOMAIN_PACKAGE:
+			return loadDifference;
+		default:
+			return loadDifference * 2;
+	}
+}
+
+
+SCHEDULING_DOMAINS_TEMPLATE_LIST
+Core*
+SCHEDULING_DOMAINS_CLASS_NAME::_IdleCore(const Domain* domain)
+{
+	for (int32 i = 0; i < domain->coreCount; i++) {
+		if (domain->cores[i]->IsIdle())
+			return domain->cores[i];
+	}
+
+	return NULL;
+}
+
+
+SCHEDULING_DOMAINS_TEMPLATE_LIST
+Core*
+SCHEDULING_DOMAINS_CLASS_NAME::_LeastLoadedCore(const Domain* domain)
+{
+	Core* leastLoaded = NULL;
+	int32 leastLoad = 0;
+
+	for (int32 i = 0; i < domain->coreCount; i++) {
+		Core* core = domain->cores[i];
+		if (core->CPUCount() == 0)
+			continue;
+
+		int32 load = core->GetLoad();
+		if (leastLoaded == NULL || load < leastLoad) {
+			leastLoaded = core;
+			leastLoad = load;
+		}
+	}
+
+	return leastLoaded;
+}
+
+
+/*!	Returns whether moving a thread with load \a threadLoad from \a core to
+	\a other brings both core loads closer to each other, by more than
+	\a threshold.
+*/
+SCHEDULING_DOMAINS_TEMPLATE_LIST
+bool
+SCHEDULING_DOMAINS_CLASS_NAME::_ShouldMigrate(Core* core, int32 coreLoad,
+	Core* other, int32 threadLoad, int32 threshold)
+{
+	if (other == NULL || other == core)
+		return false;
+
+	int32 difference = coreLoad - other->GetLoad() - threshold;
+	return difference > 0 && difference >= threadLoad;
+}
+
+
+SCHEDULING_DOMAINS_TEMPLATE_LIST
+void
+SCHEDULING_DOMAINS_CLASS_NAME::_Free()
+{
+	delete[] fDomains;
+	delete[] fDomainCores;
+	delete[] fCoreDomains;
+	delete[] fCoreNodes;
+
+	fDomains = NULL;
+	fDomainCores = NULL;
+	fCoreDomains = NULL;
+	fCoreNodes = NULL;
+	fCoreCount = 0;
+	fNodeCount = 0;
+}
+
+
+#endif	// SCHEDULING_DOMAINS_H
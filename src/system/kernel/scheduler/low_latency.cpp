@@ -44,10 +44,19 @@ has_cache_expired(const ThreadData* threadData)
 
 
 static CoreEntry*
-choose_core(const ThreadData* /* threadData */)
+choose_core(const ThreadData* threadData)
 {
 	SCHEDULER_ENTER_FUNCTION();
 
+	// The thread's cache affinity has expired, but its memory is still on
+	// its home node, prefer an idle core there.
+	if (gSchedulingDomains.NodeCount() > 1 && threadData->HomeNode() >= 0) {
+		CoreEntry* core = gSchedulingDomains.ChooseIdleCore(NULL,
+			threadData->HomeNode());
+		if (core != NULL)
+			return core;
+	}
+
 	// wake new package
 	PackageEntry* package = gIdlePackageList.Last();
 	if (package == NULL) {
@@ -88,20 +97,13 @@ rebalance(const ThreadData* threadData)
 	coreLocker.Unlock();
 	ASSERT(other != NULL);
 
-	// Check if the least loaded core is significantly less loaded than
-	// the current one.
-	int32 coreLoad = core->GetLoad();
-	int32 otherLoad = other->GetLoad();
-	if (other == core || otherLoad + kLoadDifference >= coreLoad)
-		return core;
-
-	// Check whether migrating the current thread would result in both core
-	// loads become closer to the average.
-	int32 difference = coreLoad - otherLoad - kLoadDifference;
-	ASSERT(difference > 0);
-
+	// Balance within the cores sharing a cache or a package with the
+	// current one first, and only then move the thread to the least loaded
+	// core, if that would result in both core loads become closer to the
+	// average.
 	int32 threadLoad = threadData->GetLoad() / core->CPUCount();
-	return difference >= threadLoad ? other : core;
+	return gSchedulingDomains.Rebalance(core, other, threadLoad,
+		kLoadDifference, threadData->HomeNode());
 }
 
 
@@ -66,6 +66,7 @@ spinlock gSchedulerListenersLock = B_SPINLOCK_INITIALIZER;
 static scheduler_mode_operations* sSchedulerModes[] = {
 	&gSchedulerLowLatencyMode,
 	&gSchedulerPowerSavingMode,
+	&gSchedulerThroughputMode,
 };
 
 // Since CPU IDs used internally by the kernel bear no relation to the actual
@@ -518,7 +519,8 @@ status_t
 scheduler_set_operation_mode(scheduler_mode mode)
 {
 	if (mode != SCHEDULER_MODE_LOW_LATENCY
-		&& mode != SCHEDULER_MODE_POWER_SAVING) {
+		&& mode != SCHEDULER_MODE_POWER_SAVING
+		&& mode != SCHEDULER_MODE_THROUGHPUT) {
 		return B_BAD_VALUE;
 	}
 
@@ -642,6 +644,35 @@ build_topology_mappings(int32& cpuCount, int32& coreCount, int32& packageCount)
 }
 
 
+static status_t
+init_scheduling_domains(int32 cpuCount, int32 coreCount)
+{
+	int32* topologyIDs
+		= new(std::nothrow) int32[coreCount * SCHEDULING_DOMAIN_LEVELS];
+	if (topologyIDs == NULL)
+		return B_NO_MEMORY;
+	ArrayDeleter<int32> topologyIDsDeleter(topologyIDs);
+
+	for (int32 i = 0; i < cpuCount; i++) {
+		int32* ids = &topologyIDs[sCPUToCore[i] * SCHEDULING_DOMAIN_LEVELS];
+
+		int32 cacheID = -1;
+		if (gCPUCacheLevelCount > 0)
+			cacheID = gCPU[i].cache_id[gCPUCacheLevelCount - 1];
+
+		ids[SCHEDULING_DOMAIN_LLC] = cacheID >= 0 ? cacheID : sCPUToPackage[i];
+		ids[SCHEDULING_DOMAIN_PACKAGE] = sCPUToPackage[i];
+		// There is no information about the memory topology, yet, assume a
+		// node per package.
+		ids[SCHEDULING_DOMAIN_NODE] = sCPUToPackage[i];
+	}
+
+	new(&gSchedulingDomains) SchedulingDomains<CoreEntry>;
+	return gSchedulingDomains.Init(gCoreEntries, coreCount, topologyIDs,
+		kHighLoad);
+}
+
+
 static status_t
 init()
 {
@@ -695,6 +726,10 @@ init()
 		core->AddCPU(&gCPUEntries[i]);
 	}
 
+	result = init_scheduling_domains(cpuCount, coreCount);
+	if (result != B_OK)
+		return result;
+
 	packageEntriesDeleter.Detach();
 	coreEntriesDeleter.Detach();
 	cpuEntriesDeleter.Detach();
@@ -24,6 +24,8 @@ CoreLoadHeap gCoreHighLoadHeap;
 rw_spinlock gCoreHeapsLock = B_RW_SPINLOCK_INITIALIZER;
 int32 gCoreCount;
 
+SchedulingDomains<CoreEntry> gSchedulingDomains;
+
 PackageEntry* gPackageEntries;
 IdlePackageList gIdlePackageList;
 rw_spinlock gIdlePackageLock = B_RW_SPINLOCK_INITIALIZER;
@@ -800,6 +802,32 @@ dump_idle_cores(int /* argc */, char** /* argv */)
 }
 
 
+static int
+dump_scheduling_domains(int /* argc */, char** /* argv */)
+{
+	kprintf("core node llc     package node\n");
+	for (int32 i = 0; i < gCoreCount; i++) {
+		CoreEntry* core = &gCoreEntries[i];
+		kprintf("%-4" B_PRId32 " %-4" B_PRId32, core->ID(),
+			gSchedulingDomains.NodeOf(core));
+
+		for (int32 level = 0; level < SCHEDULING_DOMAIN_LEVELS; level++) {
+			const SchedulingDomain<CoreEntry>* domain
+				= gSchedulingDomains.DomainOf(core,
+					(scheduling_domain_level)level);
+			if (domain != NULL) {
+				kprintf(" %3" B_PRId32 "/%-3" B_PRId32, domain->id,
+					domain->coreCount);
+			} else
+				kprintf(" -      ");
+		}
+		kprintf("\n");
+	}
+
+	return 0;
+}
+
+
 void Scheduler::init_debug_commands()
 {
 	new(&sDebugCPUHeap) CPUPriorityHeap(smp_get_num_cpus());
@@ -813,6 +841,10 @@ void Scheduler::init_debug_commands()
 			"\nList CPUs in CPU priority heap", 0);
 		add_debugger_command_etc("idle_cores", &dump_idle_cores,
 			"List idle cores", "\nList idle cores", 0);
+		add_debugger_command_etc("scheduling_domains",
+			&dump_scheduling_domains, "List the scheduling domains of cores",
+			"\nLists the LLC, package and node domain (ID/core count) of each"
+			" core.\n", 0);
 	}
 }
 
@@ -16,6 +16,7 @@
 #include <cpufreq.h>
 
 #include "RunQueue.h"
+#include "SchedulingDomains.h"
 #include "scheduler_common.h"
 #include "scheduler_modes.h"
 #include "scheduler_profiler.h"
@@ -164,6 +165,7 @@ public:
 
 	inline				void			CPUGoesIdle(CPUEntry* cpu);
 	inline				void			CPUWakesUp(CPUEntry* cpu);
+	inline				bool			IsIdle() const;
 
 						void			AddCPU(CPUEntry* cpu);
 						void			RemoveCPU(CPUEntry* cpu,
@@ -257,6 +259,8 @@ extern CoreLoadHeap gCoreHighLoadHeap;
 extern rw_spinlock gCoreHeapsLock;
 extern int32 gCoreCount;
 
+extern SchedulingDomains<CoreEntry> gSchedulingDomains;
+
 extern PackageEntry* gPackageEntries;
 extern IdlePackageList gIdlePackageList;
 extern rw_spinlock gIdlePackageLock;
@@ -529,6 +533,13 @@ CoreEntry::CPUWakesUp(CPUEntry* /* cpu */)
 }
 
 
+inline bool
+CoreEntry::IsIdle() const
+{
+	return fCPUCount > 0 && fIdleCPUCount == fCPUCount;
+}
+
+
 /* static */ inline CoreEntry*
 CoreEntry::GetCore(int32 cpu)
 {
@@ -99,6 +99,10 @@ ThreadData::Init()
 	ThreadData* currentThreadData = currentThread->scheduler_data;
 	fNeededLoad = currentThreadData->fNeededLoad;
 
+	// The thread gets its home node once it first runs, its creator's may
+	// well be a different one.
+	fHomeNode = -1;
+
 	if (!IsRealTime()) {
 		fPriorityPenalty = std::min(currentThreadData->fPriorityPenalty,
 				std::max(GetPriority() - _GetMinimalPriority(), int32(0)));
@@ -115,6 +119,7 @@ ThreadData::Init(CoreEntry* core)
 	_InitBase();
 
 	fCore = core;
+	fHomeNode = gSchedulingDomains.NodeOf(core);
 	fReady = true;
 	fNeededLoad = 0;
 }
@@ -140,6 +145,7 @@ ThreadData::Dump() const
 	kprintf("\twent_sleep_active:\t%" B_PRId64 "\n", fWentSleepActive);
 	kprintf("\tcore:\t\t\t%" B_PRId32 "\n",
 		fCore != NULL ? fCore->ID() : -1);
+	kprintf("\thome_node:\t\t%" B_PRId32 "\n", fHomeNode);
 	if (fCore != NULL && HasCacheExpired())
 		kprintf("\tcache affinity has expired\n");
 }
@@ -164,6 +170,8 @@ ThreadData::ChooseCoreAndCPU(CoreEntry*& targetCore, CPUEntry*& targetCPU)
 	ASSERT(targetCore != NULL);
 	ASSERT(targetCPU != NULL);
 
+	fHomeNode = gSchedulingDomains.HomeNodeOf(targetCore, fHomeNode);
+
 	if (fCore != targetCore) {
 		fLoadMeasurementEpoch = targetCore->LoadMeasurementEpoch() - 1;
 		if (fReady) {
@@ -85,6 +85,7 @@ public:
 	inline	int32		GetLoad() const	{ return fNeededLoad; }
 
 	inline	CoreEntry*	Core() const	{ return fCore; }
+	inline	int32		HomeNode() const	{ return fHomeNode; }
 			void		UnassignCore(bool running = false);
 
 	static	void		ComputeQuantumLengths();
@@ -129,6 +130,7 @@ private:
 			uint32		fLoadMeasurementEpoch;
 
 			CoreEntry*	fCore;
+			int32		fHomeNode;
 };
 
 class ThreadProcessing {
@@ -0,0 +1,208 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <util/AutoLock.h>
+
+#include "scheduler_common.h"
+#include "scheduler_cpu.h"
+#include "scheduler_modes.h"
+#include "scheduler_profiler.h"
+#include "scheduler_thread.h"
+
+
+using namespace Scheduler;
+
+
+const bigtime_t kCacheExpire = 500000;
+
+// The load difference the migration thresholds of the scheduling domains are
+// derived from. An imbalance has to persist for at least kImbalancePeriod
+// before threads are migrated away from a core.
+const int32 kImbalanceDifference = kLoadDifference * 2;
+const bigtime_t kImbalancePeriod = 100000;
+
+static bigtime_t sImbalancedSince[SMP_MAX_CPUS];
+
+
+static void
+switch_to_mode()
+{
+	for (int32 i = 0; i < gCoreCount; i++)
+		atomic_set64(&sImbalancedSince[i], 0);
+}
+
+
+static void
+set_cpu_enabled(int32 /* cpu */, bool /* enabled */)
+{
+}
+
+
+static bool
+has_cache_expired(const ThreadData* threadData)
+{
+	SCHEDULER_ENTER_FUNCTION();
+	if (threadData->WentSleepActive() == 0)
+		return false;
+	CoreEntry* core = threadData->Core();
+	bigtime_t activeTime = core->GetActiveTime();
+	return activeTime - threadData->WentSleepActive() > kCacheExpire;
+}
+
+
+static CoreEntry*
+choose_core(const ThreadData* threadData)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	// Even if the thread's cache affinity has expired, its data may still be
+	// in the caches shared with its previous core, so prefer an idle core
+	// close to it, or the previous core itself, as long as it is not
+	// overloaded. Either way, stay on the thread's home node.
+	CoreEntry* previousCore = threadData->Core();
+	CoreEntry* core = gSchedulingDomains.ChooseIdleCore(previousCore,
+		threadData->HomeNode());
+	if (core != NULL)
+		return core;
+	if (previousCore != NULL && previousCore->CPUCount() > 0
+		&& previousCore->GetLoad() < kHighLoad
+		&& (threadData->HomeNode() < 0
+			|| gSchedulingDomains.NodeOf(previousCore)
+				== threadData->HomeNode())) {
+		return previousCore;
+	}
+
+	// wake new package
+	PackageEntry* package = gIdlePackageList.Last();
+	if (package == NULL) {
+		// wake new core
+		package = PackageEntry::GetMostIdlePackage();
+	}
+
+	if (package != NULL)
+		core = package->GetIdleCore();
+
+	if (core == NULL) {
+		ReadSpinLocker coreLocker(gCoreHeapsLock);
+		// no idle cores, use least occupied core
+		core = gCoreLoadHeap.PeekMinimum();
+		if (core == NULL)
+			core = gCoreHighLoadHeap.PeekMinimum();
+	}
+
+	ASSERT(core != NULL);
+	return core;
+}
+
+
+static CoreEntry*
+rebalance(const ThreadData* threadData)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	CoreEntry* core = threadData->Core();
+	ASSERT(core != NULL);
+
+	// Get the least loaded core.
+	ReadSpinLocker coreLocker(gCoreHeapsLock);
+	CoreEntry* other = gCoreLoadHeap.PeekMinimum();
+	if (other == NULL)
+		other = gCoreHighLoadHeap.PeekMinimum();
+	coreLocker.Unlock();
+	ASSERT(other != NULL);
+
+	// Only consider migrating when the current core is a lot more loaded than
+	// the least loaded one in one of its domains, giving up the thread's
+	// cache affinity is expensive.
+	int32 threadLoad = threadData->GetLoad() / core->CPUCount();
+	CoreEntry* target = gSchedulingDomains.Rebalance(core, other, threadLoad,
+		kImbalanceDifference, threadData->HomeNode());
+	bigtime_t* imbalancedSince = &sImbalancedSince[core->ID()];
+	if (target == core) {
+		if (atomic_get64(imbalancedSince) != 0)
+			atomic_set64(imbalancedSince, 0);
+		return core;
+	}
+
+	// The imbalance has to persist for a while, short bursts of work are
+	// better absorbed by the longer quanta than by migrations.
+	bigtime_t now = system_time();
+	bigtime_t since = atomic_get64(imbalancedSince);
+	if (since == 0) {
+		atomic_test_and_set64(imbalancedSince, now, 0);
+		return core;
+	}
+	if (now - since < kImbalancePeriod)
+		return core;
+
+	// Give the core loads time to settle before migrating the next thread.
+	atomic_set64(imbalancedSince, 0);
+	return target;
+}
+
+
+static void
+rebalance_irqs(bool idle)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	if (idle)
+		return;
+
+	cpu_ent* cpu = get_cpu_struct();
+	SpinLocker locker(cpu->irqs_lock);
+
+	irq_assignment* chosen = NULL;
+	irq_assignment* irq = (irq_assignment*)list_get_first_item(&cpu->irqs);
+
+	int32 totalLoad = 0;
+	while (irq != NULL) {
+		if (chosen == NULL || chosen->load < irq->load)
+			chosen = irq;
+		totalLoad += irq->load;
+		irq = (irq_assignment*)list_get_next_item(&cpu->irqs, irq);
+	}
+
+	locker.Unlock();
+
+	if (chosen == NULL || totalLoad < kLowLoad)
+		return;
+
+	ReadSpinLocker coreLocker(gCoreHeapsLock);
+	CoreEntry* other = gCoreLoadHeap.PeekMinimum();
+	if (other == NULL)
+		other = gCoreHighLoadHeap.PeekMinimum();
+	coreLocker.Unlock();
+
+	ASSERT(other != NULL);
+
+	CoreEntry* core = CoreEntry::GetCore(cpu->cpu_num);
+	if (other == core)
+		return;
+	if (other->GetLoad() + kImbalanceDifference >= core->GetLoad())
+		return;
+
+	int32 newCPU = other->CPUHeap()->PeekRoot()->ID();
+	assign_io_interrupt_to_cpu(chosen->irq, newCPU);
+}
+
+
+scheduler_mode_operations gSchedulerThroughputMode = {
+	"throughput",
+
+	5000,
+	1000,
+	{ 2, 5 },
+
+	50000,
+
+	switch_to_mode,
+	set_cpu_enabled,
+	has_cache_expired,
+	choose_core,
+	rebalance,
+	rebalance_irqs,
+};
@@ -109,6 +109,9 @@ static int32 sBroadcastMessageCounter;
 static bool sICIEnabled = false;
 static int32 sNumCPUs = 1;
 
+static smp_ici_stats sICIStats[SMP_MAX_CPUS];
+	// each entry is only written by its CPU, with interrupts disabled
+
 static int32 process_pending_ici(int32 currentCPU);
 
 
@@ -269,6 +272,27 @@ dump_ici_messages(int argc, char** argv)
 			count, sCPUMessages[i]);
 	}
 
+	// statistics
+	kprintf("\nCPU        sent  (TLB)    received  (TLB)  sync waits  "
+		"avg wait  max wait\n");
+	for (int32 i = 0; i < sNumCPUs; i++) {
+		const smp_ici_stats& stats = sICIStats[i];
+		bigtime_t averageWait = stats.sync_waits > 0
+			? stats.sync_wait_time / stats.sync_waits : 0;
+		kprintf("%3" B_PRId32 " %11" B_PRIu64 " %5" B_PRIu64 "%%"
+			" %11" B_PRIu64 " %5" B_PRIu64 "%% %11" B_PRIu64 " %7" B_PRId64
+			"us %7" B_PRId64 "us\n", i, stats.sent,
+			stats.sent > 0 ? stats.sent_tlb * 100 / stats.sent : 0,
+			stats.received,
+			stats.received > 0 ? stats.received_tlb * 100 / stats.received : 0,
+			stats.sync_waits, averageWait, stats.max_sync_wait_time);
+	}
+
+	if (argc == 2 && strcmp(argv[1], "-r") == 0) {
+		memset(sICIStats, 0, sizeof(sICIStats));
+		kprintf("statistics reset\n");
+	}
+
 	return 0;
 }
 
@@ -308,6 +332,39 @@ dump_ici_message(int argc, char** argv)
 }
 
 
+static inline bool
+is_tlb_message(int32 message)
+{
+	return message == SMP_MSG_INVALIDATE_PAGE_RANGE
+		|| message == SMP_MSG_INVALIDATE_PAGE_LIST
+		|| message == SMP_MSG_USER_INVALIDATE_PAGES
+		|| message == SMP_MSG_GLOBAL_INVALIDATE_PAGES;
+}
+
+
+static inline void
+account_sent_message(int32 currentCPU, int32 message)
+{
+	smp_ici_stats& stats = sICIStats[currentCPU];
+	stats.sent++;
+	if (is_tlb_message(message))
+		stats.sent_tlb++;
+}
+
+
+static inline void
+account_sync_wait(int32 currentCPU, bigtime_t startTime)
+{
+	bigtime_t waitTime = system_time() - startTime;
+
+	smp_ici_stats& stats = sICIStats[currentCPU];
+	stats.sync_waits++;
+	stats.sync_wait_time += waitTime;
+	if (waitTime > stats.max_sync_wait_time)
+		stats.max_sync_wait_time = waitTime;
+}
+
+
 static inline void
 process_all_pending_ici(int32 currentCPU)
 {
@@ -934,6 +991,11 @@ process_pending_ici(int32 currentCPU)
 
 	TRACE("  cpu %ld message = %ld\n", currentCPU, msg->message);
 
+	smp_ici_stats& stats = sICIStats[currentCPU];
+	stats.received++;
+	if (is_tlb_message(msg->message))
+		stats.received_tlb++;
+
 	bool haltCPU = false;
 
 	switch (msg->message) {
@@ -1111,16 +1173,19 @@ smp_send_ici(int32 targetCPU, int32 message, addr_t data, addr_t data2,
 		} while (atomic_pointer_test_and_set(&sCPUMessages[targetCPU], msg,
 				next) != next);
 
+		account_sent_message(currentCPU, message);
 		arch_smp_send_ici(targetCPU);
 
 		if ((flags & SMP_MSG_FLAG_SYNC) != 0) {
 			// wait for the other cpu to finish processing it
 			// the interrupt handler will ref count it to <0
 			// if the message is sync after it has removed it from the mailbox
+			bigtime_t startTime = system_time();
 			while (msg->done == 0) {
 				process_all_pending_ici(currentCPU);
 				cpu_wait(&msg->done, 1);
 			}
+			account_sync_wait(currentCPU, startTime);
 			// for SYNC messages, it's our responsibility to put it
 			// back into the free list
 			return_free_message(msg);
@@ -1181,6 +1246,7 @@ smp_send_multicast_ici(CPUSet& cpuMask, int32 message, addr_t data,
 			atomic_add(&gCPU[i].ici_counter, 1);
 	}
 
+	account_sent_message(currentCPU, message);
 	if (broadcast)
 		arch_smp_send_broadcast_ici();
 	else
@@ -1190,10 +1256,12 @@ smp_send_multicast_ici(CPUSet& cpuMask, int32 message, addr_t data,
 		// wait for the other cpus to finish processing it
 		// the interrupt handler will ref count it to <0
 		// if the message is sync after it has removed it from the mailbox
+		bigtime_t startTime = system_time();
 		while (msg->done == 0) {
 			process_all_pending_ici(currentCPU);
 			cpu_wait(&msg->done, 1);
 		}
+		account_sync_wait(currentCPU, startTime);
 
 		// for SYNC messages, it's our responsibility to put it
 		// back into the free list
@@ -1246,6 +1314,7 @@ smp_send_broadcast_ici(int32 message, addr_t data, addr_t data2, addr_t data3,
 		atomic_add(&sBroadcastMessageCounter, 1);
 		atomic_add(&gCPU[currentCPU].ici_counter, 1);
 
+		account_sent_message(currentCPU, message);
 		arch_smp_send_broadcast_ici();
 
 		TRACE("smp_send_broadcast_ici: sent interrupt\n");
@@ -1256,10 +1325,12 @@ smp_send_broadcast_ici(int32 message, addr_t data, addr_t data2, addr_t data3,
 			// if the message is sync after it has removed it from the mailbox
 			TRACE("smp_send_broadcast_ici: waiting for ack\n");
 
+			bigtime_t startTime = system_time();
 			while (msg->done == 0) {
 				process_all_pending_ici(currentCPU);
 				cpu_wait(&msg->done, 1);
 			}
+			account_sync_wait(currentCPU, startTime);
 
 			TRACE("smp_send_broadcast_ici: returning message to free list\n");
 
@@ -1312,6 +1383,7 @@ smp_send_broadcast_ici_interrupts_disabled(int32 currentCPU, int32 message,
 	atomic_add(&sBroadcastMessageCounter, 1);
 	atomic_add(&gCPU[currentCPU].ici_counter, 1);
 
+	account_sent_message(currentCPU, message);
 	arch_smp_send_broadcast_ici();
 
 	TRACE("smp_send_broadcast_ici_interrupts_disabled %ld: sent interrupt\n",
@@ -1324,10 +1396,12 @@ smp_send_broadcast_ici_interrupts_disabled(int32 currentCPU, int32 message,
 		TRACE("smp_send_broadcast_ici_interrupts_disabled %ld: waiting for "
 			"ack\n", currentCPU);
 
+		bigtime_t startTime = system_time();
 		while (msg->done == 0) {
 			process_all_pending_ici(currentCPU);
 			cpu_wait(&msg->done, 1);
 		}
+		account_sync_wait(currentCPU, startTime);
 
 		TRACE("smp_send_broadcast_ici_interrupts_disabled %ld: returning "
 			"message to free list\n", currentCPU);
@@ -1418,9 +1492,12 @@ smp_init(kernel_args* args)
 		"Dumps info on a spinlock.\n", 0);
 #endif
 	add_debugger_command_etc("ici", &dump_ici_messages,
-		"Dump info on pending ICI messages",
-		"\n"
-		"Dumps info on pending ICI messages.\n", 0);
+		"Dump info on pending ICI messages and ICI statistics",
+		"[ -r ]\n"
+		"Dumps info on pending ICI messages, and the number of ICI messages\n"
+		"each CPU has sent and received, and how long it had to wait for\n"
+		"synchronous ones.\n"
+		"  -r  - Reset the statistics afterwards.\n", 0);
 	add_debugger_command_etc("ici_message", &dump_ici_message,
 		"Dump info on an ICI message",
 		"\n"
@@ -1468,6 +1545,16 @@ smp_init_post_generic_syscalls(void)
 }
 
 
+/*!	Returns a snapshot of the ICI statistics of the given CPU. The counters
+	are not read atomically, they might be slightly inconsistent.
+*/
+void
+smp_get_ici_stats(int32 cpu, smp_ici_stats* stats)
+{
+	memcpy(stats, &sICIStats[cpu], sizeof(smp_ici_stats));
+}
+
+
 void
 smp_set_num_cpus(int32 numCPUs)
 {
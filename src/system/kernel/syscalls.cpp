@@ -19,15 +19,18 @@
 
 #include <arch_config.h>
 #include <arch/system_info.h>
+#include <continuous_profiler.h>
 #include <cpu.h>
 #include <debug.h>
 #include <disk_device_manager/ddm_userland_interface.h>
 #include <elf.h>
+#include <event_queue.h>
 #include <frame_buffer_console.h>
 #include <fs/fd.h>
 #include <fs/node_monitor.h>
 #include <generic_syscall.h>
 #include <int.h>
+#include <io_ring.h>
 #include <kernel.h>
 #include <kimage.h>
 #include <ksignal.h>
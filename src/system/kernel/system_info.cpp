@@ -63,6 +63,7 @@ dump_info(int argc, char **argv)
 	// ToDo: Add page_faults
 	kprintf("pages:\t\t%" B_PRIuPHYSADDR " (%" B_PRIuPHYSADDR " max)\n",
 		vm_page_num_pages() - vm_page_num_free_pages(), vm_page_num_pages());
+	kprintf("large pages:\t%" B_PRId32 "\n", gMappedLargePagesCount);
 
 	kprintf("sems:\t\t%" B_PRId32 " (%" B_PRId32 " max)\n", sem_used_sems(),
 		sem_max_sems());
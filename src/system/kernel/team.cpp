@@ -15,8 +15,10 @@
 #include <team.h>
 
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <spawn.h>
 #include <string.h>
 #include <sys/wait.h>
 
@@ -44,6 +46,7 @@
 #include <posix/realtime_sem.h>
 #include <posix/xsi_semaphore.h>
 #include <sem.h>
+#include <spawn_defs.h>
 #include <syscall_process_info.h>
 #include <syscall_restart.h>
 #include <syscalls.h>
@@ -54,6 +57,7 @@
 #include <usergroup.h>
 #include <vfs.h>
 #include <vm/vm.h>
+#include <vm/vm_page.h>
 #include <vm/VMAddressSpace.h>
 #include <util/AutoLock.h>
 
@@ -82,11 +86,15 @@ struct team_arg {
 	uint32	flags;
 	port_id	error_port;
 	uint32	error_token;
+	spawn_args	*spawn;
 };
 
 #define TEAM_ARGS_FLAG_NO_ASLR	0x01
 
 
+static thread_id wait_for_child(pid_t child, uint32 flags, siginfo_t& _info);
+
+
 namespace {
 
 
@@ -1468,10 +1476,91 @@ copy_user_process_args(const char* const* userFlatArgs, size_t flatArgsSize,
 }
 
 
+static void
+free_spawn_args(spawn_args* args)
+{
+	if (args == NULL)
+		return;
+
+	for (int32 i = 0; i < args->file_action_count; i++)
+		free(args->file_actions[i].path);
+
+	free(args);
+}
+
+
+/*!	Copies the posix_spawn() attributes and file actions from userland. The
+	file actions are stored right after the returned structure.
+*/
+static status_t
+copy_user_spawn_args(const spawn_args* userArgs, spawn_args*& _args)
+{
+	spawn_args args;
+	if (!IS_USER_ADDRESS(userArgs)
+		|| user_memcpy(&args, userArgs, sizeof(spawn_args)) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	if (args.file_action_count < 0
+		|| args.file_action_count > MAX_SPAWN_FILE_ACTIONS) {
+		return B_BAD_VALUE;
+	}
+
+	size_t actionsSize = args.file_action_count * sizeof(spawn_file_action);
+	spawn_args* copy = (spawn_args*)malloc(sizeof(spawn_args) + actionsSize);
+	if (copy == NULL)
+		return B_NO_MEMORY;
+
+	*copy = args;
+	copy->file_actions = (spawn_file_action*)(copy + 1);
+	copy->file_action_count = 0;
+
+	if (actionsSize > 0 && (!IS_USER_ADDRESS(args.file_actions)
+			|| user_memcpy(copy->file_actions, args.file_actions, actionsSize)
+				!= B_OK)) {
+		free(copy);
+		return B_BAD_ADDRESS;
+	}
+
+	// copy the paths of the open actions
+	status_t status = B_OK;
+	for (int32 i = 0; i < args.file_action_count; i++) {
+		spawn_file_action& action = copy->file_actions[i];
+		char* userPath = action.path;
+		action.path = NULL;
+		copy->file_action_count++;
+
+		if (action.type != SPAWN_FILE_ACTION_OPEN)
+			continue;
+
+		action.path = (char*)malloc(B_PATH_NAME_LENGTH);
+		if (action.path == NULL) {
+			status = B_NO_MEMORY;
+			break;
+		}
+
+		if (userPath == NULL || !IS_USER_ADDRESS(userPath)
+			|| user_strlcpy(action.path, userPath, B_PATH_NAME_LENGTH) < 0) {
+			status = B_BAD_ADDRESS;
+			break;
+		}
+	}
+
+	if (status != B_OK) {
+		free_spawn_args(copy);
+		return status;
+	}
+
+	_args = copy;
+	return B_OK;
+}
+
+
 static void
 free_team_arg(struct team_arg* teamArg)
 {
 	if (teamArg != NULL) {
+		free_spawn_args(teamArg->spawn);
 		free(teamArg->flat_args);
 		free(teamArg->path);
 		free(teamArg);
@@ -1503,6 +1592,7 @@ create_team_arg(struct team_arg** _teamArg, const char* path, char** flatArgs,
 	teamArg->umask = umask;
 	teamArg->error_port = port;
 	teamArg->error_token = token;
+	teamArg->spawn = NULL;
 
 	// determine the flags from the environment
 	const char* const* env = flatArgs + argCount + 1;
@@ -1518,6 +1608,96 @@ create_team_arg(struct team_arg** _teamArg, const char* path, char** flatArgs,
 }
 
 
+/*!	Applies the posix_spawn() attributes that have to be set by the new team
+	itself, and its file actions, in the given order. Called by the team's
+	main thread before it loads the program, while the close-on-exec FDs
+	inherited from the parent are still open.
+*/
+static status_t
+apply_spawn_args(const spawn_args* args)
+{
+	if ((args->flags & POSIX_SPAWN_SETSID) != 0) {
+		pid_t session = _user_setsid();
+		if (session < 0)
+			return session;
+	}
+
+	if ((args->flags & POSIX_SPAWN_SETPGROUP) != 0) {
+		pid_t group = _user_setpgid(0, args->process_group);
+		if (group < 0)
+			return group;
+	}
+
+	if ((args->flags & POSIX_SPAWN_SETSIGMASK) != 0)
+		sigprocmask(SIG_SETMASK, &args->signal_mask, NULL);
+
+	// The _user_*() FD functions don't touch userland memory, and work on
+	// the new team's I/O context, since we are its main thread.
+	for (int32 i = 0; i < args->file_action_count; i++) {
+		const spawn_file_action& action = args->file_actions[i];
+		status_t status = B_OK;
+
+		switch (action.type) {
+			case SPAWN_FILE_ACTION_OPEN:
+			{
+				int fd = vfs_open(action.path, action.open_mode, action.perms,
+					false);
+				if (fd < 0 || fd == action.fd) {
+					status = fd < 0 ? fd : B_OK;
+					break;
+				}
+
+				status = _user_dup2(fd, action.fd);
+				_user_close(fd);
+				break;
+			}
+
+			case SPAWN_FILE_ACTION_CLOSE:
+				// closing an FD that isn't open is not an error
+				_user_close(action.fd);
+				break;
+
+			case SPAWN_FILE_ACTION_DUP2:
+				if (action.fd == action.new_fd) {
+					// the FD is inherited, even when it's close-on-exec
+					status = _user_fcntl(action.fd, F_SETFD, 0);
+				} else
+					status = _user_dup2(action.fd, action.new_fd);
+				break;
+
+			default:
+				status = B_BAD_VALUE;
+				break;
+		}
+
+		if (status < 0)
+			return status;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Lets the thread waiting for the current team to be loaded know that
+	loading failed with \a error.
+*/
+static void
+notify_loading_failed(Team* team, status_t error)
+{
+	TeamLocker teamLocker(team);
+
+	if (team->loading_info != NULL) {
+		struct team_loading_info* loadingInfo = team->loading_info;
+		team->loading_info = NULL;
+
+		loadingInfo->result = error;
+		loadingInfo->done = true;
+
+		thread_continue(loadingInfo->thread);
+	}
+}
+
+
 static status_t
 team_create_thread_start_internal(void* args)
 {
@@ -1536,6 +1716,19 @@ team_create_thread_start_internal(void* args)
 	team = thread->team;
 	cache_node_launched(teamArgs->arg_count, teamArgs->flat_args);
 
+	if (teamArgs->spawn != NULL) {
+		err = apply_spawn_args(teamArgs->spawn);
+		if (err != B_OK) {
+			notify_loading_failed(team, err);
+			free_team_arg(teamArgs);
+			return err;
+		}
+
+		// now that the file actions had their chance to use them, remove the
+		// close-on-exec FDs
+		vfs_exec_io_context(team->io_context);
+	}
+
 	TRACE(("team_create_thread_start: entry thread %" B_PRId32 "\n",
 		thread->id));
 
@@ -1671,12 +1864,20 @@ team_create_thread_start(void* args)
 }
 
 
+/*!	Creates a new team running the program given by the flat arguments.
+	If \a _spawnArgs is given, the team is set up according to them, like
+	posix_spawn() requires, the call waits until the program has been loaded,
+	and then lets it run. Ownership of the flat arguments and the spawn
+	arguments is transferred to the team, if it could be created; the
+	variables are unset in this case.
+*/
 static thread_id
 load_image_internal(char**& _flatArgs, size_t flatArgsSize, int32 argCount,
 	int32 envCount, int32 priority, team_id parentID, uint32 flags,
-	port_id errorPort, uint32 errorToken)
+	port_id errorPort, uint32 errorToken, spawn_args*& _spawnArgs)
 {
 	char** flatArgs = _flatArgs;
+	spawn_args* spawnArgs = _spawnArgs;
 	thread_id thread;
 	status_t status;
 	struct team_arg* teamArgs;
@@ -1712,6 +1913,11 @@ load_image_internal(char**& _flatArgs, size_t flatArgsSize, int32 argCount,
 		return B_NO_MEMORY;
 	BReference<Team> teamReference(team, true);
 
+	if (spawnArgs != NULL) {
+		// posix_spawn() has to report whether the program could be loaded
+		flags |= B_WAIT_TILL_LOADED;
+	}
+
 	if (flags & B_WAIT_TILL_LOADED) {
 		loadingInfo.thread = thread_get_current_thread();
 		loadingInfo.result = B_ERROR;
@@ -1731,6 +1937,25 @@ load_image_internal(char**& _flatArgs, size_t flatArgsSize, int32 argCount,
 	// inherit the parent's user/group
 	inherit_parent_user_and_group(team, parent);
 
+	if (spawnArgs != NULL) {
+		if ((spawnArgs->flags & POSIX_SPAWN_RESETIDS) != 0) {
+			team->effective_uid = team->real_uid;
+			team->effective_gid = team->real_gid;
+		}
+
+		// Like exec(), keep the signals the parent ignores ignored, unless
+		// they are to be reset.
+		team->InheritSignalActions(parent);
+		team->ResetSignalsOnExec();
+
+		if ((spawnArgs->flags & POSIX_SPAWN_SETSIGDEF) != 0) {
+			for (uint32 i = 1; i <= MAX_SIGNAL_NUMBER; i++) {
+				if ((spawnArgs->default_signals & SIGNAL_TO_MASK(i)) != 0)
+					team->SignalActionFor(i).sa_handler = SIG_DFL;
+			}
+		}
+	}
+
  	InterruptsSpinLocker teamsLocker(sTeamHashLock);
 
 	sTeamHash.Insert(team);
@@ -1762,15 +1987,20 @@ load_image_internal(char**& _flatArgs, size_t flatArgsSize, int32 argCount,
 	}
 
 	status = create_team_arg(&teamArgs, path, flatArgs, flatArgsSize, argCount,
-		envCount, (mode_t)-1, errorPort, errorToken);
+		envCount, spawnArgs != NULL ? spawnArgs->umask : (mode_t)-1,
+		errorPort, errorToken);
 	if (status != B_OK)
 		goto err1;
 
 	_flatArgs = NULL;
+	teamArgs->spawn = spawnArgs;
+	_spawnArgs = NULL;
 		// args are owned by the team_arg structure now
 
-	// create a new io_context for this team
-	team->io_context = vfs_new_io_context(parentIOContext, true);
+	// create a new io_context for this team -- the spawn file actions may
+	// refer to close-on-exec FDs, so they are removed only after those ran
+	team->io_context = vfs_new_io_context(parentIOContext,
+		teamArgs->spawn == NULL);
 	if (!team->io_context) {
 		status = B_NO_MEMORY;
 		goto err2;
@@ -1781,7 +2011,8 @@ load_image_internal(char**& _flatArgs, size_t flatArgsSize, int32 argCount,
 	parentIOContext = NULL;
 
 	// remove any fds that have the CLOEXEC flag set (emulating BeOS behaviour)
-	vfs_exec_io_context(team->io_context);
+	if (teamArgs->spawn == NULL)
+		vfs_exec_io_context(team->io_context);
 
 	// create an address space for this team
 	status = VMAddressSpace::Create(team->id, USER_BASE, USER_SIZE, false,
@@ -1805,7 +2036,9 @@ load_image_internal(char**& _flatArgs, size_t flatArgsSize, int32 argCount,
 	// The new thread will take over ownership of teamArgs.
 	{
 		ThreadCreationAttributes threadAttributes(team_create_thread_start,
-			threadName, B_NORMAL_PRIORITY, teamArgs, teamID, mainThread);
+			threadName, spawnArgs != NULL && spawnArgs->priority >= 0
+				? spawnArgs->priority : B_NORMAL_PRIORITY,
+			teamArgs, teamID, mainThread);
 		threadAttributes.additional_stack_size = sizeof(user_space_program_args)
 			+ teamArgs->flat_args_size;
 		thread = thread_create_thread(threadAttributes, false);
@@ -1834,13 +2067,22 @@ load_image_internal(char**& _flatArgs, size_t flatArgsSize, int32 argCount,
 		while (!loadingInfo.done)
 			thread_suspend();
 
-		if (loadingInfo.result < B_OK)
+		if (loadingInfo.result < B_OK) {
+			if (spawnArgs != NULL) {
+				// the caller never gets to see the team, so reap it
+				siginfo_t info;
+				wait_for_child(teamID, WEXITED, info);
+			}
 			return loadingInfo.result;
+		}
 	}
 
 	// notify the debugger
 	user_debug_team_created(teamID);
 
+	if (spawnArgs != NULL)
+		resume_thread(thread);
+
 	return thread;
 
 err5:
@@ -3691,8 +3933,9 @@ load_image_etc(int32 argCount, const char* const* args,
 
 	*slot++ = NULL;
 
+	spawn_args* spawnArgs = NULL;
 	thread_id thread = load_image_internal(flatArgs, size, argCount, envCount,
-		B_NORMAL_PRIORITY, parentID, B_WAIT_TILL_LOADED, -1, 0);
+		B_NORMAL_PRIORITY, parentID, B_WAIT_TILL_LOADED, -1, 0, spawnArgs);
 
 	free(flatArgs);
 		// load_image_internal() unset our variable if it took over ownership
@@ -4192,9 +4435,10 @@ _user_load_image(const char* const* userFlatArgs, size_t flatArgsSize,
 	if (error != B_OK)
 		return error;
 
+	spawn_args* spawnArgs = NULL;
 	thread_id thread = load_image_internal(flatArgs, _ALIGN(flatArgsSize),
 		argCount, envCount, priority, B_CURRENT_TEAM, flags, errorPort,
-		errorToken);
+		errorToken, spawnArgs);
 
 	free(flatArgs);
 		// load_image_internal() unset our variable if it took over ownership
@@ -4203,6 +4447,41 @@ _user_load_image(const char* const* userFlatArgs, size_t flatArgsSize,
 }
 
 
+thread_id
+_user_spawn_image(const char* const* userFlatArgs, size_t flatArgsSize,
+	int32 argCount, int32 envCount, const spawn_args* userSpawnArgs)
+{
+	TRACE(("_user_spawn_image: argc = %" B_PRId32 "\n", argCount));
+
+	if (argCount < 1 || userSpawnArgs == NULL)
+		return B_BAD_VALUE;
+
+	spawn_args* spawnArgs;
+	status_t error = copy_user_spawn_args(userSpawnArgs, spawnArgs);
+	if (error != B_OK)
+		return error;
+
+	// copy and relocate the flat arguments
+	char** flatArgs;
+	error = copy_user_process_args(userFlatArgs, flatArgsSize, argCount,
+		envCount, flatArgs);
+	if (error != B_OK) {
+		free_spawn_args(spawnArgs);
+		return error;
+	}
+
+	thread_id thread = load_image_internal(flatArgs, _ALIGN(flatArgsSize),
+		argCount, envCount, B_NORMAL_PRIORITY, B_CURRENT_TEAM, 0, -1, 0,
+		spawnArgs);
+
+	free(flatArgs);
+	free_spawn_args(spawnArgs);
+		// load_image_internal() unset our variables if it took over ownership
+
+	return thread;
+}
+
+
 void
 _user_exit_team(status_t returnValue)
 {
@@ -4338,6 +4617,7 @@ _user_get_extended_team_info(team_id teamID, uint32 flags, void* buffer,
 			gid_t	real_gid;
 			uid_t	effective_uid;
 			gid_t	effective_gid;
+			int32	large_pages;
 			char	name[B_OS_NAME_LENGTH];
 		};
 
@@ -4368,6 +4648,8 @@ _user_get_extended_team_info(team_id teamID, uint32 flags, void* buffer,
 			teamClone->real_gid = team->real_gid;
 			teamClone->effective_uid = team->effective_uid;
 			teamClone->effective_gid = team->effective_gid;
+			teamClone->large_pages = team->address_space != NULL
+				? team->address_space->TranslationMap()->LargePageCount() : 0;
 
 			// also fetch a reference to the I/O context
 			ioContext = team->io_context;
@@ -4384,7 +4666,10 @@ _user_get_extended_team_info(team_id teamID, uint32 flags, void* buffer,
 			|| info.AddInt32("uid", teamClone->real_uid) != B_OK
 			|| info.AddInt32("gid", teamClone->real_gid) != B_OK
 			|| info.AddInt32("euid", teamClone->effective_uid) != B_OK
-			|| info.AddInt32("egid", teamClone->effective_gid) != B_OK) {
+			|| info.AddInt32("egid", teamClone->effective_gid) != B_OK
+			|| info.AddInt32("large pages", teamClone->large_pages) != B_OK
+			|| info.AddInt32("system large pages", gMappedLargePagesCount)
+				!= B_OK) {
 			return B_NO_MEMORY;
 		}
 
@@ -2582,7 +2582,7 @@ deselect_thread(int32 id, struct select_info* info, bool kernel)
 		infoLocation = &(*infoLocation)->next;
 
 	if (*infoLocation != info)
-		return B_OK;
+		return B_ENTRY_NOT_FOUND;
 
 	*infoLocation = info->next;
 
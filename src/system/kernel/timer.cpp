@@ -23,14 +23,21 @@
 #include <smp.h>
 #include <thread.h>
 #include <util/AutoLock.h>
+#include <util/TimerWheel.h>
 
 
+typedef TimerWheel<timer> TimerList;
+
 struct per_cpu_timer_data {
 	spinlock		lock;
-	timer* volatile	events;
+	TimerList		events;
 	timer* volatile	current_event;
 	int32			current_event_in_progress;
 	bigtime_t		real_time_offset;
+	bigtime_t		hardware_timer;
+		// the time the hardware timer is set to, B_INFINITE_TIMEOUT if none;
+		// it may be earlier than the next deadline after a timer has been
+		// canceled
 };
 
 static per_cpu_timer_data sPerCPU[SMP_MAX_CPUS];
@@ -67,27 +74,46 @@ set_hardware_timer(bigtime_t scheduleTime)
 }
 
 
-/*! NOTE: expects interrupts to be off */
+/*!	Sets the hardware timer of the current CPU to the next deadline of its
+	timers, if there is one.
+	NOTE: expects interrupts to be off, and the CPU's timer lock to be held.
+*/
 static void
-add_event_to_list(timer* event, timer* volatile* list)
+update_hardware_timer(per_cpu_timer_data& cpuData)
 {
-	timer* next;
-	timer* last = NULL;
+	bigtime_t deadline = cpuData.events.NextDeadline();
+	if (deadline < cpuData.hardware_timer) {
+		cpuData.hardware_timer = deadline;
+		set_hardware_timer(deadline);
+	}
+}
 
-	// stick it in the event list
-	for (next = *list; next; last = next, next = (timer*)next->next) {
-		if ((bigtime_t)next->schedule_time >= (bigtime_t)event->schedule_time)
-			break;
+
+struct RealTimeTimerCollector {
+	timer*	affectedTimers;
+
+	RealTimeTimerCollector()
+		:
+		affectedTimers(NULL)
+	{
 	}
 
-	if (last != NULL) {
-		event->next = last->next;
-		last->next = event;
-	} else {
-		event->next = next;
-		*list = event;
+	bool operator()(timer* event)
+	{
+		// check whether it's an absolute real-time timer
+		uint32 flags = event->flags;
+		if ((flags & ~B_TIMER_FLAGS) != B_ONE_SHOT_ABSOLUTE_TIMER
+			|| (flags & B_TIMER_REAL_TIME_BASE) == 0) {
+			return false;
+		}
+
+		// Yep, remove the timer from the queue and add it to the
+		// affectedTimers list.
+		event->next = affectedTimers;
+		affectedTimers = event;
+		return true;
 	}
-}
+};
 
 
 static void
@@ -105,29 +131,11 @@ per_cpu_real_time_clock_changed(void*, int cpu)
 	bigtime_t timeDiff = cpuData.real_time_offset - realTimeOffset;
 	cpuData.real_time_offset = realTimeOffset;
 
-	timer* affectedTimers = NULL;
-	timer* volatile* it = &cpuData.events;
-	timer* firstEvent = *it;
-	while (timer* event = *it) {
-		// check whether it's an absolute real-time timer
-		uint32 flags = event->flags;
-		if ((flags & ~B_TIMER_FLAGS) != B_ONE_SHOT_ABSOLUTE_TIMER
-			|| (flags & B_TIMER_REAL_TIME_BASE) == 0) {
-			it = &event->next;
-			continue;
-		}
-
-		// Yep, remove the timer from the queue and add it to the
-		// affectedTimers list.
-		*it = event->next;
-		event->next = affectedTimers;
-		affectedTimers = event;
-	}
+	RealTimeTimerCollector collector;
+	cpuData.events.VisitAll(collector);
 
 	// update and requeue the affected timers
-	bool firstEventChanged = cpuData.events != firstEvent;
-	firstEvent = cpuData.events;
-
+	timer* affectedTimers = collector.affectedTimers;
 	while (affectedTimers != NULL) {
 		timer* event = affectedTimers;
 		affectedTimers = event->next;
@@ -144,20 +152,60 @@ per_cpu_real_time_clock_changed(void*, int cpu)
 				event->schedule_time = 0;
 		}
 
-		add_event_to_list(event, &cpuData.events);
+		cpuData.events.Add(event);
 	}
 
-	firstEventChanged |= cpuData.events != firstEvent;
-
-	// If the first event has changed, reset the hardware timer.
-	if (firstEventChanged)
-		set_hardware_timer(cpuData.events->schedule_time);
+	// If a timer has moved to the front, reset the hardware timer. If they
+	// have moved back, the next timer interrupt will take care of it.
+	update_hardware_timer(cpuData);
 }
 
 
 // #pragma mark - debugging
 
 
+struct TimerDumper {
+	int32	count;
+
+	TimerDumper()
+		:
+		count(0)
+	{
+	}
+
+	bool operator()(timer* event)
+	{
+		count++;
+
+		kprintf("  [%9lld] %p: ", (long long)event->schedule_time, event);
+		if ((event->flags & ~B_TIMER_FLAGS) == B_PERIODIC_TIMER)
+			kprintf("periodic %9lld, ", (long long)event->period);
+		else
+			kprintf("one shot,           ");
+
+		kprintf("flags: %#x, user data: %p, callback: %p  ",
+			event->flags, event->user_data, event->hook);
+
+		// look up and print the hook function symbol
+		const char* symbol;
+		const char* imageName;
+		bool exactMatch;
+
+		status_t error = elf_debug_lookup_symbol_address(
+			(addr_t)event->hook, NULL, &symbol, &imageName, &exactMatch);
+		if (error == B_OK && exactMatch) {
+			if (const char* slash = strchr(imageName, '/'))
+				imageName = slash + 1;
+
+			kprintf("   %s:%s", imageName, symbol);
+		}
+
+		kprintf("\n");
+		return false;
+	}
+};
+
+
 static int
 dump_timers(int argc, char** argv)
 {
@@ -165,37 +213,14 @@ dump_timers(int argc, char** argv)
 	for (int32 i = 0; i < cpuCount; i++) {
 		kprintf("CPU %" B_PRId32 ":\n", i);
 
-		if (sPerCPU[i].events == NULL) {
-			kprintf("  no timers scheduled\n");
-			continue;
-		}
-
-		for (timer* event = sPerCPU[i].events; event != NULL;
-				event = event->next) {
-			kprintf("  [%9lld] %p: ", (long long)event->schedule_time, event);
-			if ((event->flags & ~B_TIMER_FLAGS) == B_PERIODIC_TIMER)
-				kprintf("periodic %9lld, ", (long long)event->period);
-			else
-				kprintf("one shot,           ");
-
-			kprintf("flags: %#x, user data: %p, callback: %p  ",
-				event->flags, event->user_data, event->hook);
-
-			// look up and print the hook function symbol
-			const char* symbol;
-			const char* imageName;
-			bool exactMatch;
-
-			status_t error = elf_debug_lookup_symbol_address(
-				(addr_t)event->hook, NULL, &symbol, &imageName, &exactMatch);
-			if (error == B_OK && exactMatch) {
-				if (const char* slash = strchr(imageName, '/'))
-					imageName = slash + 1;
-
-				kprintf("   %s:%s", imageName, symbol);
-			}
+		TimerDumper dumper;
+		sPerCPU[i].events.VisitAll(dumper);
 
-			kprintf("\n");
+		if (dumper.count == 0)
+			kprintf("  no timers scheduled\n");
+		else {
+			kprintf("  hardware timer: %lld\n",
+				(long long)sPerCPU[i].hardware_timer);
 		}
 	}
 
@@ -218,7 +243,13 @@ timer_init(kernel_args* args)
 
 	add_debugger_command_etc("timers", &dump_timers, "List all timers",
 		"\n"
-		"Prints a list of all scheduled timers.\n", 0);
+		"Prints a list of all scheduled timers, not sorted by their schedule\n"
+		"time.\n", 0);
+
+	for (int32 i = 0; i < SMP_MAX_CPUS; i++) {
+		sPerCPU[i].events.Init(0);
+		sPerCPU[i].hardware_timer = B_INFINITE_TIMEOUT;
+	}
 
 	return B_OK;
 }
@@ -257,12 +288,12 @@ timer_interrupt()
 
 	acquire_spinlock(spinlock);
 
-	event = cpuData.events;
-	while (event != NULL && ((bigtime_t)event->schedule_time < system_time())) {
+	cpuData.hardware_timer = B_INFINITE_TIMEOUT;
+
+	while ((event = cpuData.events.RemoveExpired(system_time())) != NULL) {
 		// this event needs to happen
 		int mode = event->flags;
 
-		cpuData.events = (timer*)event->next;
 		cpuData.current_event = event;
 		atomic_set(&cpuData.current_event_in_progress, 1);
 
@@ -295,17 +326,14 @@ timer_interrupt()
 					- (now - event->schedule_time) % event->period;
 			}
 
-			add_event_to_list(event, &cpuData.events);
+			cpuData.events.Add(event);
 		}
 
 		cpuData.current_event = NULL;
-
-		event = cpuData.events;
 	}
 
 	// setup the next hardware timer
-	if (cpuData.events != NULL)
-		set_hardware_timer(cpuData.events->schedule_time);
+	update_hardware_timer(cpuData);
 
 	release_spinlock(spinlock);
 
@@ -358,12 +386,14 @@ add_timer(timer* event, timer_hook hook, bigtime_t period, int32 flags)
 			event->schedule_time = 0;
 	}
 
-	add_event_to_list(event, &cpuData.events);
+	cpuData.events.Add(event);
 	event->cpu = currentCPU;
 
-	// if we were stuck at the head of the list, set the hardware timer
-	if (event == cpuData.events)
-		set_hardware_timer(scheduleTime, currentTime);
+	// if we are the next timer to fire, set the hardware timer
+	if (event->schedule_time < cpuData.hardware_timer) {
+		cpuData.hardware_timer = event->schedule_time;
+		set_hardware_timer(event->schedule_time, currentTime);
+	}
 
 	release_spinlock(&cpuData.lock);
 	restore_interrupts(state);
@@ -399,40 +429,17 @@ cancel_timer(timer* event)
 
 	if (event != cpuData.current_event) {
 		// The timer hook is not yet being executed.
-		timer* current = cpuData.events;
-		timer* last = NULL;
-
-		while (current != NULL) {
-			if (current == event) {
-				// we found it
-				if (last == NULL)
-					cpuData.events = current->next;
-				else
-					last->next = current->next;
-				current->next = NULL;
-				// break out of the whole thing
-				break;
-			}
-			last = current;
-			current = current->next;
-		}
 
-		// If not found, we assume this was a one-shot timer and has already
+		// If not queued, we assume this was a one-shot timer and has already
 		// fired.
-		if (current == NULL)
+		if (!cpuData.events.Remove(event))
 			return true;
 
 		// invalidate CPU field
 		event->cpu = 0xffff;
 
-		// If on the current CPU, also reset the hardware timer.
-		if (cpu == smp_get_current_cpu()) {
-			if (cpuData.events == NULL)
-				arch_timer_clear_hardware_timer();
-			else
-				set_hardware_timer(cpuData.events->schedule_time);
-		}
-
+		// The hardware timer is left alone; should it go off before the next
+		// timer is due, timer_interrupt() will just set it again.
 		return false;
 	}
 
@@ -25,8 +25,9 @@
 #endif
 
 
-// maximal height of a tree
-static const int kMaxAVLTreeHeight = 32;
+// maximal height of a tree (an AVL tree of that height has at least
+// Fibonacci(50) - 1 nodes)
+static const int kMaxAVLTreeHeight = 48;
 
 
 // #pragma mark - AVLTreeCompare
@@ -61,6 +62,16 @@ AVLTreeBase::MakeEmpty()
 }
 
 
+/*!	Exchanges the nodes of the two trees. The compare objects are kept.
+*/
+void
+AVLTreeBase::Swap(AVLTreeBase& other)
+{
+	std::swap(fRoot, other.fRoot);
+	std::swap(fNodeCount, other.fNodeCount);
+}
+
+
 AVLTreeNode*
 AVLTreeBase::LeftMost(AVLTreeNode* node) const
 {
@@ -0,0 +1,529 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	The compressed swap pool is a tier of RAM in front of the swap files.
+
+	When a page of an anonymous cache is written to swap, it gets a swap slot
+	as usual, but is compressed into the pool instead of being written to the
+	slot, if the pool has room for it. The pool is indexed by the swap slot,
+	so that the swap block bookkeeping and the swap space accounting of the
+	caches don't have to know about it: a slot's page is either in the pool
+	or in the swap file. Reading the slot back first looks into the pool.
+
+	When the pool fills up, the demoter thread decompresses the least
+	recently used pages and writes them to their slots in the swap files.
+	While a page is being demoted, it stays in the pool and can still be
+	read from there; writing it anew waits until the demotion is done, and
+	freeing its slot is deferred to the demoter.
+*/
+
+
+#include "CompressedSwapPool.h"
+
+#include <string.h>
+
+#include <heap.h>
+#include <kernel_daemon.h>
+#include <slab/Slab.h>
+#include <smp.h>
+#include <thread.h>
+#include <util/AutoLock.h>
+#include <vm/vm.h>
+#include <vm_defs.h>
+
+#include "SwapCompressor.h"
+
+
+#if ENABLE_SWAP_SUPPORT
+
+// Pages that don't compress to this size go to the swap file directly.
+static const size_t kMaxCompressedSize = B_PAGE_SIZE * 3 / 4;
+
+static const int32 kMaxContexts = 16;
+static const size_t kInitialTableSize = 1024;
+static const int kTableResizeInterval = 5;
+	// in seconds, as the swap hash
+
+
+struct CompressedSwapPool::Context {
+	mutex			lock;
+	void*			compressor_context;
+	void*			buffer;
+};
+
+
+static status_t
+map_page(generic_addr_t address, bool physical, void*& _page, void*& _handle)
+{
+	if (!physical) {
+		_page = (void*)(addr_t)address;
+		return B_OK;
+	}
+
+	addr_t virtualAddress;
+	status_t status = vm_get_physical_page(address, &virtualAddress, &_handle);
+	if (status != B_OK)
+		return status;
+
+	_page = (void*)virtualAddress;
+	return B_OK;
+}
+
+
+static void
+unmap_page(void* page, void* handle, bool physical)
+{
+	if (physical)
+		vm_put_physical_page((addr_t)page, handle);
+}
+
+
+// #pragma mark -
+
+
+SwapCompressor::~SwapCompressor()
+{
+}
+
+
+SwapSlotBackend::~SwapSlotBackend()
+{
+}
+
+
+// #pragma mark -
+
+
+CompressedSwapPool::CompressedSwapPool()
+	:
+	fEntryCount(0),
+	fPoolSize(0),
+	fMaxSize(0),
+	fCompressor(NULL),
+	fBackend(NULL),
+	fContexts(NULL),
+	fContextCount(0),
+	fDemoterContext(NULL),
+	fDemoterPage(NULL),
+	fRejectedPages(0),
+	fDemotedPages(0)
+{
+}
+
+
+/*!	Sets up the pool. Until this has succeeded, the pool rejects all pages.
+	Must only be called once.
+*/
+status_t
+CompressedSwapPool::Init(SwapCompressor* compressor, SwapSlotBackend* backend,
+	size_t maxSize)
+{
+	mutex_init(&fLock, "compressed swap pool");
+	fDemoteCondition.Init(this, "compressed swap demote");
+	fDemotedCondition.Init(this, "compressed swap demoted");
+
+	status_t status = fTable.Init(kInitialTableSize);
+	if (status != B_OK)
+		return status;
+
+	int32 contextCount = min_c(smp_get_num_cpus(), kMaxContexts);
+	fContexts = new(std::nothrow) Context[contextCount];
+	if (fContexts == NULL)
+		return B_NO_MEMORY;
+
+	for (; fContextCount < contextCount; fContextCount++) {
+		Context& context = fContexts[fContextCount];
+		mutex_init(&context.lock, "compressed swap context");
+		context.compressor_context = compressor->CreateContext();
+		context.buffer = malloc(B_PAGE_SIZE);
+		if (context.compressor_context == NULL || context.buffer == NULL)
+			return B_NO_MEMORY;
+	}
+
+	fDemoterContext = compressor->CreateContext();
+	fDemoterPage = malloc(B_PAGE_SIZE);
+	if (fDemoterContext == NULL || fDemoterPage == NULL)
+		return B_NO_MEMORY;
+
+	status = register_resource_resizer(&_ResizeTable, this,
+		kTableResizeInterval);
+	if (status != B_OK)
+		return status;
+
+	thread_id thread = spawn_kernel_thread(&_DemoterThread,
+		"compressed swap demoter", B_NORMAL_PRIORITY, this);
+	if (thread < 0)
+		return thread;
+
+	fMaxSize = maxSize;
+	fBackend = backend;
+	fCompressor = compressor;
+
+	resume_thread(thread);
+
+	dprintf("compressed swap: %s, pool of up to %" B_PRIuSIZE " KB\n",
+		compressor->Name(), maxSize / 1024);
+	return B_OK;
+}
+
+
+/*!	Compresses the page at \a address into the pool, replacing what the pool
+	had for the slot before. If the page could not be stored, the slot no
+	longer has a page in the pool, and the caller has to write the page to the
+	swap file.
+*/
+bool
+CompressedSwapPool::Store(swap_addr_t slotIndex, generic_addr_t address,
+	bool physical)
+{
+	if (!IsEnabled())
+		return false;
+
+	Invalidate(slotIndex);
+
+	if (fPoolSize + kMaxCompressedSize > fMaxSize) {
+		MutexLocker locker(fLock);
+		fRejectedPages++;
+		fDemoteCondition.NotifyAll();
+		return false;
+	}
+
+	Context& context = _AcquireContext();
+
+	void* page;
+	void* handle;
+	size_t size = 0;
+	status_t status = map_page(address, physical, page, handle);
+	if (status == B_OK) {
+		status = fCompressor->Compress(context.compressor_context, page,
+			context.buffer, kMaxCompressedSize, size);
+		unmap_page(page, handle, physical);
+	}
+
+	Entry* entry = NULL;
+	if (status == B_OK) {
+		entry = (Entry*)malloc_etc(sizeof(Entry) + size,
+			CACHE_DONT_WAIT_FOR_MEMORY | CACHE_DONT_LOCK_KERNEL_SPACE);
+		if (entry != NULL)
+			memcpy(entry->data, context.buffer, size);
+	}
+
+	_ReleaseContext(context);
+
+	MutexLocker locker(fLock);
+
+	if (entry == NULL) {
+		fRejectedPages++;
+		return false;
+	}
+
+	entry->slot = slotIndex;
+	entry->size = size;
+	entry->demoting = false;
+	entry->freed = false;
+
+	fTable.InsertUnchecked(entry);
+	fLRU.Add(entry);
+	fEntryCount++;
+	fPoolSize += sizeof(Entry) + size;
+
+	if (fPoolSize > fMaxSize / 8 * 7)
+		fDemoteCondition.NotifyAll();
+
+	return true;
+}
+
+
+/*!	If the pool has a page for the slot, decompresses it to \a address, sets
+	\a _status, and returns \c true. Otherwise the page has to be read from
+	the swap file.
+*/
+bool
+CompressedSwapPool::Load(swap_addr_t slotIndex, generic_addr_t address,
+	bool physical, status_t& _status)
+{
+	if (atomic_get(&fEntryCount) == 0)
+		return false;
+
+	Context& context = _AcquireContext();
+
+	MutexLocker locker(fLock);
+
+	Entry* entry = fTable.Lookup(slotIndex);
+	if (entry == NULL) {
+		locker.Unlock();
+		_ReleaseContext(context);
+		return false;
+	}
+
+	// The data is copied, so that the entry can go away while we are
+	// decompressing it.
+	size_t size = entry->size;
+	memcpy(context.buffer, entry->data, size);
+
+	if (!entry->demoting) {
+		fLRU.Remove(entry);
+		fLRU.Add(entry);
+	}
+
+	locker.Unlock();
+
+	void* page;
+	void* handle;
+	_status = map_page(address, physical, page, handle);
+	if (_status == B_OK) {
+		_status = fCompressor->Decompress(context.compressor_context,
+			context.buffer, size, page);
+		unmap_page(page, handle, physical);
+	}
+
+	_ReleaseContext(context);
+
+	if (_status != B_OK) {
+		dprintf("compressed swap: reading slot %" B_PRIu32 " failed: %s\n",
+			slotIndex, strerror(_status));
+	}
+
+	return true;
+}
+
+
+bool
+CompressedSwapPool::Contains(swap_addr_t slotIndex)
+{
+	if (atomic_get(&fEntryCount) == 0)
+		return false;
+
+	MutexLocker locker(fLock);
+	return fTable.Lookup(slotIndex) != NULL;
+}
+
+
+/*!	Removes the slot's page from the pool, waiting for it if it's currently
+	being demoted. Must be called before the slot is written in the swap file.
+*/
+void
+CompressedSwapPool::Invalidate(swap_addr_t slotIndex)
+{
+	if (atomic_get(&fEntryCount) == 0)
+		return;
+
+	MutexLocker locker(fLock);
+
+	while (Entry* entry = fTable.Lookup(slotIndex)) {
+		if (!entry->demoting) {
+			_Remove(entry);
+			return;
+		}
+
+		ConditionVariableEntry waitEntry;
+		fDemotedCondition.Add(&waitEntry);
+		locker.Unlock();
+		waitEntry.Wait();
+		locker.Lock();
+	}
+}
+
+
+/*!	Called when the slot is freed. Removes its page from the pool, and
+	returns whether the slot can be freed now. If the page is currently being
+	demoted, the demoter frees the slot when it's done, and \c false is
+	returned.
+*/
+bool
+CompressedSwapPool::Free(swap_addr_t slotIndex)
+{
+	if (atomic_get(&fEntryCount) == 0)
+		return true;
+
+	MutexLocker locker(fLock);
+
+	Entry* entry = fTable.Lookup(slotIndex);
+	if (entry == NULL)
+		return true;
+
+	if (entry->demoting) {
+		entry->freed = true;
+		return false;
+	}
+
+	_Remove(entry);
+	return true;
+}
+
+
+void
+CompressedSwapPool::GetInfo(compressed_swap_info& info)
+{
+	if (!IsEnabled())
+		return;
+
+	MutexLocker locker(fLock);
+
+	strlcpy(info.algorithm, fCompressor->Name(), sizeof(info.algorithm));
+	info.max_pool_size = fMaxSize;
+	info.pool_size = fPoolSize;
+	info.stored_pages = fEntryCount;
+	info.rejected_pages = fRejectedPages;
+	info.demoted_pages = fDemotedPages;
+}
+
+
+void
+CompressedSwapPool::Dump()
+{
+	if (!IsEnabled()) {
+		kprintf("compressed swap pool: disabled\n");
+		return;
+	}
+
+	kprintf("compressed swap pool (%s):\n", fCompressor->Name());
+	kprintf("size:      %9" B_PRIuSIZE " KB of %" B_PRIuSIZE " KB\n",
+		fPoolSize / 1024, fMaxSize / 1024);
+	kprintf("pages:     %9" B_PRId32 "\n", fEntryCount);
+	kprintf("ratio:     %9" B_PRIu64 " %%\n", fPoolSize > 0
+		? (uint64)fEntryCount * B_PAGE_SIZE * 100 / fPoolSize : 0);
+	kprintf("rejected:  %9" B_PRIu64 "\n", fRejectedPages);
+	kprintf("demoted:   %9" B_PRIu64 "\n", fDemotedPages);
+}
+
+
+CompressedSwapPool::Context&
+CompressedSwapPool::_AcquireContext()
+{
+	// The CPU is only a hint to spread the contexts, we may be migrated
+	// anytime.
+	Context& context = fContexts[smp_get_current_cpu() % fContextCount];
+	mutex_lock(&context.lock);
+	return context;
+}
+
+
+void
+CompressedSwapPool::_ReleaseContext(Context& context)
+{
+	mutex_unlock(&context.lock);
+}
+
+
+/*!	The pool must be locked.
+*/
+void
+CompressedSwapPool::_Remove(Entry* entry)
+{
+	fTable.RemoveUnchecked(entry);
+	if (!entry->demoting)
+		fLRU.Remove(entry);
+	fEntryCount--;
+	fPoolSize -= sizeof(Entry) + entry->size;
+
+	free_etc(entry, CACHE_DONT_WAIT_FOR_MEMORY | CACHE_DONT_LOCK_KERNEL_SPACE);
+}
+
+
+/*!	Writes the least recently used pages to the swap file, until the pool is
+	down to three quarters of its size.
+*/
+status_t
+CompressedSwapPool::_Demote()
+{
+	MutexLocker locker(fLock);
+
+	while (fPoolSize > fMaxSize / 4 * 3) {
+		Entry* entry = fLRU.RemoveHead();
+		if (entry == NULL)
+			break;
+
+		entry->demoting = true;
+		locker.Unlock();
+
+		status_t status = fCompressor->Decompress(fDemoterContext,
+			entry->data, entry->size, fDemoterPage);
+		if (status == B_OK)
+			status = fBackend->WritePage(entry->slot, fDemoterPage);
+
+		locker.Lock();
+
+		if (status != B_OK && !entry->freed) {
+			// keep the page, and try again later
+			dprintf("compressed swap: demoting slot %" B_PRIu32 " failed: "
+				"%s\n", entry->slot, strerror(status));
+			entry->demoting = false;
+			fLRU.Add(entry);
+			fDemotedCondition.NotifyAll();
+			return status;
+		}
+
+		swap_addr_t slotIndex = entry->slot;
+		bool freed = entry->freed;
+
+		_Remove(entry);
+		fDemotedPages++;
+		fDemotedCondition.NotifyAll();
+
+		if (freed) {
+			locker.Unlock();
+			fBackend->FreeSlot(slotIndex);
+			locker.Lock();
+		}
+	}
+
+	return B_OK;
+}
+
+
+/*static*/ status_t
+CompressedSwapPool::_DemoterThread(void* _self)
+{
+	CompressedSwapPool* self = (CompressedSwapPool*)_self;
+
+	while (true) {
+		MutexLocker locker(self->fLock);
+
+		if (self->fPoolSize <= self->fMaxSize / 8 * 7) {
+			ConditionVariableEntry entry;
+			self->fDemoteCondition.Add(&entry);
+			locker.Unlock();
+			entry.Wait();
+		} else
+			locker.Unlock();
+
+		if (self->_Demote() != B_OK) {
+			// don't hammer the swap file
+			snooze(1000000);
+		}
+	}
+
+	return B_OK;
+}
+
+
+/*static*/ void
+CompressedSwapPool::_ResizeTable(void* _self, int)
+{
+	CompressedSwapPool* self = (CompressedSwapPool*)_self;
+	MutexLocker locker(self->fLock);
+
+	size_t size;
+	void* allocation;
+
+	do {
+		size = self->fTable.ResizeNeeded();
+		if (size == 0)
+			return;
+
+		locker.Unlock();
+
+		allocation = malloc(size);
+		if (allocation == NULL)
+			return;
+
+		locker.Lock();
+
+	} while (!self->fTable.Resize(allocation, size));
+}
+
+#endif	// ENABLE_SWAP_SUPPORT
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _KERNEL_VM_COMPRESSED_SWAP_POOL_H
+#define _KERNEL_VM_COMPRESSED_SWAP_POOL_H
+
+
+#include <condition_variable.h>
+#include <lock.h>
+#include <util/DoublyLinkedList.h>
+#include <util/OpenHashTable.h>
+
+#include "VMAnonymousCache.h"
+
+
+#if ENABLE_SWAP_SUPPORT
+
+struct compressed_swap_info;
+class SwapCompressor;
+
+
+struct compressed_swap_entry
+	: DoublyLinkedListLinkImpl<compressed_swap_entry> {
+	compressed_swap_entry*	hash_link;
+	swap_addr_t				slot;
+	uint16					size;
+	bool					demoting;
+	bool					freed;
+		// the slot has been freed while the page was being demoted
+	uint8					data[0];
+};
+
+
+struct CompressedSwapHashDefinition {
+	typedef swap_addr_t KeyType;
+	typedef compressed_swap_entry ValueType;
+
+	size_t HashKey(swap_addr_t key) const
+	{
+		return key;
+	}
+
+	size_t Hash(const compressed_swap_entry* value) const
+	{
+		return value->slot;
+	}
+
+	bool Compare(swap_addr_t key, const compressed_swap_entry* value) const
+	{
+		return value->slot == key;
+	}
+
+	compressed_swap_entry*& GetLink(compressed_swap_entry* value) const
+	{
+		return value->hash_link;
+	}
+};
+
+
+/*!	Where the pages demoted from the pool go: the swap files.
+*/
+class SwapSlotBackend {
+public:
+	virtual						~SwapSlotBackend();
+
+	virtual	status_t			WritePage(swap_addr_t slotIndex,
+									const void* page) = 0;
+	virtual	void				FreeSlot(swap_addr_t slotIndex) = 0;
+};
+
+
+class CompressedSwapPool {
+public:
+								CompressedSwapPool();
+
+			status_t			Init(SwapCompressor* compressor,
+									SwapSlotBackend* backend,
+									size_t maxSize);
+			bool				IsEnabled() const
+									{ return fCompressor != NULL; }
+
+			bool				Store(swap_addr_t slotIndex,
+									generic_addr_t address, bool physical);
+			bool				Load(swap_addr_t slotIndex,
+									generic_addr_t address, bool physical,
+									status_t& _status);
+			bool				Contains(swap_addr_t slotIndex);
+			void				Invalidate(swap_addr_t slotIndex);
+			bool				Free(swap_addr_t slotIndex);
+
+			void				GetInfo(compressed_swap_info& info);
+			void				Dump();
+
+private:
+			struct Context;
+
+			typedef compressed_swap_entry Entry;
+			typedef BOpenHashTable<CompressedSwapHashDefinition> EntryTable;
+			typedef DoublyLinkedList<Entry> EntryList;
+
+			Context&			_AcquireContext();
+			void				_ReleaseContext(Context& context);
+
+			void				_Remove(Entry* entry);
+			status_t			_Demote();
+
+	static	status_t			_DemoterThread(void* self);
+	static	void				_ResizeTable(void* self, int);
+
+private:
+			mutex				fLock;
+			EntryTable			fTable;
+			EntryList			fLRU;
+				// entries that are not being demoted, least recently used
+				// first
+			int32				fEntryCount;
+			size_t				fPoolSize;
+			size_t				fMaxSize;
+
+			SwapCompressor*		fCompressor;
+			SwapSlotBackend*	fBackend;
+			Context*			fContexts;
+			int32				fContextCount;
+
+			void*				fDemoterContext;
+			void*				fDemoterPage;
+			ConditionVariable	fDemoteCondition;
+			ConditionVariable	fDemotedCondition;
+
+			uint64				fRejectedPages;
+			uint64				fDemotedPages;
+};
+
+#endif	// ENABLE_SWAP_SUPPORT
+
+
+#endif	// _KERNEL_VM_COMPRESSED_SWAP_POOL_H
@@ -0,0 +1,39 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _KERNEL_VM_SWAP_COMPRESSOR_H
+#define _KERNEL_VM_SWAP_COMPRESSOR_H
+
+
+#include <SupportDefs.h>
+
+
+/*!	Interface of the compression algorithms used by the compressed swap pool.
+
+	An algorithm may need state and scratch memory for its work; it is kept in
+	a context created by CreateContext(). A context is only ever used by one
+	thread at a time, so that the algorithm does not need to do any locking.
+	Compress() and Decompress() must not allocate memory, as they are called
+	when memory is short.
+*/
+class SwapCompressor {
+public:
+	virtual						~SwapCompressor();
+
+	virtual	const char*			Name() const = 0;
+
+	virtual	void*				CreateContext() = 0;
+	virtual	void				DeleteContext(void* context) = 0;
+
+	virtual	status_t			Compress(void* context, const void* page,
+									void* buffer, size_t bufferSize,
+									size_t& _compressedSize) = 0;
+									// B_BUFFER_OVERFLOW, if the page doesn't
+									// compress to bufferSize bytes
+	virtual	status_t			Decompress(void* context, const void* data,
+									size_t size, void* page) = 0;
+};
+
+
+#endif	// _KERNEL_VM_SWAP_COMPRESSOR_H
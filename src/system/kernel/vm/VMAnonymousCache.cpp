@@ -55,7 +55,9 @@
 #include <vm/vm_priv.h>
 #include <vm/VMAddressSpace.h>
 
+#include "CompressedSwapPool.h"
 #include "IORequest.h"
+#include "ZlibSwapCompressor.h"
 
 
 #if	ENABLE_SWAP_SUPPORT
@@ -155,6 +157,15 @@ static mutex sAvailSwapSpaceLock;
 
 static object_cache* sSwapBlockCache;
 
+static ZlibSwapCompressor sZlibSwapCompressor;
+static CompressedSwapPool sCompressedSwapPool;
+
+// pages read in from the compressed pool and from the swap files
+static int64 sPoolFaults = 0;
+static int64 sPoolFaultTime = 0;
+static int64 sDiskFaults = 0;
+static int64 sDiskFaultTime = 0;
+
 
 #if SWAP_TRACING
 namespace SwapTracing {
@@ -254,6 +265,9 @@ dump_swap_info(int argc, char** argv)
 	kprintf("used:      %9" B_PRIu32 "\n", totalSwapPages - freeSwapPages);
 	kprintf("free:      %9" B_PRIu32 "\n", freeSwapPages);
 
+	kprintf("\n");
+	sCompressedSwapPool.Dump();
+
 	return 0;
 }
 
@@ -328,9 +342,9 @@ find_swap_file(swap_addr_t slotIndex)
 
 
 static void
-swap_slot_dealloc(swap_addr_t slotIndex, uint32 count)
+swap_slot_free(swap_addr_t slotIndex, uint32 count)
 {
-	if (slotIndex == SWAP_SLOT_NONE)
+	if (count == 0)
 		return;
 
 	mutex_lock(&sSwapFileListLock);
@@ -341,6 +355,54 @@ swap_slot_dealloc(swap_addr_t slotIndex, uint32 count)
 }
 
 
+static void
+swap_slot_dealloc(swap_addr_t slotIndex, uint32 count)
+{
+	if (slotIndex == SWAP_SLOT_NONE)
+		return;
+
+	// Slots whose pages are being moved from the compressed pool to the swap
+	// file right now are freed by the pool when it's done.
+	uint32 first = 0;
+	for (uint32 i = 0; i < count; i++) {
+		if (!sCompressedSwapPool.Free(slotIndex + i)) {
+			swap_slot_free(slotIndex + first, i - first);
+			first = i + 1;
+		}
+	}
+
+	swap_slot_free(slotIndex + first, count - first);
+}
+
+
+/*!	Writes the pages demoted from the compressed pool to their swap slots.
+*/
+class SwapFileBackend : public SwapSlotBackend {
+public:
+	virtual status_t WritePage(swap_addr_t slotIndex, const void* page)
+	{
+		swap_file* swapFile = find_swap_file(slotIndex);
+		off_t pos = (off_t)(slotIndex - swapFile->first_slot) * B_PAGE_SIZE;
+
+		generic_io_vec vector;
+		vector.base = (generic_addr_t)(addr_t)page;
+		vector.length = B_PAGE_SIZE;
+		generic_size_t length = B_PAGE_SIZE;
+
+		return vfs_write_pages(swapFile->vnode, swapFile->cookie, pos,
+			&vector, 1, 0, &length);
+	}
+
+	virtual void FreeSlot(swap_addr_t slotIndex)
+	{
+		swap_slot_free(slotIndex, 1);
+	}
+};
+
+
+static SwapFileBackend sSwapFileBackend;
+
+
 static off_t
 swap_space_reserve(off_t amount)
 {
@@ -594,13 +656,30 @@ VMAnonymousCache::Read(off_t offset, const generic_io_vec* vecs, size_t count,
 	uint32 flags, generic_size_t* _numBytes)
 {
 	off_t pageIndex = offset >> PAGE_SHIFT;
+	bool physical = (flags & B_PHYSICAL_IO_REQUEST) != 0;
 
 	for (uint32 i = 0, j = 0; i < count; i = j) {
 		swap_addr_t startSlotIndex = _SwapBlockGetAddress(pageIndex + i);
+		bigtime_t startTime = system_time();
+
+		status_t status;
+		if (sCompressedSwapPool.Load(startSlotIndex, vecs[i].base, physical,
+				status)) {
+			if (status != B_OK)
+				return status;
+
+			atomic_add64(&sPoolFaults, 1);
+			atomic_add64(&sPoolFaultTime, system_time() - startTime);
+			j = i + 1;
+			continue;
+		}
+
 		for (j = i + 1; j < count; j++) {
 			swap_addr_t slotIndex = _SwapBlockGetAddress(pageIndex + j);
-			if (slotIndex != startSlotIndex + j - i)
+			if (slotIndex != startSlotIndex + j - i
+				|| sCompressedSwapPool.Contains(slotIndex)) {
 				break;
+			}
 		}
 
 		T(ReadPage(this, pageIndex, startSlotIndex));
@@ -611,10 +690,13 @@ VMAnonymousCache::Read(off_t offset, const generic_io_vec* vecs, size_t count,
 		off_t pos = (off_t)(startSlotIndex - swapFile->first_slot)
 			* B_PAGE_SIZE;
 
-		status_t status = vfs_read_pages(swapFile->vnode, swapFile->cookie, pos,
+		status = vfs_read_pages(swapFile->vnode, swapFile->cookie, pos,
 			vecs + i, j - i, flags, _numBytes);
 		if (status != B_OK)
 			return status;
+
+		atomic_add64(&sDiskFaults, j - i);
+		atomic_add64(&sDiskFaultTime, system_time() - startTime);
 	}
 
 	return B_OK;
@@ -626,6 +708,7 @@ VMAnonymousCache::Write(off_t offset, const generic_io_vec* vecs, size_t count,
 	uint32 flags, generic_size_t* _numBytes)
 {
 	off_t pageIndex = offset >> PAGE_SHIFT;
+	bool physical = (flags & B_PHYSICAL_IO_REQUEST) != 0;
 
 	AutoLocker<VMCache> locker(this);
 
@@ -668,27 +751,41 @@ VMAnonymousCache::Write(off_t offset, const generic_io_vec* vecs, size_t count,
 			if (slotIndex == SWAP_SLOT_NONE)
 				panic("VMAnonymousCache::Write(): can't allocate swap space\n");
 
-			T(WritePage(this, pageIndex, slotIndex));
-				// TODO: Assumes that only one page is written.
+			// The pages only go to the swap file, if one of them can't be
+			// kept in the compressed pool.
+			page_num_t stored = 0;
+			while (stored < n && sCompressedSwapPool.Store(slotIndex + stored,
+					vectorBase + stored * B_PAGE_SIZE, physical)) {
+				stored++;
+			}
 
-			swap_file* swapFile = find_swap_file(slotIndex);
+			if (stored < n) {
+				for (page_num_t k = 0; k < stored; k++)
+					sCompressedSwapPool.Invalidate(slotIndex + k);
 
-			off_t pos = (off_t)(slotIndex - swapFile->first_slot) * B_PAGE_SIZE;
+				T(WritePage(this, pageIndex, slotIndex));
+					// TODO: Assumes that only one page is written.
 
-			generic_size_t length = (phys_addr_t)n * B_PAGE_SIZE;
-			generic_io_vec vector[1];
-			vector->base = vectorBase;
-			vector->length = length;
+				swap_file* swapFile = find_swap_file(slotIndex);
 
-			status_t status = vfs_write_pages(swapFile->vnode, swapFile->cookie,
-				pos, vector, 1, flags, &length);
-			if (status != B_OK) {
-				locker.Lock();
-				fAllocatedSwapSize -= (off_t)pagesLeft * B_PAGE_SIZE;
-				locker.Unlock();
+				off_t pos = (off_t)(slotIndex - swapFile->first_slot)
+					* B_PAGE_SIZE;
 
-				swap_slot_dealloc(slotIndex, n);
-				return status;
+				generic_size_t length = (phys_addr_t)n * B_PAGE_SIZE;
+				generic_io_vec vector[1];
+				vector->base = vectorBase;
+				vector->length = length;
+
+				status_t status = vfs_write_pages(swapFile->vnode,
+					swapFile->cookie, pos, vector, 1, flags, &length);
+				if (status != B_OK) {
+					locker.Lock();
+					fAllocatedSwapSize -= (off_t)pagesLeft * B_PAGE_SIZE;
+					locker.Unlock();
+
+					swap_slot_dealloc(slotIndex, n);
+					return status;
+				}
 			}
 
 			_SwapBlockBuild(pageIndex + totalPages, slotIndex, n);
@@ -736,6 +833,16 @@ VMAnonymousCache::WriteAsync(off_t offset, const generic_io_vec* vecs,
 		slotIndex = swap_slot_alloc(1);
 	}
 
+	// If the page can be kept in the compressed pool, we are done already.
+	if (sCompressedSwapPool.Store(slotIndex, vecs[0].base,
+			(flags & B_PHYSICAL_IO_REQUEST) != 0)) {
+		if (newSlot)
+			_SwapBlockBuild(pageIndex, slotIndex, 1);
+
+		_callback->IOFinished(B_OK, false, numBytes);
+		return B_OK;
+	}
+
 	// create our callback
 	WriteCallback* callback = (flags & B_VIP_IO_REQUEST) != 0
 		? new(malloc_flags(HEAP_PRIORITY_VIP)) WriteCallback(this, _callback)
@@ -1038,7 +1145,7 @@ VMAnonymousCache::_MergePagesSmallerSource(VMAnonymousCache* source)
 	for (VMCachePagesTree::Iterator it = source->pages.GetIterator();
 			vm_page* page = it.Next();) {
 		// Note: Removing the current node while iterating through a
-		// IteratableSplayTree is safe.
+		// VMCachePagesTree is safe.
 		vm_page* consumerPage = LookupPage(
 			(off_t)page->cache_offset << PAGE_SHIFT);
 		if (consumerPage == NULL) {
@@ -1073,7 +1180,7 @@ VMAnonymousCache::_MergePagesSmallerConsumer(VMAnonymousCache* source)
 		}
 
 		// Note: Removing the current node while iterating through a
-		// IteratableSplayTree is safe.
+		// VMCachePagesTree is safe.
 		source->MovePage(page);
 	}
 
@@ -1451,6 +1558,8 @@ swap_init_post_modules()
 	bool swapEnabled = true;
 	bool swapAutomatic = true;
 	off_t swapSize = 0;
+	bool compressionEnabled = true;
+	int32 compressionPoolPercent = 20;
 
 	dev_t swapDeviceID = -1;
 	VolumeInfo selectedVolume = {};
@@ -1502,6 +1611,16 @@ swap_init_post_modules()
 				}
 			}
 		}
+
+		compressionEnabled = get_driver_boolean_parameter(settings,
+			"swap_compression", true, true);
+		const char* poolPercent = get_driver_parameter(settings,
+			"swap_compression_pool", NULL, NULL);
+		if (poolPercent != NULL) {
+			compressionPoolPercent = min_c(max_c(atoi(poolPercent), 1),
+				50);
+		}
+
 		unload_driver_settings(settings);
 	}
 
@@ -1614,6 +1733,20 @@ swap_init_post_modules()
 	if (error != B_OK) {
 		dprintf("%s: Failed to add swap file %s: %s\n", __func__, swapPath,
 			strerror(error));
+		return;
+	}
+
+	// Put the compressed pool in front of the swap file. It uses the swap
+	// file's slots, so it's useless without one.
+	if (compressionEnabled) {
+		size_t poolSize = (size_t)((off_t)vm_page_num_pages() * B_PAGE_SIZE
+			* compressionPoolPercent / 100);
+		error = sCompressedSwapPool.Init(&sZlibSwapCompressor,
+			&sSwapFileBackend, poolSize);
+		if (error != B_OK) {
+			dprintf("%s: Failed to init the compressed swap pool: %s\n",
+				__func__, strerror(error));
+		}
 	}
 }
 
@@ -1681,3 +1814,26 @@ swap_get_info(system_info* info)
 #endif
 }
 
+
+status_t
+_user_get_compressed_swap_info(compressed_swap_info* userInfo, size_t size)
+{
+	if (size != sizeof(compressed_swap_info))
+		return B_BAD_VALUE;
+	if (userInfo == NULL || !IS_USER_ADDRESS(userInfo))
+		return B_BAD_ADDRESS;
+
+	compressed_swap_info info;
+	memset(&info, 0, sizeof(info));
+
+#if ENABLE_SWAP_SUPPORT
+	sCompressedSwapPool.GetInfo(info);
+	info.pool_faults = atomic_get64(&sPoolFaults);
+	info.pool_fault_time = atomic_get64(&sPoolFaultTime);
+	info.disk_faults = atomic_get64(&sDiskFaults);
+	info.disk_fault_time = atomic_get64(&sDiskFaultTime);
+#endif
+
+	return user_memcpy(userInfo, &info, sizeof(info));
+}
+
@@ -579,6 +579,97 @@ vm_cache_acquire_locked_page_cache(vm_page* page, bool dontWait)
 }
 
 
+// #pragma mark - VMCachePagesTree
+
+
+VMCachePagesTree::VMCachePagesTree()
+	:
+	fTree(this)
+{
+}
+
+
+VMCachePagesTree::~VMCachePagesTree()
+{
+}
+
+
+void
+VMCachePagesTree::Insert(vm_page* page)
+{
+	fTree.Insert(&page->cache_link);
+}
+
+
+void
+VMCachePagesTree::Remove(vm_page* page)
+{
+	fTree.Remove(&page->cache_link);
+}
+
+
+/*!	Exchanges the pages of this tree with those of \a other in constant time.
+*/
+void
+VMCachePagesTree::Swap(VMCachePagesTree& other)
+{
+	fTree.Swap(other.fTree);
+}
+
+
+/*!	Returns an iterator starting at the page with the given \a offset, if
+	\a orEqual is \c true and there is one, or else at the closest page with
+	a greater (\a greater is \c true) or lesser offset.
+*/
+VMCachePagesTree::Iterator
+VMCachePagesTree::GetIterator(page_num_t offset, bool greater,
+	bool orEqual) const
+{
+	AVLTreeNode* closest = NULL;
+	AVLTreeNode* node = fTree.Root();
+	while (node != NULL) {
+		page_num_t nodeOffset = PageFor(node)->cache_offset;
+		if (offset == nodeOffset && orEqual) {
+			closest = node;
+			break;
+		}
+
+		if (greater) {
+			if (offset < nodeOffset) {
+				closest = node;
+				node = node->left;
+			} else
+				node = node->right;
+		} else {
+			if (offset > nodeOffset) {
+				closest = node;
+				node = node->right;
+			} else
+				node = node->left;
+		}
+	}
+
+	return Iterator(&fTree, closest);
+}
+
+
+int
+VMCachePagesTree::CompareKeyNode(const void* key, const AVLTreeNode* node)
+{
+	page_num_t offset = *(const page_num_t*)key;
+	page_num_t nodeOffset = PageFor(node)->cache_offset;
+	return offset == nodeOffset ? 0 : (offset < nodeOffset ? -1 : 1);
+}
+
+
+int
+VMCachePagesTree::CompareNodes(const AVLTreeNode* node1,
+	const AVLTreeNode* node2)
+{
+	return CompareKeyNode(&PageFor(node1)->cache_offset, node2);
+}
+
+
 // #pragma mark - VMCache
 
 
@@ -667,7 +758,7 @@ VMCache::Delete()
 	T(Delete(this));
 
 	// free all of the pages in the cache
-	while (vm_page* page = pages.Root()) {
+	while (vm_page* page = pages.First()) {
 		if (!page->mappings.IsEmpty() || page->WiredCount() != 0) {
 			panic("remove page %p from cache %p: page still has mappings!\n"
 				"@!page %p; cache %p", page, this, page, this);
@@ -865,7 +956,7 @@ VMCache::MoveAllPages(VMCache* fromCache)
 	fromCache->AssertLocked();
 	ASSERT(page_count == 0);
 
-	std::swap(fromCache->pages, pages);
+	pages.Swap(fromCache->pages);
 	page_count = fromCache->page_count;
 	fromCache->page_count = 0;
 	fWiredPagesCount = fromCache->fWiredPagesCount;
@@ -1132,7 +1223,7 @@ VMCache::Resize(off_t newSize, int priority)
 				// unmap it!
 			RemovePage(page);
 			vm_page_free(this, page);
-				// Note: When iterating through a IteratableSplayTree
+				// Note: When iterating through a VMCachePagesTree
 				// removing the current node is safe.
 		}
 	}
@@ -1178,7 +1269,7 @@ VMCache::FlushAndRemoveAllPages()
 			DEBUG_PAGE_ACCESS_START(page);
 			RemovePage(page);
 			vm_page_free(this, page);
-				// Note: When iterating through a IteratableSplayTree
+				// Note: When iterating through a VMCachePagesTree
 				// removing the current node is safe.
 		}
 	}
@@ -1269,7 +1360,7 @@ VMCache::Merge(VMCache* source)
 	for (VMCachePagesTree::Iterator it = source->pages.GetIterator();
 			vm_page* page = it.Next();) {
 		// Note: Removing the current node while iterating through a
-		// IteratableSplayTree is safe.
+		// VMCachePagesTree is safe.
 		vm_page* consumerPage = LookupPage(
 			(off_t)page->cache_offset << PAGE_SHIFT);
 		if (consumerPage == NULL) {
@@ -19,7 +19,8 @@
 
 VMTranslationMap::VMTranslationMap()
 	:
-	fMapCount(0)
+	fMapCount(0),
+	fLargePageCount(0)
 {
 	recursive_lock_init(&fLock, "translation map");
 }
@@ -39,6 +40,38 @@ VMTranslationMap::DebugMarkRangePresent(addr_t start, addr_t end,
 }
 
 
+/*!	Returns the size of the large pages the translation map can use to map
+	suitably aligned, physically contiguous ranges, or \c 0, if it doesn't
+	support large pages at all.
+*/
+size_t
+VMTranslationMap::LargePageSize() const
+{
+	return 0;
+}
+
+
+/*!	Replaces the mappings of the large page sized and aligned range starting
+	at \a address by a single large page mapping.
+
+	The range must be completely mapped, physically contiguous, and all of its
+	pages must have the same protection and memory type. The translation map
+	stays responsible for splitting the large page again, when only a part of
+	the range is protected or unmapped later. Only to be used for wired
+	ranges, since the accessed and modified flags of the individual pages are
+	lost.
+
+	The map must be locked.
+
+	The default implementation returns \c B_NOT_SUPPORTED.
+*/
+status_t
+VMTranslationMap::CollapseLargePage(addr_t address)
+{
+	return B_NOT_SUPPORTED;
+}
+
+
 /*!	Unmaps a range of pages of an area.
 
 	The default implementation just iterates over all virtual pages of the
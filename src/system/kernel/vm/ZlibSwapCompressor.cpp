@@ -0,0 +1,117 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "ZlibSwapCompressor.h"
+
+#include <new>
+#include <string.h>
+
+#include <zlib.h>
+
+#include <KernelExport.h>
+
+
+// A page doesn't need a larger window than itself, and a smaller window keeps
+// the contexts small. Raw deflate streams spare us the header and checksum.
+static const int kWindowBits = 12;
+static const int kMemoryLevel = 5;
+
+
+struct zlib_context {
+	z_stream	deflate_stream;
+	z_stream	inflate_stream;
+};
+
+
+const char*
+ZlibSwapCompressor::Name() const
+{
+	return "zlib";
+}
+
+
+void*
+ZlibSwapCompressor::CreateContext()
+{
+	zlib_context* context = new(std::nothrow) zlib_context;
+	if (context == NULL)
+		return NULL;
+
+	memset(context, 0, sizeof(zlib_context));
+
+	if (deflateInit2(&context->deflate_stream, Z_BEST_SPEED, Z_DEFLATED,
+			-kWindowBits, kMemoryLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+		delete context;
+		return NULL;
+	}
+
+	if (inflateInit2(&context->inflate_stream, -kWindowBits) != Z_OK) {
+		deflateEnd(&context->deflate_stream);
+		delete context;
+		return NULL;
+	}
+
+	return context;
+}
+
+
+void
+ZlibSwapCompressor::DeleteContext(void* _context)
+{
+	zlib_context* context = (zlib_context*)_context;
+	if (context == NULL)
+		return;
+
+	deflateEnd(&context->deflate_stream);
+	inflateEnd(&context->inflate_stream);
+	delete context;
+}
+
+
+status_t
+ZlibSwapCompressor::Compress(void* _context, const void* page, void* buffer,
+	size_t bufferSize, size_t& _compressedSize)
+{
+	z_stream& stream = ((zlib_context*)_context)->deflate_stream;
+	if (deflateReset(&stream) != Z_OK)
+		return B_ERROR;
+
+	stream.next_in = (Bytef*)page;
+	stream.avail_in = B_PAGE_SIZE;
+	stream.next_out = (Bytef*)buffer;
+	stream.avail_out = bufferSize;
+
+	int zlibError = deflate(&stream, Z_FINISH);
+	if (zlibError != Z_STREAM_END) {
+		return zlibError == Z_OK || zlibError == Z_BUF_ERROR
+			? B_BUFFER_OVERFLOW : B_ERROR;
+	}
+
+	_compressedSize = stream.total_out;
+	return B_OK;
+}
+
+
+status_t
+ZlibSwapCompressor::Decompress(void* _context, const void* data, size_t size,
+	void* page)
+{
+	z_stream& stream = ((zlib_context*)_context)->inflate_stream;
+	if (inflateReset(&stream) != Z_OK)
+		return B_ERROR;
+
+	stream.next_in = (Bytef*)data;
+	stream.avail_in = size;
+	stream.next_out = (Bytef*)page;
+	stream.avail_out = B_PAGE_SIZE;
+
+	if (inflate(&stream, Z_FINISH) != Z_STREAM_END
+		|| stream.total_out != B_PAGE_SIZE) {
+		return B_BAD_DATA;
+	}
+
+	return B_OK;
+}
@@ -0,0 +1,27 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _KERNEL_VM_ZLIB_SWAP_COMPRESSOR_H
+#define _KERNEL_VM_ZLIB_SWAP_COMPRESSOR_H
+
+
+#include "SwapCompressor.h"
+
+
+class ZlibSwapCompressor : public SwapCompressor {
+public:
+	virtual	const char*			Name() const;
+
+	virtual	void*				CreateContext();
+	virtual	void				DeleteContext(void* context);
+
+	virtual	status_t			Compress(void* context, const void* page,
+									void* buffer, size_t bufferSize,
+									size_t& _compressedSize);
+	virtual	status_t			Decompress(void* context, const void* data,
+									size_t size, void* page);
+};
+
+
+#endif	// _KERNEL_VM_ZLIB_SWAP_COMPRESSOR_H
@@ -585,6 +585,72 @@ map_page(VMArea* area, vm_page* page, addr_t address, uint32 protection,
 }
 
 
+/*!	Tries to allocate a large page aligned run of pages from \a reservation,
+	inserts them into \a cache at \a offset, and maps them with a single large
+	page at \a address.
+	The cache must be locked.
+	\return \c true, if the range has been populated, \c false, if no page
+		run could be found.
+*/
+static bool
+map_large_page(VMArea* area, VMCache* cache, addr_t address, off_t offset,
+	uint32 protection, uint32 pageAllocFlags, vm_page_reservation* reservation)
+{
+	VMTranslationMap* map = area->address_space->TranslationMap();
+	size_t largePageSize = map->LargePageSize();
+
+	physical_address_restrictions restrictions = {};
+	restrictions.alignment = largePageSize;
+	vm_page* run = vm_page_allocate_reserved_page_run(reservation,
+		PAGE_STATE_WIRED | pageAllocFlags, largePageSize / B_PAGE_SIZE,
+		&restrictions);
+	if (run == NULL)
+		return false;
+
+	for (size_t i = 0; i < largePageSize / B_PAGE_SIZE; i++) {
+		vm_page* page = vm_lookup_page(run->physical_page_number + i);
+		cache->InsertPage(page, offset + i * B_PAGE_SIZE);
+		map_page(area, page, address + i * B_PAGE_SIZE, protection,
+			reservation);
+
+		DEBUG_PAGE_ACCESS_END(page);
+	}
+
+	map->Lock();
+	map->CollapseLargePage(address);
+	map->Unlock();
+
+	return true;
+}
+
+
+/*!	Maps all large page sized and aligned chunks of the given range of a wired
+	area with a single large page each, as far as the translation map supports
+	that. Only areas that asked for large pages with B_LARGE_PAGES_AREA are
+	considered. Chunks that aren't physically contiguous and aligned or don't
+	have a uniform protection are left alone.
+	The area's translation map must be locked.
+*/
+static void
+collapse_large_pages(VMArea* area, addr_t base, size_t size)
+{
+	if ((area->wiring != B_FULL_LOCK && area->wiring != B_CONTIGUOUS)
+		|| (area->protection & B_LARGE_PAGES_AREA) == 0) {
+		return;
+	}
+
+	VMTranslationMap* map = area->address_space->TranslationMap();
+	size_t largePageSize = map->LargePageSize();
+	if (largePageSize == 0)
+		return;
+
+	for (size_t offset = ROUNDUP(base, largePageSize) - base;
+			offset + largePageSize <= size; offset += largePageSize) {
+		map->CollapseLargePage(base + offset);
+	}
+}
+
+
 /*!	If \a preserveModified is \c true, the caller must hold the lock of the
 	page's cache.
 */
@@ -1299,6 +1365,7 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 	// For full lock or contiguous areas we're also going to map the pages and
 	// thus need to reserve pages for the mapping backend upfront.
 	addr_t reservedMapPages = 0;
+	size_t largePageSize = 0;
 	if (wiring == B_FULL_LOCK || wiring == B_CONTIGUOUS) {
 		AddressSpaceWriteLocker locker;
 		status_t status = locker.SetTo(team);
@@ -1307,6 +1374,24 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 
 		VMTranslationMap* map = locker.AddressSpace()->TranslationMap();
 		reservedMapPages = map->MaxPagesNeededToMap(0, size - 1);
+
+		// Large pages are only used on request, since fully locked areas
+		// have to be backed by page runs then, which are a scarcer resource.
+		if (size >= map->LargePageSize() && !isStack
+			&& (protection & B_LARGE_PAGES_AREA) != 0) {
+			largePageSize = map->LargePageSize();
+		}
+	}
+
+	// Large pages need a suitably aligned virtual address.
+	virtual_address_restrictions largePageAddressRestrictions;
+	if (largePageSize != 0
+		&& virtualAddressRestrictions->address_specification
+			!= B_EXACT_ADDRESS
+		&& virtualAddressRestrictions->alignment < largePageSize) {
+		largePageAddressRestrictions = *virtualAddressRestrictions;
+		largePageAddressRestrictions.alignment = largePageSize;
+		virtualAddressRestrictions = &largePageAddressRestrictions;
 	}
 
 	int priority;
@@ -1361,8 +1446,27 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 	if (wiring == B_CONTIGUOUS) {
 		// we try to allocate the page run here upfront as this may easily
 		// fail for obvious reasons
-		page = vm_page_allocate_page_run(PAGE_STATE_WIRED | pageAllocFlags,
-			size / B_PAGE_SIZE, physicalAddressRestrictions, priority);
+		if (largePageSize != 0 && physicalAddressRestrictions->boundary == 0
+			&& physicalAddressRestrictions->alignment < largePageSize) {
+			// Prefer a run that can be mapped with large pages, but don't
+			// insist on it.
+			physical_address_restrictions largePageRestrictions
+				= *physicalAddressRestrictions;
+			largePageRestrictions.alignment = largePageSize;
+
+			vm_page_reservation runReservation;
+			vm_page_reserve_pages(&runReservation, size / B_PAGE_SIZE,
+				priority);
+			page = vm_page_allocate_reserved_page_run(&runReservation,
+				PAGE_STATE_WIRED | pageAllocFlags, size / B_PAGE_SIZE,
+				&largePageRestrictions);
+			vm_page_unreserve_pages(&runReservation);
+		}
+
+		if (page == NULL) {
+			page = vm_page_allocate_page_run(PAGE_STATE_WIRED | pageAllocFlags,
+				size / B_PAGE_SIZE, physicalAddressRestrictions, priority);
+		}
 		if (page == NULL) {
 			status = B_NO_MEMORY;
 			goto err0;
@@ -1435,6 +1539,16 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 #	endif
 					continue;
 #endif
+				if (largePageSize != 0 && address % largePageSize == 0
+					&& area->Base() + (area->Size() - 1) - address
+						>= largePageSize - 1
+					&& map_large_page(area, cache, address, offset,
+						protection, pageAllocFlags, &reservation)) {
+					address += largePageSize - B_PAGE_SIZE;
+					offset += largePageSize - B_PAGE_SIZE;
+					continue;
+				}
+
 				vm_page* page = vm_page_allocate_page(&reservation,
 					PAGE_STATE_WIRED | pageAllocFlags);
 				cache->InsertPage(page, offset);
@@ -1519,6 +1633,8 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 				DEBUG_PAGE_ACCESS_END(page);
 			}
 
+			collapse_large_pages(area, area->Base(), area->Size());
+
 			map->Unlock();
 			break;
 		}
@@ -2353,7 +2469,7 @@ vm_copy_on_write_area(VMCache* lowerCache,
 					page->physical_page_number * B_PAGE_SIZE);
 
 				// move the wired page to the upper cache (note: removing is OK
-				// with the SplayTree iterator) and insert the copy
+				// with the VMCachePagesTree iterator) and insert the copy
 				upperCache->MovePage(page);
 				lowerCache->InsertPage(copiedPage,
 					page->cache_offset * B_PAGE_SIZE);
@@ -2678,10 +2794,16 @@ vm_set_area_protection(team_id team, area_id areaID, uint32 newProtection,
 			} else
 				map->ProtectArea(area, newProtection);
 
+			// If the protection of a part of a large page was changed, the
+			// page has been split. Now that the area is uniformly protected
+			// again, it can be collapsed.
+			collapse_large_pages(area, area->Base(), area->Size());
+
 			map->Unlock();
 		}
 
-		area->protection = newProtection;
+		area->protection = newProtection
+			| (area->protection & B_LARGE_PAGES_AREA);
 	}
 
 	return status;
@@ -5487,6 +5609,127 @@ vm_unwire_page(VMPageWiringInfo* info)
 }
 
 
+/*!	Replaces the pages backing the given page aligned range in the specified
+	team's address space by \a pages, which must be wired pages that don't
+	belong to any cache. The pages previously mapped there are freed.
+
+	This only works for ranges of a single, private and fully committed
+	anonymous area that is neither locked nor wired, and none of whose pages
+	in the range are busy, wired, or swapped out. In every other case
+	\c B_NOT_SUPPORTED is returned, and the caller has to copy the data
+	instead.
+
+	On success the pages have been taken over, and \a pages must no longer be
+	used by the caller.
+
+	\param team Identifies the address space (via team ID). \c B_CURRENT_TEAM
+		is supported.
+	\param address The page aligned start of the range.
+	\param pages The pages to move into the range.
+	\param count The number of pages.
+	\return \c B_OK on success, another error code otherwise.
+*/
+status_t
+vm_move_pages_into_area(team_id team, addr_t address, vm_page** pages,
+	size_t count)
+{
+	size_t size = count * B_PAGE_SIZE;
+	if (count == 0 || address % B_PAGE_SIZE != 0
+		|| !IS_USER_ADDRESS(address) || !IS_USER_ADDRESS(address + size - 1)
+		|| address + size < address) {
+		return B_BAD_ADDRESS;
+	}
+
+	VMAddressSpace* addressSpace;
+	if (team == B_CURRENT_TEAM)
+		addressSpace = VMAddressSpace::GetCurrent();
+	else
+		addressSpace = VMAddressSpace::Get(team);
+	if (addressSpace == NULL)
+		return B_BAD_TEAM_ID;
+
+	// reserve the pages the translation map might need to map the range
+	vm_page_reservation reservation;
+	vm_page_reserve_pages(&reservation,
+		addressSpace->TranslationMap()->MaxPagesNeededToMap(address,
+			address + size - 1),
+		team == VMAddressSpace::KernelID()
+			? VM_PRIORITY_SYSTEM : VM_PRIORITY_USER);
+
+	AddressSpaceReadLocker addressSpaceLocker(addressSpace, true);
+
+	VMArea* area = addressSpace->LookupArea(address);
+	if (area == NULL || address + size - 1 > area->Base() + area->Size() - 1) {
+		vm_page_unreserve_pages(&reservation);
+		return B_BAD_ADDRESS;
+	}
+
+	if (area->wiring != B_NO_LOCK || area->page_protections != NULL
+		|| (area->protection & B_WRITE_AREA) == 0
+		|| area->IsWired(address, size)) {
+		vm_page_unreserve_pages(&reservation);
+		return B_NOT_SUPPORTED;
+	}
+
+	VMCache* cache = vm_area_get_locked_cache(area);
+	VMCacheChainLocker cacheChainLocker(cache);
+	cacheChainLocker.LockAllSourceCaches();
+
+	// The pages must only become visible through this area, and the cache
+	// must not have to commit memory for them.
+	off_t cacheOffset = area->cache_offset + (address - area->Base());
+	bool supported = cache->type == CACHE_TYPE_RAM
+		&& cache->consumers.IsEmpty() && cache->areas == area
+		&& area->cache_next == NULL
+		&& cache->committed_size >= cache->virtual_end - cache->virtual_base;
+
+	for (size_t i = 0; supported && i < count; i++) {
+		off_t offset = cacheOffset + i * B_PAGE_SIZE;
+		vm_page* page = cache->LookupPage(offset);
+		if (page != NULL) {
+			if (page->busy || page->WiredCount() > 0)
+				supported = false;
+		} else if (cache->HasPage(offset))
+			supported = false;
+	}
+
+	if (!supported) {
+		cacheChainLocker.Unlock();
+		vm_page_unreserve_pages(&reservation);
+		return B_NOT_SUPPORTED;
+	}
+
+	unmap_pages(area, address, size);
+
+	for (size_t i = 0; i < count; i++) {
+		off_t offset = cacheOffset + i * B_PAGE_SIZE;
+
+		vm_page* oldPage = cache->LookupPage(offset);
+		if (oldPage != NULL) {
+			DEBUG_PAGE_ACCESS_START(oldPage);
+			cache->RemovePage(oldPage);
+			vm_page_free(cache, oldPage);
+		}
+
+		vm_page* page = pages[i];
+		DEBUG_PAGE_ACCESS_START(page);
+		cache->InsertPage(page, offset);
+		page->modified = true;
+		vm_page_set_state(page, PAGE_STATE_ACTIVE);
+
+		map_page(area, page, address + i * B_PAGE_SIZE, area->protection,
+			&reservation);
+			// if mapping fails, the page will be faulted in later
+		DEBUG_PAGE_ACCESS_END(page);
+	}
+
+	cacheChainLocker.Unlock();
+	vm_page_unreserve_pages(&reservation);
+
+	return B_OK;
+}
+
+
 /*!	Wires down the given address range in the specified team's address space.
 
 	If successful the function
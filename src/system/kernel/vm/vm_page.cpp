@@ -27,6 +27,7 @@
 #include <heap.h>
 #include <kernel.h>
 #include <low_resource_manager.h>
+#include <smp.h>
 #include <thread.h>
 #include <tracing.h>
 #include <util/AutoLock.h>
@@ -101,6 +102,7 @@ static const int32 kPageUsageAdvance = 3;
 static const int32 kPageUsageDecline = 1;
 
 int32 gMappedPagesCount;
+int32 gMappedLargePagesCount;
 
 static VMPageQueue sPageQueues[PAGE_STATE_COUNT];
 
@@ -133,6 +135,42 @@ static mutex sPageDeficitLock = MUTEX_INITIALIZER("page deficit");
 static rw_lock sFreePageQueuesLock
 	= RW_LOCK_INITIALIZER("free/clear page queues");
 
+// Per-CPU caches ("magazines") of free and clear pages. Most page allocations
+// and frees only touch the current CPU's magazine, which is refilled from and
+// drained to the global free/clear queues in batches.
+// The pages in a magazine are in state PAGE_STATE_UNUSED, so that code looking
+// for free pages in the page array (allocate_page_run(),
+// mark_page_range_in_use()) leaves them alone. They are still counted in
+// sUnreservedFreePages, though, so a reserved page may have to be taken from
+// another CPU's magazine. Pages are only moved between a magazine and the
+// global queues with sFreePageQueuesLock read locked, so whoever holds the
+// write lock finds every free page either in a magazine or in a queue.
+static const uint32 kPageMagazineSize = 64;
+static const uint32 kPageMagazineBatch = kPageMagazineSize / 2;
+
+enum {
+	PAGE_MAGAZINE_FREE	= 0,
+	PAGE_MAGAZINE_CLEAR	= 1
+};
+
+struct page_magazine {
+	spinlock				lock;
+	VMPageQueue::PageList	pages[2];
+	uint32					count[2];
+
+	// statistics
+	uint64					hits;
+	uint64					misses;
+	uint64					refills;
+	uint64					drains;
+	uint64					steals;
+} CACHE_LINE_ALIGN;
+
+static page_magazine sPageMagazines[SMP_MAX_CPUS];
+static bool sPageMagazinesEnabled = false;
+
+static page_num_t page_magazines_page_count();
+
 #ifdef TRACK_PAGE_USAGE_STATS
 static page_num_t sPageUsageArrays[512];
 static page_num_t* sPageUsage = sPageUsageArrays;
@@ -905,7 +943,6 @@ dump_page(int argc, char **argv)
 		page->physical_page_number);
 	kprintf("cache:           %p\n", page->Cache());
 	kprintf("cache_offset:    %" B_PRIuPHYSADDR "\n", page->cache_offset);
-	kprintf("cache_next:      %p\n", page->cache_next);
 	kprintf("state:           %s\n", page_state_to_string(page->State()));
 	kprintf("wired_count:     %d\n", page->WiredCount());
 	kprintf("usage_count:     %d\n", page->usage_count);
@@ -1092,11 +1129,14 @@ dump_page_stats(int argc, char **argv)
 		counter[PAGE_STATE_MODIFIED], busyCounter[PAGE_STATE_MODIFIED]);
 	kprintf("free: %" B_PRIuSIZE "\n", counter[PAGE_STATE_FREE]);
 	kprintf("clear: %" B_PRIuSIZE "\n", counter[PAGE_STATE_CLEAR]);
+	kprintf("in CPU magazines: %" B_PRIuPHYSADDR " (counted as unused)\n",
+		page_magazines_page_count());
 
 	kprintf("unreserved free pages: %" B_PRId32 "\n", sUnreservedFreePages);
 	kprintf("unsatisfied page reservations: %" B_PRId32 "\n",
 		sUnsatisfiedPageReservations);
 	kprintf("mapped pages: %" B_PRId32 "\n", gMappedPagesCount);
+	kprintf("mapped large pages: %" B_PRId32 "\n", gMappedLargePagesCount);
 	kprintf("longest free pages run: %" B_PRIuPHYSADDR " pages (at %"
 		B_PRIuPHYSADDR ")\n", longestFreeRun.Length(),
 		sPages[longestFreeRun.start].physical_page_number);
@@ -1131,6 +1171,45 @@ dump_page_stats(int argc, char **argv)
 }
 
 
+static int
+dump_page_magazines(int argc, char **argv)
+{
+	if (!sPageMagazinesEnabled) {
+		kprintf("page magazines are not enabled yet\n");
+		return 0;
+	}
+
+	kprintf("cpu   free  clear          hits        misses       refills"
+		"        drains        steals\n");
+
+	uint64 hits = 0;
+	uint64 misses = 0;
+	uint64 refills = 0;
+	int32 cpuCount = smp_get_num_cpus();
+	for (int32 i = 0; i < cpuCount; i++) {
+		page_magazine& magazine = sPageMagazines[i];
+		kprintf("%3" B_PRId32 "  %5" B_PRIu32 "  %5" B_PRIu32 "  %12" B_PRIu64
+			"  %12" B_PRIu64 "  %12" B_PRIu64 "  %12" B_PRIu64 "  %12" B_PRIu64
+			"\n", i, magazine.count[PAGE_MAGAZINE_FREE],
+			magazine.count[PAGE_MAGAZINE_CLEAR], magazine.hits,
+			magazine.misses, magazine.refills, magazine.drains,
+			magazine.steals);
+
+		hits += magazine.hits;
+		misses += magazine.misses;
+		refills += magazine.refills;
+	}
+
+	uint64 allocations = hits + misses;
+	if (allocations > 0) {
+		kprintf("hit rate: %" B_PRIu64 "%%, refill rate: %" B_PRIu64 "%%\n",
+			hits * 100 / allocations, refills * 100 / allocations);
+	}
+
+	return 0;
+}
+
+
 #if VM_PAGE_ALLOCATION_TRACKING_AVAILABLE
 
 static caller_info*
@@ -1461,6 +1540,230 @@ unreserve_pages(uint32 count)
 }
 
 
+static inline VMPageQueue&
+page_magazine_queue(int32 type)
+{
+	return type == PAGE_MAGAZINE_CLEAR ? sClearPageQueue : sFreePageQueue;
+}
+
+
+/*!	Removes a page from the given magazine, preferring a clear one, if
+	\a clear is \c true, and a non-clear one otherwise.
+	The magazine must be locked.
+*/
+static inline vm_page*
+page_magazine_remove(page_magazine& magazine, bool clear, bool& _isClear)
+{
+	int32 first = clear ? PAGE_MAGAZINE_CLEAR : PAGE_MAGAZINE_FREE;
+	for (int32 i = 0; i < 2; i++) {
+		int32 type = first ^ i;
+		vm_page* page = magazine.pages[type].RemoveHead();
+		if (page != NULL) {
+			magazine.count[type]--;
+			_isClear = type == PAGE_MAGAZINE_CLEAR;
+			return page;
+		}
+	}
+
+	return NULL;
+}
+
+
+/*!	Allocates a page from the current CPU's magazine. If the magazine is empty,
+	it is refilled from the global queues first.
+	The caller must have reserved the page.
+	\return The page, in state \c PAGE_STATE_UNUSED, or \c NULL, if the
+		global queues are empty as well.
+*/
+static vm_page*
+page_magazine_allocate(bool clear, bool& _isClear)
+{
+	{
+		InterruptsLocker interruptsLocker;
+		page_magazine& magazine = sPageMagazines[smp_get_current_cpu()];
+		SpinLocker locker(magazine.lock);
+
+		vm_page* page = page_magazine_remove(magazine, clear, _isClear);
+		if (page != NULL) {
+			magazine.hits++;
+			return page;
+		}
+
+		magazine.misses++;
+	}
+
+	// refill the magazine -- preferably with pages of the requested kind
+	ReadLocker queuesLocker(sFreePageQueuesLock);
+
+	VMPageQueue::PageList pages[2];
+	uint32 count[2];
+	int32 first = clear ? PAGE_MAGAZINE_CLEAR : PAGE_MAGAZINE_FREE;
+	int32 second = first ^ 1;
+	count[first] = page_magazine_queue(first).RemoveHeadUnlocked(pages[first],
+		kPageMagazineBatch);
+	count[second] = 0;
+	if (count[first] < kPageMagazineBatch) {
+		count[second] = page_magazine_queue(second).RemoveHeadUnlocked(
+			pages[second], kPageMagazineBatch - count[first]);
+	}
+	if (count[first] + count[second] == 0)
+		return NULL;
+
+	for (int32 type = 0; type < 2; type++) {
+		for (VMPageQueue::PageList::Iterator it = pages[type].GetIterator();
+				vm_page* page = it.Next();) {
+			page->SetState(PAGE_STATE_UNUSED);
+		}
+	}
+
+	// We may have been migrated to another CPU in the meantime, which doesn't
+	// really matter.
+	InterruptsLocker interruptsLocker;
+	page_magazine& magazine = sPageMagazines[smp_get_current_cpu()];
+	SpinLocker locker(magazine.lock);
+
+	for (int32 type = 0; type < 2; type++) {
+		magazine.pages[type].MoveFrom(&pages[type]);
+		magazine.count[type] += count[type];
+	}
+	magazine.refills++;
+
+	return page_magazine_remove(magazine, clear, _isClear);
+}
+
+
+/*!	Moves the least recently freed pages of a magazine back to the global
+	queues, until only \a keep pages remain in it. Non-clear pages are drained
+	first.
+	\param cpu The CPU whose magazine shall be drained, or \c -1 for the
+		current CPU.
+*/
+static void
+page_magazine_drain(int32 cpu, uint32 keep)
+{
+	ReadLocker queuesLocker(sFreePageQueuesLock);
+
+	VMPageQueue::PageList pages[2];
+	uint32 count[2] = { 0, 0 };
+
+	{
+		InterruptsLocker interruptsLocker;
+		page_magazine& magazine
+			= sPageMagazines[cpu >= 0 ? cpu : smp_get_current_cpu()];
+		SpinLocker locker(magazine.lock);
+
+		while (magazine.count[PAGE_MAGAZINE_FREE]
+				+ magazine.count[PAGE_MAGAZINE_CLEAR] > keep) {
+			int32 type = magazine.count[PAGE_MAGAZINE_FREE] > 0
+				? PAGE_MAGAZINE_FREE : PAGE_MAGAZINE_CLEAR;
+			vm_page* page = magazine.pages[type].RemoveTail();
+			magazine.count[type]--;
+
+			page->SetState(type == PAGE_MAGAZINE_CLEAR
+				? PAGE_STATE_CLEAR : PAGE_STATE_FREE);
+			pages[type].Add(page, false);
+			count[type]++;
+		}
+
+		if (count[PAGE_MAGAZINE_FREE] + count[PAGE_MAGAZINE_CLEAR] == 0)
+			return;
+
+		magazine.drains++;
+	}
+
+	for (int32 type = 0; type < 2; type++) {
+		if (count[type] > 0)
+			page_magazine_queue(type).AppendUnlocked(pages[type], count[type]);
+	}
+}
+
+
+/*!	Puts a free page into the current CPU's magazine, and drains the magazine,
+	if it has become too full.
+*/
+static void
+page_magazine_free(vm_page* page, bool clear)
+{
+	int32 type = clear ? PAGE_MAGAZINE_CLEAR : PAGE_MAGAZINE_FREE;
+
+	{
+		InterruptsLocker interruptsLocker;
+		page_magazine& magazine = sPageMagazines[smp_get_current_cpu()];
+		SpinLocker locker(magazine.lock);
+
+		page->SetState(PAGE_STATE_UNUSED);
+		magazine.pages[type].Add(page, false);
+		magazine.count[type]++;
+
+		if (magazine.count[PAGE_MAGAZINE_FREE]
+				+ magazine.count[PAGE_MAGAZINE_CLEAR] <= kPageMagazineSize) {
+			return;
+		}
+	}
+
+	page_magazine_drain(-1, kPageMagazineBatch);
+}
+
+
+/*!	Takes a page from any CPU's magazine.
+	The caller must hold \c sFreePageQueuesLock write locked.
+*/
+static vm_page*
+page_magazine_steal(bool clear, bool& _isClear)
+{
+	if (!sPageMagazinesEnabled)
+		return NULL;
+
+	int32 cpuCount = smp_get_num_cpus();
+	for (int32 i = 0; i < cpuCount; i++) {
+		page_magazine& magazine = sPageMagazines[i];
+		InterruptsSpinLocker locker(magazine.lock);
+
+		vm_page* page = page_magazine_remove(magazine, clear, _isClear);
+		if (page != NULL) {
+			magazine.steals++;
+			return page;
+		}
+	}
+
+	return NULL;
+}
+
+
+/*!	Returns the pages of all magazines to the global queues.
+*/
+static void
+page_magazines_drain_all()
+{
+	if (!sPageMagazinesEnabled)
+		return;
+
+	int32 cpuCount = smp_get_num_cpus();
+	for (int32 i = 0; i < cpuCount; i++)
+		page_magazine_drain(i, 0);
+}
+
+
+/*!	Returns the number of pages currently sitting in the CPUs' magazines.
+	The value is not a snapshot, since the magazines aren't locked.
+*/
+static page_num_t
+page_magazines_page_count()
+{
+	if (!sPageMagazinesEnabled)
+		return 0;
+
+	page_num_t count = 0;
+	int32 cpuCount = smp_get_num_cpus();
+	for (int32 i = 0; i < cpuCount; i++) {
+		count += sPageMagazines[i].count[PAGE_MAGAZINE_FREE]
+			+ sPageMagazines[i].count[PAGE_MAGAZINE_CLEAR];
+	}
+
+	return count;
+}
+
+
 static void
 free_page(vm_page* page, bool clear)
 {
@@ -1511,6 +1814,12 @@ free_page(vm_page* page, bool clear)
 	page->allocation_tracking_info.Clear();
 #endif
 
+	if (sPageMagazinesEnabled) {
+		DEBUG_PAGE_ACCESS_END(page);
+		page_magazine_free(page, clear);
+		return;
+	}
+
 	ReadLocker locker(sFreePageQueuesLock);
 
 	DEBUG_PAGE_ACCESS_END(page);
@@ -3356,6 +3665,8 @@ vm_page_init_post_area(kernel_args *args)
 		"search all known address spaces for mappings to that page and print\n"
 		"them.\n", 0);
 	add_debugger_command("page_queue", &dump_page_queue, "Dump page queue");
+	add_debugger_command("page_magazines", &dump_page_magazines,
+		"Dump the per-CPU free page caches");
 	add_debugger_command("find_page", &find_page,
 		"Find out which queue a page is actually in");
 
@@ -3403,6 +3714,11 @@ vm_page_init_post_thread(kernel_args *args)
 	new (&sFreePageCondition) ConditionVariable;
 	sFreePageCondition.Publish(&sFreePageQueue, "free page");
 
+	// from now on we know the current CPU, so the page magazines can be used
+	for (int32 i = 0; i < smp_get_num_cpus(); i++)
+		B_INITIALIZE_SPINLOCK(&sPageMagazines[i].lock);
+	sPageMagazinesEnabled = true;
+
 	// create a kernel thread to clear out pages
 
 	thread_id thread = spawn_kernel_thread(&page_scrubber, "page scrubber",
@@ -3503,20 +3819,17 @@ vm_page_try_reserve_pages(vm_page_reservation* reservation, uint32 count,
 }
 
 
-vm_page *
-vm_page_allocate_page(vm_page_reservation* reservation, uint32 flags)
+/*!	Takes a page from the global free/clear queues, or, if they are empty, from
+	any CPU's magazine. The caller must have reserved the page.
+	\return The page, in state \c PAGE_STATE_UNUSED.
+*/
+static vm_page*
+allocate_page_from_queues(bool clear, bool& _isClear)
 {
-	uint32 pageState = flags & VM_PAGE_ALLOC_STATE;
-	ASSERT(pageState != PAGE_STATE_FREE);
-	ASSERT(pageState != PAGE_STATE_CLEAR);
-
-	ASSERT(reservation->count > 0);
-	reservation->count--;
-
 	VMPageQueue* queue;
 	VMPageQueue* otherQueue;
 
-	if ((flags & VM_PAGE_ALLOC_CLEAR) != 0) {
+	if (clear) {
 		queue = &sClearPageQueue;
 		otherQueue = &sFreePageQueue;
 	} else {
@@ -3534,45 +3847,72 @@ vm_page_allocate_page(vm_page_reservation* reservation, uint32 flags)
 
 		if (page == NULL) {
 			// Unlikely, but possible: the page we have reserved has moved
-			// between the queues after we checked the first queue. Grab the
-			// write locker to make sure this doesn't happen again.
+			// between the queues after we checked the first queue, or it is
+			// in another CPU's magazine. Grab the write locker to make sure
+			// this doesn't happen again.
 			locker.Unlock();
 			WriteLocker writeLocker(sFreePageQueuesLock);
 
 			page = queue->RemoveHead();
 			if (page == NULL)
-				otherQueue->RemoveHead();
+				page = otherQueue->RemoveHead();
 
-			if (page == NULL) {
-				panic("Had reserved page, but there is none!");
-				return NULL;
-			}
+			if (page == NULL)
+				return page_magazine_steal(clear, _isClear);
 
-			// downgrade to read lock
-			locker.Lock();
+			_isClear = page->State() == PAGE_STATE_CLEAR;
+			page->SetState(PAGE_STATE_UNUSED);
+			return page;
 		}
 	}
 
+	_isClear = page->State() == PAGE_STATE_CLEAR;
+	page->SetState(PAGE_STATE_UNUSED);
+	return page;
+}
+
+
+vm_page *
+vm_page_allocate_page(vm_page_reservation* reservation, uint32 flags)
+{
+	uint32 pageState = flags & VM_PAGE_ALLOC_STATE;
+	ASSERT(pageState != PAGE_STATE_FREE);
+	ASSERT(pageState != PAGE_STATE_CLEAR);
+
+	ASSERT(reservation->count > 0);
+	reservation->count--;
+
+	bool clear = (flags & VM_PAGE_ALLOC_CLEAR) != 0;
+	bool isClear = false;
+
+	vm_page* page = NULL;
+	if (sPageMagazinesEnabled)
+		page = page_magazine_allocate(clear, isClear);
+	if (page == NULL)
+		page = allocate_page_from_queues(clear, isClear);
+
+	if (page == NULL) {
+		panic("Had reserved page, but there is none!");
+		return NULL;
+	}
+
 	if (page->CacheRef() != NULL)
 		panic("supposed to be free page %p has cache\n", page);
 
 	DEBUG_PAGE_ACCESS_START(page);
 
-	int oldPageState = page->State();
 	page->SetState(pageState);
 	page->busy = (flags & VM_PAGE_ALLOC_BUSY) != 0;
 	page->usage_count = 0;
 	page->accessed = false;
 	page->modified = false;
 
-	locker.Unlock();
-
 	if (pageState < PAGE_STATE_FIRST_UNQUEUED)
 		sPageQueues[pageState].AppendUnlocked(page);
 
-	// clear the page, if we had to take it from the free queue and a clear
-	// page was requested
-	if ((flags & VM_PAGE_ALLOC_CLEAR) != 0 && oldPageState != PAGE_STATE_CLEAR)
+	// clear the page, if we had to take a non-clear one and a clear page was
+	// requested
+	if (clear && !isClear)
 		clear_page(page);
 
 #if VM_PAGE_ALLOCATION_TRACKING_AVAILABLE
@@ -3797,6 +4137,41 @@ vm_page*
 vm_page_allocate_page_run(uint32 flags, page_num_t length,
 	const physical_address_restrictions* restrictions, int priority)
 {
+	vm_page_reservation reservation;
+	vm_page_reserve_pages(&reservation, length, priority);
+
+	vm_page* page = vm_page_allocate_reserved_page_run(&reservation, flags,
+		length, restrictions);
+	if (page == NULL) {
+		dprintf("vm_page_allocate_page_run(): Failed to allocate run of "
+			"length %" B_PRIuPHYSADDR " (low: %#" B_PRIxPHYSADDR " high: %#"
+			B_PRIxPHYSADDR " align: %" B_PRIuPHYSADDR " boundary: %"
+			B_PRIuPHYSADDR ")!\n", length, restrictions->low_address,
+			restrictions->high_address, restrictions->alignment,
+			restrictions->boundary);
+
+		vm_page_unreserve_pages(&reservation);
+	}
+
+	return page;
+}
+
+
+/*!	Like vm_page_allocate_page_run(), but takes the pages from the given
+	reservation, which must cover at least \a length pages, instead of
+	reserving them. Doesn't wait for memory, and fails silently, so that it can
+	also be used to opportunistically try to get a run with stricter
+	restrictions than actually needed.
+	On success \a length pages are removed from the reservation, otherwise
+	it's left untouched.
+*/
+vm_page*
+vm_page_allocate_reserved_page_run(vm_page_reservation* reservation,
+	uint32 flags, page_num_t length,
+	const physical_address_restrictions* restrictions)
+{
+	ASSERT(reservation->count >= length);
+
 	// compute start and end page index
 	page_num_t requestedStart
 		= std::max(restrictions->low_address / B_PAGE_SIZE, sPhysicalPageOffset)
@@ -3830,8 +4205,8 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 		boundaryMask = -boundary;
 	}
 
-	vm_page_reservation reservation;
-	vm_page_reserve_pages(&reservation, length, priority);
+	// give the pages in the CPUs' magazines a chance to be part of the run
+	page_magazines_drain_all();
 
 	WriteLocker freeClearQueueLocker(sFreePageQueuesLock);
 
@@ -3868,14 +4243,6 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 				continue;
 			}
 
-			dprintf("vm_page_allocate_page_run(): Failed to allocate run of "
-				"length %" B_PRIuPHYSADDR " (%" B_PRIuPHYSADDR " %"
-				B_PRIuPHYSADDR ") in second iteration (align: %" B_PRIuPHYSADDR
-				" boundary: %" B_PRIuPHYSADDR ")!\n", length, requestedStart,
-				end, restrictions->alignment, restrictions->boundary);
-
-			freeClearQueueLocker.Unlock();
-			vm_page_unreserve_pages(&reservation);
 			return NULL;
 		}
 
@@ -3893,8 +4260,10 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 
 		if (foundRun) {
 			i = allocate_page_run(start, length, flags, freeClearQueueLocker);
-			if (i == length)
+			if (i == length) {
+				reservation->count -= length;
 				return &sPages[start];
+			}
 
 			// apparently a cached page couldn't be allocated -- skip it and
 			// continue
@@ -3959,6 +4328,8 @@ vm_page_free_etc(VMCache* cache, vm_page* page,
 	free_page(page, false);
 	if (reservation == NULL)
 		unreserve_pages(1);
+	else
+		reservation->count++;
 }
 
 
@@ -4093,9 +4464,10 @@ vm_page_get_stats(system_info *info)
 	// max_pages is composed of:
 	//	active + inactive + unused + wired + modified + cached + free + clear
 	// So taking out the cached (including modified non-temporary), free and
-	// clear ones leaves us with all used pages.
+	// clear ones (including those in the CPUs' magazines) leaves us with all
+	// used pages.
 	uint32 subtractPages = info->cached_pages + sFreePageQueue.Count()
-		+ sClearPageQueue.Count();
+		+ sClearPageQueue.Count() + page_magazines_page_count();
 	info->used_pages = subtractPages > info->max_pages
 		? 0 : info->max_pages - subtractPages;
 
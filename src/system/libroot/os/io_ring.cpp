@@ -0,0 +1,136 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <io_ring_private.h>
+
+#include <unistd.h>
+
+#include <OS.h>
+
+#include <syscalls.h>
+
+
+status_t
+io_ring_init(io_ring* ring, uint32 entries, uint32 workerCount)
+{
+	if (entries == 0 || (entries & (entries - 1)) != 0)
+		return B_BAD_VALUE;
+
+	// Give the completions twice the room, so that a full submission ring
+	// doesn't already block further submissions.
+	io_ring_parameters parameters;
+	parameters.submission_entries = entries;
+	parameters.completion_entries = entries * 2;
+	parameters.worker_count = workerCount;
+	parameters.flags = 0;
+
+	ring->fd = _kern_io_ring_create(&parameters);
+	if (ring->fd < 0)
+		return ring->fd;
+
+	ring->area = parameters.area;
+	void* address = parameters.address;
+
+	// the kernel has filled in the header
+	ring->header = (io_ring_header*)address;
+	ring->submissions = (io_ring_submission*)((uint8*)address
+		+ ring->header->submission_offset);
+	ring->completions = (io_ring_completion*)((uint8*)address
+		+ ring->header->completion_offset);
+	ring->submission_mask = ring->header->submission_entries - 1;
+	ring->completion_mask = ring->header->completion_entries - 1;
+	ring->submission_tail = 0;
+	ring->completion_head = 0;
+
+	return B_OK;
+}
+
+
+void
+io_ring_destroy(io_ring* ring)
+{
+	// the kernel deletes the area
+	close(ring->fd);
+}
+
+
+/*!	Returns the next free submission entry, or \c NULL, if the submission ring
+	is full. The entry is passed on to the kernel with the next
+	io_ring_submit().
+*/
+io_ring_submission*
+io_ring_get_submission(io_ring* ring)
+{
+	uint32 head = (uint32)atomic_get(&ring->header->submission_head);
+	if (ring->submission_tail - head > ring->submission_mask)
+		return NULL;
+
+	return &ring->submissions[ring->submission_tail++ & ring->submission_mask];
+}
+
+
+/*!	Passes the entries filled in since the last call on to the kernel, and
+	waits until there are at least \a minComplete completions, if it is > 0.
+	Returns the number of entries the kernel took; it leaves the others in
+	the ring, if there is no room for their completions yet.
+*/
+ssize_t
+io_ring_submit(io_ring* ring, uint32 minComplete, uint32 flags,
+	bigtime_t timeout)
+{
+	// publish the entries
+	atomic_set(&ring->header->submission_tail, (int32)ring->submission_tail);
+
+	uint32 toSubmit = ring->submission_tail
+		- (uint32)atomic_get(&ring->header->submission_head);
+
+	return _kern_io_ring_enter(ring->fd, toSubmit, minComplete, flags,
+		timeout);
+}
+
+
+/*!	Returns the oldest completion not consumed yet, or \c NULL, if there is
+	none. Doesn't enter the kernel.
+*/
+io_ring_completion*
+io_ring_peek_completion(io_ring* ring)
+{
+	if (ring->completion_head
+			== (uint32)atomic_get(&ring->header->completion_tail)) {
+		return NULL;
+	}
+
+	return &ring->completions[ring->completion_head & ring->completion_mask];
+}
+
+
+/*!	Marks the \a count oldest completions consumed, so that the kernel can
+	reuse their entries.
+*/
+void
+io_ring_advance_completions(io_ring* ring, uint32 count)
+{
+	ring->completion_head += count;
+	atomic_set(&ring->header->completion_head, (int32)ring->completion_head);
+}
+
+
+status_t
+io_ring_wait_completion(io_ring* ring, io_ring_completion** _completion,
+	uint32 flags, bigtime_t timeout)
+{
+	while (true) {
+		io_ring_completion* completion = io_ring_peek_completion(ring);
+		if (completion != NULL) {
+			*_completion = completion;
+			return B_OK;
+		}
+
+		ssize_t result = _kern_io_ring_enter(ring->fd, 0, 1, flags, timeout);
+		if (result < 0)
+			return result;
+	}
+}
@@ -0,0 +1,505 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <spawn.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+#include <libroot_private.h>
+#include <spawn_defs.h>
+#include <syscalls.h>
+#include <umask.h>
+
+
+struct _posix_spawnattr {
+	short				flags;
+	pid_t				process_group;
+	int					policy;
+	struct sched_param	param;
+	sigset_t			default_signals;
+	sigset_t			signal_mask;
+};
+
+struct _posix_spawn_file_actions {
+	int32				count;
+	int32				size;
+	spawn_file_action*	actions;
+};
+
+
+static const short kValidFlags = POSIX_SPAWN_RESETIDS | POSIX_SPAWN_SETPGROUP
+	| POSIX_SPAWN_SETSCHEDPARAM | POSIX_SPAWN_SETSCHEDULER
+	| POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSID;
+
+
+static spawn_file_action*
+add_file_action(posix_spawn_file_actions_t* fileActions, int32 type, int fd)
+{
+	_posix_spawn_file_actions* actions = *fileActions;
+	if (actions->count == actions->size) {
+		if (actions->size >= MAX_SPAWN_FILE_ACTIONS)
+			return NULL;
+
+		int32 size = actions->size == 0 ? 8 : actions->size * 2;
+		spawn_file_action* newActions = (spawn_file_action*)realloc(
+			actions->actions, size * sizeof(spawn_file_action));
+		if (newActions == NULL)
+			return NULL;
+
+		actions->actions = newActions;
+		actions->size = size;
+	}
+
+	spawn_file_action* action = &actions->actions[actions->count++];
+	memset(action, 0, sizeof(spawn_file_action));
+	action->type = type;
+	action->fd = fd;
+	return action;
+}
+
+
+static int32
+priority_for_attributes(const _posix_spawnattr* attr)
+{
+	if (attr == NULL)
+		return -1;
+
+	if ((attr->flags & POSIX_SPAWN_SETSCHEDPARAM) != 0)
+		return attr->param.sched_priority;
+
+	if ((attr->flags & POSIX_SPAWN_SETSCHEDULER) != 0) {
+		return attr->policy == SCHED_RR
+			? B_FIRST_REAL_TIME_PRIORITY : B_NORMAL_PRIORITY;
+	}
+
+	return -1;
+}
+
+
+static int
+do_posix_spawn(pid_t* _pid, const char* path,
+	const posix_spawn_file_actions_t* fileActions,
+	const posix_spawnattr_t* _attr, char* const args[],
+	char* const environment[], bool useDefaultInterpreter)
+{
+	if (path == NULL || args == NULL)
+		return B_BAD_VALUE;
+
+	int32 argCount = 0;
+	while (args[argCount] != NULL)
+		argCount++;
+
+	int32 envCount = 0;
+	if (environment != NULL) {
+		while (environment[envCount] != NULL)
+			envCount++;
+	}
+
+	if (argCount == 0)
+		return B_BAD_VALUE;
+
+	// Test validity of executable + support for scripts
+	char invoker[B_FILE_NAME_LENGTH];
+	status_t status = __test_executable(path, invoker);
+	if (status < B_OK) {
+		if (status != B_NOT_AN_EXECUTABLE || !useDefaultInterpreter)
+			return status;
+
+		strcpy(invoker, "/bin/sh");
+	}
+
+	char** newArgs = NULL;
+	if (invoker[0] != '\0') {
+		status = __parse_invoke_line(invoker, &newArgs, &args, &argCount, path);
+		if (status < B_OK)
+			return status;
+
+		path = newArgs[0];
+	}
+
+	char** flatArgs = NULL;
+	size_t flatArgsSize;
+	status = __flatten_process_args(newArgs ? newArgs : args, argCount,
+		environment, &envCount, path, &flatArgs, &flatArgsSize);
+	if (status != B_OK) {
+		free(newArgs);
+		return status;
+	}
+
+	const _posix_spawnattr* attr = _attr != NULL ? *_attr : NULL;
+
+	spawn_args spawnArgs;
+	memset(&spawnArgs, 0, sizeof(spawnArgs));
+	spawnArgs.priority = priority_for_attributes(attr);
+	spawnArgs.umask = __gUmask;
+	if (attr != NULL) {
+		spawnArgs.flags = attr->flags;
+		spawnArgs.process_group = attr->process_group;
+		spawnArgs.signal_mask = attr->signal_mask;
+		spawnArgs.default_signals = attr->default_signals;
+	}
+	if (fileActions != NULL && *fileActions != NULL) {
+		spawnArgs.file_action_count = (*fileActions)->count;
+		spawnArgs.file_actions = (*fileActions)->actions;
+	}
+
+	thread_id thread = _kern_spawn_image(flatArgs, flatArgsSize, argCount,
+		envCount, &spawnArgs);
+
+	free(flatArgs);
+	free(newArgs);
+
+	if (thread < 0)
+		return thread;
+
+	if (_pid != NULL)
+		*_pid = thread;
+
+	return 0;
+}
+
+
+//	#pragma mark -
+
+
+int
+posix_spawn(pid_t* pid, const char* path,
+	const posix_spawn_file_actions_t* fileActions,
+	const posix_spawnattr_t* attr, char* const argv[], char* const envp[])
+{
+	return do_posix_spawn(pid, path, fileActions, attr, argv, envp, false);
+}
+
+
+int
+posix_spawnp(pid_t* pid, const char* file,
+	const posix_spawn_file_actions_t* fileActions,
+	const posix_spawnattr_t* attr, char* const argv[], char* const envp[])
+{
+	// let do_posix_spawn() handle cases where file is a path (or invalid)
+	if (file == NULL || strchr(file, '/') != NULL) {
+		return do_posix_spawn(pid, file, fileActions, attr, argv, envp,
+			true);
+	}
+
+	// file is just a leaf name, so we have to look it up in the path
+	const char* paths = getenv("PATH");
+	if (paths == NULL)
+		return B_ENTRY_NOT_FOUND;
+
+	int fileNameLen = strlen(file);
+
+	const char* pathEnd = paths - 1;
+	while (pathEnd != NULL) {
+		paths = pathEnd + 1;
+		pathEnd = strchr(paths, ':');
+		int pathLen = (pathEnd ? pathEnd - paths : strlen(paths));
+
+		// We skip empty paths and those that would become too long.
+		if (pathLen == 0
+			|| pathLen + 1 + fileNameLen >= B_PATH_NAME_LENGTH) {
+			continue;
+		}
+
+		char path[B_PATH_NAME_LENGTH];
+		memcpy(path, paths, pathLen);
+		path[pathLen] = '\0';
+
+		if (path[pathLen - 1] != '/')
+			strcat(path, "/");
+		strcat(path, file);
+
+		struct stat st;
+		if (stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+			continue;
+
+		if (access(path, X_OK) == 0) {
+			return do_posix_spawn(pid, path, fileActions, attr, argv, envp,
+				true);
+		}
+	}
+
+	return B_ENTRY_NOT_FOUND;
+}
+
+
+//	#pragma mark - file actions
+
+
+int
+posix_spawn_file_actions_init(posix_spawn_file_actions_t* fileActions)
+{
+	_posix_spawn_file_actions* actions = (_posix_spawn_file_actions*)malloc(
+		sizeof(_posix_spawn_file_actions));
+	if (actions == NULL)
+		return ENOMEM;
+
+	actions->count = 0;
+	actions->size = 0;
+	actions->actions = NULL;
+
+	*fileActions = actions;
+	return 0;
+}
+
+
+int
+posix_spawn_file_actions_destroy(posix_spawn_file_actions_t* fileActions)
+{
+	if (fileActions == NULL || *fileActions == NULL)
+		return EINVAL;
+
+	_posix_spawn_file_actions* actions = *fileActions;
+	for (int32 i = 0; i < actions->count; i++)
+		free(actions->actions[i].path);
+
+	free(actions->actions);
+	free(actions);
+	*fileActions = NULL;
+	return 0;
+}
+
+
+int
+posix_spawn_file_actions_addopen(posix_spawn_file_actions_t* fileActions,
+	int fildes, const char* path, int oflag, mode_t mode)
+{
+	if (fileActions == NULL || *fileActions == NULL || path == NULL)
+		return EINVAL;
+	if (fildes < 0)
+		return EBADF;
+
+	char* pathCopy = strdup(path);
+	if (pathCopy == NULL)
+		return ENOMEM;
+
+	spawn_file_action* action = add_file_action(fileActions,
+		SPAWN_FILE_ACTION_OPEN, fildes);
+	if (action == NULL) {
+		free(pathCopy);
+		return ENOMEM;
+	}
+
+	action->open_mode = oflag;
+	action->perms = mode;
+	action->path = pathCopy;
+	return 0;
+}
+
+
+int
+posix_spawn_file_actions_addclose(posix_spawn_file_actions_t* fileActions,
+	int fildes)
+{
+	if (fileActions == NULL || *fileActions == NULL)
+		return EINVAL;
+	if (fildes < 0)
+		return EBADF;
+
+	if (add_file_action(fileActions, SPAWN_FILE_ACTION_CLOSE, fildes) == NULL)
+		return ENOMEM;
+
+	return 0;
+}
+
+
+int
+posix_spawn_file_actions_adddup2(posix_spawn_file_actions_t* fileActions,
+	int fildes, int newfildes)
+{
+	if (fileActions == NULL || *fileActions == NULL)
+		return EINVAL;
+	if (fildes < 0 || newfildes < 0)
+		return EBADF;
+
+	spawn_file_action* action = add_file_action(fileActions,
+		SPAWN_FILE_ACTION_DUP2, fildes);
+	if (action == NULL)
+		return ENOMEM;
+
+	action->new_fd = newfildes;
+	return 0;
+}
+
+
+//	#pragma mark - attributes
+
+
+int
+posix_spawnattr_init(posix_spawnattr_t* _attr)
+{
+	_posix_spawnattr* attr = (_posix_spawnattr*)malloc(
+		sizeof(_posix_spawnattr));
+	if (attr == NULL)
+		return ENOMEM;
+
+	memset(attr, 0, sizeof(_posix_spawnattr));
+	attr->policy = SCHED_OTHER;
+	attr->param.sched_priority = B_NORMAL_PRIORITY;
+
+	*_attr = attr;
+	return 0;
+}
+
+
+int
+posix_spawnattr_destroy(posix_spawnattr_t* attr)
+{
+	if (attr == NULL || *attr == NULL)
+		return EINVAL;
+
+	free(*attr);
+	*attr = NULL;
+	return 0;
+}
+
+
+int
+posix_spawnattr_getflags(const posix_spawnattr_t* attr, short* flags)
+{
+	if (attr == NULL || *attr == NULL || flags == NULL)
+		return EINVAL;
+
+	*flags = (*attr)->flags;
+	return 0;
+}
+
+
+int
+posix_spawnattr_setflags(posix_spawnattr_t* attr, short flags)
+{
+	if (attr == NULL || *attr == NULL || (flags & ~kValidFlags) != 0)
+		return EINVAL;
+
+	(*attr)->flags = flags;
+	return 0;
+}
+
+
+int
+posix_spawnattr_getpgroup(const posix_spawnattr_t* attr, pid_t* pgroup)
+{
+	if (attr == NULL || *attr == NULL || pgroup == NULL)
+		return EINVAL;
+
+	*pgroup = (*attr)->process_group;
+	return 0;
+}
+
+
+int
+posix_spawnattr_setpgroup(posix_spawnattr_t* attr, pid_t pgroup)
+{
+	if (attr == NULL || *attr == NULL || pgroup < 0)
+		return EINVAL;
+
+	(*attr)->process_group = pgroup;
+	return 0;
+}
+
+
+int
+posix_spawnattr_getschedparam(const posix_spawnattr_t* attr,
+	struct sched_param* param)
+{
+	if (attr == NULL || *attr == NULL || param == NULL)
+		return EINVAL;
+
+	*param = (*attr)->param;
+	return 0;
+}
+
+
+int
+posix_spawnattr_setschedparam(posix_spawnattr_t* attr,
+	const struct sched_param* param)
+{
+	if (attr == NULL || *attr == NULL || param == NULL
+		|| param->sched_priority < B_LOWEST_ACTIVE_PRIORITY
+		|| param->sched_priority > B_REAL_TIME_PRIORITY) {
+		return EINVAL;
+	}
+
+	(*attr)->param = *param;
+	return 0;
+}
+
+
+int
+posix_spawnattr_getschedpolicy(const posix_spawnattr_t* attr, int* policy)
+{
+	if (attr == NULL || *attr == NULL || policy == NULL)
+		return EINVAL;
+
+	*policy = (*attr)->policy;
+	return 0;
+}
+
+
+int
+posix_spawnattr_setschedpolicy(posix_spawnattr_t* attr, int policy)
+{
+	if (attr == NULL || *attr == NULL
+		|| (policy != SCHED_OTHER && policy != SCHED_RR)) {
+		return EINVAL;
+	}
+
+	(*attr)->policy = policy;
+	return 0;
+}
+
+
+int
+posix_spawnattr_getsigdefault(const posix_spawnattr_t* attr,
+	sigset_t* sigdefault)
+{
+	if (attr == NULL || *attr == NULL || sigdefault == NULL)
+		return EINVAL;
+
+	*sigdefault = (*attr)->default_signals;
+	return 0;
+}
+
+
+int
+posix_spawnattr_setsigdefault(posix_spawnattr_t* attr,
+	const sigset_t* sigdefault)
+{
+	if (attr == NULL || *attr == NULL || sigdefault == NULL)
+		return EINVAL;
+
+	(*attr)->default_signals = *sigdefault;
+	return 0;
+}
+
+
+int
+posix_spawnattr_getsigmask(const posix_spawnattr_t* attr, sigset_t* sigmask)
+{
+	if (attr == NULL || *attr == NULL || sigmask == NULL)
+		return EINVAL;
+
+	*sigmask = (*attr)->signal_mask;
+	return 0;
+}
+
+
+int
+posix_spawnattr_setsigmask(posix_spawnattr_t* attr, const sigset_t* sigmask)
+{
+	if (attr == NULL || *attr == NULL || sigmask == NULL)
+		return EINVAL;
+
+	(*attr)->signal_mask = *sigmask;
+	return 0;
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <sys/sendfile.h>
+
+#include <errno.h>
+
+#include <errno_private.h>
+#include <syscalls.h>
+
+
+#define RETURN_AND_SET_ERRNO(err) \
+	if (err < 0) { \
+		__set_errno(err); \
+		return -1; \
+	} \
+	return err;
+
+
+/*!	Transfers \a length bytes from \a inFD to \a outFD within the kernel.
+	If an offset pointer is given, the transfer happens at that position in
+	the respective file, the file position is left alone, and the offset is
+	moved past the transferred data. Otherwise the file position is used and
+	moved.
+*/
+ssize_t
+splice(int inFD, off_t *inOffset, int outFD, off_t *outOffset, size_t length,
+	unsigned int flags)
+{
+	ssize_t bytes;
+
+	if ((inOffset != NULL && *inOffset < 0)
+		|| (outOffset != NULL && *outOffset < 0)) {
+		__set_errno(B_BAD_VALUE);
+		return -1;
+	}
+
+	bytes = _kern_transfer_data(inFD, inOffset != NULL ? *inOffset : -1,
+		outFD, outOffset != NULL ? *outOffset : -1, length, flags);
+	if (bytes > 0) {
+		if (inOffset != NULL)
+			*inOffset += bytes;
+		if (outOffset != NULL)
+			*outOffset += bytes;
+	}
+
+	RETURN_AND_SET_ERRNO(bytes);
+}
+
+
+ssize_t
+sendfile(int outFD, int inFD, off_t *offset, size_t count)
+{
+	return splice(inFD, offset, outFD, NULL, count, 0);
+}
@@ -2565,6 +2565,7 @@ void semget() {}
 void semop() {}
 void send_data() {}
 void send_signal() {}
+void sendfile() {}
 void set_alarm() {}
 void set_area_protection() {}
 void set_dateformats() {}
@@ -2634,6 +2635,7 @@ void snooze_etc() {}
 void snooze_until() {}
 void snprintf() {}
 void spawn_thread() {}
+void splice() {}
 void sprintf() {}
 void sqrt() {}
 void sqrtf() {}
@@ -2538,6 +2538,7 @@ void send_authentication_request_to_registrar__8BPrivateRQ28BPrivate8KMessageT1(
 void send_data() {}
 void send_request_to_launch_daemon__8BPrivateRQ28BPrivate8KMessageT1() {}
 void send_signal() {}
+void sendfile() {}
 void setMbCurMax__Q38BPrivate7Libroot21LocaleCtypeDataBridgeUs() {}
 void set_alarm() {}
 void set_area_protection() {}
@@ -2612,6 +2613,7 @@ void snooze_until() {}
 void snprintf() {}
 void sort_heap__H1ZPQ217EnvironmentFilter5Entry_X01X01_v() {}
 void spawn_thread() {}
+void splice() {}
 void sprintf() {}
 void sqrt() {}
 void sqrtf() {}
@@ -0,0 +1,297 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures how long it takes the block allocator to satisfy small and large
+	allocations from several threads at once, after the free space of the
+	volume has been fragmented. It should be run on a large volume, so that
+	the allocator has to deal with many allocation groups.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+static const int32 kMaxThreads = 64;
+static const size_t kSmallFileSize = 4096;
+static const size_t kLargeChunkSize = 1024 * 1024;
+static const int32 kLargeChunks = 64;
+
+
+enum phase {
+	FRAGMENT,
+	SMALL_FILES,
+	LARGE_FILES,
+	REMOVE
+};
+
+struct worker {
+	char		directory[B_PATH_NAME_LENGTH];
+	int32		index;
+	int32		files;
+	phase		what;
+	bigtime_t*	latencies;
+	int32		count;
+	status_t	status;
+};
+
+
+static char sBuffer[kLargeChunkSize];
+
+
+static status_t
+write_file(const char* path, size_t size, worker* info)
+{
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return errno;
+
+	while (size > 0) {
+		size_t bytes = size < sizeof(sBuffer) ? size : sizeof(sBuffer);
+
+		bigtime_t start = system_time();
+		ssize_t written = write(fd, sBuffer, bytes);
+		if (info != NULL)
+			info->latencies[info->count++] = system_time() - start;
+
+		if (written != (ssize_t)bytes) {
+			close(fd);
+			return written < 0 ? errno : B_DEVICE_FULL;
+		}
+		size -= bytes;
+	}
+
+	close(fd);
+	return B_OK;
+}
+
+
+static status_t
+worker_thread(void* data)
+{
+	worker* info = (worker*)data;
+	char path[B_PATH_NAME_LENGTH];
+
+	for (int32 i = 0; i < info->files; i++) {
+		status_t status = B_OK;
+
+		switch (info->what) {
+			case FRAGMENT:
+				// files of 1 to 16 KB; every other one is removed afterwards
+				snprintf(path, sizeof(path), "%s/fragment-%" B_PRId32,
+					info->directory, i);
+				status = write_file(path, 1024 * (1 + (i * 7 + info->index)
+					% 16), NULL);
+				break;
+
+			case SMALL_FILES:
+				snprintf(path, sizeof(path), "%s/small-%" B_PRId32,
+					info->directory, i);
+				status = write_file(path, kSmallFileSize, info);
+				break;
+
+			case LARGE_FILES:
+				snprintf(path, sizeof(path), "%s/large-%" B_PRId32,
+					info->directory, i);
+				status = write_file(path, kLargeChunkSize * kLargeChunks,
+					info);
+				break;
+
+			case REMOVE:
+				snprintf(path, sizeof(path), "%s/fragment-%" B_PRId32,
+					info->directory, i);
+				if ((i & 1) != 0 && unlink(path) != 0)
+					status = errno;
+				break;
+		}
+
+		if (status != B_OK)
+			return info->status = status;
+	}
+
+	return info->status = B_OK;
+}
+
+
+static int
+compare_latencies(const void* _a, const void* _b)
+{
+	bigtime_t a = *(const bigtime_t*)_a;
+	bigtime_t b = *(const bigtime_t*)_b;
+	return a < b ? -1 : a > b ? 1 : 0;
+}
+
+
+static void
+print_latencies(const char* name, worker* workers, int32 threadCount)
+{
+	int32 total = 0;
+	for (int32 i = 0; i < threadCount; i++)
+		total += workers[i].count;
+	if (total == 0)
+		return;
+
+	bigtime_t* latencies = (bigtime_t*)malloc(total * sizeof(bigtime_t));
+	if (latencies == NULL)
+		return;
+
+	bigtime_t sum = 0;
+	int32 index = 0;
+	for (int32 i = 0; i < threadCount; i++) {
+		for (int32 j = 0; j < workers[i].count; j++) {
+			latencies[index++] = workers[i].latencies[j];
+			sum += workers[i].latencies[j];
+		}
+	}
+
+	qsort(latencies, total, sizeof(bigtime_t), &compare_latencies);
+
+	printf("%-12s %8" B_PRId32 " %8" B_PRId64 " %8" B_PRId64 " %8" B_PRId64
+		" %8" B_PRId64 " %8" B_PRId64 "\n", name, total, latencies[0],
+		sum / total, latencies[total / 2], latencies[total * 99 / 100],
+		latencies[total - 1]);
+
+	free(latencies);
+}
+
+
+static bool
+run_phase(worker* workers, int32 threadCount, phase what, int32 samples)
+{
+	thread_id threads[kMaxThreads];
+
+	for (int32 i = 0; i < threadCount; i++) {
+		workers[i].what = what;
+		workers[i].count = 0;
+		workers[i].status = B_OK;
+		workers[i].latencies = NULL;
+
+		if (samples > 0) {
+			workers[i].latencies
+				= (bigtime_t*)malloc(samples * sizeof(bigtime_t));
+			if (workers[i].latencies == NULL)
+				return false;
+		}
+	}
+
+	for (int32 i = 0; i < threadCount; i++) {
+		threads[i] = spawn_thread(&worker_thread, "allocation worker",
+			B_NORMAL_PRIORITY, &workers[i]);
+		if (threads[i] < 0) {
+			// just do it ourselves
+			worker_thread(&workers[i]);
+		} else
+			resume_thread(threads[i]);
+	}
+
+	bool success = true;
+	for (int32 i = 0; i < threadCount; i++) {
+		if (threads[i] >= 0)
+			wait_for_thread(threads[i], NULL);
+
+		if (workers[i].status != B_OK) {
+			fprintf(stderr, "Thread %" B_PRId32 " failed: %s\n", i,
+				strerror(workers[i].status));
+			success = false;
+		}
+	}
+
+	if (success) {
+		if (what == SMALL_FILES)
+			print_latencies("small files", workers, threadCount);
+		else if (what == LARGE_FILES)
+			print_latencies("large files", workers, threadCount);
+	}
+
+	for (int32 i = 0; i < threadCount; i++)
+		free(workers[i].latencies);
+
+	return success;
+}
+
+
+static void
+usage(const char* program)
+{
+	fprintf(stderr, "Usage: %s [-t <threads>] [-n <files>] <directory>\n"
+		"The directory should be on a large BFS volume; it will be filled "
+		"with\nfiles that are not removed afterwards.\n"
+		"  -t  The number of threads that allocate at the same time "
+		"(default 4)\n"
+		"  -n  The number of small files every thread creates "
+		"(default 2000)\n", program);
+	exit(1);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int32 threadCount = 4;
+	int32 files = 2000;
+	const char* base = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-t") && i + 1 < argc)
+			threadCount = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			files = atoi(argv[++i]);
+		else if (argv[i][0] != '-' && base == NULL)
+			base = argv[i];
+		else
+			usage(argv[0]);
+	}
+
+	if (base == NULL || threadCount < 1 || threadCount > kMaxThreads
+		|| files < 1) {
+		usage(argv[0]);
+	}
+
+	memset(sBuffer, 0x55, sizeof(sBuffer));
+
+	worker workers[kMaxThreads];
+	for (int32 i = 0; i < threadCount; i++) {
+		worker& info = workers[i];
+		snprintf(info.directory, sizeof(info.directory), "%s/%" B_PRId32,
+			base, i);
+		if (mkdir(info.directory, 0755) != 0 && errno != EEXIST) {
+			fprintf(stderr, "Could not create \"%s\": %s\n", info.directory,
+				strerror(errno));
+			return 1;
+		}
+
+		info.index = i;
+		info.files = files;
+	}
+
+	// fragment the free space first
+	if (!run_phase(workers, threadCount, FRAGMENT, 0)
+		|| !run_phase(workers, threadCount, REMOVE, 0)) {
+		return 1;
+	}
+	sync();
+
+	printf("%-12s %8s %8s %8s %8s %8s %8s\n", "usec", "count", "min", "avg",
+		"p50", "p99", "max");
+
+	if (!run_phase(workers, threadCount, SMALL_FILES, files))
+		return 1;
+
+	for (int32 i = 0; i < threadCount; i++)
+		workers[i].files = 1;
+
+	if (!run_phase(workers, threadCount, LARGE_FILES, kLargeChunks))
+		return 1;
+
+	return 0;
+}
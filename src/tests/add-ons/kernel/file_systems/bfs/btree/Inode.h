@@ -49,6 +49,7 @@ class Inode {
 
 		void AssertReadLocked() { ASSERT_READ_LOCKED_RW_LOCK(&fLock); }
 		void AssertWriteLocked() { ASSERT_WRITE_LOCKED_RW_LOCK(&fLock); }
+		void WriteLockInTransaction(Transaction&) {}
 
 	private:
 		friend void dump_inode(Inode& inode);
@@ -70,6 +70,11 @@ class Transaction {
 			return B_OK;
 		}
 
+		status_t WillWriteBlock(off_t blockNumber)
+		{
+			return B_OK;
+		}
+
 
 		status_t Done()
 		{
@@ -42,7 +42,7 @@ key* gKeys;
 int32 gNum = DEFAULT_NUM_KEYS;
 int32 gType = DEFAULT_KEY_TYPE;
 int32 gTreeCount = 0;
-bool gVerbose, gExcessive;
+bool gVerbose, gExcessive, gBulkLoad;
 int32 gIterations = DEFAULT_ITERATIONS;
 int32 gHard = 1;
 Volume* gVolume;
@@ -439,6 +439,50 @@ addAllKeys(Transaction& transaction, BPlusTree* tree)
 }
 
 
+/*!	Adds all keys at once via the TreeBuilder; most keys are added once,
+	but some get enough duplicates to need fragments, or duplicate nodes.
+	If the tree is not empty, the builder inserts the keys instead.
+*/
+void
+bulkLoadKeys(BPlusTree* tree)
+{
+	printf("*** Bulk loading all keys into the tree...\n");
+
+	TreeBuilder builder(tree);
+
+	// add the keys in reverse order, so that they have to be sorted
+	for (int32 i = gNum; i-- > 0;) {
+		int32 count = 1;
+		switch (rand() % 16) {
+			case 0:
+				count = 2 + rand() % 6;
+				break;
+			case 1:
+				count = 8 + rand() % 200;
+				break;
+		}
+
+		for (int32 j = 0; j < count; j++) {
+			status_t status = builder.Add((uint8*)gKeys[i].data,
+				gKeys[i].length, gKeys[i].value);
+			if (status != B_OK) {
+				printf("TreeBuilder::Add() returned: %s\n", strerror(status));
+				bailOutWithKey(gKeys[i].data, gKeys[i].length);
+			}
+			gKeys[i].in++;
+			gTreeCount++;
+		}
+	}
+
+	status_t status = builder.Finish();
+	if (status != B_OK) {
+		printf("TreeBuilder::Finish() returned: %s\n", strerror(status));
+		bailOut();
+	}
+	checkTree(tree);
+}
+
+
 void
 removeAllKeys(Transaction& transaction, BPlusTree* tree)
 {
@@ -620,7 +664,7 @@ usage(char* program)
 {
 	if (strrchr(program, '/'))
 		program = strrchr(program, '/') + 1;
-	fprintf(stderr, "usage: %s [-veh] [-t type] [-n keys] [-i iterations] "
+	fprintf(stderr, "usage: %s [-vebh] [-t type] [-n keys] [-i iterations] "
 			"[-h times] [-r seed]\n"
 		"BFS B+Tree torture test\n"
 		"\t-t\ttype is one of string, int32, uint32, int64, uint64, float,\n"
@@ -630,6 +674,7 @@ usage(char* program)
 		"\t-i\titerations is the number of the test cycles, defaults to %d.\n"
 		"\t-r\tthe seed for the random function, defaults to %ld.\n"
 		"\t-h\tremoves the keys and start over again for x times.\n"
+		"\t-b\tadds the keys with the TreeBuilder instead of one by one.\n"
 		"\t-e\texcessive validity tests: tree contents will be tested after "
 			"every operation\n"
 		"\t-v\tfor verbose output.\n",
@@ -657,6 +702,9 @@ main(int argc, char** argv)
 					case 'e':
 						gExcessive = true;
 						break;
+					case 'b':
+						gBulkLoad = true;
+						break;
 					case 't':
 						if (*++argv == NULL)
 							usage(program);
@@ -750,7 +798,10 @@ main(int argc, char** argv)
 		dumpKeys();
 
 	for (int32 j = 0; j < gHard; j++) {
-		addAllKeys(transaction, &tree);
+		if (gBulkLoad)
+			bulkLoadKeys(&tree);
+		else
+			addAllKeys(transaction, &tree);
 
 		// Run the tests (they will exit the app, if an error occurs)
 
@@ -0,0 +1,224 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Creates a number of mail like files with indexed attributes, and then
+	measures how long some queries that combine several indices take. The
+	number of results, and a checksum over the inode IDs found are printed
+	as well, so that runs on different versions of the file system can be
+	compared.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fs_attr.h>
+#include <fs_index.h>
+#include <fs_info.h>
+#include <fs_query.h>
+#include <OS.h>
+#include <TypeConstants.h>
+
+
+static const char* kStatus[] = {"New", "Read", "Replied"};
+
+static const char* kQueries[] = {
+	// two selective indices
+	"MAIL:from==\"sender-7@example.com\" && BENCH:value>=990",
+	"MAIL:from==\"sender-7@example.com\" && MAIL:status==\"New\"",
+	"(MAIL:from==\"sender-7@example.com\" "
+		"|| MAIL:from==\"sender-8@example.com\") && BENCH:value<10",
+	"(BENCH:value<5 || BENCH:value>995) && MAIL:status==\"Read\"",
+	// one selective index
+	"name==\"mail-1*\" && MAIL:status==\"Replied\"",
+	"BENCH:value==500 && size>0",
+	"BENCH:value>100 && MAIL:from==\"sender-3@example.com\" "
+		"&& MAIL:status!=\"Read\"",
+	"BENCH:value<20 && !(MAIL:status==\"New\")",
+	// terms that cannot be answered by an index alone
+	"MAIL:from==\"sender-3@example.com\" && MAIL:comment==\"\"",
+	// no selective index
+	"MAIL:status==\"New\" && BENCH:value>100",
+	NULL
+};
+
+
+static status_t
+write_attribute(int fd, const char* name, uint32 type, const void* data,
+	size_t size)
+{
+	ssize_t written = fs_write_attr(fd, name, type, 0, data, size);
+	if (written < 0)
+		return errno;
+
+	return written == (ssize_t)size ? B_OK : B_IO_ERROR;
+}
+
+
+static status_t
+create_files(const char* directory, int32 count)
+{
+	dev_t device = dev_for_path(directory);
+
+	if ((fs_create_index(device, "MAIL:from", B_STRING_TYPE, 0) != 0
+			|| fs_create_index(device, "MAIL:status", B_STRING_TYPE, 0) != 0
+			|| fs_create_index(device, "BENCH:value", B_INT32_TYPE, 0) != 0)
+		&& errno != B_FILE_EXISTS) {
+		fprintf(stderr, "Could not create indices: %s\n", strerror(errno));
+		return errno;
+	}
+
+	for (int32 i = 0; i < count; i++) {
+		char path[B_PATH_NAME_LENGTH];
+		snprintf(path, sizeof(path), "%s/mail-%" B_PRId32, directory, i);
+
+		int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0)
+			return errno;
+
+		char from[64];
+		snprintf(from, sizeof(from), "sender-%" B_PRId32 "@example.com",
+			i % 100);
+		const char* status = kStatus[(i / 7) % 3];
+		int32 value = i % 1000;
+
+		status_t result = write_attribute(fd, "MAIL:from", B_STRING_TYPE,
+			from, strlen(from) + 1);
+		if (result == B_OK) {
+			result = write_attribute(fd, "MAIL:status", B_STRING_TYPE, status,
+				strlen(status) + 1);
+		}
+		if (result == B_OK) {
+			result = write_attribute(fd, "BENCH:value", B_INT32_TYPE, &value,
+				sizeof(value));
+		}
+		if (result == B_OK && i % 3 == 0 && write(fd, "hello", 5) != 5)
+			result = errno;
+
+		close(fd);
+
+		if (result != B_OK)
+			return result;
+	}
+
+	return B_OK;
+}
+
+
+static status_t
+run_query(dev_t device, const char* predicate, int32& _count, uint32& _hash,
+	bigtime_t& _time)
+{
+	bigtime_t start = system_time();
+
+	DIR* query = fs_open_query(device, predicate, 0);
+	if (query == NULL)
+		return errno;
+
+	int32 count = 0;
+	uint32 hash = 0;
+	while (dirent* entry = fs_read_query(query)) {
+		count++;
+		hash += (uint32)entry->d_ino * 2654435761UL;
+	}
+
+	fs_close_query(query);
+
+	_time = system_time() - start;
+	_count = count;
+	_hash = hash;
+	return B_OK;
+}
+
+
+static void
+usage(const char* program)
+{
+	fprintf(stderr, "Usage: %s [-n <files>] [-r <rounds>] [-s] <directory>\n"
+		"The directory will be filled with files that are not removed "
+		"afterwards.\n"
+		"  -n  The number of files to create (default 20000)\n"
+		"  -r  How often every query is run; the best time is printed "
+		"(default 3)\n"
+		"  -s  Skip creating the files, and only run the queries\n",
+		program);
+	exit(1);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int32 files = 20000;
+	int32 rounds = 3;
+	bool createFiles = true;
+	const char* directory = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			files = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-r") && i + 1 < argc)
+			rounds = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-s"))
+			createFiles = false;
+		else if (argv[i][0] != '-' && directory == NULL)
+			directory = argv[i];
+		else
+			usage(argv[0]);
+	}
+
+	if (directory == NULL || files < 1 || rounds < 1)
+		usage(argv[0]);
+
+	if (createFiles) {
+		if (mkdir(directory, 0755) != 0 && errno != EEXIST) {
+			fprintf(stderr, "Could not create \"%s\": %s\n", directory,
+				strerror(errno));
+			return 1;
+		}
+
+		status_t status = create_files(directory, files);
+		if (status != B_OK) {
+			fprintf(stderr, "Could not create files: %s\n", strerror(status));
+			return 1;
+		}
+		sync();
+	}
+
+	dev_t device = dev_for_path(directory);
+
+	printf("%8s %8s %10s  %s\n", "results", "checksum", "usecs", "query");
+
+	for (int32 i = 0; kQueries[i] != NULL; i++) {
+		int32 count = 0;
+		uint32 hash = 0;
+		bigtime_t best = 0;
+
+		for (int32 round = 0; round < rounds; round++) {
+			bigtime_t time;
+			status_t status = run_query(device, kQueries[i], count, hash,
+				time);
+			if (status != B_OK) {
+				fprintf(stderr, "Query \"%s\" failed: %s\n", kQueries[i],
+					strerror(status));
+				return 1;
+			}
+
+			if (round == 0 || time < best)
+				best = time;
+		}
+
+		printf("%8" B_PRId32 " %08" B_PRIx32 " %10" B_PRId64 "  %s\n", count,
+			hash, best, kQueries[i]);
+	}
+
+	return 0;
+}
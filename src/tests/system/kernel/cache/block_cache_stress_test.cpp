@@ -0,0 +1,187 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#define write_pos	block_cache_write_pos
+#define writev_pos	block_cache_writev_pos
+#define read_pos	block_cache_read_pos
+
+#include "block_cache.cpp"
+
+#undef write_pos
+#undef writev_pos
+#undef read_pos
+
+#include <OS.h>
+
+
+static const off_t kBlockCount = 4096;
+static const size_t kBlockSize = 2048;
+static const bigtime_t kRunTime = 1000000;
+
+
+struct thread_data {
+	uint32	seed;
+	uint64	lookups;
+};
+
+
+static block_cache* sCache;
+static vint32 sStart;
+static vint32 sStop;
+
+
+ssize_t
+block_cache_write_pos(int fd, off_t offset, const void* buffer, size_t size)
+{
+	return size;
+}
+
+
+ssize_t
+block_cache_writev_pos(int fd, off_t offset, const iovec* vecs, size_t count)
+{
+	ssize_t total = 0;
+	for (size_t i = 0; i < count; i++) {
+		ssize_t written = block_cache_write_pos(fd, offset + total,
+			vecs[i].iov_base, vecs[i].iov_len);
+		if (written < 0)
+			return written;
+
+		total += written;
+	}
+
+	return total;
+}
+
+
+ssize_t
+block_cache_read_pos(int fd, off_t offset, void* buffer, size_t size)
+{
+	memset(buffer, 0, size);
+	*(off_t*)buffer = offset / kBlockSize;
+	return size;
+}
+
+
+static inline uint32
+next_random(uint32& seed)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+
+static status_t
+lookup_thread(void* _data)
+{
+	thread_data* data = (thread_data*)_data;
+
+	while (atomic_get(&sStart) == 0)
+		snooze(100);
+
+	uint64 lookups = 0;
+	while (atomic_get(&sStop) == 0) {
+		for (int32 i = 0; i < 256; i++) {
+			off_t blockNumber = next_random(data->seed) % kBlockCount;
+
+			const off_t* block = (const off_t*)block_cache_get(sCache,
+				blockNumber);
+			if (block == NULL || *block != blockNumber) {
+				fprintf(stderr, "block %" B_PRIdOFF " has wrong contents!\n",
+					blockNumber);
+				exit(1);
+			}
+			block_cache_put(sCache, blockNumber);
+		}
+		lookups += 256;
+	}
+
+	data->lookups = lookups;
+	return B_OK;
+}
+
+
+static double
+run(int32 threadCount)
+{
+	thread_id threads[B_MAX_CPU_COUNT * 2];
+	thread_data data[B_MAX_CPU_COUNT * 2];
+
+	sStart = 0;
+	sStop = 0;
+
+	for (int32 i = 0; i < threadCount; i++) {
+		data[i].seed = i * 7919 + 1;
+		data[i].lookups = 0;
+
+		threads[i] = spawn_thread(&lookup_thread, "lookup",
+			B_NORMAL_PRIORITY, &data[i]);
+		resume_thread(threads[i]);
+	}
+
+	bigtime_t start = system_time();
+	atomic_set(&sStart, 1);
+	snooze(kRunTime);
+	atomic_set(&sStop, 1);
+
+	uint64 lookups = 0;
+	for (int32 i = 0; i < threadCount; i++) {
+		status_t returnValue;
+		wait_for_thread(threads[i], &returnValue);
+		lookups += data[i].lookups;
+	}
+
+	return lookups * 1000000.0 / (system_time() - start);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	block_cache_init();
+
+	sCache = (block_cache*)block_cache_create(-1, kBlockCount, kBlockSize,
+		true);
+	if (sCache == NULL) {
+		fprintf(stderr, "could not create block cache\n");
+		return 1;
+	}
+
+	system_info info;
+	get_system_info(&info);
+
+	int32 maxThreads = info.cpu_count * 2;
+	if (argc > 1)
+		maxThreads = min_c(atoi(argv[1]), B_MAX_CPU_COUNT * 2);
+
+	// Run once with all blocks being unused between lookups (every get has
+	// to take the cache lock), and once with an extra reference held on
+	// every block, like a file system does for its hot metadata blocks.
+
+	for (int32 pass = 0; pass < 2; pass++) {
+		bool referenced = pass == 1;
+		if (referenced) {
+			for (off_t i = 0; i < kBlockCount; i++)
+				block_cache_get(sCache, i);
+		}
+
+		printf("%s blocks:\n", referenced ? "referenced" : "unreferenced");
+		printf("threads  lookups/sec\n");
+
+		for (int32 threads = 1; threads <= maxThreads; threads *= 2) {
+			printf("%7" B_PRId32 "  %11.0f\n", threads,
+				run(threads));
+		}
+
+		if (referenced) {
+			for (off_t i = 0; i < kBlockCount; i++)
+				block_cache_put(sCache, i);
+		}
+	}
+
+	block_cache_delete(sCache, false);
+	return 0;
+}
@@ -0,0 +1,336 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Compares the AVL tree based VMCache page index against the splay tree it
+	replaced: lookups from one and more threads, and in-order iteration.
+	The splay tree restructures itself on every lookup, so concurrent lookups
+	need to be serialized; the AVL tree only needs a shared (read) lock.
+*/
+
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <OS.h>
+
+#include <util/AVLTreeBase.h>
+#include <util/SplayTree.h>
+
+
+typedef phys_addr_t page_num_t;
+
+
+static const int32 kDefaultPageCount = 1024 * 1024;
+	// 4 GB worth of pages
+static const int32 kLookupsPerRound = 256;
+static const bigtime_t kRunTime = 1000000;
+
+
+struct page {
+	page_num_t			cache_offset;
+	AVLTreeNode			avl_link;
+	SplayTreeLink<page>	splay_link;
+	page*				splay_next;
+};
+
+
+struct SplayTreeDefinition {
+	typedef page_num_t KeyType;
+	typedef	page NodeType;
+
+	static page_num_t GetKey(const NodeType* node)
+	{
+		return node->cache_offset;
+	}
+
+	static SplayTreeLink<NodeType>* GetLink(NodeType* node)
+	{
+		return &node->splay_link;
+	}
+
+	static int Compare(page_num_t key, const NodeType* node)
+	{
+		return key == node->cache_offset ? 0
+			: (key < node->cache_offset ? -1 : 1);
+	}
+
+	static NodeType** GetListLink(NodeType* node)
+	{
+		return &node->splay_next;
+	}
+};
+
+typedef IteratableSplayTree<SplayTreeDefinition> PageSplayTree;
+
+
+static inline page*
+page_for(const AVLTreeNode* node)
+{
+	return (page*)((addr_t)node - offsetof(page, avl_link));
+}
+
+
+class PageAVLTree : private AVLTreeCompare {
+public:
+	PageAVLTree()
+		:
+		fTree(this)
+	{
+	}
+
+	void Insert(page* page)
+	{
+		fTree.Insert(&page->avl_link);
+	}
+
+	page* Lookup(page_num_t offset) const
+	{
+		AVLTreeNode* node = fTree.Root();
+		while (node != NULL) {
+			page* page = page_for(node);
+			if (offset == page->cache_offset)
+				return page;
+
+			node = offset < page->cache_offset ? node->left : node->right;
+		}
+
+		return NULL;
+	}
+
+	page* First() const
+	{
+		AVLTreeNode* node = fTree.LeftMost(fTree.Root());
+		return node != NULL ? page_for(node) : NULL;
+	}
+
+	page* Next(page* page) const
+	{
+		AVLTreeNode* node = fTree.Next(&page->avl_link);
+		return node != NULL ? page_for(node) : NULL;
+	}
+
+private:
+	virtual int CompareKeyNode(const void* key, const AVLTreeNode* node)
+	{
+		page_num_t offset = *(const page_num_t*)key;
+		page_num_t nodeOffset = page_for(node)->cache_offset;
+		return offset == nodeOffset ? 0 : (offset < nodeOffset ? -1 : 1);
+	}
+
+	virtual int CompareNodes(const AVLTreeNode* node1,
+		const AVLTreeNode* node2)
+	{
+		return CompareKeyNode(&page_for(node1)->cache_offset, node2);
+	}
+
+private:
+	AVLTreeBase	fTree;
+};
+
+
+struct thread_data {
+	uint32	seed;
+	uint64	lookups;
+};
+
+
+static int32 sPageCount = kDefaultPageCount;
+static PageSplayTree sSplayTree;
+static PageAVLTree sAVLTree;
+static pthread_mutex_t sSplayLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_rwlock_t sAVLLock = PTHREAD_RWLOCK_INITIALIZER;
+static vint32 sStart;
+static vint32 sStop;
+
+
+static inline uint32
+next_random(uint32& seed)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+
+static inline page_num_t
+random_offset(uint32& seed)
+{
+	// Mostly sequential runs with random starting points, like the faults of
+	// a thread walking through a mapped file.
+	return (page_num_t)(next_random(seed) % (sPageCount / 16)) * 16;
+}
+
+
+static status_t
+splay_lookup_thread(void* _data)
+{
+	thread_data* data = (thread_data*)_data;
+
+	while (atomic_get(&sStart) == 0)
+		snooze(100);
+
+	uint64 lookups = 0;
+	while (atomic_get(&sStop) == 0) {
+		for (int32 i = 0; i < kLookupsPerRound; i++) {
+			page_num_t offset = random_offset(data->seed);
+
+			pthread_mutex_lock(&sSplayLock);
+			for (int32 j = 0; j < 16; j++) {
+				if (sSplayTree.Lookup(offset + j) == NULL) {
+					fprintf(stderr, "page %" B_PRIuPHYSADDR " not found!\n",
+						offset + j);
+					exit(1);
+				}
+			}
+			pthread_mutex_unlock(&sSplayLock);
+		}
+		lookups += kLookupsPerRound * 16;
+	}
+
+	data->lookups = lookups;
+	return B_OK;
+}
+
+
+static status_t
+avl_lookup_thread(void* _data)
+{
+	thread_data* data = (thread_data*)_data;
+
+	while (atomic_get(&sStart) == 0)
+		snooze(100);
+
+	uint64 lookups = 0;
+	while (atomic_get(&sStop) == 0) {
+		for (int32 i = 0; i < kLookupsPerRound; i++) {
+			page_num_t offset = random_offset(data->seed);
+
+			pthread_rwlock_rdlock(&sAVLLock);
+			for (int32 j = 0; j < 16; j++) {
+				if (sAVLTree.Lookup(offset + j) == NULL) {
+					fprintf(stderr, "page %" B_PRIuPHYSADDR " not found!\n",
+						offset + j);
+					exit(1);
+				}
+			}
+			pthread_rwlock_unlock(&sAVLLock);
+		}
+		lookups += kLookupsPerRound * 16;
+	}
+
+	data->lookups = lookups;
+	return B_OK;
+}
+
+
+static double
+run_lookups(thread_func function, int32 threadCount)
+{
+	thread_id threads[B_MAX_CPU_COUNT * 2];
+	thread_data data[B_MAX_CPU_COUNT * 2];
+
+	sStart = 0;
+	sStop = 0;
+
+	for (int32 i = 0; i < threadCount; i++) {
+		data[i].seed = i * 7919 + 1;
+		data[i].lookups = 0;
+
+		threads[i] = spawn_thread(function, "lookup", B_NORMAL_PRIORITY,
+			&data[i]);
+		resume_thread(threads[i]);
+	}
+
+	bigtime_t start = system_time();
+	atomic_set(&sStart, 1);
+	snooze(kRunTime);
+	atomic_set(&sStop, 1);
+
+	uint64 lookups = 0;
+	for (int32 i = 0; i < threadCount; i++) {
+		status_t returnValue;
+		wait_for_thread(threads[i], &returnValue);
+		lookups += data[i].lookups;
+	}
+
+	return lookups * 1000000.0 / (system_time() - start);
+}
+
+
+static void
+run_iteration()
+{
+	bigtime_t start = system_time();
+	int32 count = 0;
+	for (PageSplayTree::Iterator it = sSplayTree.GetIterator();
+			it.Next() != NULL;) {
+		count++;
+	}
+	bigtime_t splayTime = system_time() - start;
+
+	start = system_time();
+	for (page* page = sAVLTree.First(); page != NULL;
+			page = sAVLTree.Next(page)) {
+		count--;
+	}
+	bigtime_t avlTime = system_time() - start;
+
+	if (count != 0) {
+		fprintf(stderr, "trees have a different number of pages!\n");
+		exit(1);
+	}
+
+	printf("iterating %" B_PRId32 " pages: splay %" B_PRIdBIGTIME " us, "
+		"avl %" B_PRIdBIGTIME " us\n", sPageCount, splayTime, avlTime);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	if (argc > 1)
+		sPageCount = atoi(argv[1]);
+
+	system_info info;
+	get_system_info(&info);
+
+	int32 maxThreads = info.cpu_count * 2;
+	if (argc > 2)
+		maxThreads = atoi(argv[2]);
+	maxThreads = min_c(maxThreads, B_MAX_CPU_COUNT * 2);
+
+	page* pages = new page[sPageCount];
+
+	// insert the pages in a scattered order, as page faults would
+	bigtime_t start = system_time();
+	for (int32 i = 0; i < sPageCount; i++) {
+		int32 index = (int32)(((uint64)i * 7919) % sPageCount);
+		pages[index].cache_offset = index;
+		sSplayTree.Insert(&pages[index]);
+	}
+	bigtime_t splayTime = system_time() - start;
+
+	start = system_time();
+	for (int32 i = 0; i < sPageCount; i++)
+		sAVLTree.Insert(&pages[(int32)(((uint64)i * 7919) % sPageCount)]);
+	bigtime_t avlTime = system_time() - start;
+
+	printf("inserting %" B_PRId32 " pages: splay %" B_PRIdBIGTIME " us, "
+		"avl %" B_PRIdBIGTIME " us\n", sPageCount, splayTime, avlTime);
+
+	run_iteration();
+
+	printf("threads  splay lookups/sec  avl lookups/sec\n");
+	for (int32 threads = 1; threads <= maxThreads; threads *= 2) {
+		double splay = run_lookups(&splay_lookup_thread, threads);
+		double avl = run_lookups(&avl_lookup_thread, threads);
+		printf("%7" B_PRId32 "  %17.0f  %15.0f\n", threads, splay, avl);
+	}
+
+	delete[] pages;
+	return 0;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Fills more memory than is free with compressible data, so that a part of
+	it is paged out, then reads it back, verifies it, and reports the page
+	fault latencies and the state of the compressed swap pool.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include <syscalls.h>
+#include <vm_defs.h>
+
+
+static void
+print_info(const char* label)
+{
+	compressed_swap_info info;
+	status_t status = _kern_get_compressed_swap_info(&info, sizeof(info));
+	if (status != B_OK) {
+		printf("%s: could not get compressed swap info: %s\n", label,
+			strerror(status));
+		return;
+	}
+
+	if (info.algorithm[0] == '\0') {
+		printf("%s: compressed swap is disabled\n", label);
+		return;
+	}
+
+	printf("%s: %s, %" B_PRIu64 " pages in %" B_PRIu64 " of %" B_PRIu64
+		" KB, %" B_PRIu64 " rejected, %" B_PRIu64 " demoted\n", label,
+		info.algorithm, info.stored_pages, info.pool_size / 1024,
+		info.max_pool_size / 1024, info.rejected_pages, info.demoted_pages);
+	printf("%s: %" B_PRIu64 " pool faults (%" B_PRId64 " us), %" B_PRIu64
+		" disk faults (%" B_PRId64 " us)\n", label, info.pool_faults,
+		info.pool_fault_time, info.disk_faults, info.disk_fault_time);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	system_info systemInfo;
+	get_system_info(&systemInfo);
+
+	// Allocate free memory plus a quarter of it, or what was asked for.
+	uint64 size = (systemInfo.max_pages - systemInfo.used_pages) * B_PAGE_SIZE;
+	size += size / 4;
+	if (argc > 1)
+		size = strtoull(argv[1], NULL, 0) * 1024 * 1024;
+
+	uint32* memory;
+	area_id area = create_area("compressed swap test", (void**)&memory,
+		B_ANY_ADDRESS, size, B_NO_LOCK, B_READ_AREA | B_WRITE_AREA);
+	if (area < 0) {
+		fprintf(stderr, "Could not create %" B_PRIu64 " MB area: %s\n",
+			size / 1024 / 1024, strerror(area));
+		return 1;
+	}
+
+	print_info("before");
+
+	// Every page gets a few distinct words and is zero otherwise, so that it
+	// compresses well, but not to nothing.
+	size_t pageCount = size / B_PAGE_SIZE;
+	size_t wordsPerPage = B_PAGE_SIZE / sizeof(uint32);
+
+	bigtime_t startTime = system_time();
+	for (size_t i = 0; i < pageCount; i++) {
+		uint32* page = memory + i * wordsPerPage;
+		for (size_t j = 0; j < wordsPerPage; j += 64)
+			page[j] = i * 31 + j;
+	}
+	bigtime_t writeTime = system_time() - startTime;
+
+	startTime = system_time();
+	size_t errors = 0;
+	for (size_t i = 0; i < pageCount; i++) {
+		uint32* page = memory + i * wordsPerPage;
+		for (size_t j = 0; j < wordsPerPage; j++) {
+			uint32 expected = j % 64 == 0 ? i * 31 + j : 0;
+			if (page[j] != expected) {
+				errors++;
+				break;
+			}
+		}
+	}
+	bigtime_t readTime = system_time() - startTime;
+
+	printf("%" B_PRIuSIZE " pages: written in %" B_PRId64 " ms, read in %"
+		B_PRId64 " ms, %" B_PRIuSIZE " corrupt\n", pageCount, writeTime / 1000,
+		readTime / 1000, errors);
+
+	print_info("after");
+
+	delete_area(area);
+	return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,309 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Compares the cost of a wakeup with poll() and with an event queue, when
+	only one of a growing number of pipes becomes readable at a time. Also
+	checks that level-triggered events are reported until they are consumed,
+	and edge-triggered ones only once, and that a queue inherited by another
+	team can be closed there safely.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+static const int kMaxPipes = 4096;
+static const int kMaxSelectInfos = 1024;
+static const int kWakeups = 10000;
+
+
+static int sPipes[kMaxPipes][2];
+static uint32 sSeed = 1;
+
+
+static inline uint32
+next_random()
+{
+	sSeed = sSeed * 1103515245 + 12345;
+	return sSeed >> 8;
+}
+
+
+static void
+create_pipes(int count)
+{
+	for (int i = 0; i < count; i++) {
+		if (pipe(sPipes[i]) != 0) {
+			fprintf(stderr, "Creating pipe %d failed: %s\n", i,
+				strerror(errno));
+			exit(1);
+		}
+	}
+}
+
+
+static void
+delete_pipes(int count)
+{
+	for (int i = 0; i < count; i++) {
+		close(sPipes[i][0]);
+		close(sPipes[i][1]);
+	}
+}
+
+
+static void
+wake_up(int index)
+{
+	char byte = 0;
+	write(sPipes[index][1], &byte, 1);
+}
+
+
+static void
+consume(int fd)
+{
+	char byte;
+	read(fd, &byte, 1);
+}
+
+
+static double
+run_poll(int count)
+{
+	pollfd* fds = new pollfd[count];
+	for (int i = 0; i < count; i++) {
+		fds[i].fd = sPipes[i][0];
+		fds[i].events = POLLIN;
+	}
+
+	bigtime_t start = system_time();
+
+	for (int i = 0; i < kWakeups; i++) {
+		int index = next_random() % count;
+		wake_up(index);
+
+		if (poll(fds, count, -1) != 1 || fds[index].revents != POLLIN) {
+			fprintf(stderr, "poll() reported the wrong pipe\n");
+			exit(1);
+		}
+		consume(fds[index].fd);
+	}
+
+	bigtime_t time = system_time() - start;
+	delete[] fds;
+	return (double)time / kWakeups;
+}
+
+
+static int
+create_queue(int count, int32 behavior)
+{
+	int queue = event_queue_create(O_CLOEXEC);
+	if (queue < 0) {
+		fprintf(stderr, "Creating the event queue failed: %s\n",
+			strerror(queue));
+		exit(1);
+	}
+
+	event_wait_info* infos = new event_wait_info[count];
+	for (int i = 0; i < count; i++) {
+		infos[i].object = sPipes[i][0];
+		infos[i].type = B_OBJECT_TYPE_FD;
+		infos[i].events = B_EVENT_READ | behavior;
+		infos[i].user_data = (void*)(addr_t)i;
+	}
+
+	status_t status = B_OK;
+	for (int i = 0; i < count && status == B_OK; i += kMaxSelectInfos) {
+		status = event_queue_select(queue, infos + i,
+			min_c(count - i, kMaxSelectInfos));
+	}
+	delete[] infos;
+
+	if (status != B_OK) {
+		fprintf(stderr, "Selecting the pipes failed: %s\n", strerror(status));
+		exit(1);
+	}
+
+	return queue;
+}
+
+
+static double
+run_event_queue(int count)
+{
+	int queue = create_queue(count, 0);
+
+	bigtime_t start = system_time();
+
+	for (int i = 0; i < kWakeups; i++) {
+		int index = next_random() % count;
+		wake_up(index);
+
+		event_wait_info info;
+		if (event_queue_wait(queue, &info, 1, 0, 0) != 1
+			|| (int)(addr_t)info.user_data != index) {
+			fprintf(stderr, "The event queue reported the wrong pipe\n");
+			exit(1);
+		}
+		consume(info.object);
+	}
+
+	bigtime_t time = system_time() - start;
+	close(queue);
+	return (double)time / kWakeups;
+}
+
+
+static ssize_t
+pending_events(int queue)
+{
+	event_wait_info info;
+	ssize_t count = event_queue_wait(queue, &info, 1, B_RELATIVE_TIMEOUT, 0);
+	return count == B_WOULD_BLOCK || count == B_TIMED_OUT ? 0 : count;
+}
+
+
+static bool
+check_triggering()
+{
+	create_pipes(1);
+
+	int edgeQueue = create_queue(1, 0);
+	int levelQueue = create_queue(1, B_EVENT_LEVEL_TRIGGERED);
+	int oneShotQueue = create_queue(1, B_EVENT_ONE_SHOT);
+
+	wake_up(0);
+
+	// the data isn't read, so only the level-triggered event stays
+	bool ok = pending_events(edgeQueue) == 1 && pending_events(edgeQueue) == 0
+		&& pending_events(levelQueue) == 1 && pending_events(levelQueue) == 1
+		&& pending_events(oneShotQueue) == 1;
+
+	// the one shot event has been removed, so it's not reported again
+	wake_up(0);
+	ok = ok && pending_events(edgeQueue) == 1
+		&& pending_events(oneShotQueue) == 0;
+
+	consume(sPipes[0][0]);
+	consume(sPipes[0][0]);
+	ok = ok && pending_events(levelQueue) == 0;
+
+	// closing the pipe invalidates it, and removes it from the queue
+	delete_pipes(1);
+	event_wait_info info;
+	ok = ok && event_queue_wait(edgeQueue, &info, 1, B_RELATIVE_TIMEOUT, 0) == 1
+		&& (info.events & B_EVENT_INVALID) != 0
+		&& pending_events(edgeQueue) == 0;
+
+	close(edgeQueue);
+	close(levelQueue);
+	close(oneShotQueue);
+	return ok;
+}
+
+
+//!	Selecting more infos than the kernel accepts at once must fail early.
+static bool
+check_select_limit()
+{
+	int queue = create_queue(0, 0);
+
+	event_wait_info info;
+	bool ok = event_queue_select(queue, &info, kMaxSelectInfos + 1)
+			== B_BAD_VALUE
+		&& event_queue_select(queue, &info, INT32_MAX) == B_BAD_VALUE;
+
+	close(queue);
+	return ok;
+}
+
+
+/*!	The child inherits the queue, and closes it last. The pipe stays
+	selected in the parent's I/O context until the parent closes it.
+*/
+static bool
+check_other_team()
+{
+	create_pipes(1);
+	int queue = create_queue(1, 0);
+
+	pid_t child = fork();
+	if (child < 0)
+		return false;
+
+	if (child == 0) {
+		// wait until the parent has closed its queue descriptor
+		usleep(100000);
+
+		event_wait_info info;
+		bool ok = event_queue_wait(queue, &info, 1, B_RELATIVE_TIMEOUT, 0)
+			== B_NOT_ALLOWED;
+		close(queue);
+		_exit(ok ? 0 : 1);
+	}
+
+	close(queue);
+
+	int status;
+	if (waitpid(child, &status, 0) != child)
+		return false;
+
+	// the pipe must not notify the queue's freed events
+	wake_up(0);
+	delete_pipes(1);
+
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+
+int
+main()
+{
+	if (!check_triggering()) {
+		fprintf(stderr, "The event queue reported the wrong events\n");
+		return 1;
+	}
+	if (!check_other_team()) {
+		fprintf(stderr, "Using the event queue from another team failed\n");
+		return 1;
+	}
+	if (!check_select_limit()) {
+		fprintf(stderr, "The event queue accepted too many infos\n");
+		return 1;
+	}
+
+	// every pipe needs two file descriptors
+	struct rlimit limit;
+	limit.rlim_cur = kMaxPipes * 2 + 16;
+	limit.rlim_max = RLIM_INFINITY;
+	setrlimit(RLIMIT_NOFILE, &limit);
+
+	printf("  pipes  poll us/wakeup  event queue us/wakeup\n");
+
+	for (int count = 16; count <= kMaxPipes; count *= 4) {
+		create_pipes(count);
+
+		double pollTime = run_poll(count);
+		double eventQueueTime = run_event_queue(count);
+		printf("%7d  %14.2f  %21.2f\n", count, pollTime, eventQueueTime);
+
+		delete_pipes(count);
+	}
+
+	return 0;
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Like fibo_exec, but the children are started with posix_spawn(), or with
+	fork() and execv() when -f is given. The top-level process can be given a
+	large resident set with -m, which fork() has to copy, and posix_spawn()
+	doesn't, and repeats the computation -i times to measure the difference.
+*/
+
+
+#include <errno.h>
+#include <spawn.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+static bool sUseFork = false;
+
+
+static void
+usage(char const *app)
+{
+	printf("usage: %s [-f] [-m <megabytes>] [-i <iterations>] [-s] ###\n",
+		app);
+	exit(-1);
+}
+
+
+static pid_t
+start_child(const char* path, int num)
+{
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "%d", num);
+
+	char* args[5];
+	int argCount = 0;
+	args[argCount++] = (char*)path;
+	if (sUseFork)
+		args[argCount++] = (char*)"-f";
+	args[argCount++] = (char*)"-s";
+	args[argCount++] = buffer;
+	args[argCount] = NULL;
+
+	if (sUseFork) {
+		pid_t child = fork();
+		if (child == 0) {
+			execv(args[0], args);
+			fprintf(stderr, "Could not exec: %s\n", strerror(errno));
+			exit(-1);
+		}
+		if (child < 0)
+			fprintf(stderr, "fork() failed: %s\n", strerror(errno));
+		return child;
+	}
+
+	pid_t child;
+	int error = posix_spawn(&child, path, NULL, NULL, args, environ);
+	if (error != 0) {
+		fprintf(stderr, "posix_spawn() failed: %s\n", strerror(error));
+		return -1;
+	}
+
+	return child;
+}
+
+
+static int
+wait_for_child(pid_t child)
+{
+	status_t status, returnValue = 0;
+	do {
+		status = wait_for_thread(child, &returnValue);
+	} while (status == B_INTERRUPTED);
+
+	if (status != B_OK) {
+		fprintf(stderr, "wait_for_thread(%d) failed: %s\n", (int)child,
+			strerror(status));
+		return 0;
+	}
+
+	return returnValue;
+}
+
+
+static int
+fibo(const char* path, int num)
+{
+	if (num < 2)
+		return num;
+
+	pid_t childA = start_child(path, num - 1);
+	pid_t childB = start_child(path, num - 2);
+	if (childA < 0 || childB < 0)
+		exit(-1);
+
+	return wait_for_child(childA) + wait_for_child(childB);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	bool silent = false;
+	int megabytes = 0;
+	int iterations = 1;
+
+	int option;
+	while ((option = getopt(argc, argv, "fm:i:s")) != -1) {
+		switch (option) {
+			case 'f':
+				sUseFork = true;
+				break;
+			case 'm':
+				megabytes = atoi(optarg);
+				break;
+			case 'i':
+				iterations = atoi(optarg);
+				break;
+			case 's':
+				silent = true;
+				break;
+			default:
+				usage(argv[0]);
+				break;
+		}
+	}
+
+	if (optind != argc - 1 || iterations < 1)
+		usage(argv[0]);
+
+	int num = atoi(argv[optind]);
+
+	if (silent)
+		return fibo(argv[0], num);
+
+	if (megabytes > 0) {
+		// make the parent's resident set large
+		size_t size = (size_t)megabytes * 1024 * 1024;
+		char* ballast = (char*)malloc(size);
+		if (ballast == NULL) {
+			fprintf(stderr, "Could not allocate %d MB\n", megabytes);
+			return -1;
+		}
+		memset(ballast, 1, size);
+	}
+
+	int result = 0;
+	bigtime_t start = system_time();
+
+	for (int i = 0; i < iterations; i++)
+		result = fibo(argv[0], num);
+
+	bigtime_t time = system_time() - start;
+
+	printf("%d\n", result);
+	printf("%s, %d MB parent: %lld us per run\n",
+		sUseFork ? "fork() + exec()" : "posix_spawn()", megabytes,
+		(long long)(time / iterations));
+	return 0;
+}
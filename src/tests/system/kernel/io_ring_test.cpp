@@ -0,0 +1,270 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Compares random 4 KB reads from a cached file done with pread() to the
+	same reads submitted through an I/O ring in batches of growing size.
+	Also checks that the ring completes a few simple operations correctly,
+	that the team can't delete the ring's area, that only sockets can be
+	waited for, that a recv() only completes once data arrives, and that the
+	ring's file descriptor polls readable when completions are pending.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+#include <io_ring_private.h>
+
+
+static const char* kFileName = "/tmp/io_ring_test.data";
+static const off_t kFileSize = 64 * 1024 * 1024;
+static const size_t kBlockSize = 4096;
+static const int kReads = 65536;
+static const uint32 kMaxBatch = 256;
+
+
+static uint32 sSeed = 1;
+
+
+static inline uint32
+next_random()
+{
+	sSeed = sSeed * 1103515245 + 12345;
+	return sSeed >> 8;
+}
+
+
+static inline off_t
+random_offset()
+{
+	return (off_t)(next_random() % (kFileSize / kBlockSize)) * kBlockSize;
+}
+
+
+static int
+create_file()
+{
+	int fd = open(kFileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "Creating %s failed: %s\n", kFileName,
+			strerror(errno));
+		exit(1);
+	}
+
+	// Every block starts with its offset, so that the reads can be checked.
+	char block[kBlockSize];
+	memset(block, 0, sizeof(block));
+	for (off_t offset = 0; offset < kFileSize; offset += kBlockSize) {
+		memcpy(block, &offset, sizeof(offset));
+		if (write(fd, block, kBlockSize) != (ssize_t)kBlockSize) {
+			fprintf(stderr, "Writing %s failed: %s\n", kFileName,
+				strerror(errno));
+			exit(1);
+		}
+	}
+
+	// read it once, so that both runs are served by the file cache
+	for (off_t offset = 0; offset < kFileSize; offset += kBlockSize)
+		pread(fd, block, kBlockSize, offset);
+
+	return fd;
+}
+
+
+static void
+check_block(const char* block, off_t offset)
+{
+	off_t blockOffset;
+	memcpy(&blockOffset, block, sizeof(blockOffset));
+	if (blockOffset != offset) {
+		fprintf(stderr, "Read the block at %lld instead of %lld\n",
+			(long long)blockOffset, (long long)offset);
+		exit(1);
+	}
+}
+
+
+static double
+run_pread(int fd)
+{
+	char block[kBlockSize];
+
+	sSeed = 1;
+	bigtime_t start = system_time();
+
+	for (int i = 0; i < kReads; i++) {
+		off_t offset = random_offset();
+		if (pread(fd, block, kBlockSize, offset) != (ssize_t)kBlockSize) {
+			fprintf(stderr, "pread() failed: %s\n", strerror(errno));
+			exit(1);
+		}
+		check_block(block, offset);
+	}
+
+	return (double)(system_time() - start) / kReads;
+}
+
+
+static double
+run_io_ring(int fd, uint32 batch)
+{
+	io_ring ring;
+	status_t status = io_ring_init(&ring, kMaxBatch, 0);
+	if (status != B_OK) {
+		fprintf(stderr, "Creating the I/O ring failed: %s\n",
+			strerror(status));
+		exit(1);
+	}
+
+	char* buffers = (char*)malloc(batch * kBlockSize);
+	off_t offsets[kMaxBatch];
+
+	sSeed = 1;
+	bigtime_t start = system_time();
+
+	for (int done = 0; done < kReads; done += batch) {
+		for (uint32 i = 0; i < batch; i++) {
+			offsets[i] = random_offset();
+			io_ring_prepare(io_ring_get_submission(&ring), B_IO_RING_READ, fd,
+				buffers + i * kBlockSize, kBlockSize, offsets[i], i);
+		}
+
+		if (io_ring_submit(&ring, batch, 0, 0) != (ssize_t)batch) {
+			fprintf(stderr, "Submitting the reads failed\n");
+			exit(1);
+		}
+
+		uint32 completed = 0;
+		while (completed < batch) {
+			io_ring_completion* completion;
+			io_ring_wait_completion(&ring, &completion, 0, 0);
+
+			uint32 index = (uint32)completion->user_data;
+			if (completion->result != (int64)kBlockSize) {
+				fprintf(stderr, "A read failed: %s\n",
+					strerror((status_t)completion->result));
+				exit(1);
+			}
+			check_block(buffers + index * kBlockSize, offsets[index]);
+
+			io_ring_advance_completions(&ring, 1);
+			completed++;
+		}
+	}
+
+	bigtime_t time = system_time() - start;
+
+	free(buffers);
+	io_ring_destroy(&ring);
+	return (double)time / kReads;
+}
+
+
+static bool
+check_operations()
+{
+	io_ring ring;
+	if (io_ring_init(&ring, 16, 2) != B_OK)
+		return false;
+
+	// a no-op and an unknown operation complete right away
+	io_ring_prepare(io_ring_get_submission(&ring), B_IO_RING_NOP, -1, NULL,
+		0, 0, 1);
+	io_ring_prepare(io_ring_get_submission(&ring), 200, -1, NULL, 0, 0, 2);
+	bool ok = io_ring_submit(&ring, 2, 0, 0) == 2;
+
+	io_ring_completion* completion = io_ring_peek_completion(&ring);
+	ok = ok && completion != NULL && completion->user_data == 1
+		&& completion->result == B_OK;
+	io_ring_advance_completions(&ring, 1);
+
+	completion = io_ring_peek_completion(&ring);
+	ok = ok && completion != NULL && completion->user_data == 2
+		&& completion->result == B_BAD_VALUE;
+	io_ring_advance_completions(&ring, 1);
+
+	// the rings can't be unmapped from under the kernel
+	ok = ok && delete_area(ring.area) != B_OK;
+
+	// waiting for anything but a socket, like the ring itself, fails
+	io_ring_prepare(io_ring_get_submission(&ring), B_IO_RING_RECV, ring.fd,
+		NULL, 0, -1, 4);
+	ok = ok && io_ring_submit(&ring, 1, 0, 0) == 1;
+
+	completion = io_ring_peek_completion(&ring);
+	ok = ok && completion != NULL && completion->user_data == 4
+		&& completion->result == ENOTSOCK;
+	io_ring_advance_completions(&ring, 1);
+
+	// a recv() only completes when there is something to receive
+	int sockets[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+		io_ring_destroy(&ring);
+		return false;
+	}
+
+	char buffer[16];
+	io_ring_prepare(io_ring_get_submission(&ring), B_IO_RING_RECV,
+		sockets[0], buffer, sizeof(buffer), -1, 3);
+	ok = ok && io_ring_submit(&ring, 0, 0, 0) == 1;
+
+	snooze(50000);
+	ok = ok && io_ring_peek_completion(&ring) == NULL;
+
+	pollfd pollInfo;
+	pollInfo.fd = ring.fd;
+	pollInfo.events = POLLIN;
+	ok = ok && poll(&pollInfo, 1, 0) == 0;
+
+	ok = ok && send(sockets[1], "hello", 5, 0) == 5;
+
+	// the ring's descriptor becomes readable with the completion
+	ok = ok && poll(&pollInfo, 1, 1000) == 1;
+
+	ok = ok && io_ring_wait_completion(&ring, &completion, 0, 0) == B_OK
+		&& completion->user_data == 3 && completion->result == 5
+		&& memcmp(buffer, "hello", 5) == 0;
+	io_ring_advance_completions(&ring, 1);
+
+	close(sockets[0]);
+	close(sockets[1]);
+	io_ring_destroy(&ring);
+	return ok;
+}
+
+
+int
+main()
+{
+	if (!check_operations()) {
+		fprintf(stderr, "The I/O ring didn't complete the operations "
+			"correctly\n");
+		return 1;
+	}
+
+	int fd = create_file();
+
+	printf("  batch  pread us/read  io ring us/read\n");
+
+	double preadTime = run_pread(fd);
+	for (uint32 batch = 1; batch <= kMaxBatch; batch *= 4) {
+		double ringTime = run_io_ring(fd, batch);
+		printf("%7" B_PRIu32 "  %13.2f  %15.2f\n", batch, preadTime,
+			ringTime);
+	}
+
+	close(fd);
+	unlink(kFileName);
+	return 0;
+}
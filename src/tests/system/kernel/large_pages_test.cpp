@@ -0,0 +1,138 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Compares random access times of a fully locked area mapped with small
+	pages against one mapped with large pages (B_LARGE_PAGES_AREA), and checks
+	that a large page is split by a partial protection change and collapsed
+	again, once the area is uniformly protected.
+*/
+
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+#include <extended_system_info.h>
+#include <extended_system_info_defs.h>
+#include <util/KMessage.h>
+#include <vm_defs.h>
+
+
+static const size_t kDefaultAreaSize = 256 * 1024 * 1024;
+static const int32 kAccessCount = 16 * 1024 * 1024;
+
+
+static int32
+large_page_count()
+{
+	KMessage info;
+	if (BPrivate::get_extended_team_info(getpid(), B_TEAM_INFO_BASIC, info)
+			!= B_OK) {
+		return -1;
+	}
+
+	int32 count;
+	if (info.FindInt32("large pages", &count) != B_OK)
+		return -1;
+
+	return count;
+}
+
+
+static double
+run_accesses(uint8* address, size_t size)
+{
+	const size_t* slots = (const size_t*)address;
+	size_t slotCount = size / sizeof(size_t);
+	size_t index = 0;
+
+	bigtime_t start = system_time();
+	for (int32 i = 0; i < kAccessCount; i++) {
+		// The area is cleared, but the next index depends on the value read,
+		// so that the accesses can't overlap.
+		index = (index * 1103515245 + 12345 + slots[index]) % slotCount;
+	}
+	bigtime_t time = system_time() - start;
+
+	return time * 1000.0 / kAccessCount;
+}
+
+
+static area_id
+create_test_area(size_t size, uint32 protection, uint8** _address)
+{
+	area_id area = create_area("large pages test", (void**)_address,
+		B_ANY_ADDRESS, size, B_FULL_LOCK, protection);
+	if (area < 0) {
+		fprintf(stderr, "Creating the area failed: %s\n", strerror(area));
+		exit(1);
+	}
+
+	return area;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	size_t size = kDefaultAreaSize;
+	if (argc > 1)
+		size = strtoul(argv[1], NULL, 0) * 1024 * 1024;
+
+	int32 initialCount = large_page_count();
+
+	uint8* address;
+	area_id area = create_test_area(size, B_READ_AREA | B_WRITE_AREA,
+		&address);
+	double small = run_accesses(address, size);
+	delete_area(area);
+
+	area = create_test_area(size,
+		B_READ_AREA | B_WRITE_AREA | B_LARGE_PAGES_AREA, &address);
+	int32 count = large_page_count() - initialCount;
+	double large = run_accesses(address, size);
+
+	printf("%" B_PRIuSIZE " MB area: small pages %.1f ns/access, "
+		"%" B_PRId32 " large pages %.1f ns/access\n", size / 1024 / 1024,
+		small, count, large);
+
+	if (count > 0) {
+		// changing the protection of a single page must split its large page
+		if (mprotect(address + B_PAGE_SIZE, B_PAGE_SIZE, PROT_READ) != 0) {
+			fprintf(stderr, "mprotect() failed: %s\n", strerror(errno));
+			return 1;
+		}
+
+		int32 splitCount = large_page_count() - initialCount;
+		if (splitCount != count - 1) {
+			fprintf(stderr, "expected %" B_PRId32 " large pages after split, "
+				"got %" B_PRId32 "\n", count - 1, splitCount);
+			return 1;
+		}
+
+		// reading must still work, the rest of the page is still writable
+		address[2 * B_PAGE_SIZE] = address[B_PAGE_SIZE];
+
+		// protecting the area uniformly again collapses the large page
+		set_area_protection(area, B_READ_AREA | B_WRITE_AREA);
+		int32 collapsedCount = large_page_count() - initialCount;
+		if (collapsedCount != count) {
+			fprintf(stderr, "expected %" B_PRId32 " large pages after "
+				"collapse, got %" B_PRId32 "\n", count, collapsedCount);
+			return 1;
+		}
+
+		printf("split and collapse: ok\n");
+	}
+
+	delete_area(area);
+	return 0;
+}
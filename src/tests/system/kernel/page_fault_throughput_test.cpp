@@ -0,0 +1,189 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures how many page faults per second a number of threads can resolve
+	in a single area, i.e. against the page index of a single VMCache.
+	The first pass faults in fresh anonymous pages, the second one soft faults
+	on pages that are already in the cache, but not mapped yet. Given a file,
+	read-only mappings of the file are used instead.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+static const size_t kDefaultAreaSize = 256 * 1024 * 1024;
+
+
+struct thread_data {
+	uint8*	address;
+	size_t	size;
+	bool	write;
+};
+
+
+static vint32 sStart;
+
+
+static status_t
+fault_thread(void* _data)
+{
+	thread_data* data = (thread_data*)_data;
+
+	while (atomic_get(&sStart) == 0)
+		snooze(100);
+
+	uint32 sum = 0;
+	for (size_t offset = 0; offset < data->size; offset += B_PAGE_SIZE) {
+		if (data->write)
+			data->address[offset] = 42;
+		else
+			sum += data->address[offset];
+	}
+
+	return sum;
+}
+
+
+static double
+run(uint8* address, size_t size, int32 threadCount, bool write)
+{
+	thread_id threads[B_MAX_CPU_COUNT * 2];
+	thread_data data[B_MAX_CPU_COUNT * 2];
+
+	sStart = 0;
+
+	// Interleave the threads' ranges in chunks, so that they all fault on
+	// neighbouring pages of the same cache.
+	size_t chunkSize = size / threadCount;
+	chunkSize -= chunkSize % B_PAGE_SIZE;
+
+	for (int32 i = 0; i < threadCount; i++) {
+		data[i].address = address + i * chunkSize;
+		data[i].size = chunkSize;
+		data[i].write = write;
+
+		threads[i] = spawn_thread(&fault_thread, "fault", B_NORMAL_PRIORITY,
+			&data[i]);
+		resume_thread(threads[i]);
+	}
+
+	bigtime_t start = system_time();
+	atomic_set(&sStart, 1);
+
+	for (int32 i = 0; i < threadCount; i++) {
+		status_t returnValue;
+		wait_for_thread(threads[i], &returnValue);
+	}
+
+	bigtime_t time = system_time() - start;
+	return (chunkSize / B_PAGE_SIZE) * threadCount * 1000000.0 / time;
+}
+
+
+struct mapping {
+	area_id	area;
+	uint8*	address;
+	size_t	size;
+};
+
+
+static bool
+map_area(const char* fileName, const mapping* source, mapping& _mapping)
+{
+	if (fileName == NULL) {
+		// anonymous memory -- clone the source area to get a new mapping of
+		// the same cache
+		if (source != NULL) {
+			_mapping.size = source->size;
+			_mapping.area = clone_area("fault test clone",
+				(void**)&_mapping.address, B_ANY_ADDRESS,
+				B_READ_AREA | B_WRITE_AREA, source->area);
+		} else {
+			_mapping.size = kDefaultAreaSize;
+			_mapping.area = create_area("fault test",
+				(void**)&_mapping.address, B_ANY_ADDRESS, _mapping.size,
+				B_NO_LOCK, B_READ_AREA | B_WRITE_AREA);
+		}
+		return _mapping.area >= 0;
+	}
+
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat stat;
+	if (fstat(fd, &stat) != 0) {
+		close(fd);
+		return false;
+	}
+
+	_mapping.area = -1;
+	_mapping.size = stat.st_size;
+	void* address = mmap(NULL, _mapping.size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	_mapping.address = (uint8*)address;
+	return address != MAP_FAILED;
+}
+
+
+static void
+unmap_area(mapping& mapping)
+{
+	if (mapping.area >= 0)
+		delete_area(mapping.area);
+	else
+		munmap(mapping.address, mapping.size);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	const char* fileName = argc > 1 ? argv[1] : NULL;
+
+	system_info info;
+	get_system_info(&info);
+
+	int32 maxThreads = min_c(info.cpu_count * 2, B_MAX_CPU_COUNT * 2);
+
+	printf("threads  faults/sec  soft faults/sec\n");
+
+	for (int32 threads = 1; threads <= maxThreads; threads *= 2) {
+		// The first mapping faults the pages into the cache (or, for a file
+		// already in the file cache, maps them), the second one only has to
+		// look them up in the cache and map them.
+		mapping first;
+		mapping second;
+		if (!map_area(fileName, NULL, first)
+			|| !map_area(fileName, &first, second)) {
+			fprintf(stderr, "Mapping the area failed: %s\n", strerror(errno));
+			return 1;
+		}
+
+		double faults = run(first.address, first.size, threads,
+			fileName == NULL);
+		double softFaults = run(second.address, second.size, threads, false);
+
+		printf("%7" B_PRId32 "  %10.0f  %15.0f\n", threads, faults,
+			softFaults);
+
+		unmap_area(second);
+		unmap_area(first);
+	}
+
+	return 0;
+}
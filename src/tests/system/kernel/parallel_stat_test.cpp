@@ -0,0 +1,122 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures how well path resolution scales with the number of threads that
+	concurrently stat() the same paths, existing and missing ones, i.e. mostly
+	hitting the entry cache.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <OS.h>
+
+
+static const char* const kPaths[] = {
+	"/boot/system/develop/headers/posix/sys/stat.h",
+	"/boot/system/develop/headers/os/kernel/OS.h",
+	"/boot/system/lib/libroot.so",
+	"/boot/system/develop/headers/posix/sys/does_not_exist.h",
+	"/boot/system/develop/headers/os/does_not_exist/OS.h",
+	NULL
+};
+
+static const bigtime_t kRunTime = 1000000;
+static const int32 kMaxThreads = 64;
+
+static sem_id sStartSemaphore;
+static volatile bool sStop;
+
+
+static status_t
+stat_thread(void* _count)
+{
+	int64* count = (int64*)_count;
+
+	acquire_sem(sStartSemaphore);
+
+	int64 calls = 0;
+	while (!sStop) {
+		for (int32 i = 0; kPaths[i] != NULL; i++) {
+			struct stat st;
+			stat(kPaths[i], &st);
+		}
+		calls++;
+	}
+
+	*count = calls * (sizeof(kPaths) / sizeof(kPaths[0]) - 1);
+	return B_OK;
+}
+
+
+static int64
+run(int32 threadCount)
+{
+	thread_id threads[kMaxThreads];
+	int64 counts[kMaxThreads];
+
+	sStop = false;
+	sStartSemaphore = create_sem(0, "start");
+
+	for (int32 i = 0; i < threadCount; i++) {
+		counts[i] = 0;
+		threads[i] = spawn_thread(&stat_thread, "stat", B_NORMAL_PRIORITY,
+			&counts[i]);
+		resume_thread(threads[i]);
+	}
+
+	release_sem_etc(sStartSemaphore, threadCount, 0);
+	snooze(kRunTime);
+	sStop = true;
+
+	int64 total = 0;
+	for (int32 i = 0; i < threadCount; i++) {
+		status_t result;
+		wait_for_thread(threads[i], &result);
+		total += counts[i];
+	}
+
+	delete_sem(sStartSemaphore);
+	return total;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	system_info info;
+	get_system_info(&info);
+
+	int32 maxThreads = info.cpu_count;
+	if (argc > 1)
+		maxThreads = atoi(argv[1]);
+	if (maxThreads < 1 || maxThreads > kMaxThreads) {
+		fprintf(stderr, "Usage: %s [ <max threads> ]\n", argv[0]);
+		return 1;
+	}
+
+	// warm up the caches
+	run(1);
+
+	int64 singleThreaded = 0;
+	for (int32 threads = 1; ; threads = min_c(threads * 2, maxThreads)) {
+		int64 calls = run(threads);
+		if (threads == 1)
+			singleThreaded = calls;
+
+		printf("%3" B_PRId32 " threads: %10" B_PRId64 " stat()/s, %6.2f x\n",
+			threads, calls * 1000000 / kRunTime,
+			singleThreaded > 0 ? (double)calls / singleThreaded : 0.0);
+
+		if (threads == maxThreads)
+			break;
+	}
+
+	return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures the bandwidth of ports by message size, once with messages
+	copied into the reader's buffer, and once with B_REMAP_PORT_MESSAGE, which
+	lets the kernel move the pages of large messages into the buffer instead.
+	Also checks that the data arrives intact either way.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include <port_defs.h>
+
+
+static const size_t kMaxMessageSize = 256 * 1024;
+static const size_t kBytesPerRun = 256 * 1024 * 1024;
+
+
+struct writer_data {
+	port_id	port;
+	uint8*	buffer;
+	size_t	size;
+	int32	count;
+};
+
+
+static status_t
+writer_thread(void* _data)
+{
+	writer_data* data = (writer_data*)_data;
+
+	for (int32 i = 0; i < data->count; i++) {
+		// stamp the message, so that the reader can check it
+		data->buffer[0] = (uint8)i;
+		data->buffer[data->size - 1] = (uint8)~i;
+
+		status_t status = write_port(data->port, i, data->buffer, data->size);
+		if (status != B_OK)
+			return status;
+	}
+
+	return B_OK;
+}
+
+
+static double
+run(size_t size, uint32 flags, uint8* readBuffer)
+{
+	port_id port = create_port(8, "bandwidth test");
+	if (port < 0) {
+		fprintf(stderr, "Creating the port failed: %s\n", strerror(port));
+		exit(1);
+	}
+
+	writer_data data;
+	data.port = port;
+	data.buffer = (uint8*)malloc(size);
+	data.size = size;
+	data.count = kBytesPerRun / size;
+	memset(data.buffer, 0x55, size);
+
+	thread_id thread = spawn_thread(&writer_thread, "writer",
+		B_NORMAL_PRIORITY, &data);
+	resume_thread(thread);
+
+	bigtime_t start = system_time();
+
+	for (int32 i = 0; i < data.count; i++) {
+		int32 code;
+		ssize_t bytesRead = read_port_etc(port, &code, readBuffer, size,
+			flags, 0);
+		if (bytesRead != (ssize_t)size || code != i
+			|| readBuffer[0] != (uint8)i
+			|| readBuffer[size / 2] != 0x55
+			|| readBuffer[size - 1] != (uint8)~i) {
+			fprintf(stderr, "message %" B_PRId32 " of %" B_PRIuSIZE " bytes "
+				"is broken: %s\n", i, size,
+				bytesRead < 0 ? strerror(bytesRead) : "bad data");
+			exit(1);
+		}
+	}
+
+	bigtime_t time = system_time() - start;
+
+	status_t returnValue;
+	wait_for_thread(thread, &returnValue);
+	delete_port(port);
+	free(data.buffer);
+
+	return (double)data.count * size / time;
+		// bytes per microsecond equal MB/s
+}
+
+
+int
+main()
+{
+	// A private anonymous area, so that pages can be moved into it
+	uint8* readBuffer;
+	area_id area = create_area("read buffer", (void**)&readBuffer,
+		B_ANY_ADDRESS, kMaxMessageSize, B_NO_LOCK,
+		B_READ_AREA | B_WRITE_AREA);
+	if (area < 0) {
+		fprintf(stderr, "Creating the area failed: %s\n", strerror(area));
+		return 1;
+	}
+
+	printf("    size  copy MB/s  remap MB/s\n");
+
+	for (size_t size = 1024; size <= kMaxMessageSize; size *= 2) {
+		double copy = run(size, 0, readBuffer);
+		double remap = run(size, B_REMAP_PORT_MESSAGE, readBuffer);
+
+		printf("%8" B_PRIuSIZE "  %9.0f  %10.0f\n", size, copy, remap);
+	}
+
+	delete_area(area);
+	return 0;
+}
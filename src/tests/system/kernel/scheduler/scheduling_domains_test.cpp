@@ -0,0 +1,381 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Replays synthetic loads on fake CPU topologies through the scheduler's
+	SchedulingDomains, and checks that the loads are balanced within the
+	cheapest domain possible, that the balancing settles down, that new
+	threads make the nodes they are spread over their home, and that threads
+	end up on their home node.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SupportDefs.h>
+
+#include "SchedulingDomains.h"
+
+
+static const int32 kMaxLoad = 1000;
+static const int32 kHighLoad = kMaxLoad * 70 / 100;
+static const int32 kLoadDifference = kMaxLoad * 20 / 100;
+static const int32 kMaxCores = 64;
+static const int32 kMaxThreads = 256;
+static const int32 kRounds = 100;
+
+
+struct Core {
+	int32	cpuCount;
+	int32	load;
+	int32	topologyIDs[SCHEDULING_DOMAIN_LEVELS];
+
+	int32 CPUCount() const	{ return cpuCount; }
+	int32 GetLoad() const	{ return load / cpuCount; }
+	bool IsIdle() const		{ return cpuCount > 0 && load == 0; }
+};
+
+typedef SchedulingDomains<Core> Domains;
+
+
+struct topology {
+	const char*	name;
+	int32		nodes;
+	int32		llcsPerNode;
+	int32		coresPerLLC;
+	int32		smt;
+};
+
+struct workload {
+	const char*	name;
+	int32		threadCount;
+		// per core
+	int32		minLoad;
+	int32		maxLoad;
+	bool		startOnOneCore;
+	bool		remoteHome;
+		// the threads' home node is not where they start
+};
+
+struct thread {
+	Core*	core;
+	int32	load;
+	int32	homeNode;
+};
+
+struct statistics {
+	int32	migrations[SCHEDULING_DOMAIN_LEVELS + 1];
+	int32	lastRoundMigrations;
+	int32	spread;
+	int32	awayFromHome;
+	int32	homeNodes;
+		// the number of nodes that are home to any thread
+};
+
+
+static const topology kTopologies[] = {
+	{ "desktop", 1, 1, 8, 2 },
+	{ "split llc", 1, 4, 4, 2 },
+	{ "dual socket", 2, 1, 8, 2 },
+	{ "numa split llc", 2, 4, 4, 1 },
+	{ "quad socket", 4, 1, 4, 2 },
+};
+
+static const workload kWorkloads[] = {
+	{ "burst", 2, 250, 250, true, false },
+	{ "mixed", 3, 20, 600, false, false },
+	{ "remote", 1, 100, 300, true, true },
+};
+
+
+static Core sCores[kMaxCores];
+static int32 sCoreCount;
+static thread sThreads[kMaxThreads];
+static int32 sThreadCount;
+static uint32 sSeed;
+
+
+static inline uint32
+next_random()
+{
+	sSeed = sSeed * 1103515245 + 12345;
+	return sSeed >> 8;
+}
+
+
+static void
+build_topology(const topology& topology)
+{
+	sCoreCount = topology.nodes * topology.llcsPerNode * topology.coresPerLLC;
+
+	for (int32 i = 0; i < sCoreCount; i++) {
+		Core& core = sCores[i];
+		core.cpuCount = topology.smt;
+		core.load = 0;
+
+		int32 llc = i / topology.coresPerLLC;
+		int32 node = llc / topology.llcsPerNode;
+		core.topologyIDs[SCHEDULING_DOMAIN_LLC] = llc;
+		core.topologyIDs[SCHEDULING_DOMAIN_PACKAGE] = node;
+		core.topologyIDs[SCHEDULING_DOMAIN_NODE] = node;
+	}
+}
+
+
+static Core*
+least_loaded_core()
+{
+	Core* leastLoaded = &sCores[0];
+	for (int32 i = 1; i < sCoreCount; i++) {
+		if (sCores[i].GetLoad() < leastLoaded->GetLoad())
+			leastLoaded = &sCores[i];
+	}
+
+	return leastLoaded;
+}
+
+
+static void
+add_thread(Core* core, int32 load, int32 homeNode)
+{
+	thread& thread = sThreads[sThreadCount++];
+	thread.core = core;
+	thread.load = load;
+	thread.homeNode = homeNode;
+
+	core->load += load;
+}
+
+
+/*!	Returns the level of the smallest domain containing both cores, or
+	SCHEDULING_DOMAIN_LEVELS if they only share the system.
+*/
+static int32
+common_level(const Core* a, const Core* b)
+{
+	for (int32 level = 0; level < SCHEDULING_DOMAIN_LEVELS; level++) {
+		if (a->topologyIDs[level] == b->topologyIDs[level])
+			return level;
+	}
+
+	return SCHEDULING_DOMAIN_LEVELS;
+}
+
+
+static void
+place_threads(const Domains& domains, const workload& workload)
+{
+	sThreadCount = 0;
+	int32 threadCount = workload.threadCount * sCoreCount;
+
+	for (int32 i = 0; i < threadCount && sThreadCount < kMaxThreads; i++) {
+		int32 load = workload.minLoad;
+		if (workload.maxLoad > workload.minLoad)
+			load += next_random() % (workload.maxLoad - workload.minLoad);
+
+		if (workload.startOnOneCore) {
+			// everything is started from the same core, like a build job
+			// spawning its workers
+			int32 homeNode = domains.NodeOf(&sCores[0]);
+			if (workload.remoteHome)
+				homeNode = domains.NodeCount() - 1;
+			add_thread(&sCores[0], load, homeNode);
+			continue;
+		}
+
+		// the threads are new, and get their home node where they first run
+		Core* core = domains.ChooseIdleCore(NULL, -1);
+		if (core == NULL)
+			core = least_loaded_core();
+		add_thread(core, load, domains.HomeNodeOf(core, -1));
+	}
+}
+
+
+static void
+run(const Domains& domains, statistics& stats)
+{
+	memset(&stats, 0, sizeof(stats));
+
+	for (int32 round = 0; round < kRounds; round++) {
+		int32 migrations = 0;
+
+		for (int32 i = 0; i < sThreadCount; i++) {
+			thread& thread = sThreads[next_random() % sThreadCount];
+			Core* core = thread.core;
+
+			Core* target = domains.Rebalance(core, least_loaded_core(),
+				thread.load / core->CPUCount(), kLoadDifference,
+				thread.homeNode);
+			if (target == core)
+				continue;
+
+			core->load -= thread.load;
+			target->load += thread.load;
+			thread.core = target;
+
+			stats.migrations[common_level(core, target)]++;
+			migrations++;
+		}
+
+		stats.lastRoundMigrations = migrations;
+	}
+
+	int32 minLoad = kMaxLoad * 100;
+	int32 maxLoad = 0;
+	for (int32 i = 0; i < sCoreCount; i++) {
+		minLoad = min_c(minLoad, sCores[i].GetLoad());
+		maxLoad = max_c(maxLoad, sCores[i].GetLoad());
+	}
+	stats.spread = maxLoad - minLoad;
+
+	bool isHome[kMaxCores] = {};
+	for (int32 i = 0; i < sThreadCount; i++) {
+		if (domains.NodeOf(sThreads[i].core) != sThreads[i].homeNode)
+			stats.awayFromHome++;
+
+		if (!isHome[sThreads[i].homeNode]) {
+			isHome[sThreads[i].homeNode] = true;
+			stats.homeNodes++;
+		}
+	}
+}
+
+
+static bool
+check_domains(const topology& topology, const Domains& domains)
+{
+	int32 coresPerNode = topology.llcsPerNode * topology.coresPerLLC;
+
+	for (int32 i = 0; i < sCoreCount; i++) {
+		const Domains::Domain* llc
+			= domains.DomainOf(&sCores[i], SCHEDULING_DOMAIN_LLC);
+		const Domains::Domain* package
+			= domains.DomainOf(&sCores[i], SCHEDULING_DOMAIN_PACKAGE);
+
+		// Domains spanning all cores or the same cores as their child are
+		// left out, and as there is a package per node, the node domains
+		// always are.
+		bool expectLLC = topology.coresPerLLC > 1
+			&& topology.coresPerLLC < sCoreCount;
+		bool expectPackage = topology.nodes > 1 && topology.llcsPerNode > 1;
+
+		if ((llc != NULL) != expectLLC || (package != NULL) != expectPackage
+			|| domains.DomainOf(&sCores[i], SCHEDULING_DOMAIN_NODE) != NULL) {
+			fprintf(stderr, "%s: core %" B_PRId32 " has the wrong domains\n",
+				topology.name, i);
+			return false;
+		}
+
+		if (domains.NodeOf(&sCores[i]) != i / coresPerNode) {
+			fprintf(stderr, "%s: core %" B_PRId32 " is on the wrong node\n",
+				topology.name, i);
+			return false;
+		}
+	}
+
+	return domains.NodeCount() == topology.nodes;
+}
+
+
+int
+main()
+{
+	bool failed = false;
+
+	printf("topology        workload  llc  package  node  system  spread  "
+		"last round  away\n");
+
+	for (size_t i = 0; i < sizeof(kTopologies) / sizeof(kTopologies[0]);
+			i++) {
+		const topology& topology = kTopologies[i];
+
+		for (size_t j = 0; j < sizeof(kWorkloads) / sizeof(kWorkloads[0]);
+				j++) {
+			const workload& workload = kWorkloads[j];
+			sSeed = i * 7919 + j + 1;
+
+			build_topology(topology);
+
+			int32 topologyIDs[kMaxCores * SCHEDULING_DOMAIN_LEVELS];
+			for (int32 k = 0; k < sCoreCount; k++) {
+				memcpy(&topologyIDs[k * SCHEDULING_DOMAIN_LEVELS],
+					sCores[k].topologyIDs, sizeof(sCores[k].topologyIDs));
+			}
+
+			Domains domains;
+			if (domains.Init(sCores, sCoreCount, topologyIDs, kHighLoad)
+					!= B_OK) {
+				fprintf(stderr, "initializing the domains failed\n");
+				return 1;
+			}
+
+			if (!check_domains(topology, domains)) {
+				failed = true;
+				continue;
+			}
+
+			place_threads(domains, workload);
+
+			statistics stats;
+			run(domains, stats);
+
+			printf("%-15s %-8s %4" B_PRId32 " %8" B_PRId32 " %5" B_PRId32
+				" %7" B_PRId32 " %7" B_PRId32 " %11" B_PRId32 " %5" B_PRId32
+				"\n", topology.name, workload.name,
+				stats.migrations[SCHEDULING_DOMAIN_LLC],
+				stats.migrations[SCHEDULING_DOMAIN_PACKAGE],
+				stats.migrations[SCHEDULING_DOMAIN_NODE],
+				stats.migrations[SCHEDULING_DOMAIN_LEVELS], stats.spread,
+				stats.lastRoundMigrations, stats.awayFromHome);
+
+			// the balancing has to settle down
+			if (stats.lastRoundMigrations != 0) {
+				fprintf(stderr, "%s/%s: threads are still migrating\n",
+					topology.name, workload.name);
+				failed = true;
+			}
+
+			// new threads spread over all nodes, and have to stay there
+			if (!workload.startOnOneCore
+				&& (stats.homeNodes != topology.nodes
+					|| stats.awayFromHome != 0)) {
+				fprintf(stderr, "%s/%s: the threads are home on %" B_PRId32
+					" nodes, %" B_PRId32 " of them are elsewhere\n",
+					topology.name, workload.name, stats.homeNodes,
+					stats.awayFromHome);
+				failed = true;
+			}
+
+			// the loads fit on the home node, so nothing should stay away
+			if (workload.remoteHome && stats.awayFromHome != 0) {
+				fprintf(stderr, "%s/%s: %" B_PRId32 " threads are not on their "
+					"home node\n", topology.name, workload.name,
+					stats.awayFromHome);
+				failed = true;
+			}
+
+			// a burst of equal threads has to be spread until no migration
+			// is worth it anymore
+			int32 maxSpread = Domains::MigrationThreshold(topology.nodes > 1
+					? SCHEDULING_DOMAIN_NODE : SCHEDULING_DOMAIN_PACKAGE,
+				kLoadDifference) + workload.maxLoad / topology.smt;
+			if (workload.startOnOneCore && !workload.remoteHome
+				&& stats.spread > maxSpread) {
+				fprintf(stderr, "%s/%s: load spread %" B_PRId32 " is too "
+					"large\n", topology.name, workload.name, stats.spread);
+				failed = true;
+			}
+		}
+	}
+
+	if (failed)
+		return 1;
+
+	printf("ok\n");
+	return 0;
+}
@@ -0,0 +1,292 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Compares sending a cached file over a TCP loopback connection with
+	read()/write() to sending it with sendfile(). Also checks that splice()
+	copies between files at the given offsets, and moves data from a pipe
+	into a local and a TCP socket.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+static const char* kFileName = "/tmp/sendfile_test.data";
+static const char* kCopyName = "/tmp/sendfile_test.copy";
+static const off_t kFileSize = 64 * 1024 * 1024;
+static const size_t kBufferSize = 64 * 1024;
+static const int kRuns = 4;
+
+
+struct receiver {
+	int		socket;
+	off_t	bytesReceived;
+};
+
+
+static status_t
+receive_thread(void* data)
+{
+	receiver* info = (receiver*)data;
+	char buffer[kBufferSize];
+
+	while (true) {
+		ssize_t bytesRead = recv(info->socket, buffer, sizeof(buffer), 0);
+		if (bytesRead <= 0)
+			break;
+
+		info->bytesReceived += bytesRead;
+	}
+
+	return B_OK;
+}
+
+
+static void
+fail(const char* what)
+{
+	fprintf(stderr, "%s failed: %s\n", what, strerror(errno));
+	exit(1);
+}
+
+
+static int
+create_file()
+{
+	int fd = open(kFileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		fail("Creating the file");
+
+	char buffer[kBufferSize];
+	for (size_t i = 0; i < sizeof(buffer); i++)
+		buffer[i] = (char)i;
+
+	for (off_t offset = 0; offset < kFileSize; offset += sizeof(buffer)) {
+		if (write(fd, buffer, sizeof(buffer)) != (ssize_t)sizeof(buffer))
+			fail("Writing the file");
+	}
+
+	// read it once, so that all runs are served by the file cache
+	lseek(fd, 0, SEEK_SET);
+	while (read(fd, buffer, sizeof(buffer)) > 0)
+		;
+
+	return fd;
+}
+
+
+/*!	Connects two TCP sockets over the loopback interface, and starts a thread
+	that drains the receiving end. Returns the sending end.
+*/
+static int
+connect_loopback(receiver& info, thread_id& thread)
+{
+	int listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+	if (listenSocket < 0)
+		fail("socket()");
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_len = sizeof(address);
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	socklen_t addressLength = sizeof(address);
+	if (bind(listenSocket, (sockaddr*)&address, sizeof(address)) != 0
+		|| listen(listenSocket, 1) != 0
+		|| getsockname(listenSocket, (sockaddr*)&address, &addressLength)
+			!= 0) {
+		fail("Listening");
+	}
+
+	int sendSocket = socket(AF_INET, SOCK_STREAM, 0);
+	if (sendSocket < 0
+		|| connect(sendSocket, (sockaddr*)&address, sizeof(address)) != 0) {
+		fail("connect()");
+	}
+
+	info.socket = accept(listenSocket, NULL, NULL);
+	if (info.socket < 0)
+		fail("accept()");
+	close(listenSocket);
+
+	info.bytesReceived = 0;
+	thread = spawn_thread(&receive_thread, "receiver", B_NORMAL_PRIORITY,
+		&info);
+	resume_thread(thread);
+
+	return sendSocket;
+}
+
+
+static void
+finish_transfer(int sendSocket, receiver& info, thread_id thread,
+	off_t expected)
+{
+	close(sendSocket);
+
+	status_t result;
+	wait_for_thread(thread, &result);
+	close(info.socket);
+
+	if (info.bytesReceived != expected) {
+		fprintf(stderr, "Received %lld bytes instead of %lld\n",
+			(long long)info.bytesReceived, (long long)expected);
+		exit(1);
+	}
+}
+
+
+static double
+run_read_write(int fd)
+{
+	receiver info;
+	thread_id thread;
+	int sendSocket = connect_loopback(info, thread);
+
+	char buffer[kBufferSize];
+	bigtime_t start = system_time();
+
+	for (off_t offset = 0; offset < kFileSize; offset += sizeof(buffer)) {
+		if (pread(fd, buffer, sizeof(buffer), offset)
+				!= (ssize_t)sizeof(buffer)) {
+			fail("pread()");
+		}
+
+		size_t bytesWritten = 0;
+		while (bytesWritten < sizeof(buffer)) {
+			ssize_t bytes = write(sendSocket, buffer + bytesWritten,
+				sizeof(buffer) - bytesWritten);
+			if (bytes < 0)
+				fail("write()");
+			bytesWritten += bytes;
+		}
+	}
+
+	bigtime_t time = system_time() - start;
+	finish_transfer(sendSocket, info, thread, kFileSize);
+
+	return kFileSize / (double)time;
+}
+
+
+static double
+run_sendfile(int fd)
+{
+	receiver info;
+	thread_id thread;
+	int sendSocket = connect_loopback(info, thread);
+
+	bigtime_t start = system_time();
+
+	off_t offset = 0;
+	while (offset < kFileSize) {
+		if (sendfile(sendSocket, fd, &offset, kFileSize - offset) <= 0)
+			fail("sendfile()");
+	}
+
+	bigtime_t time = system_time() - start;
+	finish_transfer(sendSocket, info, thread, kFileSize);
+
+	return kFileSize / (double)time;
+}
+
+
+static bool
+check_splice(int fd)
+{
+	// file to file at the given offsets, leaving the file positions alone
+	int copy = open(kCopyName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (copy < 0)
+		return false;
+
+	off_t inOffset = 1000;
+	off_t outOffset = 10;
+	bool ok = splice(fd, &inOffset, copy, &outOffset, 100000, 0) == 100000
+		&& inOffset == 101000 && outOffset == 100010
+		&& lseek(fd, 0, SEEK_CUR) == kFileSize
+		&& lseek(copy, 0, SEEK_CUR) == 0;
+
+	char expected[256];
+	char buffer[256];
+	ok = ok && pread(fd, expected, sizeof(expected), 1000)
+			== (ssize_t)sizeof(expected)
+		&& pread(copy, buffer, sizeof(buffer), 10) == (ssize_t)sizeof(buffer)
+		&& memcmp(buffer, expected, sizeof(buffer)) == 0;
+
+	// unknown flags are rejected
+	ok = ok && splice(fd, NULL, copy, NULL, 100, 0x1000) < 0
+		&& errno == B_BAD_VALUE;
+
+	close(copy);
+	unlink(kCopyName);
+
+	// pipe to socket
+	int pipes[2];
+	int sockets[2];
+	if (!ok || pipe(pipes) != 0
+		|| socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+		return false;
+	}
+
+	ok = write(pipes[1], "hello, world", 12) == 12
+		&& splice(pipes[0], NULL, sockets[0], NULL, 12, 0) == 12
+		&& recv(sockets[1], buffer, sizeof(buffer), 0) == 12
+		&& memcmp(buffer, "hello, world", 12) == 0;
+
+	close(sockets[0]);
+	close(sockets[1]);
+
+	// pipe to TCP socket, which reads straight into the network buffers
+	if (ok) {
+		receiver info;
+		thread_id thread;
+		int sendSocket = connect_loopback(info, thread);
+
+		ok = write(pipes[1], "hello, world", 12) == 12
+			&& splice(pipes[0], NULL, sendSocket, NULL, 12, 0) == 12;
+
+		finish_transfer(sendSocket, info, thread, ok ? 12 : 0);
+	}
+
+	close(pipes[0]);
+	close(pipes[1]);
+	return ok;
+}
+
+
+int
+main()
+{
+	int fd = create_file();
+
+	if (!check_splice(fd)) {
+		fprintf(stderr, "splice() didn't transfer the data correctly\n");
+		return 1;
+	}
+
+	printf("  read/write MB/s  sendfile MB/s\n");
+
+	for (int i = 0; i < kRuns; i++) {
+		double readWriteRate = run_read_write(fd);
+		double sendfileRate = run_sendfile(fd);
+		printf("  %15.1f  %13.1f\n", readWriteRate, sendfileRate);
+	}
+
+	close(fd);
+	unlink(kFileName);
+	return 0;
+}
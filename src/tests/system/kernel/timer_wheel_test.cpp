@@ -0,0 +1,282 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures the add/cancel throughput of the kernel's TimerWheel with 100000
+	armed timers, compared to the sorted list it replaced, and checks that the
+	wheel expires timers in order, never late, that it finds the timers to be
+	removed, and that its next deadline is never later than the first timer.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <OS.h>
+
+#include <util/TimerWheel.h>
+
+
+static const int32 kTimerCount = 100000;
+static const int32 kWheelOperations = 20000;
+static const int32 kListOperations = 2000;
+static const bigtime_t kMaxTimeout = 10000000;
+
+
+struct Timer {
+	Timer*	next;
+	Timer**	prev_link;
+	int64	schedule_time;
+	bool	canceled;
+};
+
+typedef TimerWheel<Timer> Wheel;
+
+
+static Timer sTimers[kTimerCount];
+static uint32 sSeed = 1;
+
+
+static inline uint32
+next_random()
+{
+	sSeed = sSeed * 1103515245 + 12345;
+	return sSeed >> 8;
+}
+
+
+static inline bigtime_t
+random_timeout()
+{
+	return ((bigtime_t)next_random() << 8 | (next_random() & 0xff))
+		% kMaxTimeout;
+}
+
+
+// #pragma mark - sorted list
+
+
+static void
+list_add(Timer** list, Timer* timer)
+{
+	Timer** link = list;
+	while (*link != NULL && (*link)->schedule_time < timer->schedule_time)
+		link = &(*link)->next;
+
+	timer->next = *link;
+	*link = timer;
+}
+
+
+static void
+list_cancel(Timer** list, Timer* timer)
+{
+	for (Timer** link = list; *link != NULL; link = &(*link)->next) {
+		if (*link == timer) {
+			*link = timer->next;
+			return;
+		}
+	}
+}
+
+
+static int
+compare_timers(const void* _a, const void* _b)
+{
+	const Timer* a = (const Timer*)_a;
+	const Timer* b = (const Timer*)_b;
+	if (a->schedule_time == b->schedule_time)
+		return 0;
+	return a->schedule_time < b->schedule_time ? -1 : 1;
+}
+
+
+static double
+run_list(bigtime_t now)
+{
+	// sort the timers up front, adding them one by one would take ages
+	for (int32 i = 0; i < kTimerCount; i++)
+		sTimers[i].schedule_time = now + random_timeout();
+	qsort(sTimers, kTimerCount, sizeof(Timer), &compare_timers);
+
+	Timer* list = NULL;
+	for (int32 i = kTimerCount - 1; i >= 0; i--) {
+		sTimers[i].next = list;
+		list = &sTimers[i];
+	}
+
+	bigtime_t start = system_time();
+
+	for (int32 i = 0; i < kListOperations; i++) {
+		Timer* timer = &sTimers[next_random() % kTimerCount];
+		list_cancel(&list, timer);
+		timer->schedule_time = now + random_timeout();
+		list_add(&list, timer);
+	}
+
+	return (double)(system_time() - start) * 1000 / kListOperations;
+}
+
+
+// #pragma mark - wheel
+
+
+static double
+run_wheel(bigtime_t now)
+{
+	Wheel* wheel = new Wheel;
+	wheel->Init(now);
+
+	for (int32 i = 0; i < kTimerCount; i++) {
+		sTimers[i].schedule_time = now + random_timeout();
+		wheel->Add(&sTimers[i]);
+	}
+
+	bigtime_t start = system_time();
+
+	for (int32 i = 0; i < kWheelOperations; i++) {
+		Timer* timer = &sTimers[next_random() % kTimerCount];
+		wheel->Remove(timer);
+		timer->schedule_time = now + random_timeout();
+		wheel->Add(timer);
+	}
+
+	double time = (double)(system_time() - start) * 1000 / kWheelOperations;
+
+	delete wheel;
+	return time;
+}
+
+
+struct FirstTimerFinder {
+	bigtime_t	first;
+	int32		count;
+
+	FirstTimerFinder()
+		:
+		first(B_INFINITE_TIMEOUT),
+		count(0)
+	{
+	}
+
+	bool operator()(Timer* timer)
+	{
+		if (timer->schedule_time < first)
+			first = timer->schedule_time;
+		count++;
+		return false;
+	}
+};
+
+
+static bool
+check_wheel()
+{
+	static const int32 kCount = 5000;
+
+	Wheel* wheel = new Wheel;
+	bigtime_t now = 1000000;
+	wheel->Init(now);
+
+	for (int32 i = 0; i < kCount; i++) {
+		// mix near timers, far ones beyond the range of the wheel, and a few
+		// that are already due
+		Timer& timer = sTimers[i];
+		switch (next_random() % 8) {
+			case 0:
+				timer.schedule_time = now - 10;
+				break;
+			case 1:
+				timer.schedule_time = now + (bigtime_t)(next_random() % 64)
+					* 7 * 24 * 3600 * 1000000;
+				break;
+			default:
+				timer.schedule_time = now + random_timeout();
+				break;
+		}
+		timer.canceled = false;
+		wheel->Add(&timer);
+	}
+
+	int32 expired = 0;
+	int32 canceled = 0;
+	bigtime_t end = now + (bigtime_t)64 * 7 * 24 * 3600 * 1000000;
+	bool ok = true;
+
+	while (now <= end && ok) {
+		bigtime_t last = 0;
+		while (Timer* timer = wheel->RemoveExpired(now)) {
+			if (timer->schedule_time >= now || timer->schedule_time < last
+				|| timer->canceled) {
+				fprintf(stderr, "timer %p expired wrongly at %lld\n", timer,
+					(long long)now);
+				ok = false;
+			}
+			last = timer->schedule_time;
+			timer->canceled = true;
+			expired++;
+		}
+
+		// cancel a timer now and then; the wheel must only find the ones
+		// that are still in it
+		Timer& timer = sTimers[next_random() % kCount];
+		if (wheel->Remove(&timer) == timer.canceled) {
+			fprintf(stderr, "timer %p %s found for removal at %lld\n", &timer,
+				timer.canceled ? "wrongly" : "not", (long long)now);
+			ok = false;
+		}
+		if (!timer.canceled) {
+			timer.canceled = true;
+			canceled++;
+		}
+
+		FirstTimerFinder finder;
+		wheel->VisitAll(finder);
+		if (finder.first < now) {
+			fprintf(stderr, "timer at %lld missed at %lld\n",
+				(long long)finder.first, (long long)now);
+			ok = false;
+		}
+
+		bigtime_t deadline = wheel->NextDeadline();
+		if (deadline > finder.first) {
+			fprintf(stderr, "next deadline %lld is after the first timer at "
+				"%lld\n", (long long)deadline, (long long)finder.first);
+			ok = false;
+		}
+
+		if (finder.count == 0)
+			break;
+
+		// like the timer interrupt, wake up at the next deadline, but also
+		// a bit late sometimes
+		now = max_c(now, deadline) + next_random() % 3000;
+	}
+
+	if (ok && expired + canceled != kCount) {
+		fprintf(stderr, "%" B_PRId32 " timers got lost\n",
+			kCount - expired - canceled);
+		ok = false;
+	}
+
+	delete wheel;
+	return ok;
+}
+
+
+int
+main()
+{
+	if (!check_wheel())
+		return 1;
+
+	bigtime_t now = system_time();
+
+	printf("%" B_PRId32 " armed timers, cancel and add again:\n", kTimerCount);
+	printf("  sorted list  %10.1f ns/operation\n", run_list(now));
+	printf("  timer wheel  %10.1f ns/operation\n", run_wheel(now));
+
+	return 0;
+}
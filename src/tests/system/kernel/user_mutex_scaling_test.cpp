@@ -0,0 +1,108 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Runs a growing number of independent pthread mutexes, each contended by
+	two threads, so that the handovers go through the kernel's user mutex
+	wait table. Since the mutexes are unrelated, the throughput per mutex
+	should not drop as long as there are enough CPUs.
+*/
+
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <OS.h>
+
+
+static const int kMaxMutexes = 64;
+static const bigtime_t kRunTime = 1000000;
+
+
+struct mutex_data {
+	pthread_mutex_t	mutex;
+	int64			counter;
+	char			padding[64];
+		// keep the mutexes on separate cache lines
+};
+
+
+static mutex_data sMutexes[kMaxMutexes];
+static volatile bool sStop;
+
+
+static void*
+worker(void* _data)
+{
+	mutex_data* data = (mutex_data*)_data;
+
+	while (!sStop) {
+		pthread_mutex_lock(&data->mutex);
+		data->counter++;
+		pthread_mutex_unlock(&data->mutex);
+	}
+
+	return NULL;
+}
+
+
+static double
+run(int mutexCount)
+{
+	pthread_t threads[kMaxMutexes * 2];
+
+	for (int i = 0; i < mutexCount; i++) {
+		pthread_mutex_init(&sMutexes[i].mutex, NULL);
+		sMutexes[i].counter = 0;
+	}
+
+	sStop = false;
+
+	for (int i = 0; i < mutexCount * 2; i++) {
+		if (pthread_create(&threads[i], NULL, &worker, &sMutexes[i / 2])
+				!= 0) {
+			fprintf(stderr, "Creating a thread failed\n");
+			exit(1);
+		}
+	}
+
+	snooze(kRunTime);
+	sStop = true;
+
+	int64 total = 0;
+	for (int i = 0; i < mutexCount * 2; i++)
+		pthread_join(threads[i], NULL);
+
+	for (int i = 0; i < mutexCount; i++) {
+		total += sMutexes[i].counter;
+		pthread_mutex_destroy(&sMutexes[i].mutex);
+	}
+
+	return (double)total * 1000000 / kRunTime;
+}
+
+
+int
+main()
+{
+	system_info info;
+	get_system_info(&info);
+
+	int maxMutexes = info.cpu_count;
+	if (maxMutexes > kMaxMutexes)
+		maxMutexes = kMaxMutexes;
+
+	printf("%d CPUs\n", (int)info.cpu_count);
+	printf("mutexes  threads     locks/s  locks/s per mutex\n");
+
+	for (int count = 1; count <= maxMutexes; count *= 2) {
+		double locks = run(count);
+		printf("%7d  %7d  %10.0f  %17.0f\n", count, count * 2, locks,
+			locks / count);
+	}
+
+	return 0;
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Creates and removes files from a growing number of threads at once, to
+	measure how well the file system's transactions scale. Each thread uses
+	its own directory, unless they are told to share one.
+*/
+
+
+#include "command_create_unlink.h"
+
+#include <stdlib.h>
+
+#include "fssh_errors.h"
+#include "fssh_fcntl.h"
+#include "fssh_kernel_export.h"
+#include "fssh_os.h"
+#include "fssh_stdio.h"
+#include "fssh_string.h"
+#include "syscalls.h"
+
+
+namespace FSShell {
+
+
+static const char* kBaseDirectory = "/myfs/create_unlink";
+static const int32_t kMaxThreads = 64;
+
+
+struct worker {
+	char			directory[FSSH_B_PATH_NAME_LENGTH];
+	int32_t			index;
+	int32_t			files;
+	fssh_status_t	status;
+};
+
+
+static fssh_status_t
+create_unlink_thread(void* data)
+{
+	worker* info = (worker*)data;
+	char path[FSSH_B_PATH_NAME_LENGTH];
+
+	for (int32_t i = 0; i < info->files; i++) {
+		fssh_snprintf(path, sizeof(path), "%s/file-%d-%d", info->directory,
+			(int)info->index, (int)i);
+
+		int fd = _kern_open(-1, path,
+			FSSH_O_WRONLY | FSSH_O_CREAT | FSSH_O_EXCL, 0644);
+		if (fd < 0)
+			return info->status = fd;
+
+		_kern_close(fd);
+	}
+
+	for (int32_t i = 0; i < info->files; i++) {
+		fssh_snprintf(path, sizeof(path), "%s/file-%d-%d", info->directory,
+			(int)info->index, (int)i);
+
+		fssh_status_t status = _kern_unlink(-1, path);
+		if (status != FSSH_B_OK)
+			return info->status = status;
+	}
+
+	return info->status = FSSH_B_OK;
+}
+
+
+/*!	Runs one round with \a threadCount threads, and returns the time it took
+	in microseconds.
+*/
+static fssh_bigtime_t
+run_threads(int32_t threadCount, int32_t files, bool shared,
+	fssh_status_t& status)
+{
+	worker workers[kMaxThreads];
+	fssh_thread_id threads[kMaxThreads];
+
+	status = FSSH_B_OK;
+
+	for (int32_t i = 0; i < threadCount; i++) {
+		worker& info = workers[i];
+		if (shared) {
+			fssh_strlcpy(info.directory, kBaseDirectory,
+				sizeof(info.directory));
+		} else {
+			fssh_snprintf(info.directory, sizeof(info.directory), "%s/%d",
+				kBaseDirectory, (int)i);
+			status = _kern_create_dir(-1, info.directory, 0755);
+			if (status != FSSH_B_OK)
+				return 0;
+		}
+
+		info.index = i;
+		info.files = files;
+		info.status = FSSH_B_OK;
+	}
+
+	fssh_bigtime_t start = fssh_system_time();
+
+	for (int32_t i = 0; i < threadCount; i++) {
+		threads[i] = fssh_spawn_thread(&create_unlink_thread, "create unlink",
+			FSSH_B_NORMAL_PRIORITY, &workers[i]);
+		if (threads[i] < 0) {
+			// just do it ourselves
+			create_unlink_thread(&workers[i]);
+		} else
+			fssh_resume_thread(threads[i]);
+	}
+
+	for (int32_t i = 0; i < threadCount; i++) {
+		if (threads[i] >= 0)
+			fssh_wait_for_thread(threads[i], NULL);
+	}
+
+	fssh_bigtime_t time = fssh_system_time() - start;
+
+	for (int32_t i = 0; i < threadCount; i++) {
+		if (workers[i].status != FSSH_B_OK)
+			status = workers[i].status;
+		if (!shared)
+			_kern_remove_dir(-1, workers[i].directory);
+	}
+
+	return time;
+}
+
+
+fssh_status_t
+command_create_unlink(int argc, const char* const* argv)
+{
+	int32_t maxThreads = 8;
+	int32_t files = 1000;
+	bool shared = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (!fssh_strcmp(argv[i], "-s"))
+			shared = true;
+		else if (!fssh_strcmp(argv[i], "-n") && i + 1 < argc)
+			files = atoi(argv[++i]);
+		else if (argv[i][0] != '-')
+			maxThreads = atoi(argv[i]);
+		else {
+			fssh_dprintf("Usage: %s [-s] [-n <files>] [<max threads>]\n"
+				"  -s  All threads share the same directory\n"
+				"  -n  The number of files each thread creates and removes "
+					"(default 1000)\n", argv[0]);
+			return FSSH_B_OK;
+		}
+	}
+
+	if (maxThreads < 1 || maxThreads > kMaxThreads || files < 1) {
+		fssh_dprintf("Error: Between 1 and %d threads are supported.\n",
+			(int)kMaxThreads);
+		return FSSH_B_BAD_VALUE;
+	}
+
+	fssh_status_t status = _kern_create_dir(-1, kBaseDirectory, 0755);
+	if (status != FSSH_B_OK) {
+		fssh_dprintf("Error: Could not create \"%s\": %s\n", kBaseDirectory,
+			fssh_strerror(status));
+		return status;
+	}
+
+	fssh_dprintf("threads  operations/s\n");
+
+	for (int32_t threadCount = 1; threadCount <= maxThreads;
+			threadCount *= 2) {
+		fssh_bigtime_t time = run_threads(threadCount, files, shared, status);
+		if (status != FSSH_B_OK) {
+			fssh_dprintf("Error: Run with %d threads failed: %s\n",
+				(int)threadCount, fssh_strerror(status));
+			break;
+		}
+
+		// every file is created and removed again
+		double operations = 2.0 * files * threadCount;
+		fssh_dprintf("%7d  %12.0f\n", (int)threadCount,
+			operations * 1000000 / (time > 0 ? time : 1));
+	}
+
+	_kern_remove_dir(-1, kBaseDirectory);
+	return status;
+}
+
+
+}	// namespace FSShell
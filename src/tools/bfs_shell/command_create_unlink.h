@@ -0,0 +1,21 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef CREATE_UNLINK_H
+#define CREATE_UNLINK_H
+
+
+#include "fssh_types.h"
+
+
+namespace FSShell {
+
+
+fssh_status_t command_create_unlink(int argc, const char* const* argv);
+
+
+}	// namespace FSShell
+
+
+#endif	// CREATE_UNLINK_H
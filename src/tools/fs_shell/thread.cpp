@@ -12,6 +12,14 @@
 #include "fssh_errors.h"
 
 
+fssh_thread_id
+fssh_spawn_thread(fssh_thread_func function, const char *name,
+	int32_t priority, void *data)
+{
+	return spawn_thread((thread_func)function, name, priority, data);
+}
+
+
 fssh_status_t
 fssh_kill_thread(fssh_thread_id thread)
 {
@@ -33,6 +41,18 @@ fssh_suspend_thread(fssh_thread_id thread)
 }
 
 
+fssh_status_t
+fssh_wait_for_thread(fssh_thread_id thread, fssh_status_t *_returnValue)
+{
+	status_t returnValue;
+	status_t status = wait_for_thread(thread, &returnValue);
+	if (_returnValue != NULL)
+		*_returnValue = returnValue;
+
+	return status;
+}
+
+
 fssh_thread_id 
 fssh_find_thread(const char *name)
 {